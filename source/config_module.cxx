@@ -4,6 +4,7 @@
 #include "rnCrowdAgent.h"
 #include "rnNavMesh.h"
 #include "rnNavMeshManager.h"
+#include "rnNavMeshQuery.h"
 
 
 Configure( config_recastnavigation );
@@ -26,6 +27,7 @@ init_librecastnavigation() {
   RNNavMesh::init_type();
   RNCrowdAgent::init_type();
   RNNavMeshManager::init_type();
+  RNNavMeshQuery::init_type();
   RNNavMesh::register_with_read_factory();
   RNCrowdAgent::register_with_read_factory();
 
@@ -50,6 +50,30 @@ static const int MAX_ITERS_PER_UPDATE = 100;
 
 static const int MAX_PATHQUEUE_NODES = 4096;
 static const int MAX_COMMON_NODES = 512;
+static const int MIN_PARALLEL_AGENTS = 32;
+
+// The per agent phases of dtCrowd::update(), run by dtCrowd::runPhase().
+enum dtCrowdUpdatePhase
+{
+	DT_CROWD_PHASE_NEIGHBOURS,
+	DT_CROWD_PHASE_CORNERS,
+	DT_CROWD_PHASE_STEERING,
+	DT_CROWD_PHASE_VELOCITY_PLANNING,
+	DT_CROWD_PHASE_INTEGRATE,
+	DT_CROWD_PHASE_COLLISION_DISP,
+	DT_CROWD_PHASE_COLLISION_APPLY,
+	DT_CROWD_PHASE_MOVE
+};
+
+struct dtCrowdPhaseContext
+{
+	dtCrowd* crowd;
+	int phase;
+	dtCrowdAgent** agents;
+	int nagents;
+	float dt;
+	dtCrowdAgentDebugInfo* debug;
+};
 
 inline float tween(const float t, const float t0, const float t1)
 {
@@ -340,7 +364,13 @@ dtCrowd::dtCrowd() :
 	m_maxPathResult(0),
 	m_maxAgentRadius(0),
 	m_velocitySampleCount(0),
-	m_navquery(0)
+	m_navquery(0),
+	m_parallelFor(0),
+	m_parallelForContext(0),
+	m_numWorkers(1),
+	m_workerNavqueries(0),
+	m_workerObstacleQueries(0),
+	m_workerSampleCounts(0)
 {
 }
 
@@ -349,8 +379,31 @@ dtCrowd::~dtCrowd()
 	purge();
 }
 
+void dtCrowd::purgeWorkers()
+{
+	// Worker 0 uses the crowd's own queries.
+	for (int i = 1; i < m_numWorkers; ++i)
+	{
+		if (m_workerNavqueries)
+			dtFreeNavMeshQuery(m_workerNavqueries[i]);
+		if (m_workerObstacleQueries)
+			dtFreeObstacleAvoidanceQuery(m_workerObstacleQueries[i]);
+	}
+	dtFree(m_workerNavqueries);
+	m_workerNavqueries = 0;
+	dtFree(m_workerObstacleQueries);
+	m_workerObstacleQueries = 0;
+	dtFree(m_workerSampleCounts);
+	m_workerSampleCounts = 0;
+	m_numWorkers = 1;
+	m_parallelFor = 0;
+	m_parallelForContext = 0;
+}
+
 void dtCrowd::purge()
 {
+	purgeWorkers();
+
 	for (int i = 0; i < m_maxAgents; ++i)
 		m_agents[i].~dtCrowdAgent();
 	dtFree(m_agents);
@@ -461,6 +514,55 @@ bool dtCrowd::init(const int maxAgents, const float maxAgentRadius, dtNavMesh* n
 	return true;
 }
 
+/// @par
+///
+/// The per agent phases of #update (neighbours gathering, corners finding and
+/// path visibility optimization, steering, velocity planning, integration,
+/// collision resolution and movement along the navigation mesh) only write the
+/// data of their own agent, so they can be run over the agents in any order:
+/// the results are the same as the serial update, regardless of the number of
+/// workers.
+/// Each worker gets its own navigation mesh query and obstacle avoidance query.
+bool dtCrowd::setParallelFor(dtCrowdParallelForFunc func, void* userContext, const int numWorkers)
+{
+	purgeWorkers();
+	if (!func || numWorkers <= 1 || !m_navquery || !m_obstacleQuery)
+		return true;
+
+	m_workerNavqueries = (dtNavMeshQuery**)dtAlloc(sizeof(dtNavMeshQuery*)*numWorkers, DT_ALLOC_PERM);
+	m_workerObstacleQueries = (dtObstacleAvoidanceQuery**)dtAlloc(sizeof(dtObstacleAvoidanceQuery*)*numWorkers, DT_ALLOC_PERM);
+	m_workerSampleCounts = (int*)dtAlloc(sizeof(int)*numWorkers, DT_ALLOC_PERM);
+	if (!m_workerNavqueries || !m_workerObstacleQueries || !m_workerSampleCounts)
+	{
+		purgeWorkers();
+		return false;
+	}
+	memset(m_workerNavqueries, 0, sizeof(dtNavMeshQuery*)*numWorkers);
+	memset(m_workerObstacleQueries, 0, sizeof(dtObstacleAvoidanceQuery*)*numWorkers);
+	m_numWorkers = numWorkers;
+	m_workerNavqueries[0] = m_navquery;
+	m_workerObstacleQueries[0] = m_obstacleQuery;
+	for (int i = 1; i < m_numWorkers; ++i)
+	{
+		m_workerNavqueries[i] = dtAllocNavMeshQuery();
+		if (!m_workerNavqueries[i] ||
+			dtStatusFailed(m_workerNavqueries[i]->init(m_navquery->getAttachedNavMesh(), MAX_COMMON_NODES)))
+		{
+			purgeWorkers();
+			return false;
+		}
+		m_workerObstacleQueries[i] = dtAllocObstacleAvoidanceQuery();
+		if (!m_workerObstacleQueries[i] || !m_workerObstacleQueries[i]->init(6, 8))
+		{
+			purgeWorkers();
+			return false;
+		}
+	}
+	m_parallelFor = func;
+	m_parallelForContext = userContext;
+	return true;
+}
+
 void dtCrowd::setObstacleAvoidanceParams(const int idx, const dtObstacleAvoidanceParams* params)
 {
 	if (idx >= 0 && idx < DT_CROWD_MAX_OBSTAVOIDANCE_PARAMS)
@@ -1047,8 +1149,6 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 {
 	m_velocitySampleCount = 0;
 	
-	const int debugIdx = debug ? debug->idx : -1;
-	
 	dtCrowdAgent** agents = m_activeAgents;
 	int nagents = getActiveAgents(agents, m_maxAgents);
 
@@ -1072,20 +1172,173 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 	}
 	
 	// Get nearby navmesh segments and agents to collide with.
+	runPhase(DT_CROWD_PHASE_NEIGHBOURS, agents, nagents, dt, debug);
+	
+	// Find next corner to steer to.
+	runPhase(DT_CROWD_PHASE_CORNERS, agents, nagents, dt, debug);
+	
+	// Trigger off-mesh connections (depends on corners).
 	for (int i = 0; i < nagents; ++i)
 	{
 		dtCrowdAgent* ag = agents[i];
+		
 		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
 			continue;
+		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+			continue;
+		
+		// Check 
+		const float triggerRadius = ag->params.radius*2.25f;
+		if (overOffmeshConnection(ag, triggerRadius))
+		{
+			// Prepare to off-mesh connection.
+			const int idx = (int)(ag - m_agents);
+			dtCrowdAgentAnimation* anim = &m_agentAnims[idx];
+			
+			// Adjust the path over the off-mesh connection.
+			dtPolyRef refs[2];
+			if (ag->corridor.moveOverOffmeshConnection(ag->cornerPolys[ag->ncorners-1], refs,
+													   anim->startPos, anim->endPos, m_navquery))
+			{
+				dtVcopy(anim->initPos, ag->npos);
+				anim->polyRef = refs[1];
+				anim->active = true;
+				anim->t = 0.0f;
+				anim->tmax = (dtVdist2D(anim->startPos, anim->endPos) / ag->params.maxSpeed) * 0.5f;
+				
+				ag->state = DT_CROWDAGENT_STATE_OFFMESH;
+				ag->ncorners = 0;
+				ag->nneis = 0;
+				continue;
+			}
+			else
+			{
+				// Path validity check will ensure that bad/blocked connections will be replanned.
+			}
+		}
+	}
+		
+	// Calculate steering.
+	runPhase(DT_CROWD_PHASE_STEERING, agents, nagents, dt, debug);
+	
+	// Velocity planning.	
+	runPhase(DT_CROWD_PHASE_VELOCITY_PLANNING, agents, nagents, dt, debug);
+	for (int i = 0; i < m_numWorkers; ++i)
+		m_velocitySampleCount += m_workerSampleCounts ? m_workerSampleCounts[i] : 0;
 
+	// Integrate.
+	runPhase(DT_CROWD_PHASE_INTEGRATE, agents, nagents, dt, debug);
+	
+	// Handle collisions.
+	for (int iter = 0; iter < 4; ++iter)
+	{
+		runPhase(DT_CROWD_PHASE_COLLISION_DISP, agents, nagents, dt, debug);
+		runPhase(DT_CROWD_PHASE_COLLISION_APPLY, agents, nagents, dt, debug);
+	}
+	
+	// Move along navmesh.
+	runPhase(DT_CROWD_PHASE_MOVE, agents, nagents, dt, debug);
+	
+	// Update agents using off-mesh connection.
+	for (int i = 0; i < m_maxAgents; ++i)
+	{
+		dtCrowdAgentAnimation* anim = &m_agentAnims[i];
+		if (!anim->active)
+			continue;
+		dtCrowdAgent* ag = agents[i];
+
+		anim->t += dt;
+		if (anim->t > anim->tmax)
+		{
+			// Reset animation
+			anim->active = false;
+			// Prepare agent for walking.
+			ag->state = DT_CROWDAGENT_STATE_WALKING;
+			continue;
+		}
+		
+		// Update position
+		const float ta = anim->tmax*0.15f;
+		const float tb = anim->tmax;
+		if (anim->t < ta)
+		{
+			const float u = tween(anim->t, 0.0, ta);
+			dtVlerp(ag->npos, anim->initPos, anim->startPos, u);
+		}
+		else
+		{
+			const float u = tween(anim->t, ta, tb);
+			dtVlerp(ag->npos, anim->startPos, anim->endPos, u);
+		}
+			
+		// Update velocity.
+		dtVset(ag->vel, 0,0,0);
+		dtVset(ag->dvel, 0,0,0);
+	}
+	
+}
+
+void dtCrowd::runPhase(const int phase, dtCrowdAgent** agents, const int nagents,
+					   const float dt, dtCrowdAgentDebugInfo* debug)
+{
+	if (m_workerSampleCounts)
+		memset(m_workerSampleCounts, 0, sizeof(int)*m_numWorkers);
+
+	if (m_parallelFor && nagents >= MIN_PARALLEL_AGENTS)
+	{
+		dtCrowdPhaseContext ctx;
+		ctx.crowd = this;
+		ctx.phase = phase;
+		ctx.agents = agents;
+		ctx.nagents = nagents;
+		ctx.dt = dt;
+		ctx.debug = debug;
+		m_parallelFor(m_parallelForContext, nagents, runPhaseJob, &ctx);
+	}
+	else
+	{
+		for (int i = 0; i < nagents; ++i)
+			updateAgentPhase(phase, agents, nagents, i, 0, dt, debug);
+	}
+}
+
+void dtCrowd::runPhaseJob(void* jobContext, const int index, const int worker)
+{
+	const dtCrowdPhaseContext* ctx = (const dtCrowdPhaseContext*)jobContext;
+	ctx->crowd->updateAgentPhase(ctx->phase, ctx->agents, ctx->nagents, index, worker,
+								 ctx->dt, ctx->debug);
+}
+
+/// @par
+///
+/// A phase may read the data of the other agents, but only writes the data of
+/// agents[i], so that all the agents can be updated concurrently.
+void dtCrowd::updateAgentPhase(const int phase, dtCrowdAgent** agents, const int nagents,
+							   const int i, const int worker, const float dt,
+							   dtCrowdAgentDebugInfo* debug)
+{
+	static const float COLLISION_RESOLVE_FACTOR = 0.7f;
+
+	const int debugIdx = debug ? debug->idx : -1;
+	dtCrowdAgent* ag = agents[i];
+	dtNavMeshQuery* navquery = m_workerNavqueries ? m_workerNavqueries[worker] : m_navquery;
+	const dtQueryFilter* filter = &m_filters[ag->params.queryFilterType];
+
+	if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+		return;
+
+	switch (phase)
+	{
+	case DT_CROWD_PHASE_NEIGHBOURS:
+	{
 		// Update the collision boundary after certain distance has been passed or
 		// if it has become invalid.
 		const float updateThr = ag->params.collisionQueryRange*0.25f;
 		if (dtVdist2DSqr(ag->npos, ag->boundary.getCenter()) > dtSqr(updateThr) ||
-			!ag->boundary.isValid(m_navquery, &m_filters[ag->params.queryFilterType]))
+			!ag->boundary.isValid(navquery, filter))
 		{
 			ag->boundary.update(ag->corridor.getFirstPoly(), ag->npos, ag->params.collisionQueryRange,
-								m_navquery, &m_filters[ag->params.queryFilterType]);
+								navquery, filter);
 		}
 		// Query neighbour agents
 		ag->nneis = getNeighbours(ag->npos, ag->params.height, ag->params.collisionQueryRange,
@@ -1093,28 +1346,23 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 								  agents, nagents, m_grid);
 		for (int j = 0; j < ag->nneis; j++)
 			ag->neis[j].idx = getAgentIndex(agents[ag->neis[j].idx]);
+		break;
 	}
-	
-	// Find next corner to steer to.
-	for (int i = 0; i < nagents; ++i)
+	case DT_CROWD_PHASE_CORNERS:
 	{
-		dtCrowdAgent* ag = agents[i];
-		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
 		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
-			continue;
+			break;
 		
 		// Find corners for steering
 		ag->ncorners = ag->corridor.findCorners(ag->cornerVerts, ag->cornerFlags, ag->cornerPolys,
-												DT_CROWDAGENT_MAX_CORNERS, m_navquery, &m_filters[ag->params.queryFilterType]);
+												DT_CROWDAGENT_MAX_CORNERS, navquery, filter);
 		
 		// Check to see if the corner after the next corner is directly visible,
 		// and short cut to there.
 		if ((ag->params.updateFlags & DT_CROWD_OPTIMIZE_VIS) && ag->ncorners > 0)
 		{
 			const float* target = &ag->cornerVerts[dtMin(1,ag->ncorners-1)*3];
-			ag->corridor.optimizePathVisibility(target, ag->params.pathOptimizationRange, m_navquery, &m_filters[ag->params.queryFilterType]);
+			ag->corridor.optimizePathVisibility(target, ag->params.pathOptimizationRange, navquery, filter);
 			
 			// Copy data for debug purposes.
 			if (debugIdx == i)
@@ -1132,58 +1380,12 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 				dtVset(debug->optEnd, 0,0,0);
 			}
 		}
+		break;
 	}
-	
-	// Trigger off-mesh connections (depends on corners).
-	for (int i = 0; i < nagents; ++i)
+	case DT_CROWD_PHASE_STEERING:
 	{
-		dtCrowdAgent* ag = agents[i];
-		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
-			continue;
-		
-		// Check 
-		const float triggerRadius = ag->params.radius*2.25f;
-		if (overOffmeshConnection(ag, triggerRadius))
-		{
-			// Prepare to off-mesh connection.
-			const int idx = (int)(ag - m_agents);
-			dtCrowdAgentAnimation* anim = &m_agentAnims[idx];
-			
-			// Adjust the path over the off-mesh connection.
-			dtPolyRef refs[2];
-			if (ag->corridor.moveOverOffmeshConnection(ag->cornerPolys[ag->ncorners-1], refs,
-													   anim->startPos, anim->endPos, m_navquery))
-			{
-				dtVcopy(anim->initPos, ag->npos);
-				anim->polyRef = refs[1];
-				anim->active = true;
-				anim->t = 0.0f;
-				anim->tmax = (dtVdist2D(anim->startPos, anim->endPos) / ag->params.maxSpeed) * 0.5f;
-				
-				ag->state = DT_CROWDAGENT_STATE_OFFMESH;
-				ag->ncorners = 0;
-				ag->nneis = 0;
-				continue;
-			}
-			else
-			{
-				// Path validity check will ensure that bad/blocked connections will be replanned.
-			}
-		}
-	}
-		
-	// Calculate steering.
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
 		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE)
-			continue;
+			break;
 		
 		float dvel[3] = {0,0,0};
 
@@ -1252,25 +1454,21 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 		
 		// Set the desired velocity.
 		dtVcopy(ag->dvel, dvel);
+		break;
 	}
-	
-	// Velocity planning.	
-	for (int i = 0; i < nagents; ++i)
+	case DT_CROWD_PHASE_VELOCITY_PLANNING:
 	{
-		dtCrowdAgent* ag = agents[i];
-		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		
 		if (ag->params.updateFlags & DT_CROWD_OBSTACLE_AVOIDANCE)
 		{
-			m_obstacleQuery->reset();
+			dtObstacleAvoidanceQuery* obstacleQuery =
+				m_workerObstacleQueries ? m_workerObstacleQueries[worker] : m_obstacleQuery;
+			obstacleQuery->reset();
 			
 			// Add neighbours as obstacles.
 			for (int j = 0; j < ag->nneis; ++j)
 			{
 				const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
-				m_obstacleQuery->addCircle(nei->npos, nei->params.radius, nei->vel, nei->dvel);
+				obstacleQuery->addCircle(nei->npos, nei->params.radius, nei->vel, nei->dvel);
 			}
 
 			// Append neighbour segments as obstacles.
@@ -1279,7 +1477,7 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 				const float* s = ag->boundary.getSegment(j);
 				if (dtTriArea2D(ag->npos, s, s+3) < 0.0f)
 					continue;
-				m_obstacleQuery->addSegment(s, s+3);
+				obstacleQuery->addSegment(s, s+3);
 			}
 
 			dtObstacleAvoidanceDebugData* vod = 0;
@@ -1294,107 +1492,88 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 				
 			if (adaptive)
 			{
-				ns = m_obstacleQuery->sampleVelocityAdaptive(ag->npos, ag->params.radius, ag->desiredSpeed,
-															 ag->vel, ag->dvel, ag->nvel, params, vod);
+				ns = obstacleQuery->sampleVelocityAdaptive(ag->npos, ag->params.radius, ag->desiredSpeed,
+														   ag->vel, ag->dvel, ag->nvel, params, vod);
 			}
 			else
 			{
-				ns = m_obstacleQuery->sampleVelocityGrid(ag->npos, ag->params.radius, ag->desiredSpeed,
-														 ag->vel, ag->dvel, ag->nvel, params, vod);
+				ns = obstacleQuery->sampleVelocityGrid(ag->npos, ag->params.radius, ag->desiredSpeed,
+													   ag->vel, ag->dvel, ag->nvel, params, vod);
 			}
-			m_velocitySampleCount += ns;
+			if (m_workerSampleCounts)
+				m_workerSampleCounts[worker] += ns;
+			else
+				m_velocitySampleCount += ns;
 		}
 		else
 		{
 			// If not using velocity planning, new velocity is directly the desired velocity.
 			dtVcopy(ag->nvel, ag->dvel);
 		}
+		break;
 	}
-
-	// Integrate.
-	for (int i = 0; i < nagents; ++i)
+	case DT_CROWD_PHASE_INTEGRATE:
 	{
-		dtCrowdAgent* ag = agents[i];
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
 		integrate(ag, dt);
+		break;
 	}
-	
-	// Handle collisions.
-	static const float COLLISION_RESOLVE_FACTOR = 0.7f;
-	
-	for (int iter = 0; iter < 4; ++iter)
+	case DT_CROWD_PHASE_COLLISION_DISP:
 	{
-		for (int i = 0; i < nagents; ++i)
+		const int idx0 = getAgentIndex(ag);
+		
+		dtVset(ag->disp, 0,0,0);
+		
+		float w = 0;
+
+		for (int j = 0; j < ag->nneis; ++j)
 		{
-			dtCrowdAgent* ag = agents[i];
-			const int idx0 = getAgentIndex(ag);
-			
-			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-				continue;
+			const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+			const int idx1 = getAgentIndex(nei);
 
-			dtVset(ag->disp, 0,0,0);
+			float diff[3];
+			dtVsub(diff, ag->npos, nei->npos);
+			diff[1] = 0;
 			
-			float w = 0;
-
-			for (int j = 0; j < ag->nneis; ++j)
+			float dist = dtVlenSqr(diff);
+			if (dist > dtSqr(ag->params.radius + nei->params.radius))
+				continue;
+			dist = dtMathSqrtf(dist);
+			float pen = (ag->params.radius + nei->params.radius) - dist;
+			if (dist < 0.0001f)
 			{
-				const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
-				const int idx1 = getAgentIndex(nei);
-
-				float diff[3];
-				dtVsub(diff, ag->npos, nei->npos);
-				diff[1] = 0;
-				
-				float dist = dtVlenSqr(diff);
-				if (dist > dtSqr(ag->params.radius + nei->params.radius))
-					continue;
-				dist = dtMathSqrtf(dist);
-				float pen = (ag->params.radius + nei->params.radius) - dist;
-				if (dist < 0.0001f)
-				{
-					// Agents on top of each other, try to choose diverging separation directions.
-					if (idx0 > idx1)
-						dtVset(diff, -ag->dvel[2],0,ag->dvel[0]);
-					else
-						dtVset(diff, ag->dvel[2],0,-ag->dvel[0]);
-					pen = 0.01f;
-				}
+				// Agents on top of each other, try to choose diverging separation directions.
+				if (idx0 > idx1)
+					dtVset(diff, -ag->dvel[2],0,ag->dvel[0]);
 				else
-				{
-					pen = (1.0f/dist) * (pen*0.5f) * COLLISION_RESOLVE_FACTOR;
-				}
-				
-				dtVmad(ag->disp, ag->disp, diff, pen);			
-				
-				w += 1.0f;
+					dtVset(diff, ag->dvel[2],0,-ag->dvel[0]);
+				pen = 0.01f;
 			}
-			
-			if (w > 0.0001f)
+			else
 			{
-				const float iw = 1.0f / w;
-				dtVscale(ag->disp, ag->disp, iw);
+				pen = (1.0f/dist) * (pen*0.5f) * COLLISION_RESOLVE_FACTOR;
 			}
+			
+			dtVmad(ag->disp, ag->disp, diff, pen);			
+			
+			w += 1.0f;
 		}
 		
-		for (int i = 0; i < nagents; ++i)
+		if (w > 0.0001f)
 		{
-			dtCrowdAgent* ag = agents[i];
-			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-				continue;
-			
-			dtVadd(ag->npos, ag->npos, ag->disp);
+			const float iw = 1.0f / w;
+			dtVscale(ag->disp, ag->disp, iw);
 		}
+		break;
 	}
-	
-	for (int i = 0; i < nagents; ++i)
+	case DT_CROWD_PHASE_COLLISION_APPLY:
+	{
+		dtVadd(ag->npos, ag->npos, ag->disp);
+		break;
+	}
+	case DT_CROWD_PHASE_MOVE:
 	{
-		dtCrowdAgent* ag = agents[i];
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		
 		// Move along navmesh.
-		ag->corridor.movePosition(ag->npos, m_navquery, &m_filters[ag->params.queryFilterType]);
+		ag->corridor.movePosition(ag->npos, navquery, filter);
 		// Get valid constrained position back.
 		dtVcopy(ag->npos, ag->corridor.getPos());
 
@@ -1404,44 +1583,9 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 			ag->corridor.reset(ag->corridor.getFirstPoly(), ag->npos);
 			ag->partial = false;
 		}
-
+		break;
 	}
-	
-	// Update agents using off-mesh connection.
-	for (int i = 0; i < m_maxAgents; ++i)
-	{
-		dtCrowdAgentAnimation* anim = &m_agentAnims[i];
-		if (!anim->active)
-			continue;
-		dtCrowdAgent* ag = agents[i];
-
-		anim->t += dt;
-		if (anim->t > anim->tmax)
-		{
-			// Reset animation
-			anim->active = false;
-			// Prepare agent for walking.
-			ag->state = DT_CROWDAGENT_STATE_WALKING;
-			continue;
-		}
-		
-		// Update position
-		const float ta = anim->tmax*0.15f;
-		const float tb = anim->tmax;
-		if (anim->t < ta)
-		{
-			const float u = tween(anim->t, 0.0, ta);
-			dtVlerp(ag->npos, anim->initPos, anim->startPos, u);
-		}
-		else
-		{
-			const float u = tween(anim->t, ta, tb);
-			dtVlerp(ag->npos, anim->startPos, anim->endPos, u);
-		}
-			
-		// Update velocity.
-		dtVset(ag->vel, 0,0,0);
-		dtVset(ag->dvel, 0,0,0);
+	default:
+		break;
 	}
-	
 }
@@ -198,6 +198,25 @@ struct dtCrowdAgentDebugInfo
 	dtObstacleAvoidanceDebugData* vod;
 };
 
+/// A job run by a parallel loop for an item.
+///  @param[in]		jobContext	The job's data.
+///  @param[in]		index		The item index.
+///  @param[in]		worker		The number of the worker running the job.
+/// @ingroup crowd
+typedef void (*dtCrowdJobFunc)(void* jobContext, const int index, const int worker);
+
+/// Runs a job for each item index in [0, count), possibly in parallel, and
+/// returns when all of them are done.
+/// The worker numbers passed to the job must be in [0, numWorkers), where
+/// numWorkers is the value given to dtCrowd::setParallelFor().
+///  @param[in]		userContext	The context given to dtCrowd::setParallelFor().
+///  @param[in]		count		The number of items.
+///  @param[in]		job			The job to run for each item.
+///  @param[in]		jobContext	The job's data.
+/// @ingroup crowd
+typedef void (*dtCrowdParallelForFunc)(void* userContext, const int count,
+									   dtCrowdJobFunc job, void* jobContext);
+
 /// Provides local steering behaviors for a group of agents. 
 /// @ingroup crowd
 class dtCrowd
@@ -227,6 +246,13 @@ class dtCrowd
 
 	dtNavMeshQuery* m_navquery;
 
+	dtCrowdParallelForFunc m_parallelFor;
+	void* m_parallelForContext;
+	int m_numWorkers;
+	dtNavMeshQuery** m_workerNavqueries;
+	dtObstacleAvoidanceQuery** m_workerObstacleQueries;
+	int* m_workerSampleCounts;
+
 	void updateTopologyOptimization(dtCrowdAgent** agents, const int nagents, const float dt);
 	void updateMoveRequest(const float dt);
 	void checkPathValidity(dtCrowdAgent** agents, const int nagents, const float dt);
@@ -235,6 +261,14 @@ class dtCrowd
 
 	bool requestMoveTargetReplan(const int idx, dtPolyRef ref, const float* pos);
 
+	void runPhase(const int phase, dtCrowdAgent** agents, const int nagents,
+				  const float dt, dtCrowdAgentDebugInfo* debug);
+	static void runPhaseJob(void* jobContext, const int index, const int worker);
+	void updateAgentPhase(const int phase, dtCrowdAgent** agents, const int nagents,
+						  const int i, const int worker, const float dt,
+						  dtCrowdAgentDebugInfo* debug);
+
+	void purgeWorkers();
 	void purge();
 	
 public:
@@ -316,6 +350,18 @@ public:
 	///  @param[in]		dt		The time, in seconds, to update the simulation. [Limit: > 0]
 	///  @param[out]	debug	A debug object to load with debug information. [Opt]
 	void update(const float dt, dtCrowdAgentDebugInfo* debug);
+
+	/// Sets the function used to run the per agent phases of #update in parallel.
+	/// Must be called after #init, which resets it.
+	///  @param[in]		func		The parallel loop function, or null to update serially.
+	///  @param[in]		userContext	The context passed to @p func.
+	///  @param[in]		numWorkers	The number of workers used by @p func. [Limit: >= 1]
+	/// @return True if the per worker queries were successfully allocated.
+	bool setParallelFor(dtCrowdParallelForFunc func, void* userContext, const int numWorkers);
+
+	/// Gets the number of workers of the parallel update.
+	/// @return The number of workers (1 if the update is serial).
+	int getNumWorkers() const { return m_numWorkers; }
 	
 	/// Gets the filter used by the crowd.
 	/// @return The filter used by the crowd.
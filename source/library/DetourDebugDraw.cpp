@@ -258,6 +258,68 @@ void duDebugDrawNavMeshWithClosedList(struct duDebugDraw* dd, const dtNavMesh& m
 	}
 }
 
+void duDebugDrawNavMeshTile(duDebugDraw* dd, const dtNavMesh& mesh, const dtMeshTile* tile, unsigned char flags)
+{
+	if (!dd || !tile || !tile->header) return;
+
+	drawMeshTile(dd, mesh, 0, tile, flags);
+}
+
+void duDebugDrawNavMeshClosedList(duDebugDraw* dd, const dtNavMesh& mesh, const dtNavMeshQuery& query)
+{
+	if (!dd) return;
+
+	const dtNodePool* pool = query.getNodePool();
+	if (!pool) return;
+
+	// Same color as the closed polys of duDebugDrawNavMeshWithClosedList.
+	const unsigned int col = duRGBA(255,196,0,64);
+
+	dd->depthMask(false);
+
+	dd->begin(DU_DRAW_TRIS);
+	for (int i = 0; i < pool->getHashSize(); ++i)
+	{
+		for (dtNodeIndex j = pool->getFirst(i); j != DT_NULL_IDX; j = pool->getNext(j))
+		{
+			const dtNode* node = pool->getNodeAtIdx(j+1);
+			if (!node || !(node->flags & DT_NODE_CLOSED)) continue;
+			// Draw each poly once, for the first of its closed nodes (states),
+			// which are all in the same bucket.
+			bool drawn = false;
+			for (dtNodeIndex k = pool->getFirst(i); k != j && !drawn; k = pool->getNext(k))
+			{
+				const dtNode* other = pool->getNodeAtIdx(k+1);
+				drawn = other && other->id == node->id && (other->flags & DT_NODE_CLOSED);
+			}
+			if (drawn) continue;
+
+			const dtMeshTile* tile = 0;
+			const dtPoly* poly = 0;
+			if (dtStatusFailed(mesh.getTileAndPolyByRef(node->id, &tile, &poly)))
+				continue;
+			if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION) continue;
+
+			const unsigned int ip = (unsigned int)(poly - tile->polys);
+			const dtPolyDetail* pd = &tile->detailMeshes[ip];
+			for (int k = 0; k < pd->triCount; ++k)
+			{
+				const unsigned char* t = &tile->detailTris[(pd->triBase+k)*4];
+				for (int m = 0; m < 3; ++m)
+				{
+					if (t[m] < poly->vertCount)
+						dd->vertex(&tile->verts[poly->verts[t[m]]*3], col);
+					else
+						dd->vertex(&tile->detailVerts[(pd->vertBase+t[m]-poly->vertCount)*3], col);
+				}
+			}
+		}
+	}
+	dd->end();
+
+	dd->depthMask(true);
+}
+
 void duDebugDrawNavMeshNodes(struct duDebugDraw* dd, const dtNavMeshQuery& query)
 {
 	if (!dd) return;
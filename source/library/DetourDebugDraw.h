@@ -32,6 +32,10 @@ enum DrawNavMeshFlags
 
 void duDebugDrawNavMesh(struct duDebugDraw* dd, const dtNavMesh& mesh, unsigned char flags);
 void duDebugDrawNavMeshWithClosedList(struct duDebugDraw* dd, const dtNavMesh& mesh, const dtNavMeshQuery& query, unsigned char flags);
+/// Draws a single tile, as duDebugDrawNavMesh does (DU_DRAWNAVMESH_CLOSEDLIST is ignored).
+void duDebugDrawNavMeshTile(struct duDebugDraw* dd, const dtNavMesh& mesh, const dtMeshTile* tile, unsigned char flags);
+/// Draws only the polys in the query's closed list, to be drawn over the tiles.
+void duDebugDrawNavMeshClosedList(struct duDebugDraw* dd, const dtNavMesh& mesh, const dtNavMeshQuery& query);
 void duDebugDrawNavMeshNodes(struct duDebugDraw* dd, const dtNavMeshQuery& query);
 void duDebugDrawNavMeshBVTree(struct duDebugDraw* dd, const dtNavMesh& mesh);
 void duDebugDrawNavMeshPortals(struct duDebugDraw* dd, const dtNavMesh& mesh);
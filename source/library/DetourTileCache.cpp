@@ -435,6 +435,71 @@ dtStatus dtTileCache::removeObstacle(const dtObstacleRef ref)
 	return DT_SUCCESS;
 }
 
+dtStatus dtTileCache::moveObstacle(const dtObstacleRef ref, const float* pos)
+{
+	const dtTileCacheObstacle* ob = getObstacleByRef(ref);
+	if (!ob || ob->state == DT_OBSTACLE_EMPTY || ob->state == DT_OBSTACLE_REMOVING)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	
+	// Coalesce with an already requested move.
+	ObstacleRequest* req = 0;
+	for (int i = 0; i < m_nreqs; ++i)
+	{
+		if (m_reqs[i].action == REQUEST_MOVE && m_reqs[i].ref == ref)
+			req = &m_reqs[i];
+	}
+	
+	// Ignore moves shorter than a cell.
+	float cur[3];
+	if (req)
+	{
+		dtVcopy(cur, req->pos);
+	}
+	else if (ob->type == DT_OBSTACLE_CYLINDER)
+	{
+		dtVcopy(cur, ob->cylinder.pos);
+	}
+	else
+	{
+		cur[0] = (ob->box.bmin[0]+ob->box.bmax[0])*0.5f;
+		cur[1] = ob->box.bmin[1];
+		cur[2] = (ob->box.bmin[2]+ob->box.bmax[2])*0.5f;
+	}
+	if (dtMathFabsf(pos[0]-cur[0]) < m_params.cs && dtMathFabsf(pos[2]-cur[2]) < m_params.cs &&
+		dtMathFabsf(pos[1]-cur[1]) < m_params.ch)
+		return DT_SUCCESS;
+	
+	if (!req)
+	{
+		if (m_nreqs >= MAX_REQUESTS)
+			return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+		req = &m_reqs[m_nreqs++];
+		memset(req, 0, sizeof(ObstacleRequest));
+		req->action = REQUEST_MOVE;
+		req->ref = ref;
+	}
+	dtVcopy(req->pos, pos);
+	
+	return DT_SUCCESS;
+}
+
+void dtTileCache::updateObstaclesTouched()
+{
+	for (int i = 0; i < m_params.maxObstacles; ++i)
+	{
+		dtTileCacheObstacle* ob = &m_obstacles[i];
+		if (ob->state == DT_OBSTACLE_EMPTY || ob->state == DT_OBSTACLE_REMOVING)
+			continue;
+		
+		float bmin[3], bmax[3];
+		getObstacleBounds(ob, bmin, bmax);
+		
+		int ntouched = 0;
+		queryTiles(bmin, bmax, ob->touched, &ntouched, DT_MAX_TOUCHED_TILES);
+		ob->ntouched = (unsigned char)ntouched;
+	}
+}
+
 dtStatus dtTileCache::queryTiles(const float* bmin, const float* bmax,
 								 dtCompressedTileRef* results, int* resultCount, const int maxResults) const 
 {
@@ -476,116 +541,201 @@ dtStatus dtTileCache::queryTiles(const float* bmin, const float* bmax,
 	return DT_SUCCESS;
 }
 
-dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
-							 bool* upToDate)
+void dtTileCache::processRequests()
 {
-	if (m_nupdate == 0)
+	// Process requests.
+	int i = 0;
+	for (; i < m_nreqs; ++i)
 	{
-		// Process requests.
-		for (int i = 0; i < m_nreqs; ++i)
+		// Leave the remaining requests for the next pass if the update
+		// list could overflow, so no touched tile is left out.
+		// (A move touches the tiles before and after it.)
+		if (m_nupdate + 2*DT_MAX_TOUCHED_TILES > MAX_UPDATE)
+			break;
+		
+		ObstacleRequest* req = &m_reqs[i];
+		
+		unsigned int idx = decodeObstacleIdObstacle(req->ref);
+		if ((int)idx >= m_params.maxObstacles)
+			continue;
+		dtTileCacheObstacle* ob = &m_obstacles[idx];
+		unsigned int salt = decodeObstacleIdSalt(req->ref);
+		if (ob->salt != salt)
+			continue;
+		
+		if (req->action == REQUEST_ADD)
 		{
-			ObstacleRequest* req = &m_reqs[i];
-			
-			unsigned int idx = decodeObstacleIdObstacle(req->ref);
-			if ((int)idx >= m_params.maxObstacles)
-				continue;
-			dtTileCacheObstacle* ob = &m_obstacles[idx];
-			unsigned int salt = decodeObstacleIdSalt(req->ref);
-			if (ob->salt != salt)
+			// Find touched tiles.
+			float bmin[3], bmax[3];
+			getObstacleBounds(ob, bmin, bmax);
+
+			int ntouched = 0;
+			queryTiles(bmin, bmax, ob->touched, &ntouched, DT_MAX_TOUCHED_TILES);
+			ob->ntouched = (unsigned char)ntouched;
+			// Add tiles to update list.
+			ob->npending = 0;
+			for (int j = 0; j < ob->ntouched; ++j)
+			{
+				if (m_nupdate < MAX_UPDATE)
+				{
+					if (!contains(m_update, m_nupdate, ob->touched[j]))
+						m_update[m_nupdate++] = ob->touched[j];
+					ob->pending[ob->npending++] = ob->touched[j];
+				}
+			}
+		}
+		else if (req->action == REQUEST_MOVE)
+		{
+			if (ob->state == DT_OBSTACLE_EMPTY || ob->state == DT_OBSTACLE_REMOVING)
 				continue;
 			
-			if (req->action == REQUEST_ADD)
+			// Add the tiles touched before the move to the update list.
+			ob->npending = 0;
+			for (int j = 0; j < ob->ntouched; ++j)
 			{
-				// Find touched tiles.
-				float bmin[3], bmax[3];
-				getObstacleBounds(ob, bmin, bmax);
-
-				int ntouched = 0;
-				queryTiles(bmin, bmax, ob->touched, &ntouched, DT_MAX_TOUCHED_TILES);
-				ob->ntouched = (unsigned char)ntouched;
-				// Add tiles to update list.
-				ob->npending = 0;
-				for (int j = 0; j < ob->ntouched; ++j)
+				if (m_nupdate < MAX_UPDATE)
 				{
-					if (m_nupdate < MAX_UPDATE)
-					{
-						if (!contains(m_update, m_nupdate, ob->touched[j]))
-							m_update[m_nupdate++] = ob->touched[j];
-						ob->pending[ob->npending++] = ob->touched[j];
-					}
+					if (!contains(m_update, m_nupdate, ob->touched[j]))
+						m_update[m_nupdate++] = ob->touched[j];
+					ob->pending[ob->npending++] = ob->touched[j];
 				}
 			}
-			else if (req->action == REQUEST_REMOVE)
+			
+			// Move.
+			if (ob->type == DT_OBSTACLE_CYLINDER)
+			{
+				dtVcopy(ob->cylinder.pos, req->pos);
+			}
+			else if (ob->type == DT_OBSTACLE_BOX)
 			{
-				// Prepare to remove obstacle.
-				ob->state = DT_OBSTACLE_REMOVING;
-				// Add tiles to update list.
-				ob->npending = 0;
-				for (int j = 0; j < ob->ntouched; ++j)
+				float d[3];
+				d[0] = req->pos[0] - (ob->box.bmin[0]+ob->box.bmax[0])*0.5f;
+				d[1] = req->pos[1] - ob->box.bmin[1];
+				d[2] = req->pos[2] - (ob->box.bmin[2]+ob->box.bmax[2])*0.5f;
+				dtVadd(ob->box.bmin, ob->box.bmin, d);
+				dtVadd(ob->box.bmax, ob->box.bmax, d);
+			}
+			ob->state = DT_OBSTACLE_PROCESSING;
+			
+			// Find the tiles touched after the move and add them too.
+			float bmin[3], bmax[3];
+			getObstacleBounds(ob, bmin, bmax);
+			
+			int ntouched = 0;
+			queryTiles(bmin, bmax, ob->touched, &ntouched, DT_MAX_TOUCHED_TILES);
+			ob->ntouched = (unsigned char)ntouched;
+			for (int j = 0; j < ob->ntouched; ++j)
+			{
+				if (contains(ob->pending, ob->npending, ob->touched[j]))
+					continue;
+				if (m_nupdate < MAX_UPDATE)
 				{
-					if (m_nupdate < MAX_UPDATE)
-					{
-						if (!contains(m_update, m_nupdate, ob->touched[j]))
-							m_update[m_nupdate++] = ob->touched[j];
-						ob->pending[ob->npending++] = ob->touched[j];
-					}
+					if (!contains(m_update, m_nupdate, ob->touched[j]))
+						m_update[m_nupdate++] = ob->touched[j];
+					ob->pending[ob->npending++] = ob->touched[j];
+				}
+			}
+		}
+		else if (req->action == REQUEST_REMOVE)
+		{
+			// Prepare to remove obstacle.
+			ob->state = DT_OBSTACLE_REMOVING;
+			// Add tiles to update list.
+			ob->npending = 0;
+			for (int j = 0; j < ob->ntouched; ++j)
+			{
+				if (m_nupdate < MAX_UPDATE)
+				{
+					if (!contains(m_update, m_nupdate, ob->touched[j]))
+						m_update[m_nupdate++] = ob->touched[j];
+					ob->pending[ob->npending++] = ob->touched[j];
 				}
 			}
 		}
-		
-		m_nreqs = 0;
 	}
 	
-	dtStatus status = DT_SUCCESS;
-	// Process updates
-	if (m_nupdate)
-	{
-		// Build mesh
-		const dtCompressedTileRef ref = m_update[0];
-		status = buildNavMeshTile(ref, navmesh);
-		m_nupdate--;
-		if (m_nupdate > 0)
-			memmove(m_update, m_update+1, m_nupdate*sizeof(dtCompressedTileRef));
+	m_nreqs -= i;
+	if (m_nreqs > 0)
+		memmove(m_reqs, m_reqs+i, m_nreqs*sizeof(ObstacleRequest));
+}
 
-		// Update obstacle states.
-		for (int i = 0; i < m_params.maxObstacles; ++i)
+int dtTileCache::getUpdateTiles(dtCompressedTileRef* refs, const int maxRefs)
+{
+	if (m_nupdate == 0)
+		processRequests();
+	
+	const int n = dtMin(m_nupdate, maxRefs);
+	for (int i = 0; i < n; ++i)
+		refs[i] = m_update[i];
+	return n;
+}
+
+void dtTileCache::completeTileUpdate(const dtCompressedTileRef ref)
+{
+	// Remove the tile from the update list.
+	for (int i = 0; i < m_nupdate; ++i)
+	{
+		if (m_update[i] == ref)
+		{
+			m_nupdate--;
+			if (m_nupdate > i)
+				memmove(m_update+i, m_update+i+1, (m_nupdate-i)*sizeof(dtCompressedTileRef));
+			break;
+		}
+	}
+	
+	// Update obstacle states.
+	for (int i = 0; i < m_params.maxObstacles; ++i)
+	{
+		dtTileCacheObstacle* ob = &m_obstacles[i];
+		if (ob->state == DT_OBSTACLE_PROCESSING || ob->state == DT_OBSTACLE_REMOVING)
 		{
-			dtTileCacheObstacle* ob = &m_obstacles[i];
-			if (ob->state == DT_OBSTACLE_PROCESSING || ob->state == DT_OBSTACLE_REMOVING)
+			// Remove handled tile from pending list.
+			for (int j = 0; j < (int)ob->npending; j++)
 			{
-				// Remove handled tile from pending list.
-				for (int j = 0; j < (int)ob->npending; j++)
+				if (ob->pending[j] == ref)
 				{
-					if (ob->pending[j] == ref)
-					{
-						ob->pending[j] = ob->pending[(int)ob->npending-1];
-						ob->npending--;
-						break;
-					}
+					ob->pending[j] = ob->pending[(int)ob->npending-1];
+					ob->npending--;
+					break;
 				}
-				
-				// If all pending tiles processed, change state.
-				if (ob->npending == 0)
+			}
+			
+			// If all pending tiles processed, change state.
+			if (ob->npending == 0)
+			{
+				if (ob->state == DT_OBSTACLE_PROCESSING)
 				{
-					if (ob->state == DT_OBSTACLE_PROCESSING)
-					{
-						ob->state = DT_OBSTACLE_PROCESSED;
-					}
-					else if (ob->state == DT_OBSTACLE_REMOVING)
-					{
-						ob->state = DT_OBSTACLE_EMPTY;
-						// Update salt, salt should never be zero.
-						ob->salt = (ob->salt+1) & ((1<<16)-1);
-						if (ob->salt == 0)
-							ob->salt++;
-						// Return obstacle to free list.
-						ob->next = m_nextFreeObstacle;
-						m_nextFreeObstacle = ob;
-					}
+					ob->state = DT_OBSTACLE_PROCESSED;
+				}
+				else if (ob->state == DT_OBSTACLE_REMOVING)
+				{
+					ob->state = DT_OBSTACLE_EMPTY;
+					// Update salt, salt should never be zero.
+					ob->salt = (ob->salt+1) & ((1<<16)-1);
+					if (ob->salt == 0)
+						ob->salt++;
+					// Return obstacle to free list.
+					ob->next = m_nextFreeObstacle;
+					m_nextFreeObstacle = ob;
 				}
 			}
 		}
 	}
+}
+
+dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
+							 bool* upToDate)
+{
+	dtStatus status = DT_SUCCESS;
+	// Process updates
+	dtCompressedTileRef ref;
+	if (getUpdateTiles(&ref, 1))
+	{
+		// Build mesh
+		status = buildNavMeshTile(ref, navmesh);
+		completeTileUpdate(ref);
+	}
 	
 	if (upToDate)
 		*upToDate = m_nupdate == 0 && m_nreqs == 0;
@@ -611,10 +761,24 @@ dtStatus dtTileCache::buildNavMeshTilesAt(const int tx, const int ty, dtNavMesh*
 }
 
 dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh* navmesh)
+{
+	unsigned char* navData = 0;
+	int navDataSize = 0;
+	dtStatus status = buildNavMeshTileData(ref, m_talloc, &navData, &navDataSize);
+	if (dtStatusFailed(status))
+		return status;
+	return addNavMeshTileData(ref, navmesh, navData, navDataSize);
+}
+
+dtStatus dtTileCache::buildNavMeshTileData(const dtCompressedTileRef ref, dtTileCacheAlloc* talloc,
+										   unsigned char** outData, int* outDataSize) const
 {	
-	dtAssert(m_talloc);
+	dtAssert(talloc);
 	dtAssert(m_tcomp);
 	
+	*outData = 0;
+	*outDataSize = 0;
+	
 	unsigned int idx = decodeTileIdTile(ref);
 	if (idx > (unsigned int)m_params.maxTiles)
 		return DT_FAILURE | DT_INVALID_PARAM;
@@ -623,14 +787,14 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 	if (tile->salt != salt)
 		return DT_FAILURE | DT_INVALID_PARAM;
 	
-	m_talloc->reset();
+	talloc->reset();
 	
-	NavMeshTileBuildContext bc(m_talloc);
+	NavMeshTileBuildContext bc(talloc);
 	const int walkableClimbVx = (int)(m_params.walkableClimb / m_params.ch);
 	dtStatus status;
 	
 	// Decompress tile layer data. 
-	status = dtDecompressTileCacheLayer(m_talloc, m_tcomp, tile->data, tile->dataSize, &bc.layer);
+	status = dtDecompressTileCacheLayer(talloc, m_tcomp, tile->data, tile->dataSize, &bc.layer);
 	if (dtStatusFailed(status))
 		return status;
 	
@@ -656,32 +820,28 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 	}
 	
 	// Build navmesh
-	status = dtBuildTileCacheRegions(m_talloc, *bc.layer, walkableClimbVx);
+	status = dtBuildTileCacheRegions(talloc, *bc.layer, walkableClimbVx);
 	if (dtStatusFailed(status))
 		return status;
 	
-	bc.lcset = dtAllocTileCacheContourSet(m_talloc);
+	bc.lcset = dtAllocTileCacheContourSet(talloc);
 	if (!bc.lcset)
 		return status;
-	status = dtBuildTileCacheContours(m_talloc, *bc.layer, walkableClimbVx,
+	status = dtBuildTileCacheContours(talloc, *bc.layer, walkableClimbVx,
 									  m_params.maxSimplificationError, *bc.lcset);
 	if (dtStatusFailed(status))
 		return status;
 	
-	bc.lmesh = dtAllocTileCachePolyMesh(m_talloc);
+	bc.lmesh = dtAllocTileCachePolyMesh(talloc);
 	if (!bc.lmesh)
 		return status;
-	status = dtBuildTileCachePolyMesh(m_talloc, *bc.lcset, *bc.lmesh);
+	status = dtBuildTileCachePolyMesh(talloc, *bc.lcset, *bc.lmesh);
 	if (dtStatusFailed(status))
 		return status;
 	
 	// Early out if the mesh tile is empty.
 	if (!bc.lmesh->npolys)
-	{
-		// Remove existing tile.
-		navmesh->removeTile(navmesh->getTileRefAt(tile->header->tx,tile->header->ty,tile->header->tlayer),0,0);
 		return DT_SUCCESS;
-	}
 	
 	dtNavMeshCreateParams params;
 	memset(&params, 0, sizeof(params));
@@ -709,22 +869,34 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 		m_tmproc->process(&params, bc.lmesh->areas, bc.lmesh->flags);
 	}
 	
-	unsigned char* navData = 0;
-	int navDataSize = 0;
-	if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
+	if (!dtCreateNavMeshData(&params, outData, outDataSize))
 		return DT_FAILURE;
+	
+	return DT_SUCCESS;
+}
 
+dtStatus dtTileCache::addNavMeshTileData(const dtCompressedTileRef ref, dtNavMesh* navmesh,
+										 unsigned char* data, const int dataSize)
+{
+	unsigned int idx = decodeTileIdTile(ref);
+	const dtCompressedTile* tile = idx < (unsigned int)m_params.maxTiles ? &m_tiles[idx] : 0;
+	if (!tile || tile->salt != decodeTileIdSalt(ref) || !tile->header)
+	{
+		dtFree(data);
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	
 	// Remove existing tile.
 	navmesh->removeTile(navmesh->getTileRefAt(tile->header->tx,tile->header->ty,tile->header->tlayer),0,0);
 
 	// Add new tile, or leave the location empty.
-	if (navData)
+	if (data)
 	{
 		// Let the navmesh own the data.
-		status = navmesh->addTile(navData,navDataSize,DT_TILE_FREE_DATA,0,0);
+		dtStatus status = navmesh->addTile(data,dataSize,DT_TILE_FREE_DATA,0,0);
 		if (dtStatusFailed(status))
 		{
-			dtFree(navData);
+			dtFree(data);
 			return status;
 		}
 	}
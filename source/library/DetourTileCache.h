@@ -64,7 +64,7 @@ struct dtTileCacheObstacle
 	};
 
 	dtCompressedTileRef touched[DT_MAX_TOUCHED_TILES];
-	dtCompressedTileRef pending[DT_MAX_TOUCHED_TILES];
+	dtCompressedTileRef pending[DT_MAX_TOUCHED_TILES*2];	///< The tiles touched before and after a move, at most.
 	unsigned short salt;
 	unsigned char type;
 	unsigned char state;
@@ -135,6 +135,20 @@ public:
 	
 	dtStatus removeObstacle(const dtObstacleRef ref);
 	
+	/// Moves an obstacle: only the tiles touched by the obstacle before or
+	/// after the move are rebuilt (once), by the next updates.
+	/// Moves shorter than a cell (cs horizontally, ch vertically) are ignored,
+	/// and a move replaces a not yet processed one of the same obstacle.
+	///  @param[in]		ref		The obstacle.
+	///  @param[in]		pos		The new position: the base center for cylinders,
+	///							the bottom face center for boxes. [(x, y, z)]
+	dtStatus moveObstacle(const dtObstacleRef ref, const float* pos);
+	
+	/// Recomputes the tiles touched by the obstacles: to be called after
+	/// tiles have been removed and re-added (which changes their refs), when
+	/// no obstacle request is pending.
+	void updateObstaclesTouched();
+	
 	dtStatus queryTiles(const float* bmin, const float* bmax,
 						dtCompressedTileRef* results, int* resultCount, const int maxResults) const;
 	
@@ -146,10 +160,37 @@ public:
 	///  							otherwise another call will continue processing obstacle requests and tile rebuilds.
 	dtStatus update(const float dt, class dtNavMesh* navmesh, bool* upToDate = 0);
 	
+	/// Gets the next tiles to be rebuilt because of unfinished obstacle requests.
+	/// (Processes the pending obstacle requests when no tile is waiting to be rebuilt.)
+	/// Each returned tile must be completed by completeTileUpdate(), after its navmesh
+	/// tile has been rebuilt or not: this split of update() allows rebuilding tiles concurrently.
+	///  @param[out]	refs		The tiles to be rebuilt. [(ref) * @p maxRefs]
+	///  @param[in]		maxRefs		The maximum number of tiles to return.
+	/// @return The number of returned tiles.
+	int getUpdateTiles(dtCompressedTileRef* refs, const int maxRefs);
+	
+	/// Marks a tile returned by getUpdateTiles() as rebuilt, updating the obstacles' states.
+	void completeTileUpdate(const dtCompressedTileRef ref);
+	
 	dtStatus buildNavMeshTilesAt(const int tx, const int ty, class dtNavMesh* navmesh);
 	
 	dtStatus buildNavMeshTile(const dtCompressedTileRef ref, class dtNavMesh* navmesh);
 	
+	/// Builds the navmesh tile data of a tile, without modifying the tile cache or the navmesh.
+	/// Can be called concurrently for different tiles, provided each call has its own
+	/// allocator (and the compressor and mesh process are thread safe).
+	///  @param[in]		ref			The tile.
+	///  @param[in]		talloc		The allocator for the temporary data.
+	///  @param[out]	outData		The built data (0 if the tile is empty), owned by the caller.
+	///  @param[out]	outDataSize	The built data's size.
+	dtStatus buildNavMeshTileData(const dtCompressedTileRef ref, struct dtTileCacheAlloc* talloc,
+								  unsigned char** outData, int* outDataSize) const;
+	
+	/// Replaces the navmesh tile of a tile with data built by buildNavMeshTileData().
+	/// The navmesh takes ownership of the data (freed on failure); 0 just removes the navmesh tile.
+	dtStatus addNavMeshTileData(const dtCompressedTileRef ref, class dtNavMesh* navmesh,
+								unsigned char* data, const int dataSize);
+	
 	void calcTightTileBounds(const struct dtTileCacheLayerHeader* header, float* bmin, float* bmax) const;
 	
 	void getObstacleBounds(const struct dtTileCacheObstacle* ob, float* bmin, float* bmax) const;
@@ -201,16 +242,20 @@ private:
 	dtTileCache(const dtTileCache&);
 	dtTileCache& operator=(const dtTileCache&);
 
+	void processRequests();
+
 	enum ObstacleRequestAction
 	{
 		REQUEST_ADD,
 		REQUEST_REMOVE,
+		REQUEST_MOVE,
 	};
 	
 	struct ObstacleRequest
 	{
 		int action;
 		dtObstacleRef ref;
+		float pos[3];	///< The new position (REQUEST_MOVE only).
 	};
 	
 	int m_tileLutSize;						///< Tile hash lookup size (must be pot).
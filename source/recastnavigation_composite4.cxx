@@ -9,15 +9,26 @@
 #include "library/RecastContour.cpp"
 
 ///support
+#include "support/BuildArena.cpp"
 #include "support/ChunkyTriMesh.cpp"
 #include "support/ConvexVolumeTool.cpp"
 #include "support/DebugInterfaces.cpp"
+#include "support/FlowField.cpp"
 #include "support/MeshLoaderObj.cpp"
+#include "support/NavMeshMapFile.cpp"
 #include "support/NavMeshTesterTool.cpp"
 #include "support/NavMeshType.cpp"
 #include "support/NavMeshType_Obstacle.cpp"
 #include "support/NavMeshType_Solo.cpp"
 #include "support/NavMeshType_Tile.cpp"
 #include "support/OffMeshConnectionTool.cpp"
+#include "support/PathCache.cpp"
+#include "support/PathRequestQueue.cpp"
 #include "support/PerfTimer.cpp"
+#include "support/SpatialGrid.cpp"
+#include "support/TileBuildCache.cpp"
+#include "support/TileCacheCompressor.cpp"
+#include "support/TileGraph.cpp"
+#include "support/TileStreamer.cpp"
+#include "support/WorkerPool.cpp"
 #include "support/fastlz.c"
@@ -23,7 +23,13 @@ namespace rnsup
 	struct DebugDrawPanda3d;
 	struct DebugDrawMeshDrawer;
 	struct NavMeshTesterTool;
+	struct NavMeshTesterQuery;
+	struct PathRequestQueue;
+	struct PathCache;
+	struct TileGraph;
+	struct CrowdFlowFields;
 	struct rcMeshLoaderObj;
+	struct WorkerPool;
 }
 
 struct dtNavMesh;
@@ -340,24 +340,9 @@ void RNCrowdAgent::do_update_pos_dir(float dt, const LPoint3f& pos, const LVecto
 	// get the squared velocity module
 	float velSquared = vel.length_squared();
 
-	//update node path position
+	//update node path position (for RECAST_KINEMATIC, pos.z has been
+	//already corrected by RNNavMesh)
 	LPoint3f updatedPos = pos;
-	if ((mMovType == RECAST_KINEMATIC) && (velSquared > 0.0))
-	{
-		// get nav mesh manager
-		WPT(RNNavMeshManager) navMeshMgr = RNNavMeshManager::get_global_ptr();
-		// correct panda's Z: set the collision ray origin wrt collision root
-		LPoint3f pOrig = navMeshMgr->get_collision_root().get_relative_point(
-				mReferenceNP, pos) + mHeigthCorrection;
-		// get the collision height wrt the reference node path
-		Pair<bool,float> gotCollisionZ = navMeshMgr->get_collision_height(pOrig,
-				mReferenceNP);
-		if (gotCollisionZ.get_first())
-		{
-			//updatedPos.z needs correction
-			updatedPos.set_z(gotCollisionZ.get_second());
-		}
-	}
 	mThisNP.set_pos(updatedPos);
 
 	//update node path direction & throw events
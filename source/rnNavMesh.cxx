@@ -13,7 +13,11 @@
 
 #include "rnCrowdAgent.h"
 #include "rnNavMeshManager.h"
+#include "rnNavMeshQuery.h"
 #include "camera.h"
+#include "throw_event.h"
+#include "pset.h"
+#include "filename.h"
 
 #ifndef CPPPARSER
 #include "library/DetourCommon.h"
@@ -72,6 +76,10 @@ void RNNavMesh::set_crowd_area_cost(int area, float cost)
 {
 	//add area with corresponding cost
 	mPolyAreaCost[area] = cost;
+	//cached paths were found with the old costs
+	mPathCache.invalidateCosts();
+	mFlowFields.clear();
+	do_reset_tile_graph();
 
 	if(mNavMeshType)
 	{
@@ -108,6 +116,8 @@ void RNNavMesh::set_crowd_include_flags(int oredFlags)
 		//set recast crowd include
 		crowdTool->getState()->getCrowd()->getEditableFilter(0)->setIncludeFlags(
 				mCrowdIncludeFlags);
+		mFlowFields.clear();
+		do_reset_tile_graph();
 	}
 }
 
@@ -128,6 +138,26 @@ void RNNavMesh::set_crowd_exclude_flags(int oredFlags)
 		//set recast crowd exclude flags
 		crowdTool->getState()->getCrowd()->getEditableFilter(0)->setExcludeFlags(
 				mCrowdExcludeFlags);
+		mFlowFields.clear();
+		do_reset_tile_graph();
+	}
+}
+
+/**
+ * Enables/disables building tiles on the RNNavMeshManager's worker threads
+ * (enabled by default).
+ * All tiles' builds (TILE type), or the tile cache's layers rasterization and
+ * compression (OBSTACLE type), are distributed among the threads, while the
+ * results are added to the navigation mesh (or tile cache) on the calling
+ * thread.
+ */
+void RNNavMesh::set_parallel_tile_build(bool enable)
+{
+	mParallelTileBuild = enable;
+	if (mNavMeshType)
+	{
+		mNavMeshType->setWorkerPool(mParallelTileBuild ?
+				&RNNavMeshManager::get_global_ptr()->get_worker_pool() : NULL);
 	}
 }
 
@@ -276,6 +306,61 @@ void RNNavMesh::do_initialize()
 			mTmpl->get_parameter_value(RNNavMeshManager::NAVMESH,
 					string("tile_size")).c_str(), NULL);
 	mNavMeshTileSettings.set_tileSize(value >= 0.0 ? value : -value);
+	//tile cache compressor
+	mNavMeshTileSettings.set_compressorType(
+			mTmpl->get_parameter_value(RNNavMeshManager::NAVMESH,
+					string("tile_cache_compressor")) == string("dense") ?
+					rnsup::NAVMESH_TILE_COMPRESSOR_DENSE :
+					rnsup::NAVMESH_TILE_COMPRESSOR_FAST);
+	//parallel tile build
+	mParallelTileBuild = (
+			mTmpl->get_parameter_value(RNNavMeshManager::NAVMESH,
+					string("parallel_tile_build")) == string("false") ?
+					false : true);
+	//save built data
+	mSaveBuiltData = (
+			mTmpl->get_parameter_value(RNNavMeshManager::NAVMESH,
+					string("save_built_data")) == string("true") ?
+					true : false);
+	//baked navigation mesh file
+	mBakedNavMeshFile = mTmpl->get_parameter_value(RNNavMeshManager::NAVMESH,
+			string("baked_nav_mesh_file"));
+	//tile build cache directory
+	set_tile_build_cache_dir(mTmpl->get_parameter_value(
+			RNNavMeshManager::NAVMESH, string("tile_build_cache_dir")));
+	//async path max iterations
+	valueInt = strtol(
+			mTmpl->get_parameter_value(RNNavMeshManager::NAVMESH,
+					string("async_path_max_iterations")).c_str(), NULL, 0);
+	mAsyncPathMaxIterations = (valueInt >= 0 ? valueInt : -valueInt);
+	//async path event
+	mAsyncPathEvent = mTmpl->get_parameter_value(RNNavMeshManager::NAVMESH,
+			string("async_path_event"));
+	//path cache size
+	valueInt = strtol(
+			mTmpl->get_parameter_value(RNNavMeshManager::NAVMESH,
+					string("path_cache_size")).c_str(), NULL, 0);
+	mPathCache.setCapacity(valueInt >= 0 ? valueInt : -valueInt);
+	//flow field min agents
+	valueInt = strtol(
+			mTmpl->get_parameter_value(RNNavMeshManager::NAVMESH,
+					string("flow_field_min_agents")).c_str(), NULL, 0);
+	mFlowFields.setMinAgents(valueInt >= 0 ? valueInt : -valueInt);
+	//obstacle update budget
+	value = STRTOF(
+			mTmpl->get_parameter_value(RNNavMeshManager::NAVMESH,
+					string("obstacle_update_budget")).c_str(), NULL);
+	mObstacleUpdateBudget = (value >= 0.0 ? value : -value);
+	//obstacle auto update
+	mObstacleAutoUpdate = (
+			mTmpl->get_parameter_value(RNNavMeshManager::NAVMESH,
+					string("obstacle_auto_update")) == string("true") ?
+					true : false);
+	//tile stream radius
+	value = STRTOF(
+			mTmpl->get_parameter_value(RNNavMeshManager::NAVMESH,
+					string("tile_stream_radius")).c_str(), NULL);
+	mTileStreamer.setRadius(value >= 0.0 ? value : -value);
 	///
 	//0: get navmesh type
 	valueStr = mTmpl->get_parameter_value(RNNavMeshManager::NAVMESH,
@@ -381,6 +466,11 @@ void RNNavMesh::do_initialize()
 		//or flag
 		mCrowdExcludeFlags |= flag;
 	}
+	//crowd parallel update
+	mCrowdParallelUpdate = (
+			mTmpl->get_parameter_value(RNNavMeshManager::NAVMESH,
+					string("crowd_parallel_update")) == string("false") ?
+					false : true);
 
 	///get convex volumes
 	plist<string> mConvexVolumesParam = mTmpl->get_parameter_values(RNNavMeshManager::NAVMESH,
@@ -782,8 +872,15 @@ int RNNavMesh::setup()
 		mNavMeshType->setTool(NULL);
 	}
 
-	///build navigation mesh actually
-	do_build_navMesh();
+	///build navigation mesh actually: try to map it from the baked file, or,
+	///when loaded from a bam file, to restore it from the saved built data first
+	if (!((!mBakedNavMeshFile.empty()) && do_build_navMesh_from_baked_file())
+			&& !(buildFromBam && (!mBuiltData.empty())
+					&& do_build_navMesh_from_data()))
+	{
+		do_build_navMesh();
+	}
+	mBuiltData.clear();
 
 	//set crowd tool: this will be always on when nav mesh is setup
 	rnsup::CrowdTool* crowdTool = new rnsup::CrowdTool();
@@ -809,6 +906,13 @@ int RNNavMesh::setup()
 	//initialize the tester tool
 	mTesterTool.init(mNavMeshType,
 			crowdTool->getState()->getCrowd()->getEditableFilter(0));
+	mPathCache.clear();
+	mTesterTool.setPathCache(&mPathCache);
+
+	//initialize the asynchronous path requests
+	mPathRequests = new rnsup::PathRequestQueue();
+	mPathRequests->init(mNavMeshType->getNavMesh(),
+			crowdTool->getState()->getCrowd()->getEditableFilter(0));
 
 	//<this code is executed only when in manual setup:
 	{
@@ -840,7 +944,7 @@ int RNNavMesh::setup()
 		{
 			//check if adding to recast was successful
 			if (do_add_obstacle_to_recast((*iter).second(),
-							iter - mObstacles.begin(), buildFromBam) < 0)
+							iter - mObstacles.begin(), buildFromBam, false) < 0)
 			{
 				//\see http://stackoverflow.com/questions/596162/can-you-remove-elements-from-a-stdlist-while-iterating-through-it
 				iter = mObstacles.erase(iter);
@@ -849,6 +953,8 @@ int RNNavMesh::setup()
 			//increment iterator
 			++iter;
 		}
+		//rebuild all touched tiles at once
+		do_flush_obstacles();
 	}
 	else
 	{
@@ -878,16 +984,123 @@ bool RNNavMesh::do_build_navMesh()
 	mCtx->resetLog();
 #endif //RN_DEBUG
 	//build navigation mesh
+	mCtx->resetStats();
+	rnsup::TimeVal startTime = rnsup::getPerfTime();
 	bool result = mNavMeshType->handleBuild();
+	mBuildTime = rnsup::getPerfTimeUsec(rnsup::getPerfTime() - startTime)
+			/ 1000.0;
 #ifdef RN_DEBUG
 	mCtx->dumpLog("Build log %s:", mMeshName.c_str());
 #endif //RN_DEBUG
 	return result;
 }
 
+/**
+ * Restores the navigation mesh from the built data read from a bam file.
+ * Returns false if the data are missing or invalid.
+ * \note Internal use only.
+ */
+bool RNNavMesh::do_build_navMesh_from_data()
+{
+#ifdef RN_DEBUG
+	mCtx->resetLog();
+#endif //RN_DEBUG
+	Datagram dg(mBuiltData);
+	DatagramIterator scan(dg);
+	mCtx->resetStats();
+	rnsup::TimeVal startTime = rnsup::getPerfTime();
+	bool result = mNavMeshType->handleBuildFromData(scan);
+	mBuildTime = rnsup::getPerfTimeUsec(rnsup::getPerfTime() - startTime)
+			/ 1000.0;
+#ifdef RN_DEBUG
+	mCtx->dumpLog("Build from data log %s:", mMeshName.c_str());
+#endif //RN_DEBUG
+	return result;
+}
+
+/**
+ * Maps the navigation mesh from the baked file (SOLO and TILE).
+ * Returns false if the file is missing or invalid.
+ * \note Internal use only.
+ */
+bool RNNavMesh::do_build_navMesh_from_baked_file()
+{
+	if (mNavMeshTypeEnum == OBSTACLE)
+	{
+		//the tile cache must be built anyway
+		return false;
+	}
+#ifdef RN_DEBUG
+	mCtx->resetLog();
+#endif //RN_DEBUG
+	mCtx->resetStats();
+	rnsup::TimeVal startTime = rnsup::getPerfTime();
+	bool result = mNavMeshType->handleBuildFromMapFile(
+			Filename(mBakedNavMeshFile).to_os_specific().c_str());
+	mBuildTime = rnsup::getPerfTimeUsec(rnsup::getPerfTime() - startTime)
+			/ 1000.0;
+#ifdef RN_DEBUG
+	mCtx->dumpLog("Build from baked file log %s:", mMeshName.c_str());
+#endif //RN_DEBUG
+	return result;
+}
+
+/**
+ * Saves the navigation mesh to a baked file (SOLO and TILE), which can be
+ * specified (see set_baked_nav_mesh_file()) to set up RNNavMeshes with the
+ * same settings without re-running the Recast build.
+ * The file is memory mapped on setup and its tiles are used in place: so
+ * identical navigation meshes share their memory (through the page cache) in
+ * all the processes of a host.
+ * Should be called after RNNavMesh setup.
+ * Returns a negative number on error.
+ */
+int RNNavMesh::save_baked_nav_mesh(const string& fileName)
+{
+	// continue if nav mesh has been already setup
+	CONTINUE_IF_ELSE_R(mNavMeshType && (mNavMeshTypeEnum != OBSTACLE),
+			RN_ERROR)
+
+	bool saved = mNavMeshType->saveMapFile(
+			Filename(fileName).to_os_specific().c_str());
+	CONTINUE_IF_ELSE_R(saved, RN_ERROR)
+
+	PRINT_DEBUG("'" << get_owner_node_path() << "' save_baked_nav_mesh : "
+			<< fileName);
+	return RN_SUCCESS;
+}
+
+/**
+ * Sets the directory (created if missing) where the data of the tiles built
+ * are cached (TILE and OBSTACLE), each keyed by the hash of the tile's input:
+ * the overlapping triangles, convex volumes and off-mesh connections, and the
+ * build settings. So a rebuild, after an edit or on a later run, recomputes
+ * only the tiles whose input has changed.
+ * An empty directory disables the cache (the default).
+ * \note Tiles are never removed from the directory, which can be emptied at
+ * any time.
+ */
+void RNNavMesh::set_tile_build_cache_dir(const string& dirName)
+{
+	mTileBuildCacheDir = dirName;
+	mTileBuildCache.resetStats();
+	if (dirName.empty())
+	{
+		mTileBuildCache.setDirectory(string());
+		return;
+	}
+	Filename dir(dirName);
+	dir.make_dir();
+	dir.mkdir();
+	mTileBuildCache.setDirectory(dir.to_os_specific());
+	PRINT_DEBUG("'" << get_owner_node_path() << "' set_tile_build_cache_dir : "
+			<< dirName);
+}
+
 /**
  * Adds a convex volume with the points (at least 3) and the area type specified.
- * Should be called before RNNavMesh setup.
+ * Should be called before RNNavMesh setup, or after it with TILE and OBSTACLE
+ * types: in this case only the tiles the convex volume overlaps are rebuilt.
  * Returns the convex volume's unique reference (>0), or a negative number on
  * error.
  * \note The added convex volume is temporary: after setup this convex volume
@@ -897,8 +1110,10 @@ bool RNNavMesh::do_build_navMesh()
 int RNNavMesh::add_convex_volume(const ValueList<LPoint3f>& points,
 		int area)
 {
-	// continue if nav mesh has not been already setup
-	CONTINUE_IF_ELSE_R((!mNavMeshType) && (points.size() >= 3), RN_ERROR)
+	// continue if nav mesh has not been already setup (or is tiled)
+	CONTINUE_IF_ELSE_R(
+			((!mNavMeshType) || (mNavMeshTypeEnum != SOLO))
+					&& (points.size() >= 3), RN_ERROR)
 
 	// add to convex volumes
 	// compute centroid
@@ -915,6 +1130,11 @@ int RNNavMesh::add_convex_volume(const ValueList<LPoint3f>& points,
 	settings.set_centroid(centroid);
 	int ref = unique_ref();
 	settings.set_ref(ref);
+	if (mNavMeshType)
+	{
+		// nav mesh already setup: add to recast too
+		return do_add_convex_volume_to_recast(points, settings);
+	}
 	mConvexVolumes.push_back(PointListConvexVolumeSettings(points, settings));
 #ifdef RN_DEBUG
 	do_debug_static_render_unsetup();
@@ -924,14 +1144,22 @@ int RNNavMesh::add_convex_volume(const ValueList<LPoint3f>& points,
 
 /**
  * Removes a convex volume with the specified internal point.
- * Should be called before RNNavMesh setup.
+ * Should be called before RNNavMesh setup, or after it with TILE and OBSTACLE
+ * types: in this case only the tiles the convex volume overlaps are rebuilt.
  * \note The first one found convex volume will be removed.
  * Returns the convex volume's reference (>0), or a negative number on error.
  */
 int RNNavMesh::remove_convex_volume(const LPoint3f& insidePoint)
 {
-	// continue if nav mesh has not been already setup
-	CONTINUE_IF_ELSE_R(!mNavMeshType, RN_ERROR)
+	// continue if nav mesh has not been already setup (or is tiled)
+	CONTINUE_IF_ELSE_R((!mNavMeshType) || (mNavMeshTypeEnum != SOLO),
+			RN_ERROR)
+
+	if (mNavMeshType)
+	{
+		// nav mesh already setup: remove from recast too
+		return do_remove_convex_volume_from_recast(insidePoint);
+	}
 
 	//set oldRef=RN_ERROR in case of error
 	int oldRef = RN_ERROR;
@@ -989,6 +1217,137 @@ int RNNavMesh::remove_convex_volume(const LPoint3f& insidePoint)
 	return oldRef;
 }
 
+/**
+ * Adds a convex volume to the underlying nav mesh's input geometry (after
+ * setup), rebuilding the tiles it overlaps.
+ * Returns the convex volume's unique reference (>0), or a negative number on
+ * error.
+ * \note Internal use only.
+ */
+int RNNavMesh::do_add_convex_volume_to_recast(
+		const ValueList<LPoint3f>& points, RNConvexVolumeSettings settings)
+{
+	int area = settings.get_area();
+	if (area < 0)
+	{
+		area = rnsup::NAVMESH_POLYAREA_GROUND;
+	}
+	int count = mGeom->getConvexVolumeCount();
+	///HACK: use support functionality to add convex volumes (the nav mesh
+	///type's tool is the crowd tool now)
+	//create fake NavMeshType and ConvexVolumeTool on the real InputGeom
+	rnsup::NavMeshType* navMeshType = new rnsup::NavMeshType_Solo();
+	rnsup::ConvexVolumeTool* cvTool = new rnsup::ConvexVolumeTool();
+	navMeshType->handleMeshChanged(mGeom);
+	navMeshType->setTool(cvTool);
+	cvTool->setAreaType(area);
+	float recastPos[3];
+	for (int i = 0; i != points.size(); ++i)
+	{
+		//point is given wrt mOwnerObject node path but
+		//it has to be wrt mReferenceNP (see setup())
+		LPoint3f refPos = mReferenceNP.get_relative_point(mOwnerObject,
+				points[i]);
+		rnsup::LVecBase3fToRecast(refPos, recastPos);
+		cvTool->handleClick(NULL, recastPos, false);
+	}
+	//re-insert the last point (to close convex volume)
+	cvTool->handleClick(NULL, recastPos, false);
+	int idx = cvTool->getConvexVolumeIdx();
+	//delete fake objects
+	navMeshType->setTool(NULL);
+	delete navMeshType;
+	// continue if convex volume has been actually inserted
+	CONTINUE_IF_ELSE_R((idx != -1) && (mGeom->getConvexVolumeCount() == count + 1),
+			RN_ERROR)
+
+	//make sure mConvexVolumes and mGeom::m_volumes are synchronized
+	const rnsup::ConvexVolume& convexVol = mGeom->getConvexVolumes()[idx];
+	ValueList<LPoint3f> volPoints;
+	LPoint3f centroid = LPoint3f::zero();
+	float bmin[3], bmax[3];
+	rcVcopy(bmin, &convexVol.verts[0]);
+	rcVcopy(bmax, &convexVol.verts[0]);
+	for (int i = 0; i < convexVol.nverts; ++i)
+	{
+		volPoints.add_value(rnsup::RecastToLVecBase3f(&convexVol.verts[i * 3]));
+		centroid += volPoints[i];
+		rcVmin(bmin, &convexVol.verts[i * 3]);
+		rcVmax(bmax, &convexVol.verts[i * 3]);
+	}
+	centroid /= volPoints.get_num_values();
+	bmin[1] = convexVol.hmin;
+	bmax[1] = convexVol.hmax;
+	settings.set_centroid(centroid);
+	mConvexVolumes.push_back(PointListConvexVolumeSettings(volPoints, settings));
+	nassertr_always((int) mConvexVolumes.size() == mGeom->getConvexVolumeCount(),
+			RN_ERROR)
+
+	do_rebuild_tiles(bmin, bmax);
+	return settings.get_ref();
+}
+
+/**
+ * Removes the convex volume with the specified internal point from the
+ * underlying nav mesh's input geometry (after setup), rebuilding the tiles it
+ * overlapped.
+ * Returns the convex volume's reference (>0), or a negative number on error.
+ * \note Internal use only.
+ */
+int RNNavMesh::do_remove_convex_volume_from_recast(const LPoint3f& insidePoint)
+{
+	int idx = do_get_convex_volume_from_point(insidePoint);
+	CONTINUE_IF_ELSE_R(idx >= 0, RN_ERROR)
+
+	const rnsup::ConvexVolume& convexVol = mGeom->getConvexVolumes()[idx];
+	float bmin[3], bmax[3];
+	rcVcopy(bmin, &convexVol.verts[0]);
+	rcVcopy(bmax, &convexVol.verts[0]);
+	for (int i = 1; i < convexVol.nverts; ++i)
+	{
+		rcVmin(bmin, &convexVol.verts[i * 3]);
+		rcVmax(bmax, &convexVol.verts[i * 3]);
+	}
+	bmin[1] = convexVol.hmin;
+	bmax[1] = convexVol.hmax;
+	int oldRef = mConvexVolumes[idx].get_second().get_ref();
+	//InputGeom replaces the removed convex volume with the last one: keep
+	//mConvexVolumes and mGeom::m_volumes synchronized
+	mGeom->deleteConvexVolume(idx);
+	mConvexVolumes[idx] = mConvexVolumes.back();
+	mConvexVolumes.pop_back();
+
+	do_rebuild_tiles(bmin, bmax);
+	return oldRef;
+}
+
+/**
+ * Rebuilds the tiles overlapping the specified (recast) bounds after changes
+ * to the input geometry, and updates what depends on them (TILE and OBSTACLE).
+ * \note Internal use only.
+ */
+void RNNavMesh::do_rebuild_tiles(const float* bmin, const float* bmax)
+{
+	if (mNavMeshTypeEnum == OBSTACLE)
+	{
+		//pending obstacle changes refer to the current tile cache's tiles
+		do_flush_obstacles();
+	}
+	pvector<int> tiles(mNavMeshType->getNavMesh()->getMaxTiles() * 2);
+	int ntiles = mNavMeshType->rebuildTiles(bmin, bmax, &tiles[0],
+			mNavMeshType->getNavMesh()->getMaxTiles());
+	for (int i = 0; i < ntiles; ++i)
+	{
+		do_tile_changed(tiles[i * 2], tiles[i * 2 + 1]);
+	}
+#ifdef RN_DEBUG
+	if ((ntiles > 0) && !mDebugCamera.is_empty())
+	{
+		do_debug_static_render();
+	}
+#endif //RN_DEBUG
+}
+
 /**
  * Returns the index of the convex volume with the specified internal point, or
  * a negative number if none is found.
@@ -1287,7 +1646,8 @@ ValueList<LPoint3f> RNNavMesh::get_convex_volume_by_ref(int ref) const
 /**
  * Adds an off mesh connection with the specified begin/end points and if
  * it is bidirectional.
- * Should be called before RNNavMesh setup.
+ * Should be called before RNNavMesh setup, or after it with TILE and OBSTACLE
+ * types: in this case only the tiles around its end points are rebuilt.
  * \note pointPair[0] = begin point, pointPair[1] = end point
  * Returns the off mesh connection's unique reference (>0), or a negative number
  * on error.
@@ -1298,8 +1658,10 @@ ValueList<LPoint3f> RNNavMesh::get_convex_volume_by_ref(int ref) const
 int RNNavMesh::add_off_mesh_connection(const ValueList<LPoint3f>& points,
 		bool bidirectional)
 {
-	// continue if nav mesh has not been already setup
-	CONTINUE_IF_ELSE_R((!mNavMeshType) && (points.size() >= 2), RN_ERROR)
+	// continue if nav mesh has not been already setup (or is tiled)
+	CONTINUE_IF_ELSE_R(
+			((!mNavMeshType) || (mNavMeshTypeEnum != SOLO))
+					&& (points.size() >= 2), RN_ERROR)
 
 	// add to off mesh connections
 	RNOffMeshConnectionSettings settings;
@@ -1309,6 +1671,11 @@ int RNNavMesh::add_off_mesh_connection(const ValueList<LPoint3f>& points,
 	settings.set_flags(POLYFLAGS_JUMP);
 	int ref = unique_ref();
 	settings.set_ref(ref);
+	if (mNavMeshType)
+	{
+		// nav mesh already setup: add to recast too
+		return do_add_off_mesh_connection_to_recast(points, settings);
+	}
 	mOffMeshConnections.push_back(
 			PointPairOffMeshConnectionSettings(points, settings));
 #ifdef RN_DEBUG
@@ -1319,14 +1686,22 @@ int RNNavMesh::add_off_mesh_connection(const ValueList<LPoint3f>& points,
 
 /**
  * Removes an off mesh connection with the begin or end point specified.
- * Should be called before RNNavMesh setup.
+ * Should be called before RNNavMesh setup, or after it with TILE and OBSTACLE
+ * types: in this case only the tiles around its end points are rebuilt.
  * Returns the off mesh connection's reference (>0), or a negative number on
  * error.
  */
 int RNNavMesh::remove_off_mesh_connection(const LPoint3f& beginOrEndPoint)
 {
-	// continue if nav mesh has not been already setup
-	CONTINUE_IF_ELSE_R(!mNavMeshType, RN_ERROR)
+	// continue if nav mesh has not been already setup (or is tiled)
+	CONTINUE_IF_ELSE_R((!mNavMeshType) || (mNavMeshTypeEnum != SOLO),
+			RN_ERROR)
+
+	if (mNavMeshType)
+	{
+		// nav mesh already setup: remove from recast too
+		return do_remove_off_mesh_connection_from_recast(beginOrEndPoint);
+	}
 
 	//set oldRef=RN_ERROR in case of error
 	int oldRef = RN_ERROR;
@@ -1383,6 +1758,92 @@ int RNNavMesh::remove_off_mesh_connection(const LPoint3f& beginOrEndPoint)
 	return oldRef;
 }
 
+/**
+ * Adds an off mesh connection to the underlying nav mesh's input geometry
+ * (after setup), rebuilding the tiles around its end points.
+ * Returns the off mesh connection's unique reference (>0), or a negative
+ * number on error.
+ * \note Internal use only.
+ */
+int RNNavMesh::do_add_off_mesh_connection_to_recast(
+		const ValueList<LPoint3f>& points, RNOffMeshConnectionSettings settings)
+{
+	int count = mGeom->getOffMeshConnectionCount();
+	//points are given wrt mOwnerObject node path but
+	//they have to be wrt mReferenceNP (see setup())
+	float spos[3], epos[3];
+	rnsup::LVecBase3fToRecast(
+			mReferenceNP.get_relative_point(mOwnerObject, points[0]), spos);
+	rnsup::LVecBase3fToRecast(
+			mReferenceNP.get_relative_point(mOwnerObject, points[1]), epos);
+	//as OffMeshConnectionTool does
+	mGeom->addOffMeshConnection(spos, epos, mNavMeshType->getAgentRadius(),
+			settings.get_bidir() ? 1 : 0, (unsigned char) settings.get_area(),
+			(unsigned short) settings.get_flags());
+	// continue if off mesh connection has been actually inserted
+	CONTINUE_IF_ELSE_R(mGeom->getOffMeshConnectionCount() == count + 1,
+			RN_ERROR)
+
+	//make sure mOffMeshConnections and mGeom's off mesh connections are synchronized
+	float rad = mGeom->getOffMeshConnectionRads()[count];
+	settings.set_rad(rad);
+	ValueList<LPoint3f> pointPair;
+	pointPair.add_value(rnsup::RecastToLVecBase3f(spos));
+	pointPair.add_value(rnsup::RecastToLVecBase3f(epos));
+	mOffMeshConnections.push_back(
+			PointPairOffMeshConnectionSettings(pointPair, settings));
+
+	float bmin[3], bmax[3];
+	rcVcopy(bmin, spos);
+	rcVcopy(bmax, spos);
+	rcVmin(bmin, epos);
+	rcVmax(bmax, epos);
+	for (int i = 0; i < 3; ++i)
+	{
+		bmin[i] -= rad;
+		bmax[i] += rad;
+	}
+	do_rebuild_tiles(bmin, bmax);
+	return settings.get_ref();
+}
+
+/**
+ * Removes the off mesh connection with the begin or end point specified from
+ * the underlying nav mesh's input geometry (after setup), rebuilding the tiles
+ * around its end points.
+ * Returns the off mesh connection's reference (>0), or a negative number on
+ * error.
+ * \note Internal use only.
+ */
+int RNNavMesh::do_remove_off_mesh_connection_from_recast(
+		const LPoint3f& beginOrEndPoint)
+{
+	int idx = do_get_off_mesh_connection_from_point(beginOrEndPoint);
+	CONTINUE_IF_ELSE_R(idx >= 0, RN_ERROR)
+
+	const float* v = &(mGeom->getOffMeshConnectionVerts()[idx * 3 * 2]);
+	float rad = mGeom->getOffMeshConnectionRads()[idx];
+	float bmin[3], bmax[3];
+	rcVcopy(bmin, &v[0]);
+	rcVcopy(bmax, &v[0]);
+	rcVmin(bmin, &v[3]);
+	rcVmax(bmax, &v[3]);
+	for (int i = 0; i < 3; ++i)
+	{
+		bmin[i] -= rad;
+		bmax[i] += rad;
+	}
+	int oldRef = mOffMeshConnections[idx].get_second().get_ref();
+	//InputGeom replaces the removed off mesh connection with the last one:
+	//keep mOffMeshConnections and mGeom's off mesh connections synchronized
+	mGeom->deleteOffMeshConnection(idx);
+	mOffMeshConnections[idx] = mOffMeshConnections.back();
+	mOffMeshConnections.pop_back();
+
+	do_rebuild_tiles(bmin, bmax);
+	return oldRef;
+}
+
 /**
  * Gets the off mesh connection with the begin or end point specified.
  * Returns the off mesh connection's index in the list, or a negative number on
@@ -1694,11 +2155,13 @@ int RNNavMesh::cleanup()
 		{
 			//could return an error
 			if (do_remove_obstacle_from_recast(iterO->second(),
-					iterO->first().get_ref()) < 0)
+					iterO->first().get_ref(), false) < 0)
 			{
 				result = RN_ERROR;
 			}
 		}
+		//rebuild all touched tiles at once
+		do_flush_obstacles();
 	}
 
 	// remove crowd agents from recast update
@@ -1715,6 +2178,29 @@ int RNNavMesh::cleanup()
 		mNavMeshType->setTool(NULL);
 	}
 
+	//stop tile streaming (resident tiles go with the navigation mesh)
+	mTileStreamer.close();
+
+	//clear path cache
+	mPathCache.clear();
+
+	//clear flow fields
+	mFlowFields.clear();
+
+	//delete tile graph
+	do_reset_tile_graph();
+
+	//delete asynchronous path requests
+	delete mPathRequests;
+	mPathRequests = NULL;
+
+	//delete batch queries
+	for (unsigned int i = 0; i < mBatchQueries.size(); ++i)
+	{
+		delete mBatchQueries[i];
+	}
+	mBatchQueries.clear();
+
 	//delete old navigation mesh type
 	delete mNavMeshType;
 	mNavMeshType = NULL;
@@ -1793,6 +2279,10 @@ int RNNavMesh::build_tile(const LPoint3f& pos)
 		rnsup::LVecBase3fToRecast(pos, recastPos);
 		static_cast<rnsup::NavMeshType_Tile*>(mNavMeshType)->buildTile(
 				recastPos);
+		int tx, ty;
+		static_cast<rnsup::NavMeshType_Tile*>(mNavMeshType)->getTilePos(
+				recastPos, tx, ty);
+		do_tile_changed(tx, ty);
 		PRINT_DEBUG("'" << get_owner_node_path() << "' build_tile : " << pos);
 #ifdef RN_DEBUG
 		if (! mDebugCamera.is_empty())
@@ -1821,6 +2311,10 @@ int RNNavMesh::remove_tile(const LPoint3f& pos)
 		rnsup::LVecBase3fToRecast(pos, recastPos);
 		static_cast<rnsup::NavMeshType_Tile*>(mNavMeshType)->removeTile(
 				recastPos);
+		int tx, ty;
+		static_cast<rnsup::NavMeshType_Tile*>(mNavMeshType)->getTilePos(
+				recastPos, tx, ty);
+		do_tile_changed(tx, ty);
 		PRINT_DEBUG("'" << get_owner_node_path() << "' remove_tile : " << pos);
 #ifdef RN_DEBUG
 		if (! mDebugCamera.is_empty())
@@ -1846,6 +2340,12 @@ int RNNavMesh::build_all_tiles()
 	if (mNavMeshTypeEnum == TILE)
 	{
 		static_cast<rnsup::NavMeshType_Tile*>(mNavMeshType)->buildAllTiles();
+		mPathCache.clear();
+		mFlowFields.clear();
+		if (mTileGraph)
+		{
+			mTileGraph->buildAll();
+		}
 #ifdef RN_DEBUG
 		if (! mDebugCamera.is_empty())
 		{
@@ -1870,6 +2370,12 @@ int RNNavMesh::remove_all_tiles()
 	if (mNavMeshTypeEnum == TILE)
 	{
 		static_cast<rnsup::NavMeshType_Tile*>(mNavMeshType)->removeAllTiles();
+		mPathCache.clear();
+		mFlowFields.clear();
+		if (mTileGraph)
+		{
+			mTileGraph->clear();
+		}
 #ifdef RN_DEBUG
 		if (! mDebugCamera.is_empty())
 		{
@@ -1882,87 +2388,377 @@ int RNNavMesh::remove_all_tiles()
 }
 
 /**
- * Adds an obstacle as NodePath (OBSTACLE).
- * Returns the obstacle's unique reference (>0), or a negative number on error.
+ * Saves all the RNNavMesh's current tiles into a tile set file, to be used for
+ * tile streaming (TILE).
+ * Should be called after RNNavMesh setup.
+ * Returns a negative number on error.
  */
-int RNNavMesh::add_obstacle(NodePath objectNP)
+int RNNavMesh::save_tile_archive(const string& fileName)
 {
+	// continue if nav mesh has been already setup
+	CONTINUE_IF_ELSE_R(mNavMeshType && (mNavMeshTypeEnum == TILE), RN_ERROR)
 
-	// continue if not empty node paths and we have OBSTACLE
-	// nav mesh type and mReferenceNP is not empty
-	CONTINUE_IF_ELSE_R(
-			(!objectNP.is_empty()) && (mNavMeshTypeEnum == OBSTACLE)
-					&& (! mReferenceNP.is_empty()), RN_ERROR)
-
-	// return error if objectNP is already present
-	pvector<Obstacle>::iterator iterO;
-	for (iterO = mObstacles.begin(); iterO < mObstacles.end(); ++iterO)
-	{
-		if ((*iterO).second().node() == objectNP.node())
-		{
-			// break: objectNP is already present
-			break;
-		}
-	}
-	CONTINUE_IF_ELSE_R(iterO == mObstacles.end(), RN_ERROR)
+	bool saved = static_cast<rnsup::NavMeshType_Tile*>(mNavMeshType)->saveAll(
+			Filename(fileName).to_os_specific().c_str(),
+			mNavMeshType->getNavMesh());
+	CONTINUE_IF_ELSE_R(saved, RN_ERROR)
 
-	// insert obstacle with invalid ref: later will be corrected
-	RNObstacleSettings settings;
-	settings.set_ref(RN_ERROR);
-	mObstacles.push_back(Obstacle(settings, objectNP));
+	PRINT_DEBUG("'" << get_owner_node_path() << "' save_tile_archive : "
+			<< fileName);
+	return RN_SUCCESS;
+}
 
+/**
+ * Starts streaming tiles from a tile set file (TILE), written by
+ * save_tile_archive() with the same cell and tile sizes, and bounds.
+ * All the current tiles are removed: then each update() loads, in background,
+ * the tiles within the stream radius of the anchors and removes those out of
+ * range, so the navigation mesh's resident tiles depend on the areas around
+ * the anchors only (and the *max_tiles* parameter can be set accordingly,
+ * with *build_all_tiles* disabled).
+ * Should be called after RNNavMesh setup.
+ * Returns a negative number on error.
+ */
+int RNNavMesh::start_tile_streaming(const string& fileName)
+{
 	// continue if nav mesh has been already setup
-	CONTINUE_IF_ELSE_R(mNavMeshType, RN_ERROR)
+	CONTINUE_IF_ELSE_R(mNavMeshType && (mNavMeshTypeEnum == TILE), RN_ERROR)
 
-	// return the result of adding obstacle to recast
-	return do_add_obstacle_to_recast(objectNP, mObstacles.size() - 1);
+	stop_tile_streaming();
+	remove_all_tiles();
+	bool opened = mTileStreamer.open(
+			Filename(fileName).to_os_specific().c_str(),
+			mNavMeshType->getNavMesh());
+	CONTINUE_IF_ELSE_R(opened, RN_ERROR)
+
+	PRINT_DEBUG("'" << get_owner_node_path() << "' start_tile_streaming : "
+			<< fileName << " (" << mTileStreamer.getNumTiles() << " tiles)");
+	return RN_SUCCESS;
 }
 
 /**
- * Adds obstacle to the underlying nav mesh.
+ * Stops streaming tiles (TILE): the tiles currently in the navigation mesh are
+ * kept.
  * Returns a negative number on error.
- * \note Internal use only.
  */
-int RNNavMesh::do_add_obstacle_to_recast(NodePath& objectNP, int index,
-		bool buildFromBam)
+int RNNavMesh::stop_tile_streaming()
 {
-	//get obstacle dimensions
-	LVecBase3f modelDims;
-	LVector3f modelDeltaCenter;
-	float modelRadius;
-	if (!buildFromBam)
-	{
-		//compute new obstacle dimensions
-		modelRadius =
-				RNNavMeshManager::get_global_ptr()->get_bounding_dimensions(
-						objectNP, modelDims, modelDeltaCenter);
-	}
-	else
-	{
-		modelRadius = mObstacles[index].first().get_radius();
-		modelDims = mObstacles[index].first().get_dims();
-	}
+	CONTINUE_IF_ELSE_R(mTileStreamer.isOpen(), RN_ERROR)
 
-	//the obstacle is reparented to the RNNavMesh's reference node path
-	objectNP.wrt_reparent_to(mReferenceNP);
+	mTileStreamer.close();
+	return RN_SUCCESS;
+}
 
-	//calculate pos wrt reference node path
-	LPoint3f pos = objectNP.get_pos();
-	//add detour obstacle
+/**
+ * Adds a NodePath (i.e. a player or a crowd agent) as tile streaming anchor:
+ * the tiles around it are kept in the navigation mesh while streaming (TILE).
+ * Returns a negative number on error.
+ */
+int RNNavMesh::add_tile_stream_anchor(NodePath anchorNP)
+{
+	CONTINUE_IF_ELSE_R(! anchorNP.is_empty(), RN_ERROR)
+	CONTINUE_IF_ELSE_R(find(mTileStreamAnchors.begin(),
+			mTileStreamAnchors.end(), anchorNP) == mTileStreamAnchors.end(),
+			RN_ERROR)
+
+	mTileStreamAnchors.push_back(anchorNP);
+	return RN_SUCCESS;
+}
+
+/**
+ * Removes a tile streaming anchor (TILE).
+ * Returns a negative number on error.
+ */
+int RNNavMesh::remove_tile_stream_anchor(NodePath anchorNP)
+{
+	pvector<NodePath>::iterator iter = find(mTileStreamAnchors.begin(),
+			mTileStreamAnchors.end(), anchorNP);
+	CONTINUE_IF_ELSE_R(iter != mTileStreamAnchors.end(), RN_ERROR)
+
+	mTileStreamAnchors.erase(iter);
+	return RN_SUCCESS;
+}
+
+/**
+ * Streams tiles in/out around the current anchors' positions.
+ * \note Internal use only.
+ */
+void RNNavMesh::do_update_tile_streaming()
+{
+	pvector<float> anchors;
+	anchors.reserve(mTileStreamAnchors.size() * 3);
+	pvector<NodePath>::const_iterator iter;
+	for (iter = mTileStreamAnchors.begin(); iter != mTileStreamAnchors.end();
+			++iter)
+	{
+		if (iter->is_empty())
+		{
+			continue;
+		}
+		float recastPos[3];
+		rnsup::LVecBase3fToRecast(iter->get_pos(mReferenceNP), recastPos);
+		anchors.insert(anchors.end(), recastPos, recastPos + 3);
+	}
+	std::vector<int> changedTiles;
+	mTileStreamer.update(anchors.empty() ? NULL : &anchors[0],
+			(int) anchors.size() / 3, changedTiles);
+	if (changedTiles.empty())
+	{
+		return;
+	}
+	for (unsigned int i = 0; i < changedTiles.size(); i += 2)
+	{
+		do_tile_changed(changedTiles[i], changedTiles[i + 1]);
+	}
+#ifdef RN_DEBUG
+	if (! mDebugCamera.is_empty())
+	{
+		do_debug_static_render();
+	}
+#endif //RN_DEBUG
+}
+
+/**
+ * Sets the maximum number of paths kept by the path cache: 0 (the default)
+ * disables it.
+ * When enabled, the polygon corridors found by path_find_follow(),
+ * path_find_follow_cost() and path_find_straight() are cached and reused by
+ * subsequent queries with the same start and end polygons (and filter), so
+ * that only string-pulling is performed.
+ * Cached paths are invalidated when a tile they cross is rebuilt or removed,
+ * or when the area costs change.
+ */
+void RNNavMesh::set_path_cache_size(int size)
+{
+	mPathCache.setCapacity(size);
+}
+
+/**
+ * Removes all the paths kept by the path cache.
+ */
+void RNNavMesh::clear_path_cache()
+{
+	mPathCache.clear();
+}
+
+/**
+ * Removes all the flow fields: they will be rebuilt on next requests.
+ */
+void RNNavMesh::clear_flow_fields()
+{
+	mFlowFields.clear();
+}
+
+/**
+ * Returns the build and memory statistics of the navigation mesh.
+ * Stage times are accumulated since the last full build (or reset_stats()),
+ * so they account for the tiles rebuilt afterwards too.
+ * Should be called after RNNavMesh setup.
+ * Returns empty statistics on error.
+ */
+RNNavMeshStats RNNavMesh::get_stats() const
+{
+	// continue if nav mesh has been already setup
+	CONTINUE_IF_ELSE_R(mNavMeshType, RNNavMeshStats())
+
+	RNNavMeshStats stats;
+	stats.set_build_time(mBuildTime);
+	for (int i = 0; i < stats.get_num_stages(); ++i)
+	{
+		stats.set_stage_time(i,
+				mCtx->getStatTime((rcTimerLabel) i) / 1000.0);
+	}
+	//navigation mesh
+	const dtNavMesh* navMesh = mNavMeshType->getNavMesh();
+	if (navMesh)
+	{
+		int numTiles = 0, numPolys = 0, numVerts = 0, numDetailTris = 0,
+				dataSize = 0;
+		for (int i = 0; i < navMesh->getMaxTiles(); ++i)
+		{
+			const dtMeshTile* tile = navMesh->getTile(i);
+			if (!tile->header)
+			{
+				continue;
+			}
+			numTiles++;
+			numPolys += tile->header->polyCount;
+			numVerts += tile->header->vertCount;
+			numDetailTris += tile->header->detailTriCount;
+			dataSize += tile->dataSize;
+		}
+		stats.set_tiles(numTiles, navMesh->getMaxTiles());
+		stats.set_nav_mesh_sizes(numPolys, numVerts, numDetailTris, dataSize);
+	}
+	//tile cache
+	if (mNavMeshTypeEnum == OBSTACLE)
+	{
+		int numLayers, compressedSize, rawSize, allocHighWater;
+		static_cast<rnsup::NavMeshType_Obstacle*>(mNavMeshType)->getCacheStats(
+				numLayers, compressedSize, rawSize, allocHighWater);
+		stats.set_cache_sizes(numLayers, compressedSize, rawSize,
+				allocHighWater);
+	}
+	return stats;
+}
+
+/**
+ * Resets the build stages' times of the statistics.
+ * Should be called after RNNavMesh setup.
+ */
+void RNNavMesh::reset_stats()
+{
+	// continue if nav mesh has been already setup
+	CONTINUE_IF_ELSE_V(mNavMeshType)
+
+	mCtx->resetStats();
+}
+
+/**
+ * Updates the path cache, the flow fields and the tile graph after the tile
+ * at (tx,ty) has been rebuilt or removed.
+ * \note Internal use only.
+ */
+void RNNavMesh::do_tile_changed(int tx, int ty)
+{
+	mPathCache.invalidateTile(tx, ty);
+	//flow fields span the whole navigation mesh
+	mFlowFields.clear();
+	if (mTileGraph)
+	{
+		mTileGraph->updateTile(tx, ty);
+	}
+}
+
+/**
+ * Adds an obstacle as NodePath (OBSTACLE).
+ * Returns the obstacle's unique reference (>0), or a negative number on error.
+ */
+int RNNavMesh::add_obstacle(NodePath objectNP)
+{
+	return do_add_obstacle(objectNP, true);
+}
+
+/**
+ * Adds a collection of obstacles as NodePaths (OBSTACLE), rebuilding the tiles
+ * touched by all of them only once.
+ * Returns the number of obstacles successfully added, or a negative number on
+ * error.
+ */
+int RNNavMesh::add_obstacles(const NodePathCollection& objectNPs)
+{
+	// continue if we have OBSTACLE nav mesh type
+	CONTINUE_IF_ELSE_R(mNavMeshTypeEnum == OBSTACLE, RN_ERROR)
+
+	int added = 0;
+	for (int i = 0; i < objectNPs.get_num_paths(); ++i)
+	{
+		NodePath objectNP = objectNPs.get_path(i);
+		if (do_add_obstacle(objectNP, false) >= 0)
+		{
+			++added;
+		}
+	}
+	if (mNavMeshType && (mObstacleUpdateBudget == 0.0))
+	{
+		do_flush_obstacles();
+	}
+	return added;
+}
+
+/**
+ * Adds an obstacle as NodePath: if flush is false its tiles are rebuilt only by
+ * the next do_update_obstacles().
+ * Returns the obstacle's unique reference (>0), or a negative number on error.
+ * \note Internal use only.
+ */
+int RNNavMesh::do_add_obstacle(NodePath& objectNP, bool flush)
+{
+	// continue if not empty node paths and we have OBSTACLE
+	// nav mesh type and mReferenceNP is not empty
+	CONTINUE_IF_ELSE_R(
+			(!objectNP.is_empty()) && (mNavMeshTypeEnum == OBSTACLE)
+					&& (! mReferenceNP.is_empty()), RN_ERROR)
+
+	// return error if objectNP is already present
+	pvector<Obstacle>::iterator iterO;
+	for (iterO = mObstacles.begin(); iterO < mObstacles.end(); ++iterO)
+	{
+		if ((*iterO).second().node() == objectNP.node())
+		{
+			// break: objectNP is already present
+			break;
+		}
+	}
+	CONTINUE_IF_ELSE_R(iterO == mObstacles.end(), RN_ERROR)
+
+	// insert obstacle with invalid ref: later will be corrected
+	RNObstacleSettings settings;
+	settings.set_ref(RN_ERROR);
+	mObstacles.push_back(Obstacle(settings, objectNP));
+
+	// continue if nav mesh has been already setup
+	CONTINUE_IF_ELSE_R(mNavMeshType, RN_ERROR)
+
+	// return the result of adding obstacle to recast
+	return do_add_obstacle_to_recast(objectNP, mObstacles.size() - 1, false,
+			flush);
+}
+
+/**
+ * Adds obstacle to the underlying nav mesh: if flush is false (or there is an
+ * update budget) the tile cache is updated only by the next
+ * do_update_obstacles().
+ * Returns a negative number on error.
+ * \note Internal use only.
+ */
+int RNNavMesh::do_add_obstacle_to_recast(NodePath& objectNP, int index,
+		bool buildFromBam, bool flush)
+{
+	//get obstacle dimensions
+	LVecBase3f modelDims;
+	LVector3f modelDeltaCenter;
+	float modelRadius;
+	if (!buildFromBam)
+	{
+		//compute new obstacle dimensions
+		modelRadius =
+				RNNavMeshManager::get_global_ptr()->get_bounding_dimensions(
+						objectNP, modelDims, modelDeltaCenter);
+	}
+	else
+	{
+		modelRadius = mObstacles[index].first().get_radius();
+		modelDims = mObstacles[index].first().get_dims();
+	}
+
+	//the obstacle is reparented to the RNNavMesh's reference node path
+	objectNP.wrt_reparent_to(mReferenceNP);
+
+	//calculate pos wrt reference node path
+	LPoint3f pos = objectNP.get_pos();
+	//add detour obstacle
 	dtObstacleRef obstacleRef;
 	float recastPos[3];
 	rnsup::LVecBase3fToRecast(pos, recastPos);
 	dtTileCache* tileCache =
 			static_cast<rnsup::NavMeshType_Obstacle*>(mNavMeshType)->getTileCache();
+	dtStatus status = tileCache->addObstacle(recastPos, modelRadius,
+			modelDims.get_z(), &obstacleRef);
+	if (dtStatusDetail(status, DT_BUFFER_TOO_SMALL))
+	{
+		//the tile cache's request queue is full: apply it and retry
+		do_flush_obstacles();
+		status = tileCache->addObstacle(recastPos, modelRadius,
+				modelDims.get_z(), &obstacleRef);
+	}
 	// continue if obstacle addition to tile cache is successful
-	CONTINUE_IF_ELSE_R(
-			tileCache->addObstacle(recastPos, modelRadius, modelDims.get_z(),
-					&obstacleRef) == DT_SUCCESS, RN_ERROR)
+	CONTINUE_IF_ELSE_R(status == DT_SUCCESS, RN_ERROR)
 
-	//update tiles cache: repeat for all the tiles touched
-	for (int c = 0; c < DT_MAX_TOUCHED_TILES; ++c)
+	mObstacleUpdatePending = true;
+	if (flush && (mObstacleUpdateBudget == 0.0))
 	{
-		tileCache->update(0, mNavMeshType->getNavMesh());
+		do_flush_obstacles();
 	}
 	//correct to the obstacle settings
 	if (!buildFromBam)
@@ -1974,12 +2770,6 @@ int RNNavMesh::do_add_obstacle_to_recast(NodePath& objectNP, int index,
 	mObstacles[index].first().set_ref(obstacleRef);
 	PRINT_DEBUG(
 			"'" << get_owner_node_path() << "' add_obstacle: '" << objectNP << "' at pos: " << pos);
-#ifdef RN_DEBUG
-	if (!mDebugCamera.is_empty())
-	{
-		do_debug_static_render();
-	}
-#endif //RN_DEBUG
 	// obstacle added: return the last index
 	return (int) obstacleRef;
 }
@@ -1989,6 +2779,44 @@ int RNNavMesh::do_add_obstacle_to_recast(NodePath& objectNP, int index,
  * Returns the old obstacle's unique reference (>0), or a negative number on error.
  */
 int RNNavMesh::remove_obstacle(NodePath objectNP)
+{
+	return do_remove_obstacle(objectNP, true);
+}
+
+/**
+ * Removes a collection of obstacles as NodePaths (OBSTACLE), rebuilding the
+ * tiles touched by all of them only once.
+ * Returns the number of obstacles successfully removed, or a negative number
+ * on error.
+ */
+int RNNavMesh::remove_obstacles(const NodePathCollection& objectNPs)
+{
+	// continue if we have OBSTACLE nav mesh type
+	CONTINUE_IF_ELSE_R(mNavMeshTypeEnum == OBSTACLE, RN_ERROR)
+
+	int removed = 0;
+	for (int i = 0; i < objectNPs.get_num_paths(); ++i)
+	{
+		NodePath objectNP = objectNPs.get_path(i);
+		if (do_remove_obstacle(objectNP, false) >= 0)
+		{
+			++removed;
+		}
+	}
+	if (mNavMeshType && (mObstacleUpdateBudget == 0.0))
+	{
+		do_flush_obstacles();
+	}
+	return removed;
+}
+
+/**
+ * Removes an obstacle as NodePath: if flush is false its tiles are rebuilt
+ * only by the next do_update_obstacles().
+ * Returns the old obstacle's unique reference (>0), or a negative number on error.
+ * \note Internal use only.
+ */
+int RNNavMesh::do_remove_obstacle(NodePath& objectNP, bool flush)
 {
 	// continue if not empty node paths and we have OBSTACLE
 	// nav mesh type and mReferenceNP is not empty
@@ -2016,39 +2844,163 @@ int RNNavMesh::remove_obstacle(NodePath objectNP)
 	CONTINUE_IF_ELSE_R(mNavMeshType, RN_ERROR)
 
 	// return the result of removing obstacle from recast
-	return do_remove_obstacle_from_recast(objectNP, obstacleRef);
+	return do_remove_obstacle_from_recast(objectNP, obstacleRef, flush);
 }
 
 /**
- * Removes obstacle from underlying nav mesh.
+ * Removes obstacle from underlying nav mesh: if flush is false (or there is an
+ * update budget) the tile cache is updated only by the next
+ * do_update_obstacles().
  * Returns a negative number on error.
  * \note Internal use only.
  */
 int RNNavMesh::do_remove_obstacle_from_recast(NodePath& objectNP,
-		int obstacleRef)
+		int obstacleRef, bool flush)
 {
 	//remove recast obstacle
 	dtTileCache* tileCache =
 			static_cast<rnsup::NavMeshType_Obstacle*>(mNavMeshType)->getTileCache();
+	dtStatus status = tileCache->removeObstacle(obstacleRef);
+	if (dtStatusDetail(status, DT_BUFFER_TOO_SMALL))
+	{
+		//the tile cache's request queue is full: apply it and retry
+		do_flush_obstacles();
+		status = tileCache->removeObstacle(obstacleRef);
+	}
 	// continue if obstacle removal from tile cache is successful
-	CONTINUE_IF_ELSE_R(tileCache->removeObstacle(obstacleRef) == DT_SUCCESS, RN_ERROR)
+	CONTINUE_IF_ELSE_R(status == DT_SUCCESS, RN_ERROR)
 
-	//update tiles cache: repeat for all the tiles touched
-	for (int c = 0; c < DT_MAX_TOUCHED_TILES; ++c)
+	mObstacleUpdatePending = true;
+	if (flush && (mObstacleUpdateBudget == 0.0))
 	{
-		tileCache->update(0, mNavMeshType->getNavMesh());
+		do_flush_obstacles();
 	}
 	//index and remove from obstacle from the list
 	PRINT_DEBUG(
 			"'" << get_owner_node_path() << "' remove_obstacle: '" << objectNP << "'");
+	// obstacle removed
+	return (int) obstacleRef;
+}
+
+/**
+ * Updates an obstacle's position from its NodePath (OBSTACLE), without
+ * removing and re-adding it: its dimensions are not recomputed, and only the
+ * tiles it touched before or after the move are rebuilt (once). Moves shorter
+ * than a cell are ignored.
+ * Returns the obstacle's unique reference (>0), or a negative number on error.
+ */
+int RNNavMesh::update_obstacle(NodePath objectNP)
+{
+	// continue if not empty node paths and we have OBSTACLE
+	// nav mesh type and nav mesh has been already setup
+	CONTINUE_IF_ELSE_R(
+			(!objectNP.is_empty()) && (mNavMeshTypeEnum == OBSTACLE)
+					&& mNavMeshType, RN_ERROR)
+
+	pvector<Obstacle>::iterator iterO;
+	for (iterO = mObstacles.begin(); iterO < mObstacles.end(); ++iterO)
+	{
+		if ((*iterO).second().node() == objectNP.node())
+		{
+			// break: objectNP is present
+			break;
+		}
+	}
+	CONTINUE_IF_ELSE_R(iterO != mObstacles.end(), RN_ERROR)
+
+	return do_move_obstacle(*iterO, true);
+}
+
+/**
+ * Moves obstacle in the underlying nav mesh to its NodePath's current
+ * position: if flush is false (or there is an update budget) the tile cache
+ * is updated only by the next do_update_obstacles().
+ * Returns a negative number on error.
+ * \note Internal use only.
+ */
+int RNNavMesh::do_move_obstacle(Obstacle& obstacle, bool flush)
+{
+	dtObstacleRef obstacleRef = obstacle.first().get_ref();
+	//calculate pos wrt reference node path
+	LPoint3f pos = obstacle.second().get_pos(mReferenceNP);
+	float recastPos[3];
+	rnsup::LVecBase3fToRecast(pos, recastPos);
+	//move detour obstacle (moves shorter than a cell are ignored)
+	dtTileCache* tileCache =
+			static_cast<rnsup::NavMeshType_Obstacle*>(mNavMeshType)->getTileCache();
+	dtStatus status = tileCache->moveObstacle(obstacleRef, recastPos);
+	if (dtStatusDetail(status, DT_BUFFER_TOO_SMALL))
+	{
+		//the tile cache's request queue is full: apply it and retry
+		do_flush_obstacles();
+		status = tileCache->moveObstacle(obstacleRef, recastPos);
+	}
+	// continue if obstacle move in tile cache is successful
+	CONTINUE_IF_ELSE_R(status == DT_SUCCESS, RN_ERROR)
+
+	mObstacleUpdatePending = true;
+	if (flush && (mObstacleUpdateBudget == 0.0))
+	{
+		do_flush_obstacles();
+	}
+	return (int) obstacleRef;
+}
+
+/**
+ * Applies the pending obstacle changes to the tile cache, rebuilding the
+ * touched tiles in batches (one tile per worker thread) until all are done or
+ * budget milliseconds (if > 0) have elapsed, and updates what depends on the
+ * rebuilt tiles.
+ * \note Internal use only.
+ */
+void RNNavMesh::do_update_obstacles(float budget)
+{
+	rnsup::NavMeshType_Obstacle* obstacleType =
+			static_cast<rnsup::NavMeshType_Obstacle*>(mNavMeshType);
+	int batchSize = mParallelTileBuild ?
+			RNNavMeshManager::get_global_ptr()->get_worker_pool().getNumWorkers() :
+			1;
+	pvector<int> tiles(batchSize * 2);
+	pset<pair<int, int> > changedTiles;
+	rnsup::TimeVal startTime = rnsup::getPerfTime();
+	bool upToDate = false;
+	while (!upToDate)
+	{
+		int ntiles = obstacleType->updateTileCache(batchSize, &tiles[0],
+				&upToDate);
+		//notify each changed tile once
+		for (int i = 0; i < ntiles; ++i)
+		{
+			if ((tiles[i * 2] >= 0)
+					&& changedTiles.insert(
+							pair<int, int>(tiles[i * 2], tiles[i * 2 + 1])).second)
+			{
+				do_tile_changed(tiles[i * 2], tiles[i * 2 + 1]);
+			}
+		}
+		if ((budget > 0.0)
+				&& (rnsup::getPerfTimeUsec(rnsup::getPerfTime() - startTime)
+						>= budget * 1000.0))
+		{
+			break;
+		}
+	}
+	mObstacleUpdatePending = !upToDate;
 #ifdef RN_DEBUG
-	if (! mDebugCamera.is_empty())
+	if (!changedTiles.empty() && !mDebugCamera.is_empty())
 	{
 		do_debug_static_render();
 	}
 #endif //RN_DEBUG
-	// obstacle removed
-	return (int) obstacleRef;
+}
+
+/**
+ * Applies all the pending obstacle changes to the tile cache synchronously.
+ * \note Internal use only.
+ */
+void RNNavMesh::do_flush_obstacles()
+{
+	do_update_obstacles(0.0);
 }
 
 /**
@@ -2085,9 +3037,14 @@ int RNNavMesh::remove_all_obstacles()
 	PTA(Obstacle)::iterator iter = mObstacles.begin();
 	while (iter != mObstacles.end())
 	{
-		remove_obstacle(iter->second());
+		do_remove_obstacle(iter->second(), false);
 		iter = mObstacles.begin();
 	}
+	//rebuild all touched tiles at once
+	if (mNavMeshType && (mObstacleUpdateBudget == 0.0))
+	{
+		do_flush_obstacles();
+	}
 
 	//
 	return RN_SUCCESS;
@@ -2528,6 +3485,11 @@ void RNNavMesh::do_create_nav_mesh_type(rnsup::NavMeshType* navMeshType)
 	mNavMeshType = navMeshType;
 	//set rcContext
 	mNavMeshType->setContext(mCtx);
+	//set worker threads
+	mNavMeshType->setWorkerPool(mParallelTileBuild ?
+			&RNNavMeshManager::get_global_ptr()->get_worker_pool() : NULL);
+	//set tile build cache (disabled if without directory)
+	mNavMeshType->setBuildCache(&mTileBuildCache);
 	//handle Mesh Changed
 	mNavMeshType->handleMeshChanged(mGeom);
 }
@@ -2552,20 +3514,96 @@ void RNNavMesh::update(float dt)
 			static_cast<rnsup::CrowdTool*>(mNavMeshType->getTool());
 	dtCrowd* crowd = crowdTool->getState()->getCrowd();
 
+	//stream tiles in/out around the anchors
+	if (mTileStreamer.isOpen())
+	{
+		do_update_tile_streaming();
+	}
+
+	//advance asynchronous path requests
+	do_update_async_paths();
+
+	//serve agents' move requests from flow fields (if enabled)
+	mFlowFields.update(crowd);
+
+	//keep the crowd's workers in sync with the worker threads: the pool is
+	//held until the crowd has been updated, so the per-agent phases aren't
+	//interleaved with other callers' jobs (batch queries, tile builds)
+	rnsup::WorkerPool& pool =
+			RNNavMeshManager::get_global_ptr()->get_worker_pool();
+	std::unique_lock<rnsup::WorkerPool> poolLock(pool);
+	int numWorkers = mCrowdParallelUpdate ? pool.getNumWorkers() : 1;
+	if (crowd->getNumWorkers() != numWorkers)
+	{
+		crowd->setParallelFor(numWorkers > 1 ? &do_crowd_parallel_for : NULL,
+				&pool, numWorkers);
+	}
+
+	//pick up the obstacles' movements
+	if (mObstacleAutoUpdate && (mNavMeshTypeEnum == OBSTACLE))
+	{
+		pvector<Obstacle>::iterator iterO;
+		for (iterO = mObstacles.begin(); iterO != mObstacles.end(); ++iterO)
+		{
+			do_move_obstacle(*iterO, false);
+		}
+	}
+
+	//rebuild the tiles touched by obstacle changes (within the budget)
+	if (mObstacleUpdatePending)
+	{
+		do_update_obstacles(mObstacleUpdateBudget);
+	}
+
 	//update crowd agents' pos/vel
 	mNavMeshType->handleUpdate(dt);
+	poolLock.unlock();
+
+	//correct panda's Z of the moving kinematic agents: their collision
+	//rays are all checked with a single collision traversal
+	WPT(RNNavMeshManager) navMeshMgr = RNNavMeshManager::get_global_ptr();
+	NodePath collisionRoot = navMeshMgr->get_collision_root();
+	pvector<LPoint3f> rayOrigins;
+	pvector<int> rayIndexes(mCrowdAgents.size(), -1);
+	for (unsigned int i = 0; i < mCrowdAgents.size(); ++i)
+	{
+		PT(RNCrowdAgent)crowdAgent = mCrowdAgents[i];
+		const dtCrowdAgent* agent = crowd->getAgent(crowdAgent->mAgentIdx);
+		if ((crowdAgent->mMovType == RNCrowdAgent::RECAST_KINEMATIC)
+				&& (dtVlenSqr(agent->vel) > 0.0))
+		{
+			//set the collision ray origin wrt collision root
+			rayIndexes[i] = (int) rayOrigins.size();
+			rayOrigins.push_back(
+					collisionRoot.get_relative_point(crowdAgent->mReferenceNP,
+							rnsup::RecastToLVecBase3f(agent->npos))
+							+ crowdAgent->mHeigthCorrection);
+		}
+	}
+	pvector<Pair<bool,LPoint3f> > rayHits;
+	if (! rayOrigins.empty())
+	{
+		navMeshMgr->get_collision_hits(rayOrigins, rayHits);
+	}
 
 	//post-update all agent positions
-	pvector<PT(RNCrowdAgent)>::iterator iter;
-	for (iter = mCrowdAgents.begin(); iter != mCrowdAgents.end(); ++iter)
+	for (unsigned int i = 0; i < mCrowdAgents.size(); ++i)
 	{
-		int agentIdx = (*iter)->mAgentIdx;
+		PT(RNCrowdAgent)crowdAgent = mCrowdAgents[i];
+		int agentIdx = crowdAgent->mAgentIdx;
 		//give RNCrowdAgent a chance to update its pos/vel
 		LPoint3f agentPos = rnsup::RecastToLVecBase3f(
 				crowd->getAgent(agentIdx)->npos);
 		LVector3f agentDir = rnsup::RecastToLVecBase3f(
 				crowd->getAgent(agentIdx)->vel);
-		(*iter)->do_update_pos_dir(dt, agentPos, agentDir);
+		if ((rayIndexes[i] >= 0) && rayHits[rayIndexes[i]].get_first())
+		{
+			//agentPos.z needs correction: get the collision height wrt the
+			//reference node path
+			agentPos.set_z(crowdAgent->mReferenceNP.get_relative_point(
+					collisionRoot, rayHits[rayIndexes[i]].get_second()).get_z());
+		}
+		crowdAgent->do_update_pos_dir(dt, agentPos, agentDir);
 	}
 	//
 #ifdef RN_DEBUG
@@ -2783,6 +3821,332 @@ float RNNavMesh::distance_to_wall(const LPoint3f& pos)
 	return distance;
 }
 
+/**
+ * Creates a re-entrant query object for this RNNavMesh, with its own
+ * dtNavMeshQuery (which uses a node pool of maxNodes nodes).
+ * Should be called after RNNavMesh setup.
+ * Returns NULL on error.
+ * \note Unlike the tester queries above, different RNNavMeshQuery(s) can be
+ * used concurrently (see RNNavMeshQuery).
+ */
+PT(RNNavMeshQuery) RNNavMesh::create_query(int maxNodes)
+{
+	// continue if nav mesh has been already setup
+	CONTINUE_IF_ELSE_R(mNavMeshType && (maxNodes > 0), NULL)
+
+	PT(RNNavMeshQuery) query = new RNNavMeshQuery(this, maxNodes);
+	CONTINUE_IF_ELSE_R(query->is_valid(), NULL)
+
+	return query;
+}
+
+/**
+ * Requests a straight path from the start point to the end point, which will
+ * be found asynchronously, during the next updates.
+ * Returns the request's handle (> 0), or a negative number on error.
+ * \note The request's result should be retrieved (or the request cancelled)
+ * to release it.
+ */
+int RNNavMesh::path_find_straight_async(const LPoint3f& startPos,
+		const LPoint3f& endPos, RNStraightPathOptions crossingOptions)
+{
+	// continue if nav mesh has been already setup
+	CONTINUE_IF_ELSE_R(mNavMeshType, RN_ERROR)
+
+	float recastStart[3], recastEnd[3];
+	rnsup::LVecBase3fToRecast(startPos, recastStart);
+	rnsup::LVecBase3fToRecast(endPos, recastEnd);
+	unsigned int ref = mPathRequests->request(recastStart, recastEnd,
+			crossingOptions);
+	CONTINUE_IF_ELSE_R(ref > 0, RN_ERROR)
+
+	return (int) ref;
+}
+
+/**
+ * Returns the status of an asynchronous path request.
+ */
+RNNavMesh::RNAsyncPathStatus RNNavMesh::get_async_path_status(int handle) const
+{
+	// continue if nav mesh has been already setup
+	CONTINUE_IF_ELSE_R(mNavMeshType && (handle > 0), ASYNC_PATH_INVALID)
+
+	return (RNAsyncPathStatus) mPathRequests->getRequestStatus(handle);
+}
+
+/**
+ * Returns the straight path found by a completed asynchronous path request,
+ * which is then released.
+ * Returns an empty list if the request is still pending (and it is not
+ * released) or on error.
+ */
+RNNavMesh::PointFlagList RNNavMesh::get_async_path(int handle)
+{
+	// continue if nav mesh has been already setup
+	CONTINUE_IF_ELSE_R(mNavMeshType && (handle > 0), PointFlagList())
+	// continue if request is completed
+	RNAsyncPathStatus status =
+			(RNAsyncPathStatus) mPathRequests->getRequestStatus(handle);
+	CONTINUE_IF_ELSE_R(
+			(status == ASYNC_PATH_SUCCEEDED) || (status == ASYNC_PATH_FAILED),
+			PointFlagList())
+
+	PointFlagList pointFlagList;
+	const float* points;
+	const unsigned char* flags;
+	int numPoints = mPathRequests->getRequestResult(handle, &points, &flags);
+	for (int i = 0; i < numPoints; ++i)
+	{
+		pointFlagList.add_value(
+				Pair<LPoint3f, unsigned char>(
+						rnsup::Recast3fToLVecBase3f(points[i * 3],
+								points[i * 3 + 1], points[i * 3 + 2]),
+						flags[i]));
+	}
+	mPathRequests->removeRequest(handle);
+	return pointFlagList;
+}
+
+/**
+ * Cancels an asynchronous path request (pending or not), releasing it.
+ * Returns a negative number on error.
+ */
+int RNNavMesh::cancel_async_path(int handle)
+{
+	// continue if nav mesh has been already setup
+	CONTINUE_IF_ELSE_R(mNavMeshType && (handle > 0), RN_ERROR)
+
+	return mPathRequests->removeRequest(handle) ? RN_SUCCESS : RN_ERROR;
+}
+
+/**
+ * Advances the pending asynchronous path requests, within the iterations'
+ * budget, and throws the completion events (if enabled).
+ * \note Internal use only.
+ */
+void RNNavMesh::do_update_async_paths()
+{
+	// continue if there are pending requests
+	CONTINUE_IF_ELSE_V(
+			mPathRequests && (mPathRequests->getNumPendingRequests() > 0))
+
+	std::vector<unsigned int> completed;
+	mPathRequests->update(mAsyncPathMaxIterations, &completed);
+	if (! mAsyncPathEvent.empty())
+	{
+		for (unsigned int i = 0; i < completed.size(); ++i)
+		{
+			throw_event(mAsyncPathEvent, EventParameter(this),
+					EventParameter((int) completed[i]));
+		}
+	}
+}
+
+/**
+ * Finds a straight path from the start point to the end point, through a
+ * hierarchical search (TILE and OBSTACLE types only).
+ * An abstract graph of the portals between tiles is searched first, then only
+ * the polygons of the crossed tiles are searched, so this method is meant for
+ * long paths across many tiles: unlike path_find_straight(), the path length
+ * isn't limited by the maximum number of polygons.
+ * The graph is built on the first call and kept updated on tile changes.
+ * Returns a list of points, empty on error.
+ */
+RNNavMesh::PointFlagList RNNavMesh::path_find_hierarchical(
+		const LPoint3f& startPos, const LPoint3f& endPos,
+		RNStraightPathOptions crossingOptions)
+{
+	// continue if nav mesh has been already setup and has tiles
+	CONTINUE_IF_ELSE_R(mNavMeshType &&
+			((mNavMeshTypeEnum == TILE) || (mNavMeshTypeEnum == OBSTACLE)),
+			PointFlagList())
+
+	if (! mTileGraph)
+	{
+		CONTINUE_IF_ELSE_R(build_tile_graph() == RN_SUCCESS, PointFlagList())
+	}
+
+	PointFlagList pointFlagList;
+	float recastStart[3], recastEnd[3];
+	rnsup::LVecBase3fToRecast(startPos, recastStart);
+	rnsup::LVecBase3fToRecast(endPos, recastEnd);
+	int numPoints = mTileGraph->findStraightPath(recastStart, recastEnd,
+			crossingOptions);
+	const float* points = mTileGraph->getStraightPath();
+	const unsigned char* flags = mTileGraph->getStraightPathFlags();
+	for (int i = 0; i < numPoints; ++i)
+	{
+		pointFlagList.add_value(
+				Pair<LPoint3f, unsigned char>(
+						rnsup::Recast3fToLVecBase3f(points[i * 3],
+								points[i * 3 + 1], points[i * 3 + 2]),
+						flags[i]));
+	}
+	return pointFlagList;
+}
+
+/**
+ * (Re)builds the abstract graph of tiles used by path_find_hierarchical()
+ * (TILE and OBSTACLE types only).
+ * This is done automatically on first use, so this method can be called to
+ * avoid the building time at the first query.
+ * Returns a negative number on error.
+ */
+int RNNavMesh::build_tile_graph()
+{
+	// continue if nav mesh has been already setup and has tiles
+	CONTINUE_IF_ELSE_R(mNavMeshType &&
+			((mNavMeshTypeEnum == TILE) || (mNavMeshTypeEnum == OBSTACLE)),
+			RN_ERROR)
+
+	do_reset_tile_graph();
+	mTileGraph = new rnsup::TileGraph();
+	if (! mTileGraph->init(mNavMeshType->getNavMesh(),
+			mNavMeshType->getCrowd()->getFilter(0)))
+	{
+		do_reset_tile_graph();
+		return RN_ERROR;
+	}
+	mTileGraph->buildAll();
+	return RN_SUCCESS;
+}
+
+/**
+ * Deletes the tile graph: it will be rebuilt on next use.
+ * \note Internal use only.
+ */
+void RNNavMesh::do_reset_tile_graph()
+{
+	delete mTileGraph;
+	mTileGraph = NULL;
+}
+
+/**
+ * Finds a path from each start point to the corresponding end point, using
+ * the RNNavMeshManager's worker threads.
+ * Returns all the paths, in the same order as the extremes, into a single
+ * RNPathBatchResult (a path not found has no points), which is empty on error.
+ * \note The RNNavMesh should not be modified while this method is executing.
+ */
+RNPathBatchResult RNNavMesh::path_find_follow_batch(
+		const ValueList<LPoint3f>& startPositions,
+		const ValueList<LPoint3f>& endPositions)
+{
+	return do_path_find_batch(startPositions, endPositions, false,
+			NONE_CROSSINGS);
+}
+
+/**
+ * Finds a straight path from each start point to the corresponding end point,
+ * using the RNNavMeshManager's worker threads.
+ * Returns all the paths, in the same order as the extremes, into a single
+ * RNPathBatchResult (a path not found has no points), which is empty on error.
+ * \note The RNNavMesh should not be modified while this method is executing.
+ */
+RNPathBatchResult RNNavMesh::path_find_straight_batch(
+		const ValueList<LPoint3f>& startPositions,
+		const ValueList<LPoint3f>& endPositions,
+		RNStraightPathOptions crossingOptions)
+{
+	return do_path_find_batch(startPositions, endPositions, true,
+			crossingOptions);
+}
+
+/**
+ * Runs a dtCrowd's (per agent) job on the worker threads (of the manager's
+ * pool, which update() holds during the whole crowd update).
+ * \note Internal use only.
+ */
+void RNNavMesh::do_crowd_parallel_for(void* workerPool, const int count,
+		dtCrowdJobFunc job, void* jobContext)
+{
+	static_cast<rnsup::WorkerPool*>(workerPool)->parallelFor(count,
+			[job, jobContext](int index, int worker)
+			{
+				job(jobContext, index, worker);
+			});
+}
+
+/**
+ * Makes available a query for each worker thread.
+ * \note Internal use only.
+ */
+void RNNavMesh::do_setup_batch_queries(int numWorkers)
+{
+	dtNavMesh* navMesh = mNavMeshType->getNavMesh();
+	const dtQueryFilter* filter = mNavMeshType->getCrowd()->getFilter(0);
+	while ((int) mBatchQueries.size() < numWorkers)
+	{
+		mBatchQueries.push_back(new rnsup::NavMeshTesterQuery());
+	}
+	for (unsigned int i = 0; i < mBatchQueries.size(); ++i)
+	{
+		if (mBatchQueries[i]->getNavMesh() != navMesh)
+		{
+			mBatchQueries[i]->init(navMesh, filter);
+		}
+		//keep in sync with the current crowd filter
+		mBatchQueries[i]->getFilter() = *filter;
+	}
+}
+
+/**
+ * Finds (straight) paths in parallel.
+ * \note Internal use only.
+ */
+RNPathBatchResult RNNavMesh::do_path_find_batch(
+		const ValueList<LPoint3f>& startPositions,
+		const ValueList<LPoint3f>& endPositions, bool straight,
+		int crossingOptions)
+{
+	// continue if nav mesh has been already setup
+	CONTINUE_IF_ELSE_R(mNavMeshType &&
+			(startPositions.size() == endPositions.size()), RNPathBatchResult())
+
+	rnsup::WorkerPool& pool =
+			RNNavMeshManager::get_global_ptr()->get_worker_pool();
+	//hold the pool: the batch queries are shared by its callers
+	std::lock_guard<rnsup::WorkerPool> poolLock(pool);
+	do_setup_batch_queries(pool.getNumWorkers());
+
+	//find the paths: each one into its own slot
+	int numPaths = startPositions.size();
+	pvector<pvector<float> > points(numPaths);
+	pvector<pvector<unsigned char> > flags(straight ? numPaths : 0);
+	pool.parallelFor(numPaths, [&](int index, int worker)
+	{
+		rnsup::NavMeshTesterQuery* query = mBatchQueries[worker];
+		float recastStart[3], recastEnd[3];
+		rnsup::LVecBase3fToRecast(startPositions[index], recastStart);
+		rnsup::LVecBase3fToRecast(endPositions[index], recastEnd);
+		if (straight)
+		{
+			int numPoints = query->findPathStraight(recastStart, recastEnd,
+					crossingOptions);
+			points[index].assign(query->getStraightPath(),
+					query->getStraightPath() + numPoints * 3);
+			flags[index].assign(query->getStraightPathFlags(),
+					query->getStraightPathFlags() + numPoints);
+		}
+		else
+		{
+			int numPoints = query->findPathFollow(recastStart, recastEnd);
+			points[index].assign(query->getSmoothPath(),
+					query->getSmoothPath() + numPoints * 3);
+		}
+	});
+
+	//gather them into the flat result
+	RNPathBatchResult result;
+	for (int i = 0; i < numPaths; ++i)
+	{
+		result.add_path(points[i].empty() ? NULL : &points[i][0],
+				straight && (!flags[i].empty()) ? &flags[i][0] : NULL,
+				(int) points[i].size() / 3);
+	}
+	return result;
+}
+
 /**
  * Writes a sensible description of the RNNavMesh to the indicated output
  * stream.
@@ -2864,6 +4228,8 @@ void RNNavMesh::enable_debug_drawing(NodePath debugCamera)
 		}
 		mDDM = new rnsup::DebugDrawMeshDrawer(mDebugNodePath, meshDrawerCamera,
 				100);
+		mDDTiles = new rnsup::DebugDrawNavMeshTiles(mDebugNodePath);
+		mNavMeshType->setTilesDebugDraw(mDDTiles);
 		//debug static render
 		do_debug_static_render();
 	}
@@ -2894,6 +4260,15 @@ void RNNavMesh::disable_debug_drawing()
 		delete mDDM;
 		mDDM = NULL;
 	}
+	if (mDDTiles)
+	{
+		if (mNavMeshType)
+		{
+			mNavMeshType->setTilesDebugDraw(NULL);
+		}
+		delete mDDTiles;
+		mDDTiles = NULL;
+	}
 #endif //RN_DEBUG
 }
 
@@ -3068,6 +4443,20 @@ void RNNavMesh::write_datagram(BamWriter *manager, Datagram &dg)
 			manager->write_pointer(dg, pandaNode);
 		}
 	}
+
+	///Used for saving built navigation mesh data (see TypedWritable API):
+	///written last so that records without it can still be read.
+	dg.add_bool(mSaveBuiltData);
+	if(mNavMeshType && mSaveBuiltData)
+	{
+		Datagram builtDataDg;
+		mNavMeshType->writeBuiltData(builtDataDg);
+		dg.add_string32(builtDataDg.get_message());
+	}
+
+	///Tile cache compressor type (see support/TileCacheCompressor.h):
+	///written last so that records without it can still be read.
+	dg.add_int32(mNavMeshTileSettings.get_compressorType());
 }
 
 /**
@@ -3302,6 +4691,28 @@ void RNNavMesh::fillin(DatagramIterator &scan, BamReader *manager)
 			manager->read_pointer(scan);
 		}
 	}
+
+	///Used for saving built navigation mesh data (see TypedWritable API):
+	///absent from records written before it was introduced.
+	mSaveBuiltData = false;
+	mBuiltData.clear();
+	if (scan.get_remaining_size() > 0)
+	{
+		mSaveBuiltData = scan.get_bool();
+		if(mNavMeshType && mSaveBuiltData)
+		{
+			mBuiltData = scan.get_string32();
+		}
+	}
+
+	///Tile cache compressor type (see support/TileCacheCompressor.h):
+	///absent from records written before it was introduced.
+	mNavMeshTileSettings.set_compressorType(
+			rnsup::NAVMESH_TILE_COMPRESSOR_FAST);
+	if (scan.get_remaining_size() > 0)
+	{
+		mNavMeshTileSettings.set_compressorType(scan.get_int32());
+	}
 }
 
 //TypedObject semantics: hardcoded
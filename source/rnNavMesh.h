@@ -11,16 +11,23 @@
 #include "rnTools.h"
 #include "recastnavigation_includes.h"
 #include "nodePath.h"
+#include "nodePathCollection.h"
 
 #ifndef CPPPARSER
 #include "support/CrowdTool.h"
 #include "support/NavMeshType_Tile.h"
 #include "support/NavMeshType_Obstacle.h"
 #include "support/NavMeshTesterTool.h"
+#include "support/PathRequestQueue.h"
+#include "support/FlowField.h"
+#include "support/TileGraph.h"
+#include "support/TileStreamer.h"
+#include "support/TileBuildCache.h"
 #include "library/DetourTileCache.h"
 #endif //CPPPARSER
 
 class RNCrowdAgent;
+class RNNavMeshQuery;
 
 /**
  * This class represents a "navigation mesh" of the RecastNavigation library.
@@ -63,9 +70,22 @@ class RNCrowdAgent;
  * | *max_tiles*					|single| 128 | -
  * | *max_polys_per_tile*			|single| 32768 | -
  * | *tile_size*					|single| 32 | -
+ * | *tile_cache_compressor*		|single| *fast* | values: fast,dense (OBSTACLE only)
+ * | *parallel_tile_build*			|single| *true* | -
+ * | *save_built_data*				|single| *false* | -
+ * | *baked_nav_mesh_file*			|single| - | SOLO and TILE only
+ * | *tile_build_cache_dir*			|single| - | TILE and OBSTACLE only
+ * | *async_path_max_iterations*	|single| 256 | -
+ * | *async_path_event*				|single| - | -
+ * | *path_cache_size*				|single| 0 | 0 disables the cache
+ * | *flow_field_min_agents*		|single| 0 | 0 disables flow fields
+ * | *obstacle_update_budget*		|single| 0.0 | milliseconds per update(), 0 rebuilds synchronously
+ * | *obstacle_auto_update*			|single| *false* | -
+ * | *tile_stream_radius*			|single| 100.0 | -
  * | *area_flags_cost*				|multiple| - | each one specified as "area_type@flag1[:flag2...:flagN]@cost" note: flags are or-ed
  * | *crowd_include_flags*			|single| - | specified as "flag1[:flag2...:flagN]" note: flags are or-ed
  * | *crowd_exclude_flags*			|single| - | specified as "flag1[:flag2...:flagN]" note: flags are or-ed
+ * | *crowd_parallel_update*		|single| *true* | -
  * | *convex_volume*				|multiple| - | each one specified as "x1,y1,z1[:x2,y2,z2...:xN,yN,zN]@area_type"
  * | *offmesh_connection*			|multiple| - | each one specified as "xB,yB,zB:xE,yE,zE@bidirectional" with bidirectional=true,false
  *
@@ -212,6 +232,8 @@ PUBLISHED:
 	INLINE int get_crowd_include_flags() const;
 	void set_crowd_exclude_flags(int oredFlags);
 	INLINE int get_crowd_exclude_flags() const;
+	INLINE void set_crowd_parallel_update(bool enable);
+	INLINE bool get_crowd_parallel_update() const;
 	///@}
 
 	/**
@@ -261,6 +283,23 @@ PUBLISHED:
 	void set_nav_mesh_tile_settings(const RNNavMeshTileSettings& settings);
 	INLINE RNNavMeshTileSettings get_nav_mesh_tile_settings() const;
 	LVecBase2i get_tile_indexes(const LPoint3f& pos);
+	void set_parallel_tile_build(bool enable);
+	INLINE bool get_parallel_tile_build() const;
+	///@}
+
+	/**
+	 * \name SERIALIZATION
+	 */
+	///@{
+	INLINE void set_save_built_data(bool enable);
+	INLINE bool get_save_built_data() const;
+	int save_baked_nav_mesh(const string& fileName);
+	INLINE void set_baked_nav_mesh_file(const string& fileName);
+	INLINE string get_baked_nav_mesh_file() const;
+	void set_tile_build_cache_dir(const string& dirName);
+	INLINE string get_tile_build_cache_dir() const;
+	INLINE int get_num_tile_build_cache_hits() const;
+	INLINE int get_num_tile_build_cache_misses() const;
 	///@}
 
 	/**
@@ -274,6 +313,26 @@ PUBLISHED:
 	int remove_all_tiles();
 	///@}
 
+	/**
+	 * \name TILE STREAMING
+	 * (TILE type only)
+	 */
+	///@{
+	int save_tile_archive(const string& fileName);
+	int start_tile_streaming(const string& fileName);
+	int stop_tile_streaming();
+	INLINE bool is_tile_streaming() const;
+	int add_tile_stream_anchor(NodePath anchorNP);
+	int remove_tile_stream_anchor(NodePath anchorNP);
+	INLINE NodePath get_tile_stream_anchor(int index) const;
+	INLINE int get_num_tile_stream_anchors() const;
+	MAKE_SEQ(get_tile_stream_anchors, get_num_tile_stream_anchors, get_tile_stream_anchor);
+	INLINE void set_tile_stream_radius(float radius);
+	INLINE float get_tile_stream_radius() const;
+	INLINE int get_num_streamed_tiles() const;
+	INLINE int get_num_pending_streamed_tiles() const;
+	///@}
+
 	/**
 	 * \name OBSTACLES
 	 * (OBSTACLE type only)
@@ -281,11 +340,19 @@ PUBLISHED:
 	///@{
 	int add_obstacle(NodePath objectNP);
 	int remove_obstacle(NodePath objectNP);
+	int add_obstacles(const NodePathCollection& objectNPs);
+	int remove_obstacles(const NodePathCollection& objectNPs);
+	int update_obstacle(NodePath objectNP);
 	NodePath get_obstacle_by_ref(int ref) const;
 	INLINE int get_obstacle(int index) const;
 	INLINE int get_num_obstacles() const;
 	MAKE_SEQ(get_obstacles, get_num_obstacles, get_obstacle);
 	int remove_all_obstacles();
+	INLINE void set_obstacle_update_budget(float budget);
+	INLINE float get_obstacle_update_budget() const;
+	INLINE void set_obstacle_auto_update(bool enable);
+	INLINE bool get_obstacle_auto_update() const;
+	INLINE bool is_obstacle_update_pending() const;
 	///@}
 
 	/**
@@ -341,6 +408,89 @@ PUBLISHED:
 		const LPoint3f& endPos, RNStraightPathOptions crossingOptions = NONE_CROSSINGS);
 	LPoint3f ray_cast(const LPoint3f& startPos, const LPoint3f& endPos);
 	float distance_to_wall(const LPoint3f& pos);
+	PT(RNNavMeshQuery) create_query(int maxNodes = 2048);
+	///@}
+
+	/**
+	 * \name HIERARCHICAL QUERIES
+	 */
+	///@{
+	PointFlagList path_find_hierarchical(const LPoint3f& startPos,
+			const LPoint3f& endPos,
+			RNStraightPathOptions crossingOptions = NONE_CROSSINGS);
+	int build_tile_graph();
+	///@}
+
+	/**
+	 * \name PATH CACHE
+	 */
+	///@{
+	void set_path_cache_size(int size);
+	INLINE int get_path_cache_size() const;
+	INLINE int get_path_cache_num_entries() const;
+	void clear_path_cache();
+	///@}
+
+	/**
+	 * \name FLOW FIELDS
+	 */
+	///@{
+	INLINE void set_flow_field_min_agents(int minAgents);
+	INLINE int get_flow_field_min_agents() const;
+	INLINE int get_num_flow_fields() const;
+	void clear_flow_fields();
+	///@}
+
+	/**
+	 * The status of an asynchronous path request.
+	 */
+	enum RNAsyncPathStatus
+	{
+#ifndef CPPPARSER
+		ASYNC_PATH_INVALID = rnsup::PathRequestQueue::REQUEST_INVALID,
+		ASYNC_PATH_PENDING = rnsup::PathRequestQueue::REQUEST_PENDING,
+		ASYNC_PATH_SUCCEEDED = rnsup::PathRequestQueue::REQUEST_SUCCEEDED,
+		ASYNC_PATH_FAILED = rnsup::PathRequestQueue::REQUEST_FAILED
+#else
+		ASYNC_PATH_INVALID,ASYNC_PATH_PENDING,ASYNC_PATH_SUCCEEDED,ASYNC_PATH_FAILED
+#endif //CPPPARSER
+	};
+
+	/**
+	 * \name ASYNC QUERIES
+	 */
+	///@{
+	int path_find_straight_async(const LPoint3f& startPos,
+			const LPoint3f& endPos,
+			RNStraightPathOptions crossingOptions = NONE_CROSSINGS);
+	RNAsyncPathStatus get_async_path_status(int handle) const;
+	PointFlagList get_async_path(int handle);
+	int cancel_async_path(int handle);
+	INLINE void set_async_path_max_iterations(int maxIterations);
+	INLINE int get_async_path_max_iterations() const;
+	INLINE void set_async_path_event(const string& eventName);
+	INLINE string get_async_path_event() const;
+	///@}
+
+	/**
+	 * \name BATCH QUERIES
+	 */
+	///@{
+	RNPathBatchResult path_find_follow_batch(
+			const ValueList<LPoint3f>& startPositions,
+			const ValueList<LPoint3f>& endPositions);
+	RNPathBatchResult path_find_straight_batch(
+			const ValueList<LPoint3f>& startPositions,
+			const ValueList<LPoint3f>& endPositions,
+			RNStraightPathOptions crossingOptions = NONE_CROSSINGS);
+	///@}
+
+	/**
+	 * \name STATISTICS
+	 */
+	///@{
+	RNNavMeshStats get_stats() const;
+	void reset_stats();
 	///@}
 
 	/**
@@ -411,6 +561,8 @@ private:
 	rnsup::InputGeom* mGeom;
 	///Build context.
 	rnsup::BuildContext* mCtx;
+	///Time of the last full build (milliseconds).
+	float mBuildTime;
 	///Owner object's input geometry (mesh) name.
 	string mMeshName;
 	///The reference node path.
@@ -421,12 +573,20 @@ private:
 	RNNavMeshSettings mNavMeshSettings;
 	///RNNavMesh's NavMeshTileSettings equivalent.
 	RNNavMeshTileSettings mNavMeshTileSettings;
+	///Tiles' build on the RNNavMeshManager's worker threads.
+	bool mParallelTileBuild;
 	///Area types with ability flags settings (see support/NavMeshType.h).
 	rnsup::NavMeshPolyAreaFlags mPolyAreaFlags;
 	///Area types with cost settings (see support/NavMeshType.h).
 	rnsup::NavMeshPolyAreaCost mPolyAreaCost;
 	///Crowd include & exclude flags settings (see library/DetourNavMeshQuery.h).
 	int mCrowdIncludeFlags, mCrowdExcludeFlags;
+	///Crowd update on the RNNavMeshManager's worker threads.
+	bool mCrowdParallelUpdate;
+#ifndef CPPPARSER
+	static void do_crowd_parallel_for(void* workerPool, const int count,
+			dtCrowdJobFunc job, void* jobContext);
+#endif //CPPPARSER
 	///Convex volumes (see support/ConvexVolumeTool.h).
 	pvector<PointListConvexVolumeSettings> mConvexVolumes;
 	///Off mesh connections (see support/OffMeshConnectionTool.h).
@@ -445,9 +605,37 @@ private:
 
 	///Used for saving underlying geometry (see TypedWritable API).
 	rnsup::rcMeshLoaderObj mMeshLoader;
+	///Used for saving built navigation mesh data (see TypedWritable API).
+	bool mSaveBuiltData;
+	string mBuiltData;
+	///The baked navigation mesh file mapped on setup (see support/NavMeshMapFile.h).
+	string mBakedNavMeshFile;
+	///The built tiles' data cached on disk (see support/TileBuildCache.h).
+	string mTileBuildCacheDir;
+	rnsup::TileBuildCache mTileBuildCache;
 
 	///Tester tool.
 	rnsup::NavMeshTesterTool mTesterTool;
+	///Path cache used by the tester tool.
+	rnsup::PathCache mPathCache;
+	///Flow fields shared by crowd agents with the same target.
+	rnsup::CrowdFlowFields mFlowFields;
+	///Tile graph for hierarchical queries (created on demand).
+	rnsup::TileGraph* mTileGraph;
+	void do_reset_tile_graph();
+	void do_tile_changed(int tx, int ty);
+	///Per worker thread queries used by batch queries.
+	pvector<rnsup::NavMeshTesterQuery*> mBatchQueries;
+	void do_setup_batch_queries(int numWorkers);
+	RNPathBatchResult do_path_find_batch(
+			const ValueList<LPoint3f>& startPositions,
+			const ValueList<LPoint3f>& endPositions, bool straight,
+			int crossingOptions);
+	///Asynchronous path requests.
+	rnsup::PathRequestQueue* mPathRequests;
+	int mAsyncPathMaxIterations;
+	string mAsyncPathEvent;
+	void do_update_async_paths();
 
 	///Unique ref.
 	int mRef;
@@ -460,6 +648,8 @@ private:
 		rnsup::rcMeshLoaderObj* meshLoader = NULL);
 	void do_create_nav_mesh_type(rnsup::NavMeshType* navMeshType);
 	bool do_build_navMesh();
+	bool do_build_navMesh_from_data();
+	bool do_build_navMesh_from_baked_file();
 
 	void do_add_crowd_agent_to_update_list(PT(RNCrowdAgent)crowdAgent);
 	bool do_add_crowd_agent_to_recast_update(PT(RNCrowdAgent)crowdAgent,
@@ -474,12 +664,37 @@ private:
 		dtPolyRef* polys, int& npolys, const int MAX_POLYS, float reduceFactor) const;
 
 	int do_get_off_mesh_connection_from_point(const LPoint3f& insidePoint) const;
+	int do_add_convex_volume_to_recast(const ValueList<LPoint3f>& points,
+			RNConvexVolumeSettings settings);
+	int do_remove_convex_volume_from_recast(const LPoint3f& insidePoint);
+	int do_add_off_mesh_connection_to_recast(const ValueList<LPoint3f>& points,
+			RNOffMeshConnectionSettings settings);
+	int do_remove_off_mesh_connection_from_recast(
+			const LPoint3f& beginOrEndPoint);
+	void do_rebuild_tiles(const float* bmin, const float* bmax);
 	void do_find_off_mesh_connection_poly(int offMeshConnectionID,
 			dtPolyRef* poly) const;
 
+	int do_add_obstacle(NodePath& objectNP, bool flush);
+	int do_remove_obstacle(NodePath& objectNP, bool flush);
 	int do_add_obstacle_to_recast(NodePath& objectNP, int index,
-			bool buildFromBam = false);
-	int do_remove_obstacle_from_recast(NodePath& objectNP, int obstacleRef);
+			bool buildFromBam = false, bool flush = true);
+	int do_remove_obstacle_from_recast(NodePath& objectNP, int obstacleRef,
+			bool flush = true);
+	///Time budget (ms) of tile cache updates per update() (0 = synchronous).
+	float mObstacleUpdateBudget;
+	///Obstacle changes not yet applied to the tile cache.
+	bool mObstacleUpdatePending;
+	///Obstacles' moves picked up by each update().
+	bool mObstacleAutoUpdate;
+	int do_move_obstacle(Obstacle& obstacle, bool flush);
+	void do_update_obstacles(float budget);
+	void do_flush_obstacles();
+
+	///Tiles streamed from a tile set file around the anchors (TILE).
+	rnsup::TileStreamer mTileStreamer;
+	pvector<NodePath> mTileStreamAnchors;
+	void do_update_tile_streaming();
 
 #ifdef RN_DEBUG
 	/// Recast debug node path.
@@ -489,6 +704,8 @@ private:
 	/// DebugDrawers.
 	rnsup::DebugDrawPanda3d* mDD;
 	rnsup::DebugDrawMeshDrawer* mDDM;
+	/// The tiles' geometry, cached and redrawn only when they change.
+	rnsup::DebugDrawNavMeshTiles* mDDTiles;
 	///Enable Draw update.
 	bool mEnableDrawUpdate;
 	/// Debug render with DebugDrawPanda3d.
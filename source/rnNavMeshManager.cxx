@@ -19,7 +19,8 @@
 RNNavMeshManager::RNNavMeshManager(const NodePath& root,
 		const CollideMask& mask) : mReferenceNP(NodePath("ReferenceNode")),
 		mRoot(root), mMask(mask), mCollisionHandler(NULL), mPickerRay(NULL), mCTrav(
-		NULL), mReferenceDebugNP(NodePath("ReferenceDebugNode"))
+		NULL), mBatchCTrav(NULL), mBatchCollisionHandler(NULL),
+		mReferenceDebugNP(NodePath("ReferenceDebugNode"))
 {
 	PRINT_DEBUG(
 			"RNNavMeshManager::RNNavMeshManager: creating the singleton manager.");
@@ -33,6 +34,8 @@ RNNavMeshManager::RNNavMeshManager(const NodePath& root,
 	//
 	mUpdateData.clear();
 	mUpdateTask.clear();
+	//one worker per hardware thread by default
+	mWorkerPool = new rnsup::WorkerPool();
 	//
 	if (! mRoot.is_empty())
 	{
@@ -45,6 +48,15 @@ RNNavMeshManager::RNNavMeshManager(const NodePath& root,
 		pickerNode->set_into_collide_mask(BitMask32::all_off());
 		mCTrav->add_collider(mRoot.attach_new_node(pickerNode),
 				mCollisionHandler);
+		//batched rays are added on demand
+		mBatchCTrav = new CollisionTraverser();
+		mBatchCollisionHandler = new CollisionHandlerQueue();
+		mBatchPickerNode = new CollisionNode(
+				string("RNNavMeshManager::batchPickerNode"));
+		mBatchPickerNode->set_from_collide_mask(mMask);
+		mBatchPickerNode->set_into_collide_mask(BitMask32::all_off());
+		mBatchCTrav->add_collider(mRoot.attach_new_node(mBatchPickerNode),
+				mBatchCollisionHandler);
 	}
 #ifdef RN_DEBUG
 	mDD = NULL;
@@ -92,6 +104,9 @@ RNNavMeshManager::~RNNavMeshManager()
 	mCrowdAgentsParameterTable.clear();
 	//
 	delete mCTrav;
+	delete mBatchCTrav;
+	//
+	delete mWorkerPool;
 
 #ifdef RN_DEBUG
 	if (mDD)
@@ -393,6 +408,39 @@ void RNNavMeshManager::set_parameters_defaults(RNType type)
 		mNavMeshesParameterTable.insert(
 				ParameterNameValue("max_polys_per_tile", "32768"));
 		mNavMeshesParameterTable.insert(ParameterNameValue("tile_size", "32"));
+		mNavMeshesParameterTable.insert(
+				ParameterNameValue("tile_cache_compressor", "fast"));
+		//tiles built on worker threads
+		mNavMeshesParameterTable.insert(
+				ParameterNameValue("parallel_tile_build", "true"));
+		//serialization
+		mNavMeshesParameterTable.insert(
+				ParameterNameValue("save_built_data", "false"));
+		//baked navigation mesh file
+		mNavMeshesParameterTable.insert(
+				ParameterNameValue("baked_nav_mesh_file", ""));
+		//tile build cache directory
+		mNavMeshesParameterTable.insert(
+				ParameterNameValue("tile_build_cache_dir", ""));
+		//async queries
+		mNavMeshesParameterTable.insert(
+				ParameterNameValue("async_path_max_iterations", "256"));
+		mNavMeshesParameterTable.insert(
+				ParameterNameValue("async_path_event", ""));
+		//path cache
+		mNavMeshesParameterTable.insert(
+				ParameterNameValue("path_cache_size", "0"));
+		//flow fields
+		mNavMeshesParameterTable.insert(
+				ParameterNameValue("flow_field_min_agents", "0"));
+		//obstacles' tile cache updates
+		mNavMeshesParameterTable.insert(
+				ParameterNameValue("obstacle_update_budget", "0.0"));
+		mNavMeshesParameterTable.insert(
+				ParameterNameValue("obstacle_auto_update", "false"));
+		//tile streaming
+		mNavMeshesParameterTable.insert(
+				ParameterNameValue("tile_stream_radius", "100.0"));
 		//area flags cost
 		//NAVMESH_POLYAREA_GROUND@NAVMESH_POLYFLAGS_WALK@1.0
 		mNavMeshesParameterTable.insert(ParameterNameValue("area_flags_cost", "0@0x01@1.0"));
@@ -410,6 +458,8 @@ void RNNavMeshManager::set_parameters_defaults(RNType type)
 		mNavMeshesParameterTable.insert(ParameterNameValue("crowd_include_flags", "0xffef"));
 		//crowd exclude flags = NAVMESH_POLYFLAGS_DISABLED = 0x10
 		mNavMeshesParameterTable.insert(ParameterNameValue("crowd_exclude_flags", "0x10"));
+		//crowd update on worker threads
+		mNavMeshesParameterTable.insert(ParameterNameValue("crowd_parallel_update", "true"));
 	}
 	else if (type == CROWDAGENT)
 	{
@@ -494,6 +544,16 @@ void RNNavMeshManager::stop_default_update()
 	mUpdateTask.clear();
 }
 
+/**
+ * Sets the number of worker threads used by parallel operations (the calling
+ * thread included): a value <= 0 means one per hardware thread.
+ * \note Should not be called while a parallel operation is in progress.
+ */
+void RNNavMeshManager::set_num_worker_threads(int numThreads)
+{
+	mWorkerPool->setNumWorkers(numThreads);
+}
+
 
 /**
  * Gets bounding dimensions of a model NodePath.
@@ -547,6 +607,53 @@ Pair<bool,float> RNNavMeshManager::get_collision_height(const LPoint3f& rayOrigi
 	return Pair<bool,float>(false, 0.0);
 }
 
+/**
+ * For each ray origin, gets the nearest collision point, if any, below it.
+ * Ray origins and collision points are wrt the collision root: all the
+ * (downward) rays are checked with a single collision traversal, so this is
+ * much faster than calling get_collision_height() for each origin.
+ */
+void RNNavMeshManager::get_collision_hits(const pvector<LPoint3f>& rayOrigins,
+		pvector<Pair<bool,LPoint3f> >& hits)
+{
+	hits.assign(rayOrigins.size(), Pair<bool,LPoint3f>(false, LPoint3f::zero()));
+	if (mRoot.is_empty() || rayOrigins.empty())
+	{
+		return;
+	}
+	//make a ray available for each origin
+	while (mBatchPickerRays.size() < rayOrigins.size())
+	{
+		PT(CollisionRay)ray = new CollisionRay();
+		ray->set_direction(LVecBase3f(0.0, 0.0, -1.0));
+		mBatchPickerRayIndexes[ray.p()] = (int) mBatchPickerRays.size();
+		mBatchPickerRays.push_back(ray);
+	}
+	mBatchPickerNode->clear_solids();
+	for (unsigned int i = 0; i < rayOrigins.size(); ++i)
+	{
+		mBatchPickerRays[i]->set_origin(rayOrigins[i]);
+		mBatchPickerNode->add_solid(mBatchPickerRays[i]);
+	}
+	//traverse once, then take the nearest entry of each ray
+	mBatchCTrav->traverse(mRoot);
+	mBatchCollisionHandler->sort_entries();
+	for (int i = 0; i < mBatchCollisionHandler->get_num_entries(); ++i)
+	{
+		CollisionEntry *entry = mBatchCollisionHandler->get_entry(i);
+		pmap<const CollisionSolid*, int>::const_iterator iter =
+				mBatchPickerRayIndexes.find(entry->get_from());
+		if ((iter == mBatchPickerRayIndexes.end()) ||
+				(iter->second >= (int) hits.size()) ||
+				hits[iter->second].get_first())
+		{
+			continue;
+		}
+		hits[iter->second] = Pair<bool,LPoint3f>(true,
+				entry->get_surface_point(mRoot));
+	}
+}
+
 /**
  * Draws the specified primitive, given the points, the color (RGBA) and point's size.
  */
@@ -13,6 +13,7 @@
 #include "collisionTraverser.h"
 #include "collisionHandlerQueue.h"
 #include "collisionRay.h"
+#include "collisionNode.h"
 
 class RNNavMesh;
 class RNCrowdAgent;
@@ -93,6 +94,14 @@ PUBLISHED:
 	void stop_default_update();
 	///@}
 
+	/**
+	 * \name WORKER THREADS
+	 */
+	///@{
+	void set_num_worker_threads(int numThreads);
+	INLINE int get_num_worker_threads() const;
+	///@}
+
 	/**
 	 * \name SINGLETON
 	 */
@@ -148,6 +157,17 @@ PUBLISHED:
 	void debug_draw_reset();
 	///@}
 
+public:
+	/**
+	 * \name C++ ONLY
+	 * Library & support low level related methods.
+	 */
+	///@{
+	inline rnsup::WorkerPool& get_worker_pool() const;
+	void get_collision_hits(const pvector<LPoint3f>& rayOrigins,
+			pvector<Pair<bool,LPoint3f> >& hits);
+	///@}
+
 private:
 	///The reference node path.
 	NodePath mReferenceNP;
@@ -170,12 +190,21 @@ private:
 	PT(AsyncTask) mUpdateTask;
 	///@}
 
+	///The pool of worker threads shared by RNNavMeshes.
+	rnsup::WorkerPool* mWorkerPool;
+
 	///Utilities.
 	NodePath mRoot;
 	CollideMask mMask; //a.k.a. BitMask32
 	CollisionTraverser* mCTrav;
 	CollisionHandlerQueue* mCollisionHandler;
 	CollisionRay* mPickerRay;
+	///Batched downward rays: all traversed at once.
+	CollisionTraverser* mBatchCTrav;
+	CollisionHandlerQueue* mBatchCollisionHandler;
+	PT(CollisionNode) mBatchPickerNode;
+	pvector<PT(CollisionRay)> mBatchPickerRays;
+	pmap<const CollisionSolid*, int> mBatchPickerRayIndexes;
 
 	///The reference node path for debug drawing.
 	NodePath mReferenceDebugNP;
@@ -188,7 +217,8 @@ private:
 		}
 		void vertex(const LVector3f& vertex, const LVector4f& color)
 		{
-			doVertex(vertex, color);
+			doVertex(vertex, duRGBAf(color[0], color[1], color[2],
+					color[3]));
 		}
 	};
 	/// DebugDrawers.
@@ -0,0 +1,202 @@
+/**
+ * \file rnNavMeshQuery.cxx
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#include "rnNavMeshQuery.h"
+
+///RNNavMeshQuery
+/**
+ *
+ */
+RNNavMeshQuery::RNNavMeshQuery(PT(RNNavMesh) navMesh, int maxNodes) :
+		mNavMesh(navMesh)
+{
+	mQuery = new rnsup::NavMeshTesterQuery();
+	if (mNavMesh && mNavMesh->get_recast_nav_mesh())
+	{
+		mQuery->init(mNavMesh->get_recast_nav_mesh(),
+				mNavMesh->get_recast_crowd()->getFilter(0), maxNodes);
+	}
+}
+
+/**
+ *
+ */
+RNNavMeshQuery::~RNNavMeshQuery()
+{
+	delete mQuery;
+}
+
+/**
+ * Returns true if this RNNavMeshQuery can be used, i.e. if its RNNavMesh is
+ * still set up with the same underlying navigation mesh.
+ */
+bool RNNavMeshQuery::is_valid() const
+{
+	return mNavMesh && mQuery->getNavMesh()
+			&& (mQuery->getNavMesh() == mNavMesh->get_recast_nav_mesh());
+}
+
+/**
+ * Sets the query filter's include flags.
+ * \note At creation the query filter is a copy of the RNNavMesh's crowd one.
+ */
+void RNNavMeshQuery::set_include_flags(int oredFlags)
+{
+	mQuery->getFilter().setIncludeFlags(oredFlags);
+}
+
+/**
+ * Returns the query filter's include flags.
+ */
+int RNNavMeshQuery::get_include_flags() const
+{
+	return mQuery->getFilter().getIncludeFlags();
+}
+
+/**
+ * Sets the query filter's exclude flags.
+ * \note At creation the query filter is a copy of the RNNavMesh's crowd one.
+ */
+void RNNavMeshQuery::set_exclude_flags(int oredFlags)
+{
+	mQuery->getFilter().setExcludeFlags(oredFlags);
+}
+
+/**
+ * Returns the query filter's exclude flags.
+ */
+int RNNavMeshQuery::get_exclude_flags() const
+{
+	return mQuery->getFilter().getExcludeFlags();
+}
+
+/**
+ * Finds a path from the start point to the end point.
+ * Returns a list of points, empty on error.
+ */
+ValueList<LPoint3f> RNNavMeshQuery::path_find_follow(const LPoint3f& startPos,
+		const LPoint3f& endPos)
+{
+	// continue if query object is valid
+	CONTINUE_IF_ELSE_R(is_valid(), ValueList<LPoint3f>())
+
+	ValueList<LPoint3f> pointList;
+	float recastStart[3], recastEnd[3];
+	rnsup::LVecBase3fToRecast(startPos, recastStart);
+	rnsup::LVecBase3fToRecast(endPos, recastEnd);
+	int numPoints = mQuery->findPathFollow(recastStart, recastEnd);
+	const float* path = mQuery->getSmoothPath();
+	for (int i = 0; i < numPoints; ++i)
+	{
+		pointList.add_value(
+				rnsup::Recast3fToLVecBase3f(path[i * 3], path[i * 3 + 1],
+						path[i * 3 + 2]));
+	}
+	return pointList;
+}
+
+/**
+ * Finds a path's total cost (>=0.0) from the start point to the end point.
+ * Returns a negative number on error.
+ * \note The return value is directly from the path finding algorithm,
+ * and it should only be used to make comparisons.
+ */
+float RNNavMeshQuery::path_find_follow_cost(const LPoint3f& startPos,
+		const LPoint3f& endPos)
+{
+	// continue if query object is valid
+	CONTINUE_IF_ELSE_R(is_valid(), RN_ERROR)
+
+	float recastStart[3], recastEnd[3];
+	rnsup::LVecBase3fToRecast(startPos, recastStart);
+	rnsup::LVecBase3fToRecast(endPos, recastEnd);
+	float totalCost = RN_ERROR;
+	CONTINUE_IF_ELSE_R(
+			mQuery->findPathFollow(recastStart, recastEnd, &totalCost) > 0,
+			RN_ERROR)
+
+	return totalCost;
+}
+
+/**
+ * Finds a straight path from the start point to the end point.
+ * Returns a list of points, empty on error.
+ */
+RNNavMesh::PointFlagList RNNavMeshQuery::path_find_straight(
+		const LPoint3f& startPos, const LPoint3f& endPos,
+		RNNavMesh::RNStraightPathOptions crossingOptions)
+{
+	// continue if query object is valid
+	CONTINUE_IF_ELSE_R(is_valid(), RNNavMesh::PointFlagList())
+
+	RNNavMesh::PointFlagList pointFlagList;
+	float recastStart[3], recastEnd[3];
+	rnsup::LVecBase3fToRecast(startPos, recastStart);
+	rnsup::LVecBase3fToRecast(endPos, recastEnd);
+	int numPoints = mQuery->findPathStraight(recastStart, recastEnd,
+			crossingOptions);
+	const float* points = mQuery->getStraightPath();
+	const unsigned char* flags = mQuery->getStraightPathFlags();
+	for (int i = 0; i < numPoints; ++i)
+	{
+		pointFlagList.add_value(
+				Pair<LPoint3f, unsigned char>(
+						rnsup::Recast3fToLVecBase3f(points[i * 3],
+								points[i * 3 + 1], points[i * 3 + 2]),
+						flags[i]));
+	}
+	return pointFlagList;
+}
+
+/**
+ * Casts a walkability/visibility ray from the start point toward the end point.
+ * Returns the first hit point if not walkable, or the end point if walkable, or
+ * a point at "infinite".
+ * This method is meant only for short distance checks.
+ */
+LPoint3f RNNavMeshQuery::ray_cast(const LPoint3f& startPos,
+		const LPoint3f& endPos)
+{
+	// continue if query object is valid
+	CONTINUE_IF_ELSE_R(is_valid(), LPoint3f(FLT_MAX, FLT_MAX, FLT_MAX))
+
+	LPoint3f hitPoint = endPos;
+	float recastStart[3], recastEnd[3], hitPos[3];
+	rnsup::LVecBase3fToRecast(startPos, recastStart);
+	rnsup::LVecBase3fToRecast(endPos, recastEnd);
+	if (mQuery->raycast(recastStart, recastEnd, hitPos))
+	{
+		hitPoint = rnsup::Recast3fToLVecBase3f(hitPos[0], hitPos[1], hitPos[2]);
+	}
+	return hitPoint;
+}
+
+/**
+ * Finds the distance from the specified position to the nearest polygon wall.
+ * Returns an "infinite" number on error.
+ */
+float RNNavMeshQuery::distance_to_wall(const LPoint3f& pos)
+{
+	// continue if query object is valid
+	CONTINUE_IF_ELSE_R(is_valid(), FLT_MAX)
+
+	float recastPos[3];
+	rnsup::LVecBase3fToRecast(pos, recastPos);
+	return mQuery->findDistanceToWall(recastPos);
+}
+
+/**
+ * Writes a sensible description of the RNNavMeshQuery to the indicated output
+ * stream.
+ */
+void RNNavMeshQuery::output(ostream &out) const
+{
+	out << get_type() << " " << (mNavMesh ? mNavMesh->get_name() : string(""));
+}
+
+//TypedObject semantics: hardcoded
+TypeHandle RNNavMeshQuery::_type_handle;
@@ -0,0 +1,127 @@
+/**
+ * \file rnNavMeshQuery.h
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#ifndef RNNAVMESHQUERY_H_
+#define RNNAVMESHQUERY_H_
+
+#include "rnNavMesh.h"
+#include "rnTools.h"
+#include "recastnavigation_includes.h"
+
+/**
+ * This class represents a re-entrant "query object" on a RNNavMesh.
+ *
+ * A RNNavMeshQuery is created by RNNavMesh::create_query() and owns its
+ * own dtNavMeshQuery (with its own node pool), query filter and result
+ * buffers, so it doesn't go through the RNNavMesh's shared tester tool.\n
+ * Different RNNavMeshQuery(s) can be used concurrently (e.g. one per thread
+ * in Panda task chains) as long as the RNNavMesh is not modified in the
+ * meantime (i.e. no tile is built/removed and no obstacle is added/removed).
+ * \n
+ * \note A RNNavMeshQuery becomes invalid when its RNNavMesh is cleaned up or
+ * set up again: in this case a new one should be created.
+ */
+class EXPORT_CLASS RNNavMeshQuery: public TypedReferenceCount
+{
+PUBLISHED:
+	virtual ~RNNavMeshQuery();
+
+	/**
+	 * \name QUERY OBJECT
+	 */
+	///@{
+	bool is_valid() const;
+	INLINE PT(RNNavMesh) get_nav_mesh() const;
+	void set_include_flags(int oredFlags);
+	int get_include_flags() const;
+	void set_exclude_flags(int oredFlags);
+	int get_exclude_flags() const;
+	///@}
+
+	/**
+	 * \name QUERIES
+	 */
+	///@{
+	ValueList<LPoint3f> path_find_follow(const LPoint3f& startPos,
+		const LPoint3f& endPos);
+	float path_find_follow_cost(const LPoint3f& startPos,
+			const LPoint3f& endPos);
+	RNNavMesh::PointFlagList path_find_straight(const LPoint3f& startPos,
+		const LPoint3f& endPos, RNNavMesh::RNStraightPathOptions crossingOptions =
+				RNNavMesh::NONE_CROSSINGS);
+	LPoint3f ray_cast(const LPoint3f& startPos, const LPoint3f& endPos);
+	float distance_to_wall(const LPoint3f& pos);
+	///@}
+
+	/**
+	 * \name OUTPUT
+	 */
+	///@{
+	void output(ostream &out) const;
+	///@}
+
+public:
+	/**
+	 * \name C++ ONLY
+	 * Library & support low level related methods.
+	 */
+	///@{
+	inline rnsup::NavMeshTesterQuery& get_tester_query() const;
+	///@}
+
+protected:
+	friend class RNNavMesh;
+
+	RNNavMeshQuery(PT(RNNavMesh) navMesh, int maxNodes);
+
+private:
+	///The RNNavMesh this query object is associated to.
+	PT(RNNavMesh) mNavMesh;
+	///The underlying re-entrant query.
+	rnsup::NavMeshTesterQuery* mQuery;
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	RNNavMeshQuery(const RNNavMeshQuery&);
+	RNNavMeshQuery& operator=(const RNNavMeshQuery&);
+
+public:
+	/**
+	 * \name TypedObject API
+	 */
+	///@{
+	static TypeHandle get_class_type()
+	{
+		return _type_handle;
+	}
+	static void init_type()
+	{
+		TypedReferenceCount::init_type();
+		register_type(_type_handle, "RNNavMeshQuery",
+				TypedReferenceCount::get_class_type());
+	}
+	virtual TypeHandle get_type() const override
+	{
+		return get_class_type();
+	}
+	virtual TypeHandle force_init_type() override
+	{
+		init_type();
+		return get_class_type();
+	}
+	///@}
+
+private:
+	static TypeHandle _type_handle;
+
+};
+
+INLINE ostream &operator << (ostream &out, const RNNavMeshQuery & navMeshQuery);
+
+///inline
+#include "rnNavMeshQuery.I"
+
+#endif /* RNNAVMESHQUERY_H_ */
@@ -218,6 +218,8 @@ void RNNavMeshTileSettings::read_datagram(DatagramIterator &scan)
 	set_maxTiles(scan.get_int32());
 	set_maxPolysPerTile(scan.get_int32());
 	set_tileSize(scan.get_stdfloat());
+	///The compressor type is not part of this record (see RNNavMesh::fillin).
+	set_compressorType(rnsup::NAVMESH_TILE_COMPRESSOR_FAST);
 }
 
 /**
@@ -230,6 +232,7 @@ void RNNavMeshTileSettings::output(ostream &out) const
 	out << "maxTiles: " << get_maxTiles() << endl;
 	out << "maxPolysPerTile: " << get_maxPolysPerTile() << endl;
 	out << "tileSize: " << get_tileSize() << endl;
+	out << "compressorType: " << get_compressorType() << endl;
 }
 
 ///Convex volume settings.
@@ -423,6 +426,104 @@ void RNCrowdAgentParams::output(ostream &out) const
 	out << "userData: " << get_userData() << endl;
 }
 
+///RNPathBatchResult
+/**
+ *
+ */
+RNPathBatchResult::RNPathBatchResult(): _offsets(1, 0)
+{
+}
+
+/**
+ * Returns the points of the given path.
+ */
+ValueList<LPoint3f> RNPathBatchResult::get_path(int path) const
+{
+	nassertr_always((path >= 0) && (path < get_num_paths()),
+			ValueList<LPoint3f>())
+
+	ValueList<LPoint3f> pointList;
+	for (int i = _offsets[path]; i < _offsets[path + 1]; ++i)
+	{
+		pointList.add_value(LPoint3f(_points[i]));
+	}
+	return pointList;
+}
+
+/**
+ * Appends a path given as an array of recast points (and optional flags).
+ */
+void RNPathBatchResult::add_path(const float* recastPoints,
+		const unsigned char* flags, int numPoints)
+{
+	for (int i = 0; i < numPoints; ++i)
+	{
+		_points.push_back(
+				rnsup::Recast3fToLVecBase3f(recastPoints[i * 3],
+						recastPoints[i * 3 + 1], recastPoints[i * 3 + 2]));
+		_flags.push_back(flags ? flags[i] : 0);
+	}
+	_offsets.push_back((int) _points.size());
+}
+
+/**
+ * Writes a sensible description of the RNPathBatchResult to the indicated
+ * output stream.
+ */
+void RNPathBatchResult::output(ostream &out) const
+{
+	out << "paths: " << get_num_paths() << endl;
+	out << "points: " << get_num_points() << endl;
+}
+
+///RNNavMeshStats
+/**
+ *
+ */
+RNNavMeshStats::RNNavMeshStats() :
+		_buildTime(0.0), _stageTimes(RC_MAX_TIMERS, 0.0), _numTiles(0),
+		_maxTiles(0), _numPolys(0), _numVerts(0), _numDetailTris(0),
+		_navMeshDataSize(0), _numCacheLayers(0), _cacheCompressedSize(0),
+		_cacheRawSize(0), _cacheAllocHighWater(0)
+{
+}
+
+/**
+ * Returns the name of the given build stage.
+ */
+string RNNavMeshStats::get_stage_name(int stage) const
+{
+	nassertr_always((stage >= 0) && (stage < get_num_stages()), string())
+
+	return string(rnsup::BuildContext::getTimerName((rcTimerLabel) stage));
+}
+
+/**
+ * Writes a sensible description of the RNNavMeshStats to the indicated
+ * output stream.
+ */
+void RNNavMeshStats::output(ostream &out) const
+{
+	out << "build time (ms): " << get_build_time() << endl;
+	for (int i = 0; i < get_num_stages(); ++i)
+	{
+		if (_stageTimes[i] > 0.0)
+		{
+			out << "  " << get_stage_name(i) << " (ms): " << _stageTimes[i]
+					<< endl;
+		}
+	}
+	out << "tiles: " << get_num_tiles() << "/" << get_max_tiles() << endl;
+	out << "polys: " << get_num_polys() << endl;
+	out << "verts: " << get_num_verts() << endl;
+	out << "detail tris: " << get_num_detail_tris() << endl;
+	out << "nav mesh data size: " << get_nav_mesh_data_size() << endl;
+	out << "cache layers: " << get_num_cache_layers() << endl;
+	out << "cache compressed size: " << get_cache_compressed_size() << endl;
+	out << "cache raw size: " << get_cache_raw_size() << endl;
+	out << "cache alloc high water: " << get_cache_alloc_high_water() << endl;
+}
+
 ///ValueList template
 // Tell GCC that we'll take care of the instantiation explicitly here.
 #ifdef __GNUC__
@@ -18,12 +18,16 @@
 #include "recastnavigation_includes.h"
 #include "genericAsyncTask.h"
 #include "lpoint3.h"
+#include "pta_LVecBase3.h"
+#include "pta_int.h"
+#include "pta_uchar.h"
 
 using namespace std;
 
 //
 #ifndef CPPPARSER
 #include "support/NavMeshType.h"
+#include "support/WorkerPool.h"
 #endif //CPPPARSER
 
 //continue if condition is true else return a value
@@ -409,6 +413,8 @@ PUBLISHED:
 	INLINE void set_maxPolysPerTile(int value);
 	INLINE float get_tileSize() const;
 	INLINE void set_tileSize(float value);
+	INLINE int get_compressorType() const;
+	INLINE void set_compressorType(int value);
 	void output(ostream &out) const;
 private:
 #ifndef CPPPARSER
@@ -596,6 +602,83 @@ private:
 #endif //CPPPARSER
 };
 
+///Path batch result
+struct EXPORT_CLASS RNPathBatchResult
+{
+PUBLISHED:
+	RNPathBatchResult();
+
+	INLINE int get_num_paths() const;
+	INLINE int get_path_offset(int path) const;
+	INLINE int get_path_size(int path) const;
+	ValueList<LPoint3f> get_path(int path) const;
+	MAKE_SEQ(get_paths, get_num_paths, get_path);
+	INLINE int get_num_points() const;
+	INLINE LPoint3f get_point(int index) const;
+	MAKE_SEQ(get_points, get_num_points, get_point);
+	INLINE unsigned char get_point_flag(int index) const;
+	INLINE CPTA_LVecBase3f get_point_buffer() const;
+	INLINE CPTA_uchar get_flag_buffer() const;
+	INLINE CPTA_int get_offset_buffer() const;
+	void output(ostream &out) const;
+
+public:
+	INLINE void clear();
+	void add_path(const float* recastPoints, const unsigned char* flags,
+			int numPoints);
+
+private:
+	///All paths' points (and flags) one after the other.
+	PTA_LVecBase3f _points;
+	PTA_uchar _flags;
+	///Path i is [_offsets[i], _offsets[i+1]) of _points.
+	PTA_int _offsets;
+};
+INLINE ostream &operator << (ostream &out, const RNPathBatchResult & result);
+
+///NavMesh build & memory statistics
+struct EXPORT_CLASS RNNavMeshStats
+{
+PUBLISHED:
+	RNNavMeshStats();
+
+	INLINE float get_build_time() const;
+	INLINE int get_num_stages() const;
+	string get_stage_name(int stage) const;
+	INLINE float get_stage_time(int stage) const;
+	MAKE_SEQ(get_stage_times, get_num_stages, get_stage_time);
+	INLINE int get_num_tiles() const;
+	INLINE int get_max_tiles() const;
+	INLINE int get_num_polys() const;
+	INLINE int get_num_verts() const;
+	INLINE int get_num_detail_tris() const;
+	INLINE int get_nav_mesh_data_size() const;
+	INLINE int get_num_cache_layers() const;
+	INLINE int get_cache_compressed_size() const;
+	INLINE int get_cache_raw_size() const;
+	INLINE int get_cache_alloc_high_water() const;
+	void output(ostream &out) const;
+
+public:
+	INLINE void set_build_time(float value);
+	INLINE void set_stage_time(int stage, float value);
+	INLINE void set_tiles(int numTiles, int maxTiles);
+	INLINE void set_nav_mesh_sizes(int numPolys, int numVerts,
+			int numDetailTris, int dataSize);
+	INLINE void set_cache_sizes(int numLayers, int compressedSize, int rawSize,
+			int allocHighWater);
+
+private:
+	///Times are in milliseconds, sizes in bytes.
+	float _buildTime;
+	pvector<float> _stageTimes;
+	int _numTiles, _maxTiles;
+	int _numPolys, _numVerts, _numDetailTris, _navMeshDataSize;
+	int _numCacheLayers, _cacheCompressedSize, _cacheRawSize,
+			_cacheAllocHighWater;
+};
+INLINE ostream &operator << (ostream &out, const RNNavMeshStats & stats);
+
 ///Result values
 #define RN_SUCCESS 0
 #define RN_ERROR -1
@@ -0,0 +1,172 @@
+/**
+ * \file BuildArena.cpp
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#include "BuildArena.h"
+#include <RecastAlloc.h>
+#include <stdlib.h>
+
+namespace rnsup
+{
+
+///Every Recast allocation is preceded by this header, so rcFree() knows if
+///it comes from an arena (and which one) or from malloc.
+struct BuildArenaHeader
+{
+	BuildArena* arena;
+	size_t size;
+};
+static const size_t BUILDARENA_HEADER_SIZE = 16;
+static const size_t BUILDARENA_ALIGNMENT = 16;
+static const size_t BUILDARENA_MIN_BLOCK_SIZE = 1024 * 1024;
+
+///The arena of the calling thread's current scope (if any).
+static thread_local BuildArena* buildArenaActive = 0;
+
+static size_t buildArenaAlign(size_t size)
+{
+	return (size + BUILDARENA_ALIGNMENT - 1) & ~(BUILDARENA_ALIGNMENT - 1);
+}
+
+static void* buildArenaAlloc(size_t size, rcAllocHint /*hint*/)
+{
+	if (buildArenaActive)
+		return buildArenaActive->alloc(size);
+	unsigned char* mem = (unsigned char*) malloc(size + BUILDARENA_HEADER_SIZE);
+	if (!mem)
+		return 0;
+	BuildArenaHeader* header = (BuildArenaHeader*) mem;
+	header->arena = 0;
+	header->size = size;
+	return mem + BUILDARENA_HEADER_SIZE;
+}
+
+static void buildArenaFree(void* ptr)
+{
+	BuildArenaHeader* header = (BuildArenaHeader*) ((unsigned char*) ptr
+			- BUILDARENA_HEADER_SIZE);
+	if (!header->arena)
+		::free(header);
+	else if (header->arena == buildArenaActive)
+		header->arena->dealloc(ptr);
+	// else: reclaimed when its scope ends
+}
+
+///Installs the allocation functions before any Recast allocation is made.
+static struct BuildArenaInstaller
+{
+	BuildArenaInstaller()
+	{
+		rcAllocSetCustom(buildArenaAlloc, buildArenaFree);
+	}
+} buildArenaInstaller;
+
+BuildArena::BuildArena() :
+		m_block(0), m_top(0)
+{
+}
+
+BuildArena::~BuildArena()
+{
+	for (size_t i = 0; i < m_blocks.size(); ++i)
+		::free(m_blocks[i].data);
+}
+
+void* BuildArena::alloc(size_t size)
+{
+	const size_t needed = BUILDARENA_HEADER_SIZE + buildArenaAlign(size);
+	// find room in the current block or in the next ones
+	while ((m_block < m_blocks.size())
+			&& (m_top + needed > m_blocks[m_block].size))
+	{
+		++m_block;
+		m_top = 0;
+	}
+	if (m_block == m_blocks.size())
+	{
+		// grow geometrically
+		size_t blockSize = m_blocks.empty() ?
+				BUILDARENA_MIN_BLOCK_SIZE : m_blocks.back().size * 2;
+		if (blockSize < needed)
+			blockSize = needed;
+		Block block;
+		block.data = (unsigned char*) malloc(blockSize);
+		if (!block.data)
+			return 0;
+		block.size = blockSize;
+		m_blocks.push_back(block);
+		m_top = 0;
+	}
+	unsigned char* mem = m_blocks[m_block].data + m_top;
+	m_top += needed;
+	BuildArenaHeader* header = (BuildArenaHeader*) mem;
+	header->arena = this;
+	header->size = size;
+	return mem + BUILDARENA_HEADER_SIZE;
+}
+
+void BuildArena::dealloc(void* ptr)
+{
+	// only the top allocation can be given back
+	unsigned char* mem = (unsigned char*) ptr;
+	const BuildArenaHeader* header = (const BuildArenaHeader*) (mem
+			- BUILDARENA_HEADER_SIZE);
+	if ((m_block < m_blocks.size())
+			&& (mem + buildArenaAlign(header->size)
+					== m_blocks[m_block].data + m_top))
+		m_top -= BUILDARENA_HEADER_SIZE + buildArenaAlign(header->size);
+}
+
+void BuildArena::reset()
+{
+	if (m_blocks.size() > 1)
+	{
+		// merge the blocks, so the next scopes fit into one
+		const size_t capacity = getCapacity();
+		for (size_t i = 0; i < m_blocks.size(); ++i)
+			::free(m_blocks[i].data);
+		m_blocks.clear();
+		Block block;
+		block.data = (unsigned char*) malloc(capacity);
+		block.size = capacity;
+		if (block.data)
+			m_blocks.push_back(block);
+	}
+	m_block = 0;
+	m_top = 0;
+}
+
+size_t BuildArena::getCapacity() const
+{
+	size_t capacity = 0;
+	for (size_t i = 0; i < m_blocks.size(); ++i)
+		capacity += m_blocks[i].size;
+	return capacity;
+}
+
+BuildArena& BuildArena::getThreadArena()
+{
+	static thread_local BuildArena arena;
+	return arena;
+}
+
+BuildArenaScope::BuildArenaScope() :
+		m_outermost(buildArenaActive == 0)
+{
+	if (m_outermost)
+		buildArenaActive = &BuildArena::getThreadArena();
+}
+
+BuildArenaScope::~BuildArenaScope()
+{
+	if (m_outermost)
+	{
+		buildArenaActive->reset();
+		buildArenaActive = 0;
+	}
+}
+
+} // namespace rnsup
@@ -0,0 +1,83 @@
+/**
+ * \file BuildArena.h
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#ifndef BUILDARENA_H
+#define BUILDARENA_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace rnsup
+{
+
+/**
+ * A thread's scratch memory for the Recast build stages (heightfields,
+ * contours, polygon meshes and their temporary buffers).
+ *
+ * While a BuildArenaScope is alive, the calling thread's rcAlloc() calls are
+ * served from its arena by bumping a pointer, and rcFree() calls only give
+ * back the most recent allocation (which covers Recast's temporary buffers);
+ * all the memory is then reclaimed at once when the scope ends, and kept for
+ * the next one. So rebuilding many tiles doesn't go back to malloc, nor
+ * contend for its lock, once the arenas have grown to the largest tile.\n
+ * Outside of any scope rcAlloc() falls back to malloc.
+ * \note Everything allocated inside a scope must be freed (or abandoned)
+ * before it ends: its memory is reused by the next scope.
+ */
+class BuildArena
+{
+	struct Block
+	{
+		unsigned char* data;
+		size_t size;
+	};
+	std::vector<Block> m_blocks;
+	size_t m_block;
+	size_t m_top;
+
+public:
+	BuildArena();
+	~BuildArena();
+
+	void* alloc(size_t size);
+	void dealloc(void* ptr);
+	///Reclaims all the allocations, keeping the memory (merged into a single
+	///block if the arena has grown).
+	void reset();
+
+	size_t getCapacity() const;
+
+	///Gets the calling thread's arena.
+	static BuildArena& getThreadArena();
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	BuildArena(const BuildArena&);
+	BuildArena& operator=(const BuildArena&);
+};
+
+/**
+ * Routes the calling thread's Recast allocations to its BuildArena for the
+ * scope's lifetime (see BuildArena). Nested scopes share the outermost one.
+ */
+class BuildArenaScope
+{
+	bool m_outermost;
+
+public:
+	BuildArenaScope();
+	~BuildArenaScope();
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	BuildArenaScope(const BuildArenaScope&);
+	BuildArenaScope& operator=(const BuildArenaScope&);
+};
+
+} // namespace rnsup
+
+#endif // BUILDARENA_H
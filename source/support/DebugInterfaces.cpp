@@ -11,6 +11,8 @@
 #include <cstdarg>
 #include <cstring>
 #include <cfloat>
+#include <cstddef>
+#include <sstream>
 #include "DebugInterfaces.h"
 #include "NavMeshType.h"
 #include <RecastDebugDraw.h>
@@ -19,6 +21,13 @@
 #include <geomPoints.h>
 #include <geomLines.h>
 #include <geomTriangles.h>
+#include <geomVertexArrayFormat.h>
+#include <geomVertexArrayData.h>
+#include <internalName.h>
+#include <renderState.h>
+#include <depthWriteAttrib.h>
+#include <transparencyAttrib.h>
+#include <renderModeAttrib.h>
 #include <omniBoundingVolume.h>
 
 #ifdef WIN32
@@ -37,6 +46,7 @@ BuildContext::BuildContext() :
 	memset(m_messages, 0, sizeof(char*) * MAX_MESSAGES);
 
 	resetTimers();
+	resetStats();
 }
 
 // Virtual functions for custom implementations.
@@ -87,6 +97,7 @@ void BuildContext::doStopTimer(const rcTimerLabel label)
 		m_accTime[label] = deltaTime;
 	else
 		m_accTime[label] += deltaTime;
+	m_statTime[label] += deltaTime;
 }
 
 int BuildContext::doGetAccumulatedTime(const rcTimerLabel label) const
@@ -149,6 +160,68 @@ const char* BuildContext::getLogText(const int i) const
 	return m_messages[i]+1;
 }
 
+void BuildContext::resetStats()
+{
+	for (int i = 0; i < RC_MAX_TIMERS; ++i)
+		m_statTime[i] = 0;
+}
+
+int BuildContext::getStatTime(const rcTimerLabel label) const
+{
+	return getPerfTimeUsec(m_statTime[label]);
+}
+
+void BuildContext::merge(const BuildContext& other)
+{
+	if (m_logEnabled)
+	{
+		for (int i = 0; i < other.m_messageCount; ++i)
+		{
+			const char* msg = other.m_messages[i];
+			doLog((rcLogCategory)msg[0], msg+1, (int)strlen(msg+1));
+		}
+	}
+	for (int i = 0; i < RC_MAX_TIMERS; ++i)
+		m_statTime[i] += other.m_statTime[i];
+}
+
+const char* BuildContext::getTimerName(const rcTimerLabel label)
+{
+	// in rcTimerLabel order
+	static const char* names[RC_MAX_TIMERS] =
+	{
+		"total",
+		"temp",
+		"rasterize_triangles",
+		"build_compact_heightfield",
+		"build_contours",
+		"build_contours_trace",
+		"build_contours_simplify",
+		"filter_border",
+		"filter_walkable",
+		"median_area",
+		"filter_low_obstacles",
+		"build_polymesh",
+		"merge_polymesh",
+		"erode_area",
+		"mark_box_area",
+		"mark_cylinder_area",
+		"mark_convexpoly_area",
+		"build_distancefield",
+		"build_distancefield_dist",
+		"build_distancefield_blur",
+		"build_regions",
+		"build_regions_watershed",
+		"build_regions_expand",
+		"build_regions_flood",
+		"build_regions_filter",
+		"build_layers",
+		"build_polymeshdetail",
+		"merge_polymeshdetail",
+	};
+	return ((label >= 0) && (label < RC_MAX_TIMERS)) ? names[label] : "";
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 class GLCheckerTexture
@@ -331,7 +404,7 @@ bool FileIO::read(void* ptr, const size_t size)
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 DebugDrawPanda3d::DebugDrawPanda3d(NodePath render) :
-		m_render(render), m_depthMask(true), m_texture(true), m_vertexIdx(0), m_prim(
+		m_render(render), m_depthMask(true), m_texture(true), m_prim(
 				DU_DRAW_TRIS), m_size(0), m_quadCurrIdx(0)
 {
 }
@@ -340,6 +413,25 @@ DebugDrawPanda3d::~DebugDrawPanda3d()
 {
 }
 
+CPT(GeomVertexFormat) DebugDrawPanda3d::getVertexFormat()
+{
+	static CPT(GeomVertexFormat) format;
+	if (!format)
+	{
+		// laid out as Vertex, so the vertices are copied at once
+		PT(GeomVertexArrayFormat) arrayFormat = new GeomVertexArrayFormat();
+		arrayFormat->add_column(InternalName::get_vertex(), 3,
+				Geom::NT_float32, Geom::C_point, offsetof(Vertex, pos));
+		arrayFormat->add_column(InternalName::get_color(), 4,
+				Geom::NT_uint8, Geom::C_color, offsetof(Vertex, color));
+		arrayFormat->add_column(InternalName::get_texcoord(), 2,
+				Geom::NT_float32, Geom::C_texcoord, offsetof(Vertex, uv));
+		arrayFormat->set_stride(sizeof(Vertex));
+		format = GeomVertexFormat::register_format(arrayFormat);
+	}
+	return format;
+}
+
 void DebugDrawPanda3d::depthMask(bool state)
 {
 	m_depthMask = state;
@@ -352,79 +444,41 @@ void DebugDrawPanda3d::texture(bool state)
 
 void DebugDrawPanda3d::begin(duDebugDrawPrimitives prim, float size)
 {
-	m_vertexData = new GeomVertexData("VertexData",
-			GeomVertexFormat::get_v3c4t2(), Geom::UH_static);
-	m_vertex = GeomVertexWriter(m_vertexData, "vertex");
-	m_color = GeomVertexWriter(m_vertexData, "color");
-	m_texcoord = GeomVertexWriter(m_vertexData, "texcoord");
-	switch (prim)
-	{
-	case DU_DRAW_POINTS:
-		m_geomPrim = new GeomPoints(Geom::UH_static);
-		break;
-	case DU_DRAW_LINES:
-		m_geomPrim = new GeomLines(Geom::UH_static);
-		break;
-	case DU_DRAW_TRIS:
-		m_geomPrim = new GeomTriangles(Geom::UH_static);
-		break;
-	case DU_DRAW_QUADS:
-		m_geomPrim = new GeomTriangles(Geom::UH_static);
-		m_quadCurrIdx = 0;
-		break;
-	};
+	m_vertices.clear();
 	m_prim = prim;
 	m_size = size;
-	m_vertexIdx = 0;
-}
-
-void DebugDrawPanda3d::doVertex(const LVector3f& vertex, const LVector4f& color,
-		const LVector2f& uv)
-{
-	if (m_prim != DU_DRAW_QUADS)
+	m_quadCurrIdx = 0;
+}
+
+void DebugDrawPanda3d::doVertex(const LVecBase3f& vertex, unsigned int color,
+		const float u, const float v)
+{
+	Vertex currVertex;
+	currVertex.pos[0] = vertex.get_x();
+	currVertex.pos[1] = vertex.get_y();
+	currVertex.pos[2] = vertex.get_z();
+	currVertex.color[0] = (unsigned char) ((color & 0x000000FF) >> 0);
+	currVertex.color[1] = (unsigned char) ((color & 0x0000FF00) >> 8);
+	currVertex.color[2] = (unsigned char) ((color & 0x00FF0000) >> 16);
+	currVertex.color[3] = (unsigned char) ((color & 0xFF000000) >> 24);
+	currVertex.uv[0] = u;
+	currVertex.uv[1] = v;
+	if (m_prim == DU_DRAW_QUADS)
 	{
-		m_vertex.add_data3f(vertex);
-		m_color.add_data4f(color);
-		m_texcoord.add_data2f(uv);
-		//
-		m_geomPrim->add_vertex(m_vertexIdx);
-		++m_vertexIdx;
-	}
-	else
-	{
-		int quadCurrIdxMod = m_quadCurrIdx % 4;
-		LVector3f currVertex = vertex;
-		LVector4f currColor = color;
-		LVector2f currUV = uv;
-		switch (quadCurrIdxMod)
+		// a quad (0,1,2,3) is drawn as triangles (0,1,2) and (0,2,3)
+		switch (m_quadCurrIdx % 4)
 		{
 		case 0:
 			m_quadFirstVertex = currVertex;
-			m_quadFirstColor = currColor;
-			m_quadFirstUV = currUV;
 			++m_quadCurrIdx;
 			break;
 		case 2:
 			m_quadThirdVertex = currVertex;
-			m_quadThirdColor = currColor;
-			m_quadThirdUV = currUV;
 			++m_quadCurrIdx;
 			break;
 		case 3:
-			//first
-			m_vertex.add_data3f(m_quadFirstVertex);
-			m_color.add_data4f(m_quadFirstColor);
-			m_texcoord.add_data2f(m_quadFirstUV);
-			//
-			m_geomPrim->add_vertex(m_vertexIdx);
-			++m_vertexIdx;
-			//last
-			m_vertex.add_data3f(m_quadThirdVertex);
-			m_color.add_data4f(m_quadThirdColor);
-			m_texcoord.add_data2f(m_quadThirdUV);
-			//
-			m_geomPrim->add_vertex(m_vertexIdx);
-			++m_vertexIdx;
+			m_vertices.push_back(m_quadFirstVertex);
+			m_vertices.push_back(m_quadThirdVertex);
 			m_quadCurrIdx = 0;
 			break;
 		case 1:
@@ -433,62 +487,91 @@ void DebugDrawPanda3d::doVertex(const LVector3f& vertex, const LVector4f& color,
 		default:
 			break;
 		};
-		//current vertex
-		///
-		m_vertex.add_data3f(currVertex);
-		m_color.add_data4f(currColor);
-		m_texcoord.add_data2f(currUV);
-		//
-		m_geomPrim->add_vertex(m_vertexIdx);
-		++m_vertexIdx;
-		///
 	}
+	//current vertex
+	m_vertices.push_back(currVertex);
 }
 
 void DebugDrawPanda3d::vertex(const float* pos, unsigned int color)
 {
-	doVertex(Recast3fToLVecBase3f(pos[0], pos[1], pos[2]),
-			LVector4f(red(color), green(color), blue(color), alpha(color)));
+	doVertex(Recast3fToLVecBase3f(pos[0], pos[1], pos[2]), color);
 }
 
 void DebugDrawPanda3d::vertex(const float x, const float y, const float z,
 		unsigned int color)
 {
-	doVertex(Recast3fToLVecBase3f(x, y, z),
-			LVector4f(red(color), green(color), blue(color), alpha(color)));
+	doVertex(Recast3fToLVecBase3f(x, y, z), color);
 }
 
 void DebugDrawPanda3d::vertex(const float* pos, unsigned int color,
 		const float* uv)
 {
-	doVertex(Recast3fToLVecBase3f(pos[0], pos[1], pos[2]),
-			LVector4f(red(color), green(color), blue(color), alpha(color)),
-			LVector2f(uv[0], uv[1]));
+	doVertex(Recast3fToLVecBase3f(pos[0], pos[1], pos[2]), color, uv[0],
+			uv[1]);
 }
 
 void DebugDrawPanda3d::vertex(const float x, const float y, const float z,
 		unsigned int color, const float u, const float v)
 {
-	doVertex(Recast3fToLVecBase3f(x, y, z),
-			LVector4f(red(color), green(color), blue(color), alpha(color)),
-			LVector2f(u, v));
+	doVertex(Recast3fToLVecBase3f(x, y, z), color, u, v);
 }
 
 void DebugDrawPanda3d::end()
 {
-	m_geomPrim->close_primitive();
-	m_geom = new Geom(m_vertexData);
-	m_geom->add_primitive(m_geomPrim);
+	const int numVertices = (int) m_vertices.size();
+	if (numVertices == 0)
+	{
+		return;
+	}
+	// copy the vertices at once
+	PT(GeomVertexData) vertexData = new GeomVertexData("VertexData",
+			getVertexFormat(), Geom::UH_static);
+	vertexData->unclean_set_num_rows(numVertices);
+	{
+		PT(GeomVertexArrayDataHandle) handle =
+				vertexData->modify_array(0)->modify_handle();
+		memcpy(handle->get_write_pointer(), &m_vertices[0],
+				numVertices * sizeof(Vertex));
+	}
+	m_vertices.clear();
+	// the primitive just references them in order (not indexed)
+	PT(GeomPrimitive) geomPrim;
+	switch (m_prim)
+	{
+	case DU_DRAW_POINTS:
+		geomPrim = new GeomPoints(Geom::UH_static);
+		break;
+	case DU_DRAW_LINES:
+		geomPrim = new GeomLines(Geom::UH_static);
+		break;
+	case DU_DRAW_TRIS:
+	case DU_DRAW_QUADS:
+	default:
+		geomPrim = new GeomTriangles(Geom::UH_static);
+		break;
+	};
+	geomPrim->add_consecutive_vertices(0, numVertices);
+	geomPrim->close_primitive();
+	PT(Geom) geom = new Geom(vertexData);
+	geom->add_primitive(geomPrim);
+	CPT(RenderState) state = RenderState::make(
+			DepthWriteAttrib::make(
+					m_depthMask ?
+							DepthWriteAttrib::M_on : DepthWriteAttrib::M_off),
+			TransparencyAttrib::make(TransparencyAttrib::M_alpha),
+			RenderModeAttrib::make(RenderModeAttrib::M_unchanged, m_size));
+	if (m_groupNode)
+	{
+		m_groupNode->add_geom(geom, state);
+		return;
+	}
 	std::ostringstream ss;
 	ss << "DebugDrawPanda3d_GeomNode_" << m_geomNodeNPCollection.size();
-	m_geomNodeNP = NodePath(new GeomNode(ss.str()));
-	DCAST(GeomNode, m_geomNodeNP.node())->add_geom(m_geom);
-	m_geomNodeNP.reparent_to(m_render);
-	m_geomNodeNP.set_depth_write(m_depthMask);
-	m_geomNodeNP.set_transparency(TransparencyAttrib::M_alpha);
-	m_geomNodeNP.set_render_mode_thickness(m_size);
+	PT(GeomNode) geomNode = new GeomNode(ss.str());
+	geomNode->add_geom(geom, state);
+	NodePath geomNodeNP = m_render.attach_new_node(geomNode);
 	//add to geom node paths.
-	m_geomNodeNPCollection.push_back(m_geomNodeNP);
+	m_geomNodeNPCollection.push_back(geomNodeNP);
 }
 
 unsigned int DebugDrawPanda3d::areaToCol(unsigned int area)
@@ -533,6 +616,118 @@ void DebugDrawPanda3d::reset()
 	m_geomNodeNPCollection.clear();
 }
 
+void DebugDrawPanda3d::beginGroup(const std::string& name)
+{
+	m_groupNode = new GeomNode(name);
+}
+
+NodePath DebugDrawPanda3d::endGroup()
+{
+	NodePath groupNP;
+	if (m_groupNode)
+	{
+		groupNP = m_render.attach_new_node(m_groupNode);
+		m_groupNode.clear();
+	}
+	return groupNP;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+DebugDrawNavMeshTiles::DebugDrawNavMeshTiles(NodePath render) :
+		m_mesh(0), m_flags(0), m_redrawnTiles(0), m_dd(render)
+{
+}
+
+DebugDrawNavMeshTiles::~DebugDrawNavMeshTiles()
+{
+	reset();
+}
+
+unsigned int DebugDrawNavMeshTiles::getSignature(const dtNavMesh& mesh,
+		const dtMeshTile* tile)
+{
+	// FNV-1a of: the tile's reference, whose salt changes whenever the tile is
+	// replaced, the polygons' areas, and the links, whose references change
+	// whenever a linked (neighbor) tile is replaced
+	unsigned int hash = 2166136261u;
+	const dtTileRef tileRef = mesh.getTileRef(tile);
+	for (unsigned int i = 0; i < sizeof(dtTileRef); ++i)
+	{
+		hash = (hash ^ ((tileRef >> (i * 8)) & 0xFF)) * 16777619u;
+	}
+	for (int i = 0; i < tile->header->polyCount; ++i)
+	{
+		const dtPoly* p = &tile->polys[i];
+		hash = (hash ^ p->areaAndtype) * 16777619u;
+		for (unsigned int k = p->firstLink; k != DT_NULL_LINK;
+				k = tile->links[k].next)
+		{
+			const dtLink& link = tile->links[k];
+			for (unsigned int j = 0; j < sizeof(dtPolyRef); ++j)
+			{
+				hash = (hash ^ ((link.ref >> (j * 8)) & 0xFF)) * 16777619u;
+			}
+			hash = (hash ^ link.edge) * 16777619u;
+		}
+	}
+	// 0 means not drawn
+	return hash ? hash : 1;
+}
+
+void DebugDrawNavMeshTiles::draw(const dtNavMesh& mesh, unsigned char flags)
+{
+	if ((&mesh != m_mesh) || (flags != m_flags))
+	{
+		reset();
+		m_mesh = &mesh;
+		m_flags = flags;
+	}
+	m_tiles.resize(mesh.getMaxTiles());
+	m_redrawnTiles = 0;
+	for (int i = 0; i < mesh.getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = mesh.getTile(i);
+		Tile& cached = m_tiles[i];
+		const unsigned int signature =
+				tile->header ? getSignature(mesh, tile) : 0;
+		if (signature == cached.signature)
+		{
+			continue;
+		}
+		// changed: redraw (or remove) it
+		if (!cached.geomNodeNP.is_empty())
+		{
+			cached.geomNodeNP.remove_node();
+		}
+		cached.signature = signature;
+		if (tile->header)
+		{
+			std::ostringstream ss;
+			ss << "DebugDrawNavMeshTiles_Tile_" << tile->header->x << "_"
+					<< tile->header->y << "_" << tile->header->layer;
+			m_dd.beginGroup(ss.str());
+			duDebugDrawNavMeshTile(&m_dd, mesh, tile, flags);
+			cached.geomNodeNP = m_dd.endGroup();
+			++m_redrawnTiles;
+		}
+	}
+}
+
+void DebugDrawNavMeshTiles::reset()
+{
+	std::vector<Tile>::iterator iter;
+	for (iter = m_tiles.begin(); iter != m_tiles.end(); ++iter)
+	{
+		if (!(*iter).geomNodeNP.is_empty())
+		{
+			(*iter).geomNodeNP.remove_node();
+		}
+	}
+	m_tiles.clear();
+	m_mesh = 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 DebugDrawMeshDrawer::DebugDrawMeshDrawer(NodePath render, NodePath camera,
@@ -29,9 +29,11 @@
 #include "common.h"
 #include <DebugDraw.h>
 #include <Recast.h>
+#include <DetourNavMesh.h>
 #include "PerfTimer.h"
 #include <nodePath.h>
-#include <geomVertexWriter.h>
+#include <geomNode.h>
+#include <geomVertexFormat.h>
 #include <meshDrawer.h>
 #include <RecastDump.h>
 
@@ -44,6 +46,8 @@ class BuildContext : public rcContext
 {
 	TimeVal m_startTime[RC_MAX_TIMERS];
 	TimeVal m_accTime[RC_MAX_TIMERS];
+	///Accumulated times not affected by resetTimers() (see resetStats()).
+	TimeVal m_statTime[RC_MAX_TIMERS];
 
 	static const int MAX_MESSAGES = 1000;
 	const char* m_messages[MAX_MESSAGES];
@@ -61,6 +65,16 @@ public:
 	int getLogCount() const;
 	/// Returns log message text.
 	const char* getLogText(const int i) const;
+	/// Resets the statistics' timers.
+	void resetStats();
+	/// Returns the time (usec) accumulated by a timer since the last
+	/// resetStats(), that is through any number of resetTimers().
+	int getStatTime(const rcTimerLabel label) const;
+	/// Returns the name of a timer.
+	static const char* getTimerName(const rcTimerLabel label);
+	/// Appends the log of another context (i.e. of a worker thread) and adds
+	/// its statistics' times.
+	void merge(const BuildContext& other);
 	
 protected:	
 	/// Virtual functions for custom implementations.
@@ -109,47 +123,58 @@ private:
 };
 
 /// Panda3d debug draw implementation.
+///
+/// The vertices of each begin()/end() pair are collected into a plain array,
+/// which is copied at once into the GeomVertexData of a Geom. Each Geom goes
+/// into its own GeomNode, unless inside a beginGroup()/endGroup() pair, where
+/// all the Geoms (each with its render state) go into a single GeomNode.
 class DebugDrawPanda3d : public duDebugDraw
 {
 protected:
+	///A vertex, as laid out in the GeomVertexData (see getVertexFormat()).
+	struct Vertex
+	{
+		float pos[3];
+		unsigned char color[4];
+		float uv[2];
+	};
 	///The render node path.
 	NodePath m_render;
 	///Depth Mask.
 	bool m_depthMask;
 	///Texture.
 	bool m_texture;
-	///The current GeomVertexData.
-	PT(GeomVertexData) m_vertexData;
-	///The current vertex index.
-	int m_vertexIdx;
-	///The current GeomVertexWriters.
-	GeomVertexWriter m_vertex, m_color, m_texcoord;
-	///The current GeomPrimitive and draw type.
-	PT(GeomPrimitive) m_geomPrim;
+	///The current vertices.
+	std::vector<Vertex> m_vertices;
+	///The current draw type.
 	duDebugDrawPrimitives m_prim;
 	///Size (for points)
 	float m_size;
-	///The current Geom.
-	PT(Geom) m_geom;
-	///The current GeomNode node path.
-	NodePath m_geomNodeNP;
 	///The GeomNodes' node paths.
 	std::vector<NodePath> m_geomNodeNPCollection;
+	///The GeomNode of the current group (if any).
+	PT(GeomNode) m_groupNode;
 	///QUADS stuff.
 	int m_quadCurrIdx;
-	LVector3f m_quadFirstVertex, m_quadThirdVertex;
-	LVector4f m_quadFirstColor, m_quadThirdColor;
-	LVector2f m_quadFirstUV, m_quadThirdUV;
+	Vertex m_quadFirstVertex, m_quadThirdVertex;
 
 	///Helper
-	void doVertex(const LVector3f& vertex, const LVector4f& color,
-			const LVector2f& uv = LVecBase2f::zero());
+	void doVertex(const LVecBase3f& vertex, unsigned int color,
+			const float u = 0.0f, const float v = 0.0f);
+	static CPT(GeomVertexFormat) getVertexFormat();
 public:
 	DebugDrawPanda3d(NodePath render);
 	virtual ~DebugDrawPanda3d();
 
 	void reset();
 
+	///Collects the Geoms of the next begin()/end() pairs into a single
+	///GeomNode.
+	void beginGroup(const std::string& name);
+	///Ends the current group, returning its GeomNode's node path (a child of
+	///the render node path), which isn't removed by reset().
+	NodePath endGroup();
+
 	virtual void depthMask(bool state);
 	virtual void texture(bool state);
 	virtual void begin(duDebugDrawPrimitives prim, float size = 1.0f);
@@ -163,6 +188,65 @@ public:
 	NodePath getGeomNode(int i);
 	int getGeomNodesNum();
 
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	DebugDrawPanda3d(const DebugDrawPanda3d&);
+	DebugDrawPanda3d& operator=(const DebugDrawPanda3d&);
+};
+
+/// Panda3d debug draw of a navigation mesh, whose tiles' geometry is cached.
+///
+/// Each tile is drawn into its own GeomNode, which is kept until the tile
+/// changes: that is, until it is rebuilt or removed, its polygons' areas
+/// change, or its links to the neighbor tiles change. So redrawing the
+/// navigation mesh only regenerates the geometry of the tiles changed since
+/// the last draw().
+/// \note The closed list depends on the last query, not on the tiles, so it
+/// isn't drawn here (see duDebugDrawNavMeshClosedList()).
+class DebugDrawNavMeshTiles
+{
+	struct Tile
+	{
+		Tile() :
+				signature(0)
+		{
+		}
+		///The hash of what the drawing depends on (0 if not drawn).
+		unsigned int signature;
+		NodePath geomNodeNP;
+	};
+	///The drawn navigation mesh.
+	const dtNavMesh* m_mesh;
+	///The draw flags (see DrawNavMeshFlags).
+	unsigned char m_flags;
+	///The cached tiles, indexed like the navigation mesh's ones.
+	std::vector<Tile> m_tiles;
+	///The number of tiles redrawn by the last draw().
+	int m_redrawnTiles;
+	///The tiles' drawer.
+	DebugDrawPanda3d m_dd;
+
+	static unsigned int getSignature(const dtNavMesh& mesh,
+			const dtMeshTile* tile);
+public:
+	DebugDrawNavMeshTiles(NodePath render);
+	~DebugDrawNavMeshTiles();
+
+	///Draws the changed tiles of the navigation mesh (all of them if the mesh
+	///or the flags have changed), and removes those no longer present.
+	void draw(const dtNavMesh& mesh, unsigned char flags);
+	///Removes all the tiles' geometry.
+	void reset();
+
+	int getRedrawnTilesNum() const
+	{
+		return m_redrawnTiles;
+	}
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	DebugDrawNavMeshTiles(const DebugDrawNavMeshTiles&);
+	DebugDrawNavMeshTiles& operator=(const DebugDrawNavMeshTiles&);
 };
 
 /// MeshDrawer debug draw implementation.
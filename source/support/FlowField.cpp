@@ -0,0 +1,367 @@
+/**
+ * \file FlowField.cpp
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#include "FlowField.h"
+#include <DetourCommon.h>
+#include <float.h>
+#include <functional>
+#include <queue>
+
+namespace rnsup
+{
+
+FlowField::FlowField() :
+		m_navMesh(0), m_goalRef(0), m_numReached(0)
+{
+	dtVset(m_goalPos, 0, 0, 0);
+}
+
+bool FlowField::build(const dtNavMesh* navMesh, const dtQueryFilter* filter,
+		dtPolyRef goalRef, const float* goalPos)
+{
+	clear();
+	if (!navMesh || !filter || !navMesh->isValidPolyRef(goalRef))
+		return false;
+
+	m_navMesh = navMesh;
+	m_goalRef = goalRef;
+	dtVcopy(m_goalPos, goalPos);
+
+	// allocate a cell for each polygon of each tile
+	const int maxTiles = navMesh->getMaxTiles();
+	m_tileOffsets.resize(maxTiles + 1);
+	int numCells = 0;
+	for (int i = 0; i < maxTiles; ++i)
+	{
+		m_tileOffsets[i] = numCells;
+		const dtMeshTile* tile = navMesh->getTile(i);
+		if (tile->header)
+			numCells += tile->header->polyCount;
+	}
+	m_tileOffsets[maxTiles] = numCells;
+	m_cells.resize(numCells);
+
+	// polygon centers and passability
+	std::vector<float> centers(numCells * 3);
+	std::vector<unsigned char> passable(numCells, 0);
+	for (int i = 0; i < maxTiles; ++i)
+	{
+		const dtMeshTile* tile = navMesh->getTile(i);
+		if (!tile->header)
+			continue;
+		const dtPolyRef base = navMesh->getPolyRefBase(tile);
+		for (int j = 0; j < tile->header->polyCount; ++j)
+		{
+			const int slot = m_tileOffsets[i] + j;
+			const dtPoly* poly = &tile->polys[j];
+			Cell& cell = m_cells[slot];
+			cell.ref = base | (dtPolyRef) j;
+			cell.next = 0;
+			cell.cost = FLT_MAX;
+			passable[slot] = ((poly->flags & filter->getIncludeFlags()) != 0)
+					&& ((poly->flags & filter->getExcludeFlags()) == 0);
+			float* center = &centers[slot * 3];
+			dtVset(center, 0, 0, 0);
+			for (int k = 0; k < (int) poly->vertCount; ++k)
+				dtVadd(center, center, &tile->verts[poly->verts[k] * 3]);
+			dtVscale(center, center, 1.0f / (float) poly->vertCount);
+		}
+	}
+
+	// incoming links of each polygon (links may be one-way, i.e. off-mesh
+	// connections) with their portal midpoints, in compressed form
+	std::vector<int> inOffsets(numCells + 1, 0);
+	std::vector<int> inSlots;
+	std::vector<float> inPortals;
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		std::vector<int> fill;
+		if (pass == 1)
+		{
+			for (int s = 0; s < numCells; ++s)
+				inOffsets[s + 1] += inOffsets[s];
+			inSlots.resize(inOffsets[numCells]);
+			inPortals.resize(inOffsets[numCells] * 3);
+			fill.assign(inOffsets.begin(), inOffsets.end() - 1);
+		}
+		for (int i = 0; i < maxTiles; ++i)
+		{
+			const dtMeshTile* tile = navMesh->getTile(i);
+			if (!tile->header)
+				continue;
+			for (int j = 0; j < tile->header->polyCount; ++j)
+			{
+				const int from = m_tileOffsets[i] + j;
+				if (!passable[from])
+					continue;
+				const dtPoly* poly = &tile->polys[j];
+				for (unsigned int k = poly->firstLink; k != DT_NULL_LINK;
+						k = tile->links[k].next)
+				{
+					const dtLink& link = tile->links[k];
+					const int to = getSlot(link.ref);
+					if ((to < 0) || !passable[to])
+						continue;
+					if (pass == 0)
+					{
+						++inOffsets[to + 1];
+						continue;
+					}
+					const int in = fill[to]++;
+					inSlots[in] = from;
+					getPortalMid(tile, poly, link, &centers[from * 3],
+							&inPortals[in * 3]);
+				}
+			}
+		}
+	}
+
+	// reverse Dijkstra from the goal: like the Detour's A*, a polygon is
+	// entered at the midpoint of the portal it is reached through, and the
+	// cost of crossing it is the distance to its exit weighted by its area cost
+	typedef std::pair<float, int> QueueItem;
+	std::priority_queue<QueueItem, std::vector<QueueItem>,
+			std::greater<QueueItem> > open;
+	std::vector<float> entries(centers);
+	const int goalSlot = getSlot(goalRef);
+	dtVcopy(&entries[goalSlot * 3], m_goalPos);
+	m_cells[goalSlot].cost = 0.0f;
+	open.push(QueueItem(0.0f, goalSlot));
+	while (!open.empty())
+	{
+		const QueueItem item = open.top();
+		open.pop();
+		const int cur = item.second;
+		if (item.first > m_cells[cur].cost)
+			continue;
+		++m_numReached;
+		const dtMeshTile* tile = 0;
+		const dtPoly* poly = 0;
+		navMesh->getTileAndPolyByRefUnsafe(m_cells[cur].ref, &tile, &poly);
+		const float areaCost = filter->getAreaCost(poly->getArea());
+		for (int k = inOffsets[cur]; k < inOffsets[cur + 1]; ++k)
+		{
+			const int from = inSlots[k];
+			const float* portal = &inPortals[k * 3];
+			const float cost = item.first
+					+ dtVdist(portal, &entries[cur * 3]) * areaCost;
+			if (cost < m_cells[from].cost)
+			{
+				m_cells[from].cost = cost;
+				m_cells[from].next = m_cells[cur].ref;
+				dtVcopy(&entries[from * 3], portal);
+				open.push(QueueItem(cost, from));
+			}
+		}
+	}
+	return true;
+}
+
+void FlowField::clear()
+{
+	m_navMesh = 0;
+	m_goalRef = 0;
+	m_tileOffsets.clear();
+	m_cells.clear();
+	m_numReached = 0;
+}
+
+float FlowField::getCost(dtPolyRef ref) const
+{
+	const int slot = getSlot(ref);
+	return slot >= 0 ? m_cells[slot].cost : FLT_MAX;
+}
+
+dtPolyRef FlowField::getNextHop(dtPolyRef ref) const
+{
+	const int slot = getSlot(ref);
+	return slot >= 0 ? m_cells[slot].next : 0;
+}
+
+int FlowField::getPath(dtPolyRef startRef, dtPolyRef* path,
+		const int maxPath, bool* complete) const
+{
+	int npath = 0;
+	dtPolyRef ref = startRef;
+	while (npath < maxPath)
+	{
+		const int slot = getSlot(ref);
+		if ((slot < 0) || (m_cells[slot].ref != ref)
+				|| (m_cells[slot].cost == FLT_MAX))
+			return 0;
+		path[npath++] = ref;
+		if (ref == m_goalRef)
+		{
+			if (complete)
+				*complete = true;
+			return npath;
+		}
+		ref = m_cells[slot].next;
+	}
+	// the goal is reachable (its cost is finite) but farther than maxPath
+	if (complete)
+		*complete = false;
+	return npath;
+}
+
+void FlowField::getPortalMid(const dtMeshTile* tile, const dtPoly* poly,
+		const dtLink& link, const float* center, float* mid) const
+{
+	if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		// the connection's end point
+		dtVcopy(mid, &tile->verts[poly->verts[link.edge] * 3]);
+		return;
+	}
+	if (link.edge >= poly->vertCount)
+	{
+		// link towards an off-mesh connection
+		dtVcopy(mid, center);
+		return;
+	}
+	const float* va = &tile->verts[poly->verts[link.edge] * 3];
+	const float* vb = &tile->verts[poly->verts[(link.edge + 1)
+			% poly->vertCount] * 3];
+	float tmin = 0.0f, tmax = 1.0f;
+	if (link.side != 0xff)
+	{
+		// portal to another tile: a part of the edge
+		tmin = link.bmin * (1.0f / 255.0f);
+		tmax = link.bmax * (1.0f / 255.0f);
+	}
+	dtVlerp(mid, va, vb, (tmin + tmax) * 0.5f);
+}
+
+int FlowField::getSlot(dtPolyRef ref) const
+{
+	if (!m_navMesh || !ref)
+		return -1;
+	unsigned int salt, it, ip;
+	m_navMesh->decodePolyId(ref, salt, it, ip);
+	if (it + 1 >= (unsigned int) m_tileOffsets.size())
+		return -1;
+	const int slot = m_tileOffsets[it] + (int) ip;
+	if (slot >= m_tileOffsets[it + 1])
+		return -1;
+	return slot;
+}
+
+CrowdFlowFields::CrowdFlowFields() :
+		m_minAgents(0), m_maxFields(8), m_tick(0)
+{
+}
+
+CrowdFlowFields::~CrowdFlowFields()
+{
+	clear();
+}
+
+void CrowdFlowFields::setMaxFields(int maxFields)
+{
+	m_maxFields = maxFields > 1 ? maxFields : 1;
+	evict(m_maxFields);
+}
+
+void CrowdFlowFields::update(dtCrowd* crowd)
+{
+	if (!m_minAgents || !crowd)
+		return;
+
+	// group the agents requesting a path by target
+	std::map<Key, std::vector<int> > requests;
+	for (int i = 0; i < crowd->getAgentCount(); ++i)
+	{
+		const dtCrowdAgent* ag = crowd->getAgent(i);
+		if (!ag->active || (ag->state == DT_CROWDAGENT_STATE_INVALID)
+				|| (ag->targetState != DT_CROWDAGENT_TARGET_REQUESTING))
+			continue;
+		requests[Key(ag->targetRef, ag->params.queryFilterType)].push_back(i);
+	}
+	if (requests.empty())
+		return;
+
+	++m_tick;
+	const dtNavMesh* navMesh = crowd->getNavMeshQuery()->getAttachedNavMesh();
+	dtPolyRef path[MAX_PATH];
+	std::map<Key, std::vector<int> >::const_iterator iter;
+	for (iter = requests.begin(); iter != requests.end(); ++iter)
+	{
+		const Key& key = iter->first;
+		const std::vector<int>& agents = iter->second;
+		std::map<Key, Entry*>::iterator fieldIter = m_fields.find(key);
+		if (fieldIter == m_fields.end())
+		{
+			if ((int) agents.size() < m_minAgents)
+				continue;
+			evict(m_maxFields - 1);
+			Entry* entry = new Entry();
+			if (!entry->field.build(navMesh, crowd->getFilter(key.second),
+					key.first, crowd->getAgent(agents[0])->targetPos))
+			{
+				delete entry;
+				continue;
+			}
+			fieldIter = m_fields.insert(std::make_pair(key, entry)).first;
+		}
+		Entry* entry = fieldIter->second;
+		entry->lastUse = m_tick;
+
+		// set corridors as dtCrowd::updateMoveRequest() does on success
+		for (int i = 0; i < (int) agents.size(); ++i)
+		{
+			dtCrowdAgent* ag = crowd->getEditableAgent(agents[i]);
+			// the corridor must be shorter than its max path (MAX_PATH too)
+			bool complete = false;
+			const int npath = entry->field.getPath(ag->corridor.getFirstPoly(),
+					path, MAX_PATH - 1, &complete);
+			if (!npath)
+				// let the crowd plan it
+				continue;
+			if (complete)
+				ag->corridor.setCorridor(ag->targetPos, path, npath);
+			else
+			{
+				// partial: the target is constrained inside the last polygon
+				// and the crowd replans when the corridor's end is near
+				float target[3];
+				crowd->getNavMeshQuery()->closestPointOnPoly(path[npath - 1],
+						ag->targetPos, target, 0);
+				ag->corridor.setCorridor(target, path, npath);
+			}
+			ag->boundary.reset();
+			ag->partial = !complete;
+			ag->targetState = DT_CROWDAGENT_TARGET_VALID;
+			ag->targetReplanTime = 0.0;
+		}
+	}
+}
+
+void CrowdFlowFields::clear()
+{
+	std::map<Key, Entry*>::iterator iter;
+	for (iter = m_fields.begin(); iter != m_fields.end(); ++iter)
+		delete iter->second;
+	m_fields.clear();
+}
+
+void CrowdFlowFields::evict(int maxFields)
+{
+	while ((int) m_fields.size() > maxFields)
+	{
+		std::map<Key, Entry*>::iterator lru = m_fields.begin();
+		std::map<Key, Entry*>::iterator iter;
+		for (iter = m_fields.begin(); iter != m_fields.end(); ++iter)
+		{
+			if (iter->second->lastUse < lru->second->lastUse)
+				lru = iter;
+		}
+		delete lru->second;
+		m_fields.erase(lru);
+	}
+}
+
+} // namespace rnsup
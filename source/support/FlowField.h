@@ -0,0 +1,146 @@
+/**
+ * \file FlowField.h
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include <DetourNavMesh.h>
+#include <DetourNavMeshQuery.h>
+#include <DetourCrowd.h>
+#include <map>
+#include <vector>
+
+namespace rnsup
+{
+
+/**
+ * A flow field towards a goal polygon.
+ *
+ * A single (reverse) Dijkstra search from the goal over the whole navigation
+ * mesh stores, for each reached polygon, its cost to the goal and the next
+ * polygon ("next hop") to go through: the polygon corridor from any polygon
+ * to the goal is then obtained by simply following the next hops.\n
+ * The field refers to the tiles' polygons as they were when it was built, so
+ * it should be rebuilt (or discarded) after tile changes.
+ */
+class FlowField
+{
+	struct Cell
+	{
+		///The polygon ref when the field was built (for salt checks).
+		dtPolyRef ref;
+		dtPolyRef next;
+		float cost;
+	};
+
+	const dtNavMesh* m_navMesh;
+	dtPolyRef m_goalRef;
+	float m_goalPos[3];
+	///Index of the first cell of each tile (plus one past the end).
+	std::vector<int> m_tileOffsets;
+	std::vector<Cell> m_cells;
+	int m_numReached;
+
+public:
+	FlowField();
+
+	bool build(const dtNavMesh* navMesh, const dtQueryFilter* filter,
+			dtPolyRef goalRef, const float* goalPos);
+	void clear();
+
+	dtPolyRef getGoalRef() const
+	{
+		return m_goalRef;
+	}
+	const float* getGoalPos() const
+	{
+		return m_goalPos;
+	}
+	int getNumReached() const
+	{
+		return m_numReached;
+	}
+	///Returns FLT_MAX if the goal isn't reachable from ref.
+	float getCost(dtPolyRef ref) const;
+	dtPolyRef getNextHop(dtPolyRef ref) const;
+	///Returns the corridor's polygons count, or 0 if the goal isn't reachable
+	///from startRef. If the goal is farther than maxPath polygons only the
+	///first maxPath ones are returned and complete is set to false.
+	int getPath(dtPolyRef startRef, dtPolyRef* path, const int maxPath,
+			bool* complete = 0) const;
+
+private:
+	int getSlot(dtPolyRef ref) const;
+	void getPortalMid(const dtMeshTile* tile, const dtPoly* poly,
+			const dtLink& link, const float* center, float* mid) const;
+};
+
+/**
+ * Flow fields shared by the crowd agents moving towards the same target.
+ *
+ * update() should be called just before dtCrowd::update(): the agents which
+ * have just requested a move target (or a replan) are grouped by target
+ * polygon and query filter type, and, when at least getMinAgents() agents
+ * share a target, a FlowField is built for it and their corridors are set
+ * from it, so they skip the per agent A* searches of the dtCrowd.\n
+ * Fields are kept (up to getMaxFields(), least recently used are dropped) and
+ * reused by following requests for the same target.
+ * \note A minimum of 0 agents disables flow fields.
+ */
+class CrowdFlowFields
+{
+	struct Entry
+	{
+		FlowField field;
+		unsigned int lastUse;
+	};
+	///Key: (target polygon, query filter type).
+	typedef std::pair<dtPolyRef, int> Key;
+
+	std::map<Key, Entry*> m_fields;
+	int m_minAgents, m_maxFields;
+	unsigned int m_tick;
+
+public:
+	///As dtCrowd's agent corridors.
+	static const int MAX_PATH = 256;
+
+	CrowdFlowFields();
+	~CrowdFlowFields();
+
+	void setMinAgents(int minAgents)
+	{
+		m_minAgents = minAgents > 0 ? minAgents : 0;
+	}
+	int getMinAgents() const
+	{
+		return m_minAgents;
+	}
+	void setMaxFields(int maxFields);
+	int getMaxFields() const
+	{
+		return m_maxFields;
+	}
+	int getNumFields() const
+	{
+		return (int) m_fields.size();
+	}
+
+	void update(dtCrowd* crowd);
+	void clear();
+
+private:
+	void evict(int maxFields);
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	CrowdFlowFields(const CrowdFlowFields&);
+	CrowdFlowFields& operator=(const CrowdFlowFields&);
+};
+
+} // namespace rnsup
+
+#endif // FLOWFIELD_H
@@ -138,8 +138,7 @@ bool InputGeom::loadMesh(rcContext* ctx, const std::string& filepath,
 		delete m_mesh;
 		m_mesh = 0;
 	}
-	m_offMeshConCount = 0;
-	m_volumeCount = 0;
+	clearVolumesAndConnections();
 	
 	m_mesh = new rcMeshLoaderObj;
 	if (!m_mesh)
@@ -179,6 +178,11 @@ bool InputGeom::loadMesh(rcContext* ctx, const std::string& filepath,
 	}
 
 	rcCalcBounds(m_mesh->getVerts(), m_mesh->getVertCount(), m_meshBMin, m_meshBMax);
+	
+	// Index convex volumes and off-mesh connections on a 64x64 grid over the mesh.
+	const float gridCellSize = rcMax(m_meshBMax[0]-m_meshBMin[0], m_meshBMax[2]-m_meshBMin[2]) / 64.0f;
+	m_offMeshConGrid.init(m_meshBMin, m_meshBMax, gridCellSize);
+	m_volumeGrid.init(m_meshBMin, m_meshBMax, gridCellSize);
 
 	m_chunkyMesh = new rcChunkyTriMesh;
 	if (!m_chunkyMesh)
@@ -234,8 +238,7 @@ bool InputGeom::loadGeomSet(rcContext* ctx, const std::string& filepath)
 		return false;
 	}
 	
-	m_offMeshConCount = 0;
-	m_volumeCount = 0;
+	clearVolumesAndConnections();
 	delete m_mesh;
 	m_mesh = 0;
 
@@ -266,34 +269,27 @@ bool InputGeom::loadGeomSet(rcContext* ctx, const std::string& filepath)
 		else if (row[0] == 'c')
 		{
 			// Off-mesh connection
-			if (m_offMeshConCount < MAX_OFFMESH_CONNECTIONS)
-			{
-				float* v = &m_offMeshConVerts[m_offMeshConCount*3*2];
-				int bidir, area = 0, flags = 0;
-				float rad;
-				sscanf(row+1, "%f %f %f  %f %f %f %f %d %d %d",
-					   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &rad, &bidir, &area, &flags);
-				m_offMeshConRads[m_offMeshConCount] = rad;
-				m_offMeshConDirs[m_offMeshConCount] = (unsigned char)bidir;
-				m_offMeshConAreas[m_offMeshConCount] = (unsigned char)area;
-				m_offMeshConFlags[m_offMeshConCount] = (unsigned short)flags;
-				m_offMeshConCount++;
-			}
+			float v[6];
+			int bidir, area = 0, flags = 0;
+			float rad;
+			sscanf(row+1, "%f %f %f  %f %f %f %f %d %d %d",
+				   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &rad, &bidir, &area, &flags);
+			addOffMeshConnection(&v[0], &v[3], rad, (unsigned char)bidir,
+								 (unsigned char)area, (unsigned short)flags);
 		}
 		else if (row[0] == 'v')
 		{
 			// Convex volumes
-			if (m_volumeCount < MAX_VOLUMES)
+			ConvexVolume vol;
+			memset(&vol, 0, sizeof(ConvexVolume));
+			sscanf(row+1, "%d %d %f %f", &vol.nverts, &vol.area, &vol.hmin, &vol.hmax);
+			for (int i = 0; i < vol.nverts; ++i)
 			{
-				ConvexVolume* vol = &m_volumes[m_volumeCount++];
-				sscanf(row+1, "%d %d %f %f", &vol->nverts, &vol->area, &vol->hmin, &vol->hmax);
-				for (int i = 0; i < vol->nverts; ++i)
-				{
-					row[0] = '\0';
-					src = parseRow(src, srcEnd, row, sizeof(row)/sizeof(char));
-					sscanf(row, "%f %f %f", &vol->verts[i*3+0], &vol->verts[i*3+1], &vol->verts[i*3+2]);
-				}
+				row[0] = '\0';
+				src = parseRow(src, srcEnd, row, sizeof(row)/sizeof(char));
+				sscanf(row, "%f %f %f", &vol.verts[i*3+0], &vol.verts[i*3+1], &vol.verts[i*3+2]);
 			}
+			addConvexVolume(vol.verts, vol.nverts, vol.hmin, vol.hmax, (unsigned char)vol.area);
 		}
 		else if (row[0] == 's')
 		{
@@ -507,15 +503,14 @@ bool InputGeom::raycastMesh(float* src, float* dst, float& tmin)
 void InputGeom::addOffMeshConnection(const float* spos, const float* epos, const float rad,
 									 unsigned char bidir, unsigned char area, unsigned short flags)
 {
-	if (m_offMeshConCount >= MAX_OFFMESH_CONNECTIONS) return;
-	float* v = &m_offMeshConVerts[m_offMeshConCount*3*2];
-	m_offMeshConRads[m_offMeshConCount] = rad;
-	m_offMeshConDirs[m_offMeshConCount] = bidir;
-	m_offMeshConAreas[m_offMeshConCount] = area;
-	m_offMeshConFlags[m_offMeshConCount] = flags;
-	m_offMeshConId[m_offMeshConCount] = 1000 + m_offMeshConCount;
-	rcVcopy(&v[0], spos);
-	rcVcopy(&v[3], epos);
+	m_offMeshConVerts.insert(m_offMeshConVerts.end(), spos, spos + 3);
+	m_offMeshConVerts.insert(m_offMeshConVerts.end(), epos, epos + 3);
+	m_offMeshConRads.push_back(rad);
+	m_offMeshConDirs.push_back(bidir);
+	m_offMeshConAreas.push_back(area);
+	m_offMeshConFlags.push_back(flags);
+	m_offMeshConId.push_back(1000 + m_offMeshConCount);
+	indexOffMeshConnection(m_offMeshConCount);
 	m_offMeshConCount++;
 }
 
@@ -530,6 +525,52 @@ void InputGeom::deleteOffMeshConnection(int i)
 	m_offMeshConDirs[i] = m_offMeshConDirs[m_offMeshConCount];
 	m_offMeshConAreas[i] = m_offMeshConAreas[m_offMeshConCount];
 	m_offMeshConFlags[i] = m_offMeshConFlags[m_offMeshConCount];
+	m_offMeshConVerts.resize(m_offMeshConCount*3*2);
+	m_offMeshConRads.pop_back();
+	m_offMeshConDirs.pop_back();
+	m_offMeshConAreas.pop_back();
+	m_offMeshConFlags.pop_back();
+	m_offMeshConId.pop_back();
+	// the last connection's end points take the deleted one's ids
+	m_offMeshConGrid.remove(i*2);
+	m_offMeshConGrid.remove(i*2+1);
+	m_offMeshConGrid.move(m_offMeshConCount*2, i*2);
+	m_offMeshConGrid.move(m_offMeshConCount*2+1, i*2+1);
+}
+
+void InputGeom::indexOffMeshConnection(int i)
+{
+	const float* v = &m_offMeshConVerts[i*3*2];
+	m_offMeshConGrid.insert(i*2, &v[0], &v[0]);
+	m_offMeshConGrid.insert(i*2+1, &v[3], &v[3]);
+}
+
+void InputGeom::getOffMeshConnections(const float* bmin, const float* bmax,
+									  OffMeshConnectionSet& set) const
+{
+	// end points' ids to connections' indices (sorted ids keep them sorted)
+	m_offMeshConGrid.query(bmin, bmax, set.indices);
+	for (int k = 0; k < (int)set.indices.size(); ++k)
+		set.indices[k] /= 2;
+	set.indices.erase(std::unique(set.indices.begin(), set.indices.end()), set.indices.end());
+	
+	set.count = (int)set.indices.size();
+	set.verts.resize(set.count*3*2);
+	set.rads.resize(set.count);
+	set.dirs.resize(set.count);
+	set.areas.resize(set.count);
+	set.flags.resize(set.count);
+	set.ids.resize(set.count);
+	for (int k = 0; k < set.count; ++k)
+	{
+		const int i = set.indices[k];
+		memcpy(&set.verts[k*3*2], &m_offMeshConVerts[i*3*2], sizeof(float)*3*2);
+		set.rads[k] = m_offMeshConRads[i];
+		set.dirs[k] = m_offMeshConDirs[i];
+		set.areas[k] = m_offMeshConAreas[i];
+		set.flags[k] = m_offMeshConFlags[i];
+		set.ids[k] = m_offMeshConId[i];
+	}
 }
 
 void InputGeom::drawOffMeshConnections(duDebugDraw* dd, bool hilight)
@@ -566,20 +607,60 @@ void InputGeom::drawOffMeshConnections(duDebugDraw* dd, bool hilight)
 void InputGeom::addConvexVolume(const float* verts, const int nverts,
 								const float minh, const float maxh, unsigned char area)
 {
-	if (m_volumeCount >= MAX_VOLUMES) return;
-	ConvexVolume* vol = &m_volumes[m_volumeCount++];
+	m_volumes.resize(m_volumeCount + 1);
+	ConvexVolume* vol = &m_volumes[m_volumeCount];
 	memset(vol, 0, sizeof(ConvexVolume));
 	memcpy(vol->verts, verts, sizeof(float)*3*nverts);
 	vol->hmin = minh;
 	vol->hmax = maxh;
 	vol->nverts = nverts;
 	vol->area = area;
+	indexConvexVolume(m_volumeCount);
+	m_volumeCount++;
 }
 
 void InputGeom::deleteConvexVolume(int i)
 {
 	m_volumeCount--;
 	m_volumes[i] = m_volumes[m_volumeCount];
+	m_volumes.pop_back();
+	m_volumeGrid.remove(i);
+	m_volumeGrid.move(m_volumeCount, i);
+}
+
+void InputGeom::indexConvexVolume(int i)
+{
+	const ConvexVolume* vol = &m_volumes[i];
+	float bmin[3], bmax[3];
+	rcVcopy(bmin, &vol->verts[0]);
+	rcVcopy(bmax, &vol->verts[0]);
+	for (int j = 1; j < vol->nverts; ++j)
+	{
+		rcVmin(bmin, &vol->verts[j*3]);
+		rcVmax(bmax, &vol->verts[j*3]);
+	}
+	m_volumeGrid.insert(i, bmin, bmax);
+}
+
+void InputGeom::queryConvexVolumes(const float* bmin, const float* bmax,
+								   std::vector<int>& indices) const
+{
+	m_volumeGrid.query(bmin, bmax, indices);
+}
+
+void InputGeom::clearVolumesAndConnections()
+{
+	m_offMeshConVerts.clear();
+	m_offMeshConRads.clear();
+	m_offMeshConDirs.clear();
+	m_offMeshConAreas.clear();
+	m_offMeshConFlags.clear();
+	m_offMeshConId.clear();
+	m_offMeshConCount = 0;
+	m_offMeshConGrid.clear();
+	m_volumes.clear();
+	m_volumeCount = 0;
+	m_volumeGrid.clear();
 }
 
 void InputGeom::drawConvexVolumes(struct duDebugDraw* dd, bool /*hilight*/)
@@ -31,6 +31,8 @@
 #include <DebugDraw.h>
 #include "ChunkyTriMesh.h"
 #include "MeshLoaderObj.h"
+#include "SpatialGrid.h"
+#include <vector>
 
 namespace rnsup
 {
@@ -43,6 +45,22 @@ struct ConvexVolume
 	int area;
 };
 
+/// A subset of the off-mesh connections, laid out as dtNavMeshCreateParams
+/// wants them.
+struct OffMeshConnectionSet
+{
+	std::vector<int> indices;
+	std::vector<float> verts;
+	std::vector<float> rads;
+	std::vector<unsigned char> dirs;
+	std::vector<unsigned char> areas;
+	std::vector<unsigned short> flags;
+	std::vector<unsigned int> ids;
+	int count;
+
+	OffMeshConnectionSet() : count(0) {}
+};
+
 struct BuildSettings
 {
 	// Cell size in world units
@@ -91,24 +109,28 @@ class InputGeom
 	
 	/// @name Off-Mesh connections.
 	///@{
-	static const int MAX_OFFMESH_CONNECTIONS = 256;
-	float m_offMeshConVerts[MAX_OFFMESH_CONNECTIONS*3*2];
-	float m_offMeshConRads[MAX_OFFMESH_CONNECTIONS];
-	unsigned char m_offMeshConDirs[MAX_OFFMESH_CONNECTIONS];
-	unsigned char m_offMeshConAreas[MAX_OFFMESH_CONNECTIONS];
-	unsigned short m_offMeshConFlags[MAX_OFFMESH_CONNECTIONS];
-	unsigned int m_offMeshConId[MAX_OFFMESH_CONNECTIONS];
+	std::vector<float> m_offMeshConVerts;
+	std::vector<float> m_offMeshConRads;
+	std::vector<unsigned char> m_offMeshConDirs;
+	std::vector<unsigned char> m_offMeshConAreas;
+	std::vector<unsigned short> m_offMeshConFlags;
+	std::vector<unsigned int> m_offMeshConId;
 	int m_offMeshConCount;
+	/// Indexes the end points: connection i's are items 2*i and 2*i+1.
+	SpatialGrid m_offMeshConGrid;
 	///@}
 
 	/// @name Convex Volumes.
 	///@{
-	static const int MAX_VOLUMES = 256;
-	ConvexVolume m_volumes[MAX_VOLUMES];
+	std::vector<ConvexVolume> m_volumes;
 	int m_volumeCount;
+	SpatialGrid m_volumeGrid;
 	///@}
 	
 	bool loadGeomSet(class rcContext* ctx, const std::string& filepath);
+	void clearVolumesAndConnections();
+	void indexOffMeshConnection(int i);
+	void indexConvexVolume(int i);
 public:
 	InputGeom();
 	~InputGeom();
@@ -134,25 +156,33 @@ public:
 	/// @name Off-Mesh connections.
 	///@{
 	int getOffMeshConnectionCount() const { return m_offMeshConCount; }
-	const float* getOffMeshConnectionVerts() const { return m_offMeshConVerts; }
-	const float* getOffMeshConnectionRads() const { return m_offMeshConRads; }
-	const unsigned char* getOffMeshConnectionDirs() const { return m_offMeshConDirs; }
-	const unsigned char* getOffMeshConnectionAreas() const { return m_offMeshConAreas; }
-	const unsigned short* getOffMeshConnectionFlags() const { return m_offMeshConFlags; }
-	const unsigned int* getOffMeshConnectionId() const { return m_offMeshConId; }
+	const float* getOffMeshConnectionVerts() const { return m_offMeshConCount ? &m_offMeshConVerts[0] : 0; }
+	const float* getOffMeshConnectionRads() const { return m_offMeshConCount ? &m_offMeshConRads[0] : 0; }
+	const unsigned char* getOffMeshConnectionDirs() const { return m_offMeshConCount ? &m_offMeshConDirs[0] : 0; }
+	const unsigned char* getOffMeshConnectionAreas() const { return m_offMeshConCount ? &m_offMeshConAreas[0] : 0; }
+	const unsigned short* getOffMeshConnectionFlags() const { return m_offMeshConCount ? &m_offMeshConFlags[0] : 0; }
+	const unsigned int* getOffMeshConnectionId() const { return m_offMeshConCount ? &m_offMeshConId[0] : 0; }
 	void addOffMeshConnection(const float* spos, const float* epos, const float rad,
 							  unsigned char bidir, unsigned char area, unsigned short flags);
 	void deleteOffMeshConnection(int i);
+	/// Gets the off-mesh connections with an end point inside the bounds (x,z),
+	/// i.e. those a tile with these bounds could link (thread safe).
+	void getOffMeshConnections(const float* bmin, const float* bmax,
+							   OffMeshConnectionSet& set) const;
 	void drawOffMeshConnections(struct duDebugDraw* dd, bool hilight = false);
 	///@}
 
 	/// @name Box Volumes.
 	///@{
 	int getConvexVolumeCount() const { return m_volumeCount; }
-	const ConvexVolume* getConvexVolumes() const { return m_volumes; }
+	const ConvexVolume* getConvexVolumes() const { return m_volumeCount ? &m_volumes[0] : 0; }
 	void addConvexVolume(const float* verts, const int nverts,
 						 const float minh, const float maxh, unsigned char area);
 	void deleteConvexVolume(int i);
+	/// Gets the (sorted) indices of the convex volumes overlapping the bounds
+	/// (x,z) (thread safe).
+	void queryConvexVolumes(const float* bmin, const float* bmax,
+							std::vector<int>& indices) const;
 	void drawConvexVolumes(struct duDebugDraw* dd, bool hilight = false);
 	///@}
 	
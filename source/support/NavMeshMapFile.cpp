@@ -0,0 +1,265 @@
+/**
+ * \file NavMeshMapFile.cpp
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#include "NavMeshMapFile.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#endif
+
+namespace rnsup
+{
+
+static const int NAVMESHMAP_MAGIC = 'N'<<24 | 'M'<<16 | 'M'<<8 | 'F'; //'NMMF';
+static const int NAVMESHMAP_VERSION = 3;
+///Tiles' data offsets' alignment (a memory page).
+static const int NAVMESHMAP_ALIGNMENT = 4096;
+
+struct NavMeshMapHeader
+{
+	int magic;
+	int version;
+	int numTiles;
+	int alignment;
+	int tileRefSize;
+	int navMeshVersion;
+	unsigned long long settingsHash;
+	unsigned long long geometryHash;
+	dtNavMeshParams params;
+};
+
+struct NavMeshMapTileHeader
+{
+	long long dataOffset;
+	dtTileRef tileRef;
+	int dataSize;
+};
+
+NavMeshMapFile::NavMeshMapFile() :
+		m_data(0), m_size(0),
+#ifdef _WIN32
+		m_file(0), m_mapping(0)
+#else
+		m_fd(-1)
+#endif
+{
+}
+
+NavMeshMapFile::~NavMeshMapFile()
+{
+	close();
+}
+
+bool NavMeshMapFile::save(const char* path, const dtNavMesh* mesh,
+		unsigned long long settingsHash, unsigned long long geometryHash)
+{
+	if (!mesh)
+		return false;
+
+	std::vector<const dtMeshTile*> tiles;
+	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = mesh->getTile(i);
+		if (!tile || !tile->header || !tile->dataSize)
+			continue;
+		tiles.push_back(tile);
+	}
+	const int numTiles = (int) tiles.size();
+
+	// lay out the tiles' data at aligned offsets after the tiles' headers
+	NavMeshMapHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = NAVMESHMAP_MAGIC;
+	header.version = NAVMESHMAP_VERSION;
+	header.numTiles = numTiles;
+	header.alignment = NAVMESHMAP_ALIGNMENT;
+	header.tileRefSize = (int) sizeof(dtTileRef);
+	header.navMeshVersion = DT_NAVMESH_VERSION;
+	header.settingsHash = settingsHash;
+	header.geometryHash = geometryHash;
+	memcpy(&header.params, mesh->getParams(), sizeof(dtNavMeshParams));
+	std::vector<NavMeshMapTileHeader> tileHeaders(numTiles);
+	long long offset = sizeof(NavMeshMapHeader)
+			+ sizeof(NavMeshMapTileHeader) * numTiles;
+	for (int i = 0; i < numTiles; ++i)
+	{
+		offset = (offset + NAVMESHMAP_ALIGNMENT - 1)
+				& ~((long long) NAVMESHMAP_ALIGNMENT - 1);
+		memset(&tileHeaders[i], 0, sizeof(NavMeshMapTileHeader));
+		tileHeaders[i].dataOffset = offset;
+		tileHeaders[i].tileRef = mesh->getTileRef(tiles[i]);
+		tileHeaders[i].dataSize = tiles[i]->dataSize;
+		offset += tiles[i]->dataSize;
+	}
+
+	const std::string tmpPath = std::string(path) + ".tmp";
+	FILE* fp = fopen(tmpPath.c_str(), "wb");
+	if (!fp)
+		return false;
+	bool ok = (fwrite(&header, sizeof(NavMeshMapHeader), 1, fp) == 1)
+			&& ((numTiles == 0) || (fwrite(&tileHeaders[0],
+					sizeof(NavMeshMapTileHeader), numTiles, fp)
+					== (size_t) numTiles));
+	long long pos = sizeof(NavMeshMapHeader)
+			+ sizeof(NavMeshMapTileHeader) * numTiles;
+	static const unsigned char padding[NAVMESHMAP_ALIGNMENT] = { 0 };
+	for (int i = 0; ok && (i < numTiles); ++i)
+	{
+		const size_t padSize = (size_t) (tileHeaders[i].dataOffset - pos);
+		ok = ((padSize == 0) || (fwrite(padding, padSize, 1, fp) == 1))
+				&& (fwrite(tiles[i]->data, tiles[i]->dataSize, 1, fp) == 1);
+		pos = tileHeaders[i].dataOffset + tiles[i]->dataSize;
+	}
+	ok = (fclose(fp) == 0) && ok;
+
+	// processes which have mapped the old file keep it
+#ifdef _WIN32
+	if (ok)
+		remove(path);
+#endif
+	ok = ok && (rename(tmpPath.c_str(), path) == 0);
+	if (!ok)
+		remove(tmpPath.c_str());
+	return ok;
+}
+
+bool NavMeshMapFile::open(const char* path, unsigned long long settingsHash,
+		unsigned long long geometryHash)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	HANDLE mapping = NULL;
+	void* data = NULL;
+	if (GetFileSizeEx(file, &size)
+			&& (size.QuadPart >= (LONGLONG) sizeof(NavMeshMapHeader)))
+	{
+		// copy-on-write
+		mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+		if (mapping)
+			data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	}
+	if (!data)
+	{
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	m_file = file;
+	m_mapping = mapping;
+	m_size = size.QuadPart;
+#else
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	void* data = MAP_FAILED;
+	if ((fstat(fd, &st) == 0) && (st.st_size >= (off_t) sizeof(NavMeshMapHeader)))
+		// copy-on-write
+		data = mmap(0, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED)
+	{
+		::close(fd);
+		return false;
+	}
+	m_fd = fd;
+	m_size = st.st_size;
+#endif
+	m_data = (unsigned char*) data;
+
+	// validate the header (against this build, the settings and the input
+	// geometry) and the tiles' layout
+	const NavMeshMapHeader* header = (const NavMeshMapHeader*) m_data;
+	bool valid = (header->magic == NAVMESHMAP_MAGIC)
+			&& (header->version == NAVMESHMAP_VERSION)
+			&& (header->tileRefSize == (int) sizeof(dtTileRef))
+			&& (header->navMeshVersion == DT_NAVMESH_VERSION)
+			&& (header->settingsHash == settingsHash)
+			&& (header->geometryHash == geometryHash)
+			&& (header->numTiles >= 0)
+			&& ((long long) (sizeof(NavMeshMapHeader)
+					+ sizeof(NavMeshMapTileHeader) * header->numTiles) <= m_size);
+	const NavMeshMapTileHeader* tileHeaders =
+			(const NavMeshMapTileHeader*) (m_data + sizeof(NavMeshMapHeader));
+	for (int i = 0; valid && (i < header->numTiles); ++i)
+	{
+		valid = (tileHeaders[i].dataSize > 0)
+				&& (tileHeaders[i].dataOffset % 4 == 0)
+				&& (tileHeaders[i].dataOffset + tileHeaders[i].dataSize <= m_size);
+	}
+	if (!valid)
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void NavMeshMapFile::close()
+{
+	if (!m_data)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+	CloseHandle((HANDLE) m_mapping);
+	CloseHandle((HANDLE) m_file);
+	m_file = m_mapping = 0;
+#else
+	munmap(m_data, (size_t) m_size);
+	::close(m_fd);
+	m_fd = -1;
+#endif
+	m_data = 0;
+	m_size = 0;
+}
+
+const dtNavMeshParams* NavMeshMapFile::getParams() const
+{
+	if (!m_data)
+		return 0;
+	return &((const NavMeshMapHeader*) m_data)->params;
+}
+
+bool NavMeshMapFile::addTiles(dtNavMesh* mesh)
+{
+	if (!m_data || !mesh)
+		return false;
+	const NavMeshMapHeader* header = (const NavMeshMapHeader*) m_data;
+	const NavMeshMapTileHeader* tileHeaders =
+			(const NavMeshMapTileHeader*) (m_data + sizeof(NavMeshMapHeader));
+	for (int i = 0; i < header->numTiles; ++i)
+	{
+		// the mesh doesn't own the (mapped) data
+		dtStatus status = mesh->addTile(m_data + tileHeaders[i].dataOffset,
+				tileHeaders[i].dataSize, 0, tileHeaders[i].tileRef, 0);
+		if (dtStatusFailed(status))
+			return false;
+	}
+	return true;
+}
+
+} // namespace rnsup
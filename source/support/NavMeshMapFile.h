@@ -0,0 +1,73 @@
+/**
+ * \file NavMeshMapFile.h
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#ifndef NAVMESHMAPFILE_H
+#define NAVMESHMAPFILE_H
+
+#include <DetourNavMesh.h>
+
+namespace rnsup
+{
+
+/**
+ * A baked navigation mesh file which is memory mapped, so that its tiles are
+ * added to a dtNavMesh in place, without reading or copying them.
+ *
+ * Tiles' data are stored at page aligned offsets, and added without the
+ * DT_TILE_FREE_DATA flag: the mapping is owned by this object, which must
+ * outlive the navigation mesh's tiles. The file is mapped copy-on-write,
+ * because dtNavMesh::addTile() writes the tiles' polygons' links, so the
+ * pages of the other tiles' sections (vertices, detail meshes, BV trees)
+ * stay shared through the page cache among all the processes mapping the
+ * same file.
+ * The header records the hashes of the settings and of the input geometry
+ * the mesh was built with, and the size of dtTileRef and DT_NAVMESH_VERSION:
+ * open() rejects a file which doesn't match them, so the mesh is built
+ * instead.
+ * \note A mapped file shouldn't be overwritten: save() writes a temporary
+ * file and renames it.
+ */
+class NavMeshMapFile
+{
+	unsigned char* m_data;
+	long long m_size;
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping;
+#else
+	int m_fd;
+#endif
+
+public:
+	NavMeshMapFile();
+	~NavMeshMapFile();
+
+	static bool save(const char* path, const dtNavMesh* mesh,
+			unsigned long long settingsHash, unsigned long long geometryHash);
+
+	bool open(const char* path, unsigned long long settingsHash,
+			unsigned long long geometryHash);
+	///Unmaps the file: the tiles added from it must have been removed.
+	void close();
+	bool isOpen() const
+	{
+		return m_data != 0;
+	}
+
+	const dtNavMeshParams* getParams() const;
+	///Adds all the tiles to the mesh (with their original refs).
+	bool addTiles(dtNavMesh* mesh);
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	NavMeshMapFile(const NavMeshMapFile&);
+	NavMeshMapFile& operator=(const NavMeshMapFile&);
+};
+
+} // namespace rnsup
+
+#endif // NAVMESHMAPFILE_H
@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <float.h>
 #include "NavMeshTesterTool.h"
 #include "NavMeshType.h"
 #include <Recast.h>
@@ -208,6 +209,259 @@ static bool getSteerTarget(dtNavMeshQuery* navQuery, const float* startPos, cons
 	return true;
 }
 
+// Returns the total cost of a path found by the last findPath() call on
+// navQuery (read from its node pool).
+static float getPathCost(const dtNavMeshQuery* navQuery, dtPolyRef startRef, dtPolyRef endRef,
+						 const float* spos, const float* epos, const dtPolyRef* path, const int npath)
+{
+	if (startRef == endRef)
+	{
+		// start and end pos in the same poly
+		const float H_SCALE = 0.999f;
+		return dtVdist(spos, epos) * H_SCALE;
+	}
+	// reset cost to infinite
+	float totalCost = FLT_MAX;
+	// find the nodes for the last poly
+	dtPolyRef lastPoly = path[npath - 1];
+	dtNode* nodes[DT_MAX_STATES_PER_NODE];
+	int n = navQuery->getNodePool()->findNodes(lastPoly,
+			nodes, DT_MAX_STATES_PER_NODE);
+	// get the lowest total cost among the nodes
+	for (int k = 0; k < n; ++k)
+	{
+		if (nodes[k]->total < totalCost)
+		{
+			totalCost = nodes[k]->total;
+		}
+	}
+	return totalCost;
+}
+
+// Gets the midpoint of the portal between two adjacent polygons (as the
+// private dtNavMeshQuery::getEdgeMidPoint() does).
+static bool getPortalMid(const dtMeshTile* fromTile, const dtPoly* fromPoly,
+						 const dtMeshTile* toTile, const dtPoly* toPoly,
+						 dtPolyRef from, dtPolyRef to, float* mid)
+{
+	const dtLink* link = 0;
+	for (unsigned int i = fromPoly->firstLink; i != DT_NULL_LINK; i = fromTile->links[i].next)
+	{
+		if (fromTile->links[i].ref == to)
+		{
+			link = &fromTile->links[i];
+			break;
+		}
+	}
+	if (!link)
+		return false;
+	// off-mesh connections: their end point
+	if (fromPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		dtVcopy(mid, &fromTile->verts[fromPoly->verts[link->edge]*3]);
+		return true;
+	}
+	if (toPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		for (unsigned int i = toPoly->firstLink; i != DT_NULL_LINK; i = toTile->links[i].next)
+		{
+			if (toTile->links[i].ref == from)
+			{
+				dtVcopy(mid, &toTile->verts[toPoly->verts[toTile->links[i].edge]*3]);
+				return true;
+			}
+		}
+		return false;
+	}
+	const float* v0 = &fromTile->verts[fromPoly->verts[link->edge]*3];
+	const float* v1 = &fromTile->verts[fromPoly->verts[(link->edge+1) % (int)fromPoly->vertCount]*3];
+	float tmin = 0.0f, tmax = 1.0f;
+	// at tile boundary the portal is clamped to the link width
+	if (link->side != 0xff)
+	{
+		tmin = link->bmin / 255.0f;
+		tmax = link->bmax / 255.0f;
+	}
+	dtVlerp(mid, v0, v1, (tmin + tmax) * 0.5f);
+	return true;
+}
+
+// Returns the total cost of a corridor (e.g. a cached one, for which findPath()
+// didn't run), summing the filter's costs from spos, through the portals'
+// midpoints, to epos, as findPath() does.
+static float getCorridorCost(const dtNavMeshQuery* navQuery, const dtQueryFilter* filter,
+							 const float* spos, const float* epos, const dtPolyRef* path, const int npath)
+{
+	if (npath == 1)
+	{
+		// start and end pos in the same poly
+		const float H_SCALE = 0.999f;
+		return dtVdist(spos, epos) * H_SCALE;
+	}
+	const dtNavMesh* navMesh = navQuery->getAttachedNavMesh();
+	const dtMeshTile* tiles[3] = {0, 0, 0};
+	const dtPoly* polys[3] = {0, 0, 0};
+	dtPolyRef refs[3] = {0, 0, 0};
+	// (prev, cur, next) = (0, 1, 2)
+	refs[1] = path[0];
+	if (dtStatusFailed(navMesh->getTileAndPolyByRef(refs[1], &tiles[1], &polys[1])))
+		return FLT_MAX;
+	float pa[3], pb[3];
+	dtVcopy(pa, spos);
+	float totalCost = 0.0f;
+	for (int i = 1; i < npath; ++i)
+	{
+		refs[2] = path[i];
+		if (dtStatusFailed(navMesh->getTileAndPolyByRef(refs[2], &tiles[2], &polys[2])) ||
+			!getPortalMid(tiles[1], polys[1], tiles[2], polys[2], refs[1], refs[2], pb))
+			return FLT_MAX;
+		totalCost += filter->getCost(pa, pb, refs[0], tiles[0], polys[0],
+				refs[1], tiles[1], polys[1], refs[2], tiles[2], polys[2]);
+		dtVcopy(pa, pb);
+		refs[0] = refs[1]; tiles[0] = tiles[1]; polys[0] = polys[1];
+		refs[1] = refs[2]; tiles[1] = tiles[2]; polys[1] = polys[2];
+	}
+	totalCost += filter->getCost(pa, epos, refs[0], tiles[0], polys[0],
+			refs[1], tiles[1], polys[1], 0, 0, 0);
+	return totalCost;
+}
+
+static const int MAX_SMOOTH_PATH_POLYS = 256;
+
+// Iterates over the path to find smooth path on the detail mesh surface.
+// Returns the number of points stored into smoothPath.
+static int findSmoothPath(dtNavMeshQuery* navQuery, const dtQueryFilter* filter, dtPolyRef startRef,
+						  const float* spos, const float* epos, const dtPolyRef* path, const int npath,
+						  float* smoothPath, const int maxSmooth)
+{
+	if (!npath)
+		return 0;
+
+	const dtNavMesh* navMesh = navQuery->getAttachedNavMesh();
+	int nsmoothPath = 0;
+
+	// Iterate over the path to find smooth path on the detail mesh surface.
+	dtPolyRef polys[MAX_SMOOTH_PATH_POLYS];
+	int npolys = dtMin(npath, MAX_SMOOTH_PATH_POLYS);
+	memcpy(polys, path, sizeof(dtPolyRef)*npolys);
+	
+	float iterPos[3], targetPos[3];
+	navQuery->closestPointOnPoly(startRef, spos, iterPos, 0);
+	navQuery->closestPointOnPoly(polys[npolys-1], epos, targetPos, 0);
+	
+	static const float STEP_SIZE = 0.5f;
+	static const float SLOP = 0.01f;
+	
+	dtVcopy(&smoothPath[nsmoothPath*3], iterPos);
+	nsmoothPath++;
+	
+	// Move towards target a small advancement at a time until target reached or
+	// when ran out of memory to store the path.
+	while (npolys && nsmoothPath < maxSmooth)
+	{
+		// Find location to steer towards.
+		float steerPos[3];
+		unsigned char steerPosFlag;
+		dtPolyRef steerPosRef;
+		
+		if (!getSteerTarget(navQuery, iterPos, targetPos, SLOP,
+							polys, npolys, steerPos, steerPosFlag, steerPosRef))
+			break;
+		
+		bool endOfPath = (steerPosFlag & DT_STRAIGHTPATH_END) ? true : false;
+		bool offMeshConnection = (steerPosFlag & DT_STRAIGHTPATH_OFFMESH_CONNECTION) ? true : false;
+		
+		// Find movement delta.
+		float delta[3], len;
+		dtVsub(delta, steerPos, iterPos);
+		len = dtMathSqrtf(dtVdot(delta, delta));
+		// If the steer target is end of path or off-mesh link, do not move past the location.
+		if ((endOfPath || offMeshConnection) && len < STEP_SIZE)
+			len = 1;
+		else
+			len = STEP_SIZE / len;
+		float moveTgt[3];
+		dtVmad(moveTgt, iterPos, delta, len);
+		
+		// Move
+		float result[3];
+		dtPolyRef visited[16];
+		int nvisited = 0;
+		navQuery->moveAlongSurface(polys[0], iterPos, moveTgt, filter,
+								   result, visited, &nvisited, 16);
+
+		npolys = fixupCorridor(polys, npolys, MAX_SMOOTH_PATH_POLYS, visited, nvisited);
+		npolys = fixupShortcuts(polys, npolys, navQuery);
+
+		float h = 0;
+		navQuery->getPolyHeight(polys[0], result, &h);
+		result[1] = h;
+		dtVcopy(iterPos, result);
+
+		// Handle end of path and off-mesh links when close enough.
+		if (endOfPath && inRange(iterPos, steerPos, SLOP, 1.0f))
+		{
+			// Reached end of path.
+			dtVcopy(iterPos, targetPos);
+			if (nsmoothPath < maxSmooth)
+			{
+				dtVcopy(&smoothPath[nsmoothPath*3], iterPos);
+				nsmoothPath++;
+			}
+			break;
+		}
+		else if (offMeshConnection && inRange(iterPos, steerPos, SLOP, 1.0f))
+		{
+			// Reached off-mesh connection.
+			float startPos[3], endPos[3];
+			
+			// Advance the path up to and over the off-mesh connection.
+			dtPolyRef prevRef = 0, polyRef = polys[0];
+			int npos = 0;
+			while (npos < npolys && polyRef != steerPosRef)
+			{
+				prevRef = polyRef;
+				polyRef = polys[npos];
+				npos++;
+			}
+			for (int i = npos; i < npolys; ++i)
+				polys[i-npos] = polys[i];
+			npolys -= npos;
+			
+			// Handle the connection.
+			dtStatus status = navMesh->getOffMeshConnectionPolyEndPoints(prevRef, polyRef, startPos, endPos);
+			if (dtStatusSucceed(status))
+			{
+				if (nsmoothPath < maxSmooth)
+				{
+					dtVcopy(&smoothPath[nsmoothPath*3], startPos);
+					nsmoothPath++;
+					// Hack to make the dotted path not visible during off-mesh connection.
+					if ((nsmoothPath & 1) && nsmoothPath < maxSmooth)
+					{
+						dtVcopy(&smoothPath[nsmoothPath*3], startPos);
+						nsmoothPath++;
+					}
+				}
+				// Move position at the other side of the off-mesh link.
+				dtVcopy(iterPos, endPos);
+				float eh = 0.0f;
+				navQuery->getPolyHeight(polys[0], iterPos, &eh);
+				iterPos[1] = eh;
+			}
+		}
+		
+		// Store results.
+		if (nsmoothPath < maxSmooth)
+		{
+			dtVcopy(&smoothPath[nsmoothPath*3], iterPos);
+			nsmoothPath++;
+		}
+	}
+
+	return nsmoothPath;
+}
+
 namespace rnsup
 {
 
@@ -217,6 +471,7 @@ NavMeshTesterTool::NavMeshTesterTool() :
 	m_navQuery(0),
 	m_filter(0),
 	m_pathFindStatus(DT_FAILURE),
+	m_pathCache(0),
 	m_toolMode(TOOLMODE_PATHFIND_FOLLOW),
 	m_straightPathOptions(0),
 	m_startRef(0),
@@ -727,166 +982,24 @@ void NavMeshTesterTool::recalc()
 				   m_filter->getIncludeFlags(), m_filter->getExcludeFlags());
 #endif
 
-			dtStatus status =
-					m_navQuery->findPath(m_startRef, m_endRef, m_spos, m_epos, m_filter, m_polys, &m_npolys, MAX_POLYS);
+			bool cached = false;
+			dtStatus status = findPathCached(m_pathCache, m_navQuery,
+					m_startRef, m_endRef, m_spos, m_epos, m_filter, m_polys, &m_npolys, MAX_POLYS,
+					&cached);
 			if (status & DT_SUCCESS)
 			{
-				// get total cost
-				if (m_startRef == m_endRef)
-				{
-					// start and end pos in the same poly
-					const float H_SCALE = 0.999f;
-					m_totalCost = dtVdist(m_spos, m_epos) * H_SCALE;
-				}
-				else
-				{
-					// reset m_totalCost to infinite
-					m_totalCost = FLT_MAX;
-					// find the nodes for the last poly
-					dtPolyRef lastPoly = m_polys[m_npolys - 1];
-					dtNode* nodes[DT_MAX_STATES_PER_NODE];
-					int n = m_navQuery->getNodePool()->findNodes(lastPoly,
-							nodes, DT_MAX_STATES_PER_NODE);
-					// get the lowest total cost among the nodes
-					for (int k = 0; k < n; ++k)
-					{
-						if (nodes[k]->total < m_totalCost)
-						{
-							m_totalCost = nodes[k]->total;
-						}
-					}
-				}
+				// get total cost: the node pool holds it only if findPath() ran
+				m_totalCost = cached ?
+						getCorridorCost(m_navQuery, m_filter, m_spos, m_epos, m_polys, m_npolys) :
+						getPathCost(m_navQuery, m_startRef, m_endRef, m_spos, m_epos, m_polys, m_npolys);
 			}
 			else
 			{
 				m_totalCost = -1.0;
 			}
 
-			m_nsmoothPath = 0;
-
-			if (m_npolys)
-			{
-				// Iterate over the path to find smooth path on the detail mesh surface.
-				dtPolyRef polys[MAX_POLYS];
-				memcpy(polys, m_polys, sizeof(dtPolyRef)*m_npolys); 
-				int npolys = m_npolys;
-				
-				float iterPos[3], targetPos[3];
-				m_navQuery->closestPointOnPoly(m_startRef, m_spos, iterPos, 0);
-				m_navQuery->closestPointOnPoly(polys[npolys-1], m_epos, targetPos, 0);
-				
-				static const float STEP_SIZE = 0.5f;
-				static const float SLOP = 0.01f;
-				
-				m_nsmoothPath = 0;
-				
-				dtVcopy(&m_smoothPath[m_nsmoothPath*3], iterPos);
-				m_nsmoothPath++;
-				
-				// Move towards target a small advancement at a time until target reached or
-				// when ran out of memory to store the path.
-				while (npolys && m_nsmoothPath < MAX_SMOOTH)
-				{
-					// Find location to steer towards.
-					float steerPos[3];
-					unsigned char steerPosFlag;
-					dtPolyRef steerPosRef;
-					
-					if (!getSteerTarget(m_navQuery, iterPos, targetPos, SLOP,
-										polys, npolys, steerPos, steerPosFlag, steerPosRef))
-						break;
-					
-					bool endOfPath = (steerPosFlag & DT_STRAIGHTPATH_END) ? true : false;
-					bool offMeshConnection = (steerPosFlag & DT_STRAIGHTPATH_OFFMESH_CONNECTION) ? true : false;
-					
-					// Find movement delta.
-					float delta[3], len;
-					dtVsub(delta, steerPos, iterPos);
-					len = dtMathSqrtf(dtVdot(delta, delta));
-					// If the steer target is end of path or off-mesh link, do not move past the location.
-					if ((endOfPath || offMeshConnection) && len < STEP_SIZE)
-						len = 1;
-					else
-						len = STEP_SIZE / len;
-					float moveTgt[3];
-					dtVmad(moveTgt, iterPos, delta, len);
-					
-					// Move
-					float result[3];
-					dtPolyRef visited[16];
-					int nvisited = 0;
-					m_navQuery->moveAlongSurface(polys[0], iterPos, moveTgt, m_filter,
-												 result, visited, &nvisited, 16);
-
-					npolys = fixupCorridor(polys, npolys, MAX_POLYS, visited, nvisited);
-					npolys = fixupShortcuts(polys, npolys, m_navQuery);
-
-					float h = 0;
-					m_navQuery->getPolyHeight(polys[0], result, &h);
-					result[1] = h;
-					dtVcopy(iterPos, result);
-
-					// Handle end of path and off-mesh links when close enough.
-					if (endOfPath && inRange(iterPos, steerPos, SLOP, 1.0f))
-					{
-						// Reached end of path.
-						dtVcopy(iterPos, targetPos);
-						if (m_nsmoothPath < MAX_SMOOTH)
-						{
-							dtVcopy(&m_smoothPath[m_nsmoothPath*3], iterPos);
-							m_nsmoothPath++;
-						}
-						break;
-					}
-					else if (offMeshConnection && inRange(iterPos, steerPos, SLOP, 1.0f))
-					{
-						// Reached off-mesh connection.
-						float startPos[3], endPos[3];
-						
-						// Advance the path up to and over the off-mesh connection.
-						dtPolyRef prevRef = 0, polyRef = polys[0];
-						int npos = 0;
-						while (npos < npolys && polyRef != steerPosRef)
-						{
-							prevRef = polyRef;
-							polyRef = polys[npos];
-							npos++;
-						}
-						for (int i = npos; i < npolys; ++i)
-							polys[i-npos] = polys[i];
-						npolys -= npos;
-						
-						// Handle the connection.
-						dtStatus status = m_navMesh->getOffMeshConnectionPolyEndPoints(prevRef, polyRef, startPos, endPos);
-						if (dtStatusSucceed(status))
-						{
-							if (m_nsmoothPath < MAX_SMOOTH)
-							{
-								dtVcopy(&m_smoothPath[m_nsmoothPath*3], startPos);
-								m_nsmoothPath++;
-								// Hack to make the dotted path not visible during off-mesh connection.
-								if (m_nsmoothPath & 1)
-								{
-									dtVcopy(&m_smoothPath[m_nsmoothPath*3], startPos);
-									m_nsmoothPath++;
-								}
-							}
-							// Move position at the other side of the off-mesh link.
-							dtVcopy(iterPos, endPos);
-							float eh = 0.0f;
-							m_navQuery->getPolyHeight(polys[0], iterPos, &eh);
-							iterPos[1] = eh;
-						}
-					}
-					
-					// Store results.
-					if (m_nsmoothPath < MAX_SMOOTH)
-					{
-						dtVcopy(&m_smoothPath[m_nsmoothPath*3], iterPos);
-						m_nsmoothPath++;
-					}
-				}
-			}
+			m_nsmoothPath = findSmoothPath(m_navQuery, m_filter, m_startRef,
+					m_spos, m_epos, m_polys, m_npolys, m_smoothPath, MAX_SMOOTH);
 
 		}
 		else
@@ -904,7 +1017,8 @@ void NavMeshTesterTool::recalc()
 				   m_spos[0],m_spos[1],m_spos[2], m_epos[0],m_epos[1],m_epos[2],
 				   m_filter->getIncludeFlags(), m_filter->getExcludeFlags());
 #endif
-			m_navQuery->findPath(m_startRef, m_endRef, m_spos, m_epos, m_filter, m_polys, &m_npolys, MAX_POLYS);
+			findPathCached(m_pathCache, m_navQuery, m_startRef, m_endRef,
+					m_spos, m_epos, m_filter, m_polys, &m_npolys, MAX_POLYS);
 			m_nstraightPath = 0;
 			if (m_npolys)
 			{
@@ -1483,4 +1597,146 @@ void NavMeshTesterTool::drawAgent(const float* pos, float r, float h, float c, c
 	dd.depthMask(true);
 }
 
+///NavMeshTesterQuery
+NavMeshTesterQuery::NavMeshTesterQuery() :
+	m_navMesh(0),
+	m_navQuery(0),
+	m_npolys(0),
+	m_nsmoothPath(0),
+	m_nstraightPath(0)
+{
+	m_filter.setIncludeFlags(NAVMESH_POLYFLAGS_ALL ^ NAVMESH_POLYFLAGS_DISABLED);
+	m_filter.setExcludeFlags(0);
+
+	m_polyPickExt[0] = 2;
+	m_polyPickExt[1] = 4;
+	m_polyPickExt[2] = 2;
+}
+
+NavMeshTesterQuery::~NavMeshTesterQuery()
+{
+	dtFreeNavMeshQuery(m_navQuery);
+}
+
+bool NavMeshTesterQuery::init(const dtNavMesh* navMesh, const dtQueryFilter* filter, const int maxNodes)
+{
+	m_navMesh = 0;
+	if (!navMesh)
+		return false;
+
+	if (!m_navQuery)
+	{
+		m_navQuery = dtAllocNavMeshQuery();
+		if (!m_navQuery)
+			return false;
+	}
+	if (dtStatusFailed(m_navQuery->init(navMesh, maxNodes)))
+		return false;
+
+	if (filter)
+		m_filter = *filter;
+	m_navMesh = navMesh;
+	return true;
+}
+
+int NavMeshTesterQuery::findPathFollow(const float* spos, const float* epos, float* totalCost)
+{
+	m_npolys = 0;
+	m_nsmoothPath = 0;
+	if (totalCost)
+		*totalCost = -1.0f;
+	if (!m_navMesh)
+		return 0;
+
+	dtPolyRef startRef = 0, endRef = 0;
+	m_navQuery->findNearestPoly(spos, m_polyPickExt, &m_filter, &startRef, 0);
+	m_navQuery->findNearestPoly(epos, m_polyPickExt, &m_filter, &endRef, 0);
+	if (!startRef || !endRef)
+		return 0;
+
+	dtStatus status = m_navQuery->findPath(startRef, endRef, spos, epos, &m_filter,
+			m_polys, &m_npolys, MAX_POLYS);
+	if ((status & DT_SUCCESS) && totalCost)
+		*totalCost = getPathCost(m_navQuery, startRef, endRef, spos, epos, m_polys, m_npolys);
+
+	m_nsmoothPath = findSmoothPath(m_navQuery, &m_filter, startRef, spos, epos,
+			m_polys, m_npolys, m_smoothPath, MAX_SMOOTH);
+	return m_nsmoothPath;
+}
+
+int NavMeshTesterQuery::findPathStraight(const float* spos, const float* epos, const int options)
+{
+	m_npolys = 0;
+	m_nstraightPath = 0;
+	if (!m_navMesh)
+		return 0;
+
+	dtPolyRef startRef = 0, endRef = 0;
+	m_navQuery->findNearestPoly(spos, m_polyPickExt, &m_filter, &startRef, 0);
+	m_navQuery->findNearestPoly(epos, m_polyPickExt, &m_filter, &endRef, 0);
+	if (!startRef || !endRef)
+		return 0;
+
+	m_navQuery->findPath(startRef, endRef, spos, epos, &m_filter, m_polys, &m_npolys, MAX_POLYS);
+	if (m_npolys)
+	{
+		// In case of partial path, make sure the end point is clamped to the last polygon.
+		float clampedEpos[3];
+		dtVcopy(clampedEpos, epos);
+		if (m_polys[m_npolys-1] != endRef)
+			m_navQuery->closestPointOnPoly(m_polys[m_npolys-1], epos, clampedEpos, 0);
+
+		m_navQuery->findStraightPath(spos, clampedEpos, m_polys, m_npolys,
+									 m_straightPath, m_straightPathFlags,
+									 m_straightPathPolys, &m_nstraightPath, MAX_POLYS, options);
+	}
+	return m_nstraightPath;
+}
+
+bool NavMeshTesterQuery::raycast(const float* spos, const float* epos, float* hitPos)
+{
+	dtVcopy(hitPos, epos);
+	if (!m_navMesh)
+		return false;
+
+	dtPolyRef startRef = 0;
+	m_navQuery->findNearestPoly(spos, m_polyPickExt, &m_filter, &startRef, 0);
+	if (!startRef)
+		return false;
+
+	float t = 0, hitNormal[3];
+	m_npolys = 0;
+	m_navQuery->raycast(startRef, spos, epos, &m_filter, &t, hitNormal, m_polys, &m_npolys, MAX_POLYS);
+	bool hitResult = false;
+	if (t <= 1)
+	{
+		// Hit
+		dtVlerp(hitPos, spos, epos, t);
+		hitResult = true;
+	}
+	// Adjust height.
+	if (m_npolys > 0)
+	{
+		float h = 0;
+		m_navQuery->getPolyHeight(m_polys[m_npolys-1], hitPos, &h);
+		hitPos[1] = h;
+	}
+	return hitResult;
+}
+
+float NavMeshTesterQuery::findDistanceToWall(const float* pos, const float maxRadius)
+{
+	if (!m_navMesh)
+		return 0.0f;
+
+	dtPolyRef startRef = 0;
+	m_navQuery->findNearestPoly(pos, m_polyPickExt, &m_filter, &startRef, 0);
+	if (!startRef)
+		return 0.0f;
+
+	float distanceToWall = 0.0f, hitPos[3], hitNormal[3];
+	m_navQuery->findDistanceToWall(startRef, pos, maxRadius, &m_filter, &distanceToWall, hitPos, hitNormal);
+	return distanceToWall;
+}
+
 } // rnsup
@@ -27,6 +27,7 @@
 #define NAVMESHTESTERTOOL_H
 
 #include "NavMeshType.h"
+#include "PathCache.h"
 #include <DetourNavMesh.h>
 #include <DetourNavMeshQuery.h>
 
@@ -45,6 +46,8 @@ class NavMeshTesterTool : public NavMeshTypeTool
 
 	dtStatus m_pathFindStatus;
 
+	PathCache* m_pathCache;
+
 public:
 	enum ToolMode
 	{
@@ -131,6 +134,11 @@ public:
 		m_toolMode = mode;
 	}
 	void setStartEndPos(const float* s, const float* e);
+	//path finding through a (optional) PathCache
+	void setPathCache(PathCache* pathCache)
+	{
+		m_pathCache = pathCache;
+	}
 
 	//TOOLMODE_PATHFIND_FOLLOW
 	float *getSmoothPath()
@@ -178,6 +186,77 @@ public:
 	}
 };
 
+/// Re-entrant counterpart of the NavMeshTesterTool's queries.
+/// Each instance owns its dtNavMeshQuery (and so its node pool), its query
+/// filter and its result buffers: different instances can be used at the
+/// same time (e.g. from different threads) on a dtNavMesh that is not being
+/// modified.
+class NavMeshTesterQuery
+{
+public:
+	static const int MAX_POLYS = 256;
+	static const int MAX_SMOOTH = 2048;
+
+private:
+	const dtNavMesh* m_navMesh;
+	dtNavMeshQuery* m_navQuery;
+	dtQueryFilter m_filter;
+
+	float m_polyPickExt[3];
+	dtPolyRef m_polys[MAX_POLYS];
+	int m_npolys;
+	float m_smoothPath[MAX_SMOOTH*3];
+	int m_nsmoothPath;
+	float m_straightPath[MAX_POLYS*3];
+	unsigned char m_straightPathFlags[MAX_POLYS];
+	dtPolyRef m_straightPathPolys[MAX_POLYS];
+	int m_nstraightPath;
+
+public:
+	NavMeshTesterQuery();
+	~NavMeshTesterQuery();
+
+	bool init(const dtNavMesh* navMesh, const dtQueryFilter* filter, const int maxNodes = 2048);
+	const dtNavMesh* getNavMesh() const
+	{
+		return m_navMesh;
+	}
+	dtNavMeshQuery* getNavMeshQuery()
+	{
+		return m_navQuery;
+	}
+	dtQueryFilter& getFilter()
+	{
+		return m_filter;
+	}
+
+	//TOOLMODE_PATHFIND_FOLLOW: returns the number of smooth path points.
+	int findPathFollow(const float* spos, const float* epos, float* totalCost = 0);
+	const float* getSmoothPath() const
+	{
+		return m_smoothPath;
+	}
+	//TOOLMODE_PATHFIND_STRAIGHT: returns the number of straight path points.
+	int findPathStraight(const float* spos, const float* epos, const int options = 0);
+	const float* getStraightPath() const
+	{
+		return m_straightPath;
+	}
+	const unsigned char* getStraightPathFlags() const
+	{
+		return m_straightPathFlags;
+	}
+	//TOOLMODE_RAYCAST: returns true on hit.
+	bool raycast(const float* spos, const float* epos, float* hitPos);
+	//TOOLMODE_DISTANCE_TO_WALL
+	float findDistanceToWall(const float* pos, const float maxRadius = 100.0f);
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	NavMeshTesterQuery(const NavMeshTesterQuery&);
+	NavMeshTesterQuery& operator=(const NavMeshTesterQuery&);
+};
+
 } // namespace rnsup
 
 #endif // NAVMESHTESTERTOOL_H
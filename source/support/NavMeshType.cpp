@@ -25,7 +25,10 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include "NavMeshType.h"
+#include "NavMeshMapFile.h"
+#include "TileBuildCache.h"
 #include "InputGeom.h"
 #include <DetourDebugDraw.h>
 #include <RecastDebugDraw.h>
@@ -68,7 +71,11 @@ NavMeshType::NavMeshType() :
 	m_filterLedgeSpans(true),
 	m_filterWalkableLowHeightSpans(true),
 	m_tool(0),
-	m_ctx(0)
+	m_ctx(0),
+	m_workerPool(0),
+	m_buildCache(0),
+	m_mapFile(0),
+	m_tilesDebugDraw(0)
 {
 	resetNavMeshSettings();
 	m_navQuery = dtAllocNavMeshQuery();
@@ -82,6 +89,8 @@ NavMeshType::~NavMeshType()
 {
 	dtFreeNavMeshQuery(m_navQuery);
 	dtFreeNavMesh(m_navMesh);
+	// after the tiles it mapped
+	delete m_mapFile;
 	dtFreeCrowd(m_crowd);
 	delete m_tool;
 	for (int i = 0; i < MAX_TOOLS; i++)
@@ -127,6 +136,22 @@ void NavMeshType::handleRender(duDebugDraw& m_dd)
 	duDebugDrawBoxWire(&m_dd, bmin[0],bmin[1],bmin[2], bmax[0],bmax[1],bmax[2], duRGBA(255,255,255,128), 1.0f);
 }
 
+void NavMeshType::drawNavMesh(duDebugDraw& dd)
+{
+	if (!m_navMesh || !m_navQuery)
+		return;
+	
+	if (m_tilesDebugDraw)
+	{
+		// Only the changed tiles are redrawn, the closed list over them.
+		m_tilesDebugDraw->draw(*m_navMesh, m_navMeshDrawFlags & ~DU_DRAWNAVMESH_CLOSEDLIST);
+		if (m_navMeshDrawFlags & DU_DRAWNAVMESH_CLOSEDLIST)
+			duDebugDrawNavMeshClosedList(&dd, *m_navMesh, *m_navQuery);
+	}
+	else
+		duDebugDrawNavMeshWithClosedList(&dd, *m_navMesh, *m_navQuery, m_navMeshDrawFlags);
+}
+
 //void NavMeshType::handleRenderOverlay(double* /*proj*/, double* /*model*/, int* /*view*/)
 //{
 //}
@@ -283,6 +308,121 @@ void NavMeshType::handleUpdate(const float dt)
 	updateToolStates(dt);
 }
 
+static const int NAVMESHDATA_MAGIC = 'N'<<24 | 'M'<<16 | 'B'<<8 | 'D'; //'NMBD';
+static const int NAVMESHDATA_VERSION = 1;
+
+void NavMeshType::writeBuiltData(Datagram& dg) const
+{
+	if (!m_navMesh) return;
+
+	dg.add_int32(NAVMESHDATA_MAGIC);
+	dg.add_int32(NAVMESHDATA_VERSION);
+	writeNavMeshParams(dg, *m_navMesh->getParams());
+	writeNavMeshTiles(dg, m_navMesh);
+}
+
+bool NavMeshType::handleBuildFromData(DatagramIterator& scan)
+{
+	if (scan.get_remaining_size() < 8)
+		return false;
+	if (scan.get_int32() != NAVMESHDATA_MAGIC)
+		return false;
+	if (scan.get_int32() != NAVMESHDATA_VERSION)
+		return false;
+
+	dtNavMeshParams params;
+	readNavMeshParams(scan, params);
+
+	dtFreeNavMesh(m_navMesh);
+
+	m_navMesh = dtAllocNavMesh();
+	if (!m_navMesh)
+	{
+		CTXLOG(m_ctx, RC_LOG_ERROR, "buildFromData: Could not allocate navmesh.");
+		return false;
+	}
+
+	dtStatus status = m_navMesh->init(&params);
+	if (dtStatusFailed(status))
+	{
+		CTXLOG(m_ctx, RC_LOG_ERROR, "buildFromData: Could not init navmesh.");
+		return false;
+	}
+
+	if (!readNavMeshTiles(scan, m_navMesh))
+	{
+		CTXLOG(m_ctx, RC_LOG_ERROR, "buildFromData: Could not read navmesh tiles.");
+		return false;
+	}
+
+	status = m_navQuery->init(m_navMesh, 2048);
+	if (dtStatusFailed(status))
+	{
+		CTXLOG(m_ctx, RC_LOG_ERROR, "buildFromData: Could not init Detour navmesh query");
+		return false;
+	}
+
+	if (m_tool)
+		m_tool->init(this);
+	initToolStates(this);
+
+	return true;
+}
+
+bool NavMeshType::saveMapFile(const char* path) const
+{
+	return NavMeshMapFile::save(path, m_navMesh, getSettingsHash(),
+			getGeometryHash());
+}
+
+bool NavMeshType::handleBuildFromMapFile(const char* path)
+{
+	dtFreeNavMesh(m_navMesh);
+	m_navMesh = 0;
+	delete m_mapFile;
+
+	m_mapFile = new NavMeshMapFile;
+	if (!m_mapFile->open(path, getSettingsHash(), getGeometryHash()))
+	{
+		CTXLOG1(m_ctx, RC_LOG_ERROR,
+				"buildFromMapFile: Could not map '%s' (or it was baked with other settings or geometry).",
+				path);
+		return false;
+	}
+
+	m_navMesh = dtAllocNavMesh();
+	if (!m_navMesh)
+	{
+		CTXLOG(m_ctx, RC_LOG_ERROR, "buildFromMapFile: Could not allocate navmesh.");
+		return false;
+	}
+
+	dtStatus status = m_navMesh->init(m_mapFile->getParams());
+	if (dtStatusFailed(status))
+	{
+		CTXLOG(m_ctx, RC_LOG_ERROR, "buildFromMapFile: Could not init navmesh.");
+		return false;
+	}
+
+	if (!m_mapFile->addTiles(m_navMesh))
+	{
+		CTXLOG(m_ctx, RC_LOG_ERROR, "buildFromMapFile: Could not add navmesh tiles.");
+		return false;
+	}
+
+	status = m_navQuery->init(m_navMesh, 2048);
+	if (dtStatusFailed(status))
+	{
+		CTXLOG(m_ctx, RC_LOG_ERROR, "buildFromMapFile: Could not init Detour navmesh query");
+		return false;
+	}
+
+	if (m_tool)
+		m_tool->init(this);
+	initToolStates(this);
+
+	return true;
+}
 
 void NavMeshType::updateToolStates(const float dt)
 {
@@ -366,6 +506,34 @@ NavMeshSettings NavMeshType::getNavMeshSettings()
 	return settings;
 } 
 
+unsigned long long NavMeshType::getSettingsHash() const
+{
+	TileInputHash hash;
+	hash.add(m_cellSize);
+	hash.add(m_cellHeight);
+	hash.add(m_agentHeight);
+	hash.add(m_agentRadius);
+	hash.add(m_agentMaxClimb);
+	hash.add(m_agentMaxSlope);
+	hash.add(m_regionMinSize);
+	hash.add(m_regionMergeSize);
+	hash.add(m_edgeMaxLen);
+	hash.add(m_edgeMaxError);
+	hash.add(m_vertsPerPoly);
+	hash.add(m_detailSampleDist);
+	hash.add(m_detailSampleMaxError);
+	hash.add(m_partitionType);
+	return hash.getValue();
+}
+
+unsigned long long NavMeshType::getGeometryHash() const
+{
+	TileInputHash hash;
+	if (m_geom && m_geom->getMesh())
+		hash.addAllGeometry(m_geom);
+	return hash.getValue();
+}
+
 const float* NavMeshType::getBoundsMin()
 {
 	if (!m_geom) return 0;
@@ -378,4 +546,76 @@ const float* NavMeshType::getBoundsMax()
 	return m_geom->getMeshBoundsMax();
 }
 
+void writeNavMeshParams(Datagram& dg, const dtNavMeshParams& params)
+{
+	for (int i = 0; i < 3; ++i)
+		dg.add_stdfloat(params.orig[i]);
+	dg.add_stdfloat(params.tileWidth);
+	dg.add_stdfloat(params.tileHeight);
+	dg.add_int32(params.maxTiles);
+	dg.add_int32(params.maxPolys);
+}
+
+void readNavMeshParams(DatagramIterator& scan, dtNavMeshParams& params)
+{
+	memset(&params, 0, sizeof(params));
+	for (int i = 0; i < 3; ++i)
+		params.orig[i] = scan.get_stdfloat();
+	params.tileWidth = scan.get_stdfloat();
+	params.tileHeight = scan.get_stdfloat();
+	params.maxTiles = scan.get_int32();
+	params.maxPolys = scan.get_int32();
+}
+
+void writeNavMeshTiles(Datagram& dg, const dtNavMesh* mesh)
+{
+	int numTiles = 0;
+	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = mesh->getTile(i);
+		if (!tile || !tile->header || !tile->dataSize) continue;
+		numTiles++;
+	}
+	dg.add_int32(numTiles);
+
+	// Tile data is stored as is: it is only meant to be read back on
+	// platforms with the same endianness.
+	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = mesh->getTile(i);
+		if (!tile || !tile->header || !tile->dataSize) continue;
+
+		dg.add_uint64((uint64_t)mesh->getTileRef(tile));
+		dg.add_int32(tile->dataSize);
+		dg.append_data(tile->data, tile->dataSize);
+	}
+}
+
+bool readNavMeshTiles(DatagramIterator& scan, dtNavMesh* mesh)
+{
+	const int numTiles = scan.get_int32();
+	for (int i = 0; i < numTiles; ++i)
+	{
+		dtTileRef tileRef = (dtTileRef)scan.get_uint64();
+		int dataSize = scan.get_int32();
+		if (!tileRef || dataSize <= 0 ||
+				scan.get_remaining_size() < (size_t)dataSize)
+			return false;
+
+		unsigned char* data = (unsigned char*)dtAlloc(dataSize, DT_ALLOC_PERM);
+		if (!data)
+			return false;
+		scan.extract_bytes(data, dataSize);
+
+		// The nav mesh owns the data from now on.
+		dtStatus status = mesh->addTile(data, dataSize, DT_TILE_FREE_DATA, tileRef, 0);
+		if (dtStatusFailed(status))
+		{
+			dtFree(data);
+			return false;
+		}
+	}
+	return true;
+}
+
 } // namespace rnsup
@@ -30,6 +30,8 @@
 #include "DebugInterfaces.h"
 #include <DetourNavMeshQuery.h>
 #include <DetourCrowd.h>
+#include <datagram.h>
+#include <datagramIterator.h>
 
 namespace rnsup
 {
@@ -88,6 +90,12 @@ enum NavMeshPartitionType
 	NAVMESH_PARTITION_MONOTONE,
 	NAVMESH_PARTITION_LAYERS,
 };
+///Tile cache's layers compression (see TileCacheCompressor).
+enum NavMeshTileCompressorType
+{
+	NAVMESH_TILE_COMPRESSOR_FAST,
+	NAVMESH_TILE_COMPRESSOR_DENSE,
+};
 ///Table giving for each area the corresponding (or'ed) flags.
 typedef std::map<int,int> NavMeshPolyAreaFlags;
 ///Table giving for each area the corresponding cost (for dtCrowd).
@@ -143,6 +151,7 @@ struct NavMeshTileSettings
 	int m_maxTiles;
 	int m_maxPolysPerTile;
 	float m_tileSize;
+	int m_compressorType;
 };
 
 class NavMeshType
@@ -179,6 +188,13 @@ protected:
 	NavMeshPolyAreaFlags m_flagsAreaTable;
 	
 	BuildContext* m_ctx;
+	class WorkerPool* m_workerPool;
+	/// The built tiles' data cached on disk (if any).
+	class TileBuildCache* m_buildCache;
+	/// The baked file the navigation mesh's tiles are mapped from (if any).
+	class NavMeshMapFile* m_mapFile;
+	/// The tiles' debug drawing cache (if any).
+	class DebugDrawNavMeshTiles* m_tilesDebugDraw;
 
 //	SampleDebugDraw m_dd;
 	
@@ -187,6 +203,14 @@ public:
 	virtual ~NavMeshType();
 	
 	void setContext(BuildContext* ctx) { m_ctx = ctx; }
+	/// Sets the threads used to build tiles (NULL builds them on the calling
+	/// thread only).
+	void setWorkerPool(class WorkerPool* pool) { m_workerPool = pool; }
+	/// Sets the cache of the built tiles' data (NULL always builds them).
+	void setBuildCache(class TileBuildCache* cache) { m_buildCache = cache; }
+	/// Sets the cache of the tiles' debug drawing (NULL draws all the tiles
+	/// through the handleRender()'s duDebugDraw).
+	void setTilesDebugDraw(class DebugDrawNavMeshTiles* tilesDebugDraw) { m_tilesDebugDraw = tilesDebugDraw; }
 	
 	NavMeshTypeTool* getTool();
 	void setTool(NavMeshTypeTool* tool);
@@ -206,7 +230,26 @@ public:
 	virtual void handleMeshChanged(class InputGeom* geom);
 	virtual bool handleBuild();
 	virtual void handleUpdate(const float dt);
+	virtual void writeBuiltData(Datagram& dg) const;
+	virtual bool handleBuildFromData(DatagramIterator& scan);
+	/// Saves the navigation mesh as a baked file to be mapped by
+	/// handleBuildFromMapFile() (see NavMeshMapFile), which rejects the file
+	/// if it was baked with other settings or input geometry (see
+	/// getSettingsHash() and getGeometryHash()).
+	bool saveMapFile(const char* path) const;
+	virtual bool handleBuildFromMapFile(const char* path);
+	/// Hash of the settings the navigation mesh is built with.
+	virtual unsigned long long getSettingsHash() const;
+	/// Hash of the input geometry the navigation mesh is built from: the
+	/// mesh, convex volumes and off-mesh connections.
+	unsigned long long getGeometryHash() const;
 	virtual void collectSettings(struct BuildSettings& settings);
+	/// Rebuilds the existing tiles affected by input geometry changes (convex
+	/// volumes, off-mesh connections) inside the bounds, returning their count
+	/// and their (tx,ty) coordinates. [(tx,ty) * maxTiles]
+	/// Not tiled navigation meshes can't be rebuilt partially: 0 is returned.
+	virtual int rebuildTiles(const float* /*bmin*/, const float* /*bmax*/,
+			int* /*tiles*/, const int /*maxTiles*/) { return 0; }
 
 	virtual class InputGeom* getInputGeom() { return m_geom; }
 	virtual class dtNavMesh* getNavMesh() { return m_navMesh; }
@@ -224,6 +267,9 @@ public:
 	
 	unsigned char getNavMeshDrawFlags() const { return m_navMeshDrawFlags; }
 	void setNavMeshDrawFlags(unsigned char flags) { m_navMeshDrawFlags = flags; }
+	/// Draws the navigation mesh (by handleRender()): the tiles through their
+	/// debug drawing cache, if set, and the rest through dd.
+	void drawNavMesh(duDebugDraw& dd);
 
 	void updateToolStates(const float dt);
 	void initToolStates(NavMeshType* sample);
@@ -241,6 +287,12 @@ private:
 	NavMeshType& operator=(const NavMeshType&);
 };
 
+///Built data serialization helpers.
+void writeNavMeshParams(Datagram& dg, const dtNavMeshParams& params);
+void readNavMeshParams(DatagramIterator& scan, dtNavMeshParams& params);
+void writeNavMeshTiles(Datagram& dg, const dtNavMesh* mesh);
+bool readNavMeshTiles(DatagramIterator& scan, dtNavMesh* mesh);
+
 } // namespace rnsup
 
 #endif // RECASTSAMPLE_H
@@ -29,11 +29,14 @@
 #include <float.h>
 #include <new>
 #include "NavMeshType_Obstacle.h"
+#include "WorkerPool.h"
+#include "TileBuildCache.h"
+#include "BuildArena.h"
+#include "TileCacheCompressor.h"
 #include "DebugInterfaces.h"
 #include "InputGeom.h"
 #include "ChunkyTriMesh.h"
 #include "ConvexVolumeTool.h"
-#include "fastlz.h"
 #include <Recast.h>
 #include <DetourNavMeshBuilder.h>
 #include <DetourDebugDraw.h>
@@ -100,66 +103,78 @@ namespace rnsup
 
 
 
-struct FastLZCompressor : public dtTileCacheCompressor
-{
-	virtual int maxCompressedSize(const int bufferSize)
-	{
-		return (int)(bufferSize* 1.05f);
-	}
-	
-	virtual dtStatus compress(const unsigned char* buffer, const int bufferSize,
-							  unsigned char* compressed, const int /*maxCompressedSize*/, int* compressedSize)
-	{
-		*compressedSize = fastlz_compress((const void *const)buffer, bufferSize, compressed);
-		return DT_SUCCESS;
-	}
-	
-	virtual dtStatus decompress(const unsigned char* compressed, const int compressedSize,
-								unsigned char* buffer, const int maxBufferSize, int* bufferSize)
-	{
-		*bufferSize = fastlz_decompress(compressed, compressedSize, buffer, maxBufferSize);
-		return *bufferSize < 0 ? DT_FAILURE : DT_SUCCESS;
-	}
-};
-
+// Grows on demand by chunks, so live allocations are never moved, and merges
+// them into a single buffer on reset(): a tile which doesn't fit only costs a
+// new chunk, and then the allocator is sized for it.
 struct LinearAllocator : public dtTileCacheAlloc
 {
-	unsigned char* buffer;
-	size_t capacity;
+	struct Chunk
+	{
+		unsigned char* buffer;
+		size_t capacity;
+	};
+	std::vector<Chunk> chunks;
+	size_t current;
 	size_t top;
+	// Bytes allocated since the last reset(), and their peak.
+	size_t used;
 	size_t high;
 	
-	LinearAllocator(const size_t cap) : buffer(0), capacity(0), top(0), high(0)
+	LinearAllocator(const size_t cap) : current(0), top(0), used(0), high(0)
 	{
 		resize(cap);
 	}
 	
 	~LinearAllocator()
 	{
-		dtFree(buffer);
+		freeChunks();
 	}
 
 	void resize(const size_t cap)
 	{
-		if (buffer) dtFree(buffer);
-		buffer = (unsigned char*)dtAlloc(cap, DT_ALLOC_PERM);
-		capacity = cap;
+		freeChunks();
+		addChunk(cap);
+		current = 0;
+		top = 0;
+	}
+	
+	size_t getCapacity() const
+	{
+		size_t capacity = 0;
+		for (size_t i = 0; i < chunks.size(); ++i)
+			capacity += chunks[i].capacity;
+		return capacity;
 	}
 	
 	virtual void reset()
 	{
-		high = dtMax(high, top);
+		if (chunks.size() > 1)
+			resize(getCapacity());
+		current = 0;
 		top = 0;
+		used = 0;
 	}
 	
 	virtual void* alloc(const size_t size)
 	{
-		if (!buffer)
-			return 0;
-		if (top+size > capacity)
-			return 0;
-		unsigned char* mem = &buffer[top];
-		top += size;
+		// Keep the allocations aligned.
+		const size_t asize = (size + 15) & ~(size_t)15;
+		while (current < chunks.size() && top+asize > chunks[current].capacity)
+		{
+			++current;
+			top = 0;
+		}
+		if (current == chunks.size())
+		{
+			// Double the capacity at least.
+			if (!addChunk(dtMax(asize, getCapacity())))
+				return 0;
+			top = 0;
+		}
+		unsigned char* mem = &chunks[current].buffer[top];
+		top += asize;
+		used += asize;
+		high = dtMax(high, used);
 		return mem;
 	}
 	
@@ -167,6 +182,25 @@ struct LinearAllocator : public dtTileCacheAlloc
 	{
 		// Empty
 	}
+	
+private:
+	bool addChunk(const size_t cap)
+	{
+		Chunk chunk;
+		chunk.buffer = (unsigned char*)dtAlloc(cap, DT_ALLOC_PERM);
+		if (!chunk.buffer)
+			return false;
+		chunk.capacity = cap;
+		chunks.push_back(chunk);
+		return true;
+	}
+	
+	void freeChunks()
+	{
+		for (size_t i = 0; i < chunks.size(); ++i)
+			dtFree(chunks[i].buffer);
+		chunks.clear();
+	}
 };
 
 struct MeshProcess : public dtTileCacheMeshProcess
@@ -195,8 +229,11 @@ struct MeshProcess : public dtTileCacheMeshProcess
 			//set polyFlags for polyAreas only if m_flagsAreaTable not empty
 			if (! (*m_flagsAreaTable).empty())
 			{ 
-				// get flags from a table indexed by areas
-				polyFlags[i] = (*m_flagsAreaTable)[polyAreas[i]];
+				// get flags from a table indexed by areas (with find(): tiles
+				// can be processed concurrently)
+				NavMeshPolyAreaFlags::const_iterator iter =
+						m_flagsAreaTable->find(polyAreas[i]);
+				polyFlags[i] = iter != m_flagsAreaTable->end() ? iter->second : 0;
 			} 
 			else
 			{ 
@@ -218,16 +255,22 @@ struct MeshProcess : public dtTileCacheMeshProcess
 			} 
 		}
 
-		// Pass in off-mesh connections.
+		// Pass in off-mesh connections: only those which can be linked to
+		// this tile (params are consumed on this same thread right after).
 		if (m_geom)
 		{
-			params->offMeshConVerts = m_geom->getOffMeshConnectionVerts();
-			params->offMeshConRad = m_geom->getOffMeshConnectionRads();
-			params->offMeshConDir = m_geom->getOffMeshConnectionDirs();
-			params->offMeshConAreas = m_geom->getOffMeshConnectionAreas();
-			params->offMeshConFlags = m_geom->getOffMeshConnectionFlags();
-			params->offMeshConUserID = m_geom->getOffMeshConnectionId();
-			params->offMeshConCount = m_geom->getOffMeshConnectionCount();	
+			static thread_local OffMeshConnectionSet cons;
+			m_geom->getOffMeshConnections(params->bmin, params->bmax, cons);
+			if (cons.count)
+			{
+				params->offMeshConVerts = &cons.verts[0];
+				params->offMeshConRad = &cons.rads[0];
+				params->offMeshConDir = &cons.dirs[0];
+				params->offMeshConAreas = &cons.areas[0];
+				params->offMeshConFlags = &cons.flags[0];
+				params->offMeshConUserID = &cons.ids[0];
+			}
+			params->offMeshConCount = cons.count;
 		}
 	}
 };
@@ -246,11 +289,24 @@ struct TileCacheData
 	int dataSize;
 };
 
+struct TileCacheLayers
+{
+	TileCacheLayers() :
+		ntiles(0)
+	{
+		memset(tiles, 0, sizeof(TileCacheData)*MAX_LAYERS);
+	}
+	
+	TileCacheData tiles[MAX_LAYERS];
+	int ntiles;
+};
+
 struct RasterizationContext
 {
 	RasterizationContext() :
 		solid(0),
 		triareas(0),
+		maxTriareas(0),
 		lset(0),
 		chf(0),
 		ntiles(0)
@@ -260,26 +316,41 @@ struct RasterizationContext
 	
 	~RasterizationContext()
 	{
-		rcFreeHeightField(solid);
+		reset();
 		delete [] triareas;
+	}
+	
+	// Frees the results of a rasterization, so the context can be reused
+	// (the triangle flags' buffer is kept).
+	void reset()
+	{
+		rcFreeHeightField(solid);
+		solid = 0;
 		rcFreeHeightfieldLayerSet(lset);
+		lset = 0;
 		rcFreeCompactHeightfield(chf);
+		chf = 0;
 		for (int i = 0; i < MAX_LAYERS; ++i)
 		{
 			dtFree(tiles[i].data);
 			tiles[i].data = 0;
+			tiles[i].dataSize = 0;
 		}
+		ntiles = 0;
 	}
 	
 	rcHeightfield* solid;
 	unsigned char* triareas;
+	int maxTriareas;
 	rcHeightfieldLayerSet* lset;
 	rcCompactHeightfield* chf;
 	TileCacheData tiles[MAX_LAYERS];
 	int ntiles;
+	std::vector<int> volumes;
 };
 
-int NavMeshType_Obstacle::rasterizeTileLayers(
+int NavMeshType_Obstacle::rasterizeTileLayers(BuildContext* ctx,
+							   rnsup::RasterizationContext& rc,
 							   const int tx, const int ty,
 							   const rcConfig& cfg,
 							   rnsup::TileCacheData* tiles,
@@ -287,12 +358,21 @@ int NavMeshType_Obstacle::rasterizeTileLayers(
 {
 	if (!m_geom || !m_geom->getMesh() || !m_geom->getChunkyMesh())
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildTile: Input mesh is not specified.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildTile: Input mesh is not specified.");
 		return 0;
 	}
 	
-	rnsup::FastLZCompressor comp;
-	rnsup::RasterizationContext rc;
+	// The context may have been used by a previous rasterization.
+	rc.reset();
+	
+	// The intermediate results are built into the thread's scratch arena, and
+	// freed before returning.
+	rnsup::BuildArenaScope arenaScope;
+	struct ResultsGuard
+	{
+		rnsup::RasterizationContext& rc;
+		~ResultsGuard() { rc.reset(); }
+	} resultsGuard = { rc };
 	
 	const float* verts = m_geom->getMesh()->getVerts();
 	const int nverts = m_geom->getMesh()->getVertCount();
@@ -315,26 +395,69 @@ int NavMeshType_Obstacle::rasterizeTileLayers(
 	tcfg.bmax[0] += tcfg.borderSize*tcfg.cs;
 	tcfg.bmax[2] += tcfg.borderSize*tcfg.cs;
 	
+	// Reuse the layers compressed from the same input.
+	const bool useCache = m_buildCache && m_buildCache->isEnabled();
+	unsigned long long inputHash = 0;
+	if (useCache)
+	{
+		rnsup::TileInputHash hash;
+		hash.add('O');
+		hash.add(DT_TILECACHE_VERSION);
+		hash.add(tx);
+		hash.add(ty);
+		hash.add(tcfg);
+		hash.add(m_tcomp->getType());
+		hash.add(m_filterLowHangingObstacles);
+		hash.add(m_filterLedgeSpans);
+		hash.add(m_filterWalkableLowHeightSpans);
+		hash.addGeometry(m_geom, tcfg.bmin, tcfg.bmax);
+		inputHash = hash.getValue();
+		
+		unsigned char* datas[MAX_LAYERS];
+		int sizes[MAX_LAYERS];
+		const int count = m_buildCache->load(inputHash, datas, sizes, MAX_LAYERS);
+		if (count >= 0)
+		{
+			int n = 0;
+			for (int i = 0; i < count; ++i)
+			{
+				if (n < maxTiles)
+				{
+					tiles[n].data = datas[i];
+					tiles[n++].dataSize = sizes[i];
+				}
+				else
+					dtFree(datas[i]);
+			}
+			return n;
+		}
+	}
+	
 	// Allocate voxel heightfield where we rasterize our input data to.
 	rc.solid = rcAllocHeightfield();
 	if (!rc.solid)
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'solid'.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'solid'.");
 		return 0;
 	}
-	if (!rcCreateHeightfield(m_ctx, *rc.solid, tcfg.width, tcfg.height, tcfg.bmin, tcfg.bmax, tcfg.cs, tcfg.ch))
+	if (!rcCreateHeightfield(ctx, *rc.solid, tcfg.width, tcfg.height, tcfg.bmin, tcfg.bmax, tcfg.cs, tcfg.ch))
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Could not create solid heightfield.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Could not create solid heightfield.");
 		return 0;
 	}
 	
 	// Allocate array that can hold triangle flags.
 	// If you have multiple meshes you need to process, allocate
 	// and array which can hold the max number of triangles you need to process.
-	rc.triareas = new unsigned char[chunkyMesh->maxTrisPerChunk];
+	if (rc.maxTriareas < chunkyMesh->maxTrisPerChunk)
+	{
+		delete [] rc.triareas;
+		rc.triareas = new unsigned char[chunkyMesh->maxTrisPerChunk];
+		rc.maxTriareas = chunkyMesh->maxTrisPerChunk;
+	}
 	if (!rc.triareas)
 	{
-		CTXLOG1(m_ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'm_triareas' (%d).", chunkyMesh->maxTrisPerChunk);
+		CTXLOG1(ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'm_triareas' (%d).", chunkyMesh->maxTrisPerChunk);
 		return 0;
 	}
 	
@@ -357,10 +480,10 @@ int NavMeshType_Obstacle::rasterizeTileLayers(
 		const int ntris = node.n;
 		
 		memset(rc.triareas, 0, ntris*sizeof(unsigned char));
-		rcMarkWalkableTriangles(m_ctx, tcfg.walkableSlopeAngle,
+		rcMarkWalkableTriangles(ctx, tcfg.walkableSlopeAngle,
 								verts, nverts, tris, ntris, rc.triareas);
 		
-		if (!rcRasterizeTriangles(m_ctx, verts, nverts, tris, rc.triareas, ntris, *rc.solid, tcfg.walkableClimb))
+		if (!rcRasterizeTriangles(ctx, verts, nverts, tris, rc.triareas, ntris, *rc.solid, tcfg.walkableClimb))
 			return 0;
 	}
 	
@@ -368,37 +491,39 @@ int NavMeshType_Obstacle::rasterizeTileLayers(
 	// remove unwanted overhangs caused by the conservative rasterization
 	// as well as filter spans where the character cannot possibly stand.
 	if (m_filterLowHangingObstacles)
-		rcFilterLowHangingWalkableObstacles(m_ctx, tcfg.walkableClimb, *rc.solid);
+		rcFilterLowHangingWalkableObstacles(ctx, tcfg.walkableClimb, *rc.solid);
 	if (m_filterLedgeSpans)
-		rcFilterLedgeSpans(m_ctx, tcfg.walkableHeight, tcfg.walkableClimb, *rc.solid);
+		rcFilterLedgeSpans(ctx, tcfg.walkableHeight, tcfg.walkableClimb, *rc.solid);
 	if (m_filterWalkableLowHeightSpans)
-		rcFilterWalkableLowHeightSpans(m_ctx, tcfg.walkableHeight, *rc.solid);
+		rcFilterWalkableLowHeightSpans(ctx, tcfg.walkableHeight, *rc.solid);
 	
 	
 	rc.chf = rcAllocCompactHeightfield();
 	if (!rc.chf)
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'chf'.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'chf'.");
 		return 0;
 	}
-	if (!rcBuildCompactHeightfield(m_ctx, tcfg.walkableHeight, tcfg.walkableClimb, *rc.solid, *rc.chf))
+	if (!rcBuildCompactHeightfield(ctx, tcfg.walkableHeight, tcfg.walkableClimb, *rc.solid, *rc.chf))
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Could not build compact data.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Could not build compact data.");
 		return 0;
 	}
 	
 	// Erode the walkable area by agent radius.
-	if (!rcErodeWalkableArea(m_ctx, tcfg.walkableRadius, *rc.chf))
+	if (!rcErodeWalkableArea(ctx, tcfg.walkableRadius, *rc.chf))
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Could not erode.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Could not erode.");
 		return 0;
 	}
 	
 	// (Optional) Mark areas.
 	const rnsup::ConvexVolume* vols = m_geom->getConvexVolumes();
-	for (int i  = 0; i < m_geom->getConvexVolumeCount(); ++i)
+	m_geom->queryConvexVolumes(tcfg.bmin, tcfg.bmax, rc.volumes);
+	for (int k = 0; k < (int)rc.volumes.size(); ++k)
 	{
-		rcMarkConvexPolyArea(m_ctx, vols[i].verts, vols[i].nverts,
+		const int i = rc.volumes[k];
+		rcMarkConvexPolyArea(ctx, vols[i].verts, vols[i].nverts,
 							 vols[i].hmin, vols[i].hmax,
 							 (unsigned char)vols[i].area, *rc.chf);
 	}
@@ -406,12 +531,12 @@ int NavMeshType_Obstacle::rasterizeTileLayers(
 	rc.lset = rcAllocHeightfieldLayerSet();
 	if (!rc.lset)
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'lset'.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'lset'.");
 		return 0;
 	}
-	if (!rcBuildHeightfieldLayers(m_ctx, *rc.chf, tcfg.borderSize, tcfg.walkableHeight, *rc.lset))
+	if (!rcBuildHeightfieldLayers(ctx, *rc.chf, tcfg.borderSize, tcfg.walkableHeight, *rc.lset))
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Could not build heighfield layers.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Could not build heighfield layers.");
 		return 0;
 	}
 	
@@ -443,7 +568,7 @@ int NavMeshType_Obstacle::rasterizeTileLayers(
 		header.hmin = (unsigned short)layer->hmin;
 		header.hmax = (unsigned short)layer->hmax;
 
-		dtStatus status = dtBuildTileCacheLayer(&comp, &header, layer->heights, layer->areas, layer->cons,
+		dtStatus status = dtBuildTileCacheLayer(m_tcomp, &header, layer->heights, layer->areas, layer->cons,
 												&tile->data, &tile->dataSize);
 		if (dtStatusFailed(status))
 		{
@@ -451,6 +576,18 @@ int NavMeshType_Obstacle::rasterizeTileLayers(
 		}
 	}
 
+	if (useCache)
+	{
+		const unsigned char* datas[MAX_LAYERS];
+		int sizes[MAX_LAYERS];
+		for (int i = 0; i < rc.ntiles; ++i)
+		{
+			datas[i] = rc.tiles[i].data;
+			sizes[i] = rc.tiles[i].dataSize;
+		}
+		m_buildCache->store(inputHash, datas, sizes, rc.ntiles);
+	}
+	
 	// Transfer ownsership of tile data from build context to the caller.
 	int n = 0;
 	for (int i = 0; i < rcMin(rc.ntiles, maxTiles); ++i)
@@ -847,7 +984,7 @@ NavMeshType_Obstacle::NavMeshType_Obstacle() :
 	resetNavMeshSettings();
 	
 	m_talloc = new LinearAllocator(32000);
-	m_tcomp = new FastLZCompressor;
+	m_tcomp = new TileCacheCompressor;
 	m_tmproc = new MeshProcess;
 	m_tmproc->m_flagsAreaTable = &m_flagsAreaTable;
 	
@@ -859,6 +996,8 @@ NavMeshType_Obstacle::~NavMeshType_Obstacle()
 	dtFreeNavMesh(m_navMesh);
 	m_navMesh = 0;
 	dtFreeTileCache(m_tileCache);
+	for (unsigned int i = 0; i < m_workerTallocs.size(); ++i)
+		delete m_workerTallocs[i];
 }
 
 //void NavMeshType_Obstacle::handleSettings()
@@ -1087,7 +1226,7 @@ void NavMeshType_Obstacle::handleRender(duDebugDraw& m_dd)
 //		 m_drawMode == DRAWMODE_NAVMESH_INVIS))
 //	{
 //		if (m_drawMode != DRAWMODE_NAVMESH_INVIS)
-			duDebugDrawNavMeshWithClosedList(&m_dd, *m_navMesh, *m_navQuery, m_navMeshDrawFlags/*|DU_DRAWNAVMESH_COLOR_TILES*/);
+			drawNavMesh(m_dd);
 //		if (m_drawMode == DRAWMODE_NAVMESH_BVTREE)
 //			duDebugDrawNavMeshBVTree(&m_dd, *m_navMesh);
 //		if (m_drawMode == DRAWMODE_NAVMESH_PORTALS)
@@ -1203,29 +1342,12 @@ void NavMeshType_Obstacle::clearAllTempObstacles()
 	}
 }
 
-bool NavMeshType_Obstacle::handleBuild()
+void NavMeshType_Obstacle::initTileConfig(rcConfig& cfg) const
 {
-	dtStatus status;
-	
-	if (!m_geom || !m_geom->getMesh())
-	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildTiledNavigation: No vertices and triangles.");
-		return false;
-	}
-
-	m_tmproc->init(m_geom);
-	
-	// Init cache
 	const float* bmin = m_geom->getNavMeshBoundsMin();
 	const float* bmax = m_geom->getNavMeshBoundsMax();
-	int gw = 0, gh = 0;
-	rcCalcGridSize(bmin, bmax, m_cellSize, &gw, &gh);
-	const int ts = (int)m_tileSize;
-	const int tw = (gw + ts-1) / ts;
-	const int th = (gh + ts-1) / ts;
-
+	
 	// Generation params.
-	rcConfig cfg;
 	memset(&cfg, 0, sizeof(cfg));
 	cfg.cs = m_cellSize;
 	cfg.ch = m_cellHeight;
@@ -1246,6 +1368,32 @@ bool NavMeshType_Obstacle::handleBuild()
 	cfg.detailSampleMaxError = m_cellHeight * m_detailSampleMaxError;
 	rcVcopy(cfg.bmin, bmin);
 	rcVcopy(cfg.bmax, bmax);
+}
+
+bool NavMeshType_Obstacle::handleBuild()
+{
+	dtStatus status;
+	
+	if (!m_geom || !m_geom->getMesh())
+	{
+		CTXLOG(m_ctx, RC_LOG_ERROR, "buildTiledNavigation: No vertices and triangles.");
+		return false;
+	}
+
+	m_tmproc->init(m_geom);
+	
+	// Init cache
+	const float* bmin = m_geom->getNavMeshBoundsMin();
+	const float* bmax = m_geom->getNavMeshBoundsMax();
+	int gw = 0, gh = 0;
+	rcCalcGridSize(bmin, bmax, m_cellSize, &gw, &gh);
+	const int ts = (int)m_tileSize;
+	const int tw = (gw + ts-1) / ts;
+	const int th = (gh + ts-1) / ts;
+
+	// Generation params.
+	rcConfig cfg;
+	initTileConfig(cfg);
 	
 	// Tile cache params.
 	dtTileCacheParams tcparams;
@@ -1318,13 +1466,55 @@ bool NavMeshType_Obstacle::handleBuild()
 	m_cacheRawSize = 0;
 #endif
 	
+	// Rasterize and compress the tiles' layers: each worker has its own
+	// context and rasterization context (the compressor has no state), while
+	// the layers are added to the tile cache serially (and in the same order)
+	// afterwards.
+	// hold the pool while its workers' scratch data are in use
+	std::unique_lock<WorkerPool> poolLock;
+	if (m_workerPool)
+		poolLock = std::unique_lock<WorkerPool>(*m_workerPool);
+	const int numWorkers = m_workerPool ? m_workerPool->getNumWorkers() : 1;
+	std::vector<TileCacheLayers> tileLayers(tw*th);
+	if ((numWorkers > 1) && (tw*th > 1))
+	{
+		std::vector<BuildContext*> contexts(numWorkers);
+		std::vector<RasterizationContext> rcs(numWorkers);
+		for (int i = 0; i < numWorkers; ++i)
+		{
+			contexts[i] = new BuildContext;
+			contexts[i]->resetStats();
+		}
+		m_workerPool->parallelFor(tw*th, [&](int index, int worker)
+		{
+			TileCacheLayers& layers = tileLayers[index];
+			layers.ntiles = rasterizeTileLayers(contexts[worker], rcs[worker],
+					index % tw, index / tw, cfg, layers.tiles, MAX_LAYERS);
+		});
+		for (int i = 0; i < numWorkers; ++i)
+		{
+			m_ctx->merge(*contexts[i]);
+			delete contexts[i];
+		}
+	}
+	else
+	{
+		RasterizationContext rc;
+		for (int index = 0; index < tw*th; ++index)
+		{
+			TileCacheLayers& layers = tileLayers[index];
+			layers.ntiles = rasterizeTileLayers(m_ctx, rc, index % tw,
+					index / tw, cfg, layers.tiles, MAX_LAYERS);
+		}
+	}
+	
 	for (int y = 0; y < th; ++y)
 	{
 		for (int x = 0; x < tw; ++x)
 		{
-			TileCacheData tiles[MAX_LAYERS];
-			memset(tiles, 0, sizeof(tiles));
-			int ntiles = rasterizeTileLayers(x, y, cfg, tiles, MAX_LAYERS);
+			TileCacheLayers& layers = tileLayers[y*tw + x];
+			TileCacheData* tiles = layers.tiles;
+			int ntiles = layers.ntiles;
 
 			for (int i = 0; i < ntiles; ++i)
 			{
@@ -1387,7 +1577,292 @@ void NavMeshType_Obstacle::handleUpdate(const float dt)
 	if (!m_tileCache)
 		return;
 	
-	m_tileCache->update(dt, m_navMesh);
+	// Tile cache updates are driven by updateTileCache().
+}
+
+int NavMeshType_Obstacle::rebuildTiles(const float* bmin, const float* bmax,
+		int* tiles, const int maxTiles)
+{
+	if (!m_geom || !m_navMesh || !m_tileCache)
+		return 0;
+	
+	rcConfig cfg;
+	initTileConfig(cfg);
+	int gw = 0, gh = 0;
+	rcCalcGridSize(cfg.bmin, cfg.bmax, cfg.cs, &gw, &gh);
+	const int tw = (gw + cfg.tileSize-1) / cfg.tileSize;
+	const int th = (gh + cfg.tileSize-1) / cfg.tileSize;
+	const float tcs = cfg.tileSize*cfg.cs;
+	
+	// Layers are rasterized with a border (see rasterizeTileLayers()).
+	const float border = cfg.borderSize*cfg.cs;
+	const int tx0 = rcMax((int)floorf((bmin[0] - border - cfg.bmin[0]) / tcs), 0);
+	const int tx1 = rcMin((int)floorf((bmax[0] + border - cfg.bmin[0]) / tcs), tw-1);
+	const int ty0 = rcMax((int)floorf((bmin[2] - border - cfg.bmin[2]) / tcs), 0);
+	const int ty1 = rcMin((int)floorf((bmax[2] + border - cfg.bmin[2]) / tcs), th-1);
+	
+	// Re-rasterize the layers of the existing tiles, replacing them in the
+	// tile cache.
+	RasterizationContext rc;
+	int n = 0;
+	for (int ty = ty0; ty <= ty1; ++ty)
+	{
+		for (int tx = tx0; tx <= tx1; ++tx)
+		{
+			dtCompressedTileRef refs[MAX_LAYERS];
+			const int nrefs = m_tileCache->getTilesAt(tx, ty, refs, MAX_LAYERS);
+			if (n >= maxTiles || !nrefs)
+				continue;
+			
+			TileCacheLayers layers;
+			layers.ntiles = rasterizeTileLayers(m_ctx, rc, tx, ty, cfg,
+					layers.tiles, MAX_LAYERS);
+			for (int i = 0; i < nrefs; ++i)
+				m_tileCache->removeTile(refs[i], 0, 0);
+			for (int i = 0; i < layers.ntiles; ++i)
+			{
+				TileCacheData* tile = &layers.tiles[i];
+				dtStatus status = m_tileCache->addTile(tile->data, tile->dataSize,
+						DT_COMPRESSEDTILE_FREE_DATA, 0);
+				if (dtStatusFailed(status))
+				{
+					dtFree(tile->data);
+					tile->data = 0;
+				}
+			}
+			tiles[n*2+0] = tx;
+			tiles[n*2+1] = ty;
+			++n;
+		}
+	}
+	
+	// The obstacles refer to the replaced layers.
+	m_tileCache->updateObstaclesTouched();
+	
+	// Rebuild the navmesh tiles (even the layers no more existing).
+	for (int i = 0; i < n; ++i)
+	{
+		const dtMeshTile* meshTiles[MAX_LAYERS];
+		const int nmeshTiles = m_navMesh->getTilesAt(tiles[i*2+0], tiles[i*2+1],
+				meshTiles, MAX_LAYERS);
+		for (int j = 0; j < nmeshTiles; ++j)
+			m_navMesh->removeTile(m_navMesh->getTileRef(meshTiles[j]), 0, 0);
+		m_tileCache->buildNavMeshTilesAt(tiles[i*2+0], tiles[i*2+1], m_navMesh);
+	}
+	return n;
+}
+
+int NavMeshType_Obstacle::updateTileCache(const int maxTiles, int* tiles, bool* upToDate)
+{
+	if (upToDate)
+		*upToDate = true;
+	if (!m_navMesh || !m_tileCache || maxTiles <= 0)
+		return 0;
+	
+	std::vector<dtCompressedTileRef> refs(maxTiles);
+	const int nrefs = m_tileCache->getUpdateTiles(&refs[0], maxTiles);
+	
+	// Build the tiles' navmesh data: each worker has its own allocator, while
+	// the data are swapped into the navmesh serially afterwards.
+	std::vector<unsigned char*> datas(nrefs, (unsigned char*)0);
+	std::vector<int> dataSizes(nrefs, 0);
+	std::vector<dtStatus> status(nrefs, DT_FAILURE);
+	// hold the pool while its workers' scratch data are in use
+	std::unique_lock<WorkerPool> poolLock;
+	if (m_workerPool)
+		poolLock = std::unique_lock<WorkerPool>(*m_workerPool);
+	const int numWorkers = m_workerPool ? m_workerPool->getNumWorkers() : 1;
+	if ((numWorkers > 1) && (nrefs > 1))
+	{
+		while ((int)m_workerTallocs.size() < numWorkers)
+			m_workerTallocs.push_back(new LinearAllocator(32000));
+		m_workerPool->parallelFor(nrefs, [&](int index, int worker)
+		{
+			status[index] = m_tileCache->buildNavMeshTileData(refs[index],
+					m_workerTallocs[worker], &datas[index], &dataSizes[index]);
+		});
+	}
+	else
+	{
+		for (int i = 0; i < nrefs; ++i)
+			status[i] = m_tileCache->buildNavMeshTileData(refs[i], m_talloc,
+					&datas[i], &dataSizes[i]);
+	}
+	
+	for (int i = 0; i < nrefs; ++i)
+	{
+		const dtCompressedTile* tile = m_tileCache->getTileByRef(refs[i]);
+		if (dtStatusSucceed(status[i]))
+			m_tileCache->addNavMeshTileData(refs[i], m_navMesh, datas[i], dataSizes[i]);
+		m_tileCache->completeTileUpdate(refs[i]);
+		tiles[i*2+0] = tile && tile->header ? tile->header->tx : -1;
+		tiles[i*2+1] = tile && tile->header ? tile->header->ty : -1;
+	}
+	
+	if (upToDate)
+	{
+		dtCompressedTileRef ref;
+		*upToDate = m_tileCache->getUpdateTiles(&ref, 1) == 0;
+	}
+	return nrefs;
+}
+
+static const int TILECACHEDATA_MAGIC = 'T'<<24 | 'C'<<16 | 'B'<<8 | 'D'; //'TCBD';
+static const int TILECACHEDATA_VERSION = 1;
+
+void NavMeshType_Obstacle::writeBuiltData(Datagram& dg) const
+{
+	if (!m_navMesh || !m_tileCache) return;
+
+	dg.add_int32(TILECACHEDATA_MAGIC);
+	dg.add_int32(TILECACHEDATA_VERSION);
+	writeNavMeshParams(dg, *m_navMesh->getParams());
+
+	// Tile cache params.
+	const dtTileCacheParams* tcparams = m_tileCache->getParams();
+	for (int i = 0; i < 3; ++i)
+		dg.add_stdfloat(tcparams->orig[i]);
+	dg.add_stdfloat(tcparams->cs);
+	dg.add_stdfloat(tcparams->ch);
+	dg.add_int32(tcparams->width);
+	dg.add_int32(tcparams->height);
+	dg.add_stdfloat(tcparams->walkableHeight);
+	dg.add_stdfloat(tcparams->walkableRadius);
+	dg.add_stdfloat(tcparams->walkableClimb);
+	dg.add_stdfloat(tcparams->maxSimplificationError);
+	dg.add_int32(tcparams->maxTiles);
+	dg.add_int32(tcparams->maxObstacles);
+
+	// Compressed tiles: nav mesh tiles are rebuilt from these (obstacles are
+	// not baked in).
+	int numTiles = 0;
+	for (int i = 0; i < m_tileCache->getTileCount(); ++i)
+	{
+		const dtCompressedTile* tile = m_tileCache->getTile(i);
+		if (!tile || !tile->header || !tile->dataSize) continue;
+		numTiles++;
+	}
+	dg.add_int32(numTiles);
+	for (int i = 0; i < m_tileCache->getTileCount(); ++i)
+	{
+		const dtCompressedTile* tile = m_tileCache->getTile(i);
+		if (!tile || !tile->header || !tile->dataSize) continue;
+
+		dg.add_int32(tile->dataSize);
+		dg.append_data(tile->data, tile->dataSize);
+	}
+}
+
+bool NavMeshType_Obstacle::handleBuildFromData(DatagramIterator& scan)
+{
+	if (scan.get_remaining_size() < 8)
+		return false;
+	if (scan.get_int32() != TILECACHEDATA_MAGIC)
+		return false;
+	if (scan.get_int32() != TILECACHEDATA_VERSION)
+		return false;
+
+	if (!m_geom || !m_geom->getMesh())
+	{
+		CTXLOG(m_ctx, RC_LOG_ERROR, "buildFromData: No vertices and triangles.");
+		return false;
+	}
+
+	m_tmproc->init(m_geom);
+
+	dtNavMeshParams params;
+	readNavMeshParams(scan, params);
+
+	dtTileCacheParams tcparams;
+	memset(&tcparams, 0, sizeof(tcparams));
+	for (int i = 0; i < 3; ++i)
+		tcparams.orig[i] = scan.get_stdfloat();
+	tcparams.cs = scan.get_stdfloat();
+	tcparams.ch = scan.get_stdfloat();
+	tcparams.width = scan.get_int32();
+	tcparams.height = scan.get_int32();
+	tcparams.walkableHeight = scan.get_stdfloat();
+	tcparams.walkableRadius = scan.get_stdfloat();
+	tcparams.walkableClimb = scan.get_stdfloat();
+	tcparams.maxSimplificationError = scan.get_stdfloat();
+	tcparams.maxTiles = scan.get_int32();
+	tcparams.maxObstacles = scan.get_int32();
+
+	dtFreeTileCache(m_tileCache);
+
+	m_tileCache = dtAllocTileCache();
+	if (!m_tileCache)
+	{
+		CTXLOG(m_ctx, RC_LOG_ERROR, "buildFromData: Could not allocate tile cache.");
+		return false;
+	}
+	dtStatus status = m_tileCache->init(&tcparams, m_talloc, m_tcomp, m_tmproc);
+	if (dtStatusFailed(status))
+	{
+		CTXLOG(m_ctx, RC_LOG_ERROR, "buildFromData: Could not init tile cache.");
+		return false;
+	}
+
+	dtFreeNavMesh(m_navMesh);
+
+	m_navMesh = dtAllocNavMesh();
+	if (!m_navMesh)
+	{
+		CTXLOG(m_ctx, RC_LOG_ERROR, "buildFromData: Could not allocate navmesh.");
+		return false;
+	}
+	status = m_navMesh->init(&params);
+	if (dtStatusFailed(status))
+	{
+		CTXLOG(m_ctx, RC_LOG_ERROR, "buildFromData: Could not init navmesh.");
+		return false;
+	}
+
+	status = m_navQuery->init(m_navMesh, 2048);
+	if (dtStatusFailed(status))
+	{
+		CTXLOG(m_ctx, RC_LOG_ERROR, "buildFromData: Could not init Detour navmesh query");
+		return false;
+	}
+
+	const int numTiles = scan.get_int32();
+	for (int i = 0; i < numTiles; ++i)
+	{
+		int dataSize = scan.get_int32();
+		if (dataSize <= 0 || scan.get_remaining_size() < (size_t)dataSize)
+		{
+			CTXLOG(m_ctx, RC_LOG_ERROR, "buildFromData: Could not read compressed tiles.");
+			return false;
+		}
+
+		unsigned char* data = (unsigned char*)dtAlloc(dataSize, DT_ALLOC_PERM);
+		if (!data)
+			return false;
+		scan.extract_bytes(data, dataSize);
+
+		dtCompressedTileRef tile = 0;
+		status = m_tileCache->addTile(data, dataSize, DT_COMPRESSEDTILE_FREE_DATA, &tile);
+		if (dtStatusFailed(status))
+		{
+			dtFree(data);
+			CTXLOG(m_ctx, RC_LOG_ERROR, "buildFromData: Could not add compressed tile.");
+			return false;
+		}
+
+		// the tile cache owns the data from now on
+		status = m_tileCache->buildNavMeshTile(tile, m_navMesh);
+		if (dtStatusFailed(status))
+		{
+			CTXLOG(m_ctx, RC_LOG_ERROR, "buildFromData: Could not build navmesh tile.");
+			return false;
+		}
+	}
+
+	if (m_tool)
+		m_tool->init(this);
+	initToolStates(this);
+
+	return true;
 }
 
 void NavMeshType_Obstacle::getTilePos(const float* pos, int& tx, int& ty)
@@ -1404,11 +1879,33 @@ dtTileCache* NavMeshType_Obstacle::getTileCache()
 {
 	return m_tileCache;
 }
+// Computed from the current tile cache's content, so they are valid also
+// for tile caches restored from built data.
+void NavMeshType_Obstacle::getCacheStats(int& layerCount, int& compressedSize,
+		int& rawSize, int& allocHighWater) const
+{
+	layerCount = compressedSize = rawSize = allocHighWater = 0;
+	if (!m_tileCache)
+		return;
+	for (int i = 0; i < m_tileCache->getTileCount(); ++i)
+	{
+		const dtCompressedTile* tile = m_tileCache->getTile(i);
+		if (!tile->header)
+			continue;
+		layerCount++;
+		compressedSize += tile->dataSize;
+		rawSize += calcLayerBufferSize(tile->header->width, tile->header->height);
+	}
+	allocHighWater = m_talloc ? (int) m_talloc->high : 0;
+	for (unsigned int i = 0; i < m_workerTallocs.size(); ++i)
+		allocHighWater = dtMax(allocHighWater, (int) m_workerTallocs[i]->high);
+}
 void NavMeshType_Obstacle::setTileSettings(const NavMeshTileSettings& settings)
 {
 	m_maxTiles = settings.m_maxTiles;
 	m_maxPolysPerTile = settings.m_maxPolysPerTile;
 	m_tileSize = settings.m_tileSize;
+	m_tcomp->setType(settings.m_compressorType);
 }
 NavMeshTileSettings NavMeshType_Obstacle::getTileSettings()
 {
@@ -1416,6 +1913,7 @@ NavMeshTileSettings NavMeshType_Obstacle::getTileSettings()
 	settings.m_maxTiles = m_maxTiles;
 	settings.m_maxPolysPerTile = m_maxPolysPerTile;
 	settings.m_tileSize = m_tileSize;
+	settings.m_compressorType = m_tcomp->getType();
 	return settings;
 }
 } //rnsup
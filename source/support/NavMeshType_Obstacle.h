@@ -40,8 +40,10 @@ protected:
 	bool m_keepInterResults;
 
 	struct LinearAllocator* m_talloc;
-	struct FastLZCompressor* m_tcomp;
+	class TileCacheCompressor* m_tcomp;
 	struct MeshProcess* m_tmproc;
+	///Per worker allocators for updateTileCache().
+	std::vector<struct LinearAllocator*> m_workerTallocs;
 
 	class dtTileCache* m_tileCache;
 	
@@ -82,10 +84,20 @@ public:
 	virtual void handleMeshChanged(class InputGeom* geom);
 	virtual bool handleBuild();
 	virtual void handleUpdate(const float dt);
+	virtual void writeBuiltData(Datagram& dg) const;
+	virtual bool handleBuildFromData(DatagramIterator& scan);
+	virtual int rebuildTiles(const float* bmin, const float* bmax, int* tiles,
+			const int maxTiles);
 
 	void setTileSettings(const NavMeshTileSettings& settings);
 	NavMeshTileSettings getTileSettings();
 	dtTileCache* getTileCache();
+	void getCacheStats(int& layerCount, int& compressedSize, int& rawSize,
+			int& allocHighWater) const;
+	///Rebuilds up to maxTiles tiles touched by obstacle changes, concurrently
+	///on the worker pool (if any): returns their count and their (tx,ty)
+	///coordinates in tiles [(tx,ty) * maxTiles].
+	int updateTileCache(const int maxTiles, int* tiles, bool* upToDate = 0);
 
 	void getTilePos(const float* pos, int& tx, int& ty);
 	
@@ -104,7 +116,10 @@ private:
 	NavMeshType_Obstacle(const NavMeshType_Obstacle&);
 	NavMeshType_Obstacle& operator=(const NavMeshType_Obstacle&);
 
-	int rasterizeTileLayers(const int tx, const int ty, const rcConfig& cfg, struct TileCacheData* tiles, const int maxTiles);
+	void initTileConfig(rcConfig& cfg) const;
+	int rasterizeTileLayers(BuildContext* ctx, struct RasterizationContext& rc,
+			const int tx, const int ty,
+			const rcConfig& cfg, struct TileCacheData* tiles, const int maxTiles);
 };
 
 } // namespace rnsup
@@ -245,7 +245,7 @@ void NavMeshType_Solo::handleRender(duDebugDraw& m_dd)
 //		m_drawMode == DRAWMODE_NAVMESH_INVIS))
 //	{
 //		if (m_drawMode != DRAWMODE_NAVMESH_INVIS)
-			duDebugDrawNavMeshWithClosedList(&m_dd, *m_navMesh, *m_navQuery, m_navMeshDrawFlags);
+			drawNavMesh(m_dd);
 //		if (m_drawMode == DRAWMODE_NAVMESH_BVTREE)
 ///			duDebugDrawNavMeshBVTree(&m_dd, *m_navMesh);
 //		if (m_drawMode == DRAWMODE_NAVMESH_NODES)
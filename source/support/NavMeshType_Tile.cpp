@@ -27,6 +27,9 @@
 #include <stdio.h>
 #include <string.h>
 #include "NavMeshType_Tile.h"
+#include "WorkerPool.h"
+#include "TileBuildCache.h"
+#include "BuildArena.h"
 #include <RecastDump.h>
 #include <DetourNavMeshBuilder.h>
 #include <DetourDebugDraw.h>
@@ -200,6 +203,41 @@ NavMeshType_Tile::~NavMeshType_Tile()
 	m_navMesh = 0;
 }
 
+TileBuildData::TileBuildData() :
+	triareas(0),
+	maxTriareas(0),
+	solid(0),
+	chf(0),
+	cset(0),
+	pmesh(0),
+	dmesh(0),
+	triCount(0)
+{
+	memset(&cfg, 0, sizeof(cfg));
+}
+
+void TileBuildData::freeResults()
+{
+	rcFreeHeightField(solid);
+	solid = 0;
+	rcFreeCompactHeightfield(chf);
+	chf = 0;
+	rcFreeContourSet(cset);
+	cset = 0;
+	rcFreePolyMesh(pmesh);
+	pmesh = 0;
+	rcFreePolyMeshDetail(dmesh);
+	dmesh = 0;
+}
+
+void TileBuildData::freeAll()
+{
+	freeResults();
+	delete [] triareas;
+	triareas = 0;
+	maxTriareas = 0;
+}
+
 void NavMeshType_Tile::cleanup()
 {
 	delete [] m_triareas;
@@ -216,34 +254,13 @@ void NavMeshType_Tile::cleanup()
 	m_dmesh = 0;
 }
 
-} // rnsup
-
-static const int NAVMESHSET_MAGIC = 'M'<<24 | 'S'<<16 | 'E'<<8 | 'T'; //'MSET';
-static const int NAVMESHSET_VERSION = 1;
-
-namespace rnsup
+bool NavMeshType_Tile::saveAll(const char* path, const dtNavMesh* mesh)
 {
-struct NavMeshSetHeader
-{
-	int magic;
-	int version;
-	int numTiles;
-	dtNavMeshParams params;
-};
-
-struct NavMeshTileHeader
-{
-	dtTileRef tileRef;
-	int dataSize;
-};
-
-void NavMeshType_Tile::saveAll(const char* path, const dtNavMesh* mesh)
-{
-	if (!mesh) return;
+	if (!mesh) return false;
 	
 	FILE* fp = fopen(path, "wb");
 	if (!fp)
-		return;
+		return false;
 	
 	// Store header.
 	NavMeshSetHeader header;
@@ -273,7 +290,7 @@ void NavMeshType_Tile::saveAll(const char* path, const dtNavMesh* mesh)
 		fwrite(tile->data, tile->dataSize, 1, fp);
 	}
 
-	fclose(fp);
+	return fclose(fp) == 0;
 }
 
 dtNavMesh* NavMeshType_Tile::loadAll(const char* path)
@@ -586,7 +603,7 @@ void NavMeshType_Tile::handleRender(duDebugDraw& m_dd)
 //		 m_drawMode == DRAWMODE_NAVMESH_INVIS))
 //	{
 //		if (m_drawMode != DRAWMODE_NAVMESH_INVIS)
-			duDebugDrawNavMeshWithClosedList(&m_dd, *m_navMesh, *m_navQuery, m_navMeshDrawFlags);
+			drawNavMesh(m_dd);
 //		if (m_drawMode == DRAWMODE_NAVMESH_BVTREE)
 //			duDebugDrawNavMeshBVTree(&m_dd, *m_navMesh);
 //		if (m_drawMode == DRAWMODE_NAVMESH_PORTALS)
@@ -774,12 +791,24 @@ void NavMeshType_Tile::buildTile(const float* pos)
 	if (!m_navMesh) return;
 		
 	const float* bmin = m_geom->getNavMeshBoundsMin();
-	const float* bmax = m_geom->getNavMeshBoundsMax();
 	
 	const float ts = m_tileSize*m_cellSize;
 	const int tx = (int)((pos[0] - bmin[0]) / ts);
 	const int ty = (int)((pos[2] - bmin[2]) / ts);
 	
+	buildTileAt(tx, ty);
+}
+
+void NavMeshType_Tile::buildTileAt(const int tx, const int ty)
+{
+	if (!m_geom) return;
+	if (!m_navMesh) return;
+		
+	const float* bmin = m_geom->getNavMeshBoundsMin();
+	const float* bmax = m_geom->getNavMeshBoundsMax();
+	
+	const float ts = m_tileSize*m_cellSize;
+	
 	m_lastBuiltTileBmin[0] = bmin[0] + tx*ts;
 	m_lastBuiltTileBmin[1] = bmin[1];
 	m_lastBuiltTileBmin[2] = bmin[2] + ty*ts;
@@ -813,6 +842,45 @@ void NavMeshType_Tile::buildTile(const float* pos)
 #endif
 }
 
+int NavMeshType_Tile::rebuildTiles(const float* bmin, const float* bmax,
+		int* tiles, const int maxTiles)
+{
+	if (!m_geom) return 0;
+	if (!m_navMesh) return 0;
+	
+	const float* gbmin = m_geom->getNavMeshBoundsMin();
+	const float* gbmax = m_geom->getNavMeshBoundsMax();
+	int gw = 0, gh = 0;
+	rcCalcGridSize(gbmin, gbmax, m_cellSize, &gw, &gh);
+	const int ts = (int)m_tileSize;
+	const int tw = (gw + ts-1) / ts;
+	const int th = (gh + ts-1) / ts;
+	const float tcs = m_tileSize*m_cellSize;
+	
+	// Tiles are rasterized with a border (see buildTileMesh()).
+	const float border = ((int)ceilf(m_agentRadius / m_cellSize) + 3) * m_cellSize;
+	const int tx0 = rcMax((int)floorf((bmin[0] - border - gbmin[0]) / tcs), 0);
+	const int tx1 = rcMin((int)floorf((bmax[0] + border - gbmin[0]) / tcs), tw-1);
+	const int ty0 = rcMax((int)floorf((bmin[2] - border - gbmin[2]) / tcs), 0);
+	const int ty1 = rcMin((int)floorf((bmax[2] + border - gbmin[2]) / tcs), th-1);
+	
+	int n = 0;
+	for (int ty = ty0; ty <= ty1; ++ty)
+	{
+		for (int tx = tx0; tx <= tx1; ++tx)
+		{
+			// Rebuild only the tiles that have been built.
+			if (n >= maxTiles || !m_navMesh->getTileAt(tx, ty, 0))
+				continue;
+			buildTileAt(tx, ty);
+			tiles[n*2+0] = tx;
+			tiles[n*2+1] = ty;
+			++n;
+		}
+	}
+	return n;
+}
+
 void NavMeshType_Tile::getTilePos(const float* pos, int& tx, int& ty)
 {
 	if (!m_geom) return;
@@ -869,28 +937,100 @@ void NavMeshType_Tile::buildAllTiles()
 	m_ctx->startTimer(RC_TIMER_TEMP);
 #endif
 
-	for (int y = 0; y < th; ++y)
+	// hold the pool while its workers' scratch data are in use
+	std::unique_lock<WorkerPool> poolLock;
+	if (m_workerPool)
+		poolLock = std::unique_lock<WorkerPool>(*m_workerPool);
+	const int numWorkers = m_workerPool ? m_workerPool->getNumWorkers() : 1;
+	if ((numWorkers > 1) && (tw*th > 1) && !m_keepInterResults)
 	{
-		for (int x = 0; x < tw; ++x)
+		// Build the tiles in parallel: each worker has its own context and
+		// scratch data, while the tiles are added to the navmesh serially
+		// (and in the same order) afterwards.
+		std::vector<BuildContext*> contexts(numWorkers);
+		std::vector<TileBuildData> workerData(numWorkers);
+		for (int i = 0; i < numWorkers; ++i)
 		{
-			m_lastBuiltTileBmin[0] = bmin[0] + x*tcs;
-			m_lastBuiltTileBmin[1] = bmin[1];
-			m_lastBuiltTileBmin[2] = bmin[2] + y*tcs;
-			
-			m_lastBuiltTileBmax[0] = bmin[0] + (x+1)*tcs;
-			m_lastBuiltTileBmax[1] = bmax[1];
-			m_lastBuiltTileBmax[2] = bmin[2] + (y+1)*tcs;
+			contexts[i] = new BuildContext;
+			contexts[i]->resetStats();
+		}
+		std::vector<unsigned char*> tileData(tw*th, (unsigned char*)0);
+		std::vector<int> tileDataSize(tw*th, 0);
+		
+		m_workerPool->parallelFor(tw*th, [&](int index, int worker)
+		{
+			const int x = index % tw;
+			const int y = index / tw;
+			float tileBmin[3], tileBmax[3];
+			tileBmin[0] = bmin[0] + x*tcs;
+			tileBmin[1] = bmin[1];
+			tileBmin[2] = bmin[2] + y*tcs;
+			tileBmax[0] = bmin[0] + (x+1)*tcs;
+			tileBmax[1] = bmax[1];
+			tileBmax[2] = bmin[2] + (y+1)*tcs;
 			
-			int dataSize = 0;
-			unsigned char* data = buildTileMesh(x, y, m_lastBuiltTileBmin, m_lastBuiltTileBmax, dataSize);
-			if (data)
+			TileBuildData& bd = workerData[worker];
+			BuildArenaScope arenaScope;
+			tileData[index] = buildTileMesh(contexts[worker], bd, x, y,
+					tileBmin, tileBmax, tileDataSize[index], false);
+			bd.freeResults();
+		});
+		
+		for (int i = 0; i < numWorkers; ++i)
+		{
+			m_ctx->merge(*contexts[i]);
+			delete contexts[i];
+			workerData[i].freeAll();
+		}
+		
+		for (int index = 0; index < tw*th; ++index)
+		{
+			unsigned char* data = tileData[index];
+			if (!data)
+				continue;
+			const int x = index % tw;
+			const int y = index / tw;
+			// Remove any previous data (navmesh owns and deletes the data).
+			m_navMesh->removeTile(m_navMesh->getTileRefAt(x,y,0),0,0);
+			// Let the navmesh own the data.
+			dtStatus status = m_navMesh->addTile(data,tileDataSize[index],DT_TILE_FREE_DATA,0,0);
+			if (dtStatusFailed(status))
+				dtFree(data);
+		}
+		
+		m_lastBuiltTileBmin[0] = bmin[0] + (tw-1)*tcs;
+		m_lastBuiltTileBmin[1] = bmin[1];
+		m_lastBuiltTileBmin[2] = bmin[2] + (th-1)*tcs;
+		
+		m_lastBuiltTileBmax[0] = bmin[0] + tw*tcs;
+		m_lastBuiltTileBmax[1] = bmax[1];
+		m_lastBuiltTileBmax[2] = bmin[2] + th*tcs;
+	}
+	else
+	{
+		for (int y = 0; y < th; ++y)
+		{
+			for (int x = 0; x < tw; ++x)
 			{
-				// Remove any previous data (navmesh owns and deletes the data).
-				m_navMesh->removeTile(m_navMesh->getTileRefAt(x,y,0),0,0);
-				// Let the navmesh own the data.
-				dtStatus status = m_navMesh->addTile(data,dataSize,DT_TILE_FREE_DATA,0,0);
-				if (dtStatusFailed(status))
-					dtFree(data);
+				m_lastBuiltTileBmin[0] = bmin[0] + x*tcs;
+				m_lastBuiltTileBmin[1] = bmin[1];
+				m_lastBuiltTileBmin[2] = bmin[2] + y*tcs;
+				
+				m_lastBuiltTileBmax[0] = bmin[0] + (x+1)*tcs;
+				m_lastBuiltTileBmax[1] = bmax[1];
+				m_lastBuiltTileBmax[2] = bmin[2] + (y+1)*tcs;
+				
+				int dataSize = 0;
+				unsigned char* data = buildTileMesh(x, y, m_lastBuiltTileBmin, m_lastBuiltTileBmax, dataSize);
+				if (data)
+				{
+					// Remove any previous data (navmesh owns and deletes the data).
+					m_navMesh->removeTile(m_navMesh->getTileRefAt(x,y,0),0,0);
+					// Let the navmesh own the data.
+					dtStatus status = m_navMesh->addTile(data,dataSize,DT_TILE_FREE_DATA,0,0);
+					if (dtStatusFailed(status))
+						dtFree(data);
+				}
 			}
 		}
 	}
@@ -925,41 +1065,78 @@ void NavMeshType_Tile::removeAllTiles()
 
 unsigned char* NavMeshType_Tile::buildTileMesh(const int tx, const int ty, const float* bmin, const float* bmax, int& dataSize)
 {
-	if (!m_geom || !m_geom->getMesh() || !m_geom->getChunkyMesh())
-	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Input mesh is not specified.");
-		return 0;
-	}
-	
 	m_tileMemUsage = 0;
 	m_tileBuildTime = 0;
 	
 	cleanup();
 	
+	TileBuildData bd;
+	unsigned char* navData;
+	if (m_keepInterResults)
+	{
+		navData = buildTileMesh(m_ctx, bd, tx, ty, bmin, bmax, dataSize, true);
+		
+		// Keep the intermediate results (freed by cleanup()).
+		m_solid = bd.solid;
+		m_chf = bd.chf;
+		m_cset = bd.cset;
+		m_pmesh = bd.pmesh;
+		m_dmesh = bd.dmesh;
+	}
+	else
+	{
+		// The intermediate results are built into (and discarded from) the
+		// thread's scratch arena.
+		BuildArenaScope arenaScope;
+		navData = buildTileMesh(m_ctx, bd, tx, ty, bmin, bmax, dataSize, false);
+		bd.freeResults();
+	}
+	m_cfg = bd.cfg;
+	m_triareas = bd.triareas;
+	m_tileTriCount = bd.triCount;
+	
+	if (navData)
+		m_tileMemUsage = dataSize/1024.0f;
+#ifdef RN_DEBUG
+	m_tileBuildTime = m_ctx->getAccumulatedTime(RC_TIMER_TOTAL)/1000.0f;
+#endif
+	return navData;
+}
+
+unsigned char* NavMeshType_Tile::buildTileMesh(BuildContext* ctx, TileBuildData& bd,
+		const int tx, const int ty, const float* bmin, const float* bmax,
+		int& dataSize, const bool keepInterResults)
+{
+	if (!m_geom || !m_geom->getMesh() || !m_geom->getChunkyMesh())
+	{
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Input mesh is not specified.");
+		return 0;
+	}
+	
 	const float* verts = m_geom->getMesh()->getVerts();
 	const int nverts = m_geom->getMesh()->getVertCount();
 	const int ntris = m_geom->getMesh()->getTriCount();
 	const rcChunkyTriMesh* chunkyMesh = m_geom->getChunkyMesh();
 		
 	// Init build configuration from GUI
-	memset(&m_cfg, 0, sizeof(m_cfg));
-	m_cfg.cs = m_cellSize;
-	m_cfg.ch = m_cellHeight;
-	m_cfg.walkableSlopeAngle = m_agentMaxSlope;
-	m_cfg.walkableHeight = (int)ceilf(m_agentHeight / m_cfg.ch);
-	m_cfg.walkableClimb = (int)floorf(m_agentMaxClimb / m_cfg.ch);
-	m_cfg.walkableRadius = (int)ceilf(m_agentRadius / m_cfg.cs);
-	m_cfg.maxEdgeLen = (int)(m_edgeMaxLen / m_cellSize);
-	m_cfg.maxSimplificationError = m_edgeMaxError;
-	m_cfg.minRegionArea = (int)rcSqr(m_regionMinSize);		// Note: area = size*size
-	m_cfg.mergeRegionArea = (int)rcSqr(m_regionMergeSize);	// Note: area = size*size
-	m_cfg.maxVertsPerPoly = (int)m_vertsPerPoly;
-	m_cfg.tileSize = (int)m_tileSize;
-	m_cfg.borderSize = m_cfg.walkableRadius + 3; // Reserve enough padding.
-	m_cfg.width = m_cfg.tileSize + m_cfg.borderSize*2;
-	m_cfg.height = m_cfg.tileSize + m_cfg.borderSize*2;
-	m_cfg.detailSampleDist = m_detailSampleDist < 0.9f ? 0 : m_cellSize * m_detailSampleDist;
-	m_cfg.detailSampleMaxError = m_cellHeight * m_detailSampleMaxError;
+	memset(&bd.cfg, 0, sizeof(bd.cfg));
+	bd.cfg.cs = m_cellSize;
+	bd.cfg.ch = m_cellHeight;
+	bd.cfg.walkableSlopeAngle = m_agentMaxSlope;
+	bd.cfg.walkableHeight = (int)ceilf(m_agentHeight / bd.cfg.ch);
+	bd.cfg.walkableClimb = (int)floorf(m_agentMaxClimb / bd.cfg.ch);
+	bd.cfg.walkableRadius = (int)ceilf(m_agentRadius / bd.cfg.cs);
+	bd.cfg.maxEdgeLen = (int)(m_edgeMaxLen / m_cellSize);
+	bd.cfg.maxSimplificationError = m_edgeMaxError;
+	bd.cfg.minRegionArea = (int)rcSqr(m_regionMinSize);		// Note: area = size*size
+	bd.cfg.mergeRegionArea = (int)rcSqr(m_regionMergeSize);	// Note: area = size*size
+	bd.cfg.maxVertsPerPoly = (int)m_vertsPerPoly;
+	bd.cfg.tileSize = (int)m_tileSize;
+	bd.cfg.borderSize = bd.cfg.walkableRadius + 3; // Reserve enough padding.
+	bd.cfg.width = bd.cfg.tileSize + bd.cfg.borderSize*2;
+	bd.cfg.height = bd.cfg.tileSize + bd.cfg.borderSize*2;
+	bd.cfg.detailSampleDist = m_detailSampleDist < 0.9f ? 0 : m_cellSize * m_detailSampleDist;
+	bd.cfg.detailSampleMaxError = m_cellHeight * m_detailSampleMaxError;
 	
 	// Expand the heighfield bounding box by border size to find the extents of geometry we need to build this tile.
 	//
@@ -982,59 +1159,104 @@ unsigned char* NavMeshType_Tile::buildTileMesh(const int tx, const int ty, const
 	// For example if you build a navmesh for terrain, and want the navmesh tiles to match the terrain tile size
 	// you will need to pass in data from neighbour terrain tiles too! In a simple case, just pass in all the 8 neighbours,
 	// or use the bounding box below to only pass in a sliver of each of the 8 neighbours.
-	rcVcopy(m_cfg.bmin, bmin);
-	rcVcopy(m_cfg.bmax, bmax);
-	m_cfg.bmin[0] -= m_cfg.borderSize*m_cfg.cs;
-	m_cfg.bmin[2] -= m_cfg.borderSize*m_cfg.cs;
-	m_cfg.bmax[0] += m_cfg.borderSize*m_cfg.cs;
-	m_cfg.bmax[2] += m_cfg.borderSize*m_cfg.cs;
+	rcVcopy(bd.cfg.bmin, bmin);
+	rcVcopy(bd.cfg.bmax, bmax);
+	bd.cfg.bmin[0] -= bd.cfg.borderSize*bd.cfg.cs;
+	bd.cfg.bmin[2] -= bd.cfg.borderSize*bd.cfg.cs;
+	bd.cfg.bmax[0] += bd.cfg.borderSize*bd.cfg.cs;
+	bd.cfg.bmax[2] += bd.cfg.borderSize*bd.cfg.cs;
+	
+	// Reuse the tile's data built from the same input, unless the
+	// intermediate results are wanted.
+	const bool useCache = m_buildCache && m_buildCache->isEnabled() &&
+			!keepInterResults;
+	unsigned long long inputHash = 0;
+	if (useCache)
+	{
+		TileInputHash hash;
+		hash.add('T');
+		hash.add(DT_NAVMESH_VERSION);
+		hash.add(tx);
+		hash.add(ty);
+		hash.add(bd.cfg);
+		hash.add(m_agentHeight);
+		hash.add(m_agentRadius);
+		hash.add(m_agentMaxClimb);
+		hash.add(m_partitionType);
+		hash.add(m_filterLowHangingObstacles);
+		hash.add(m_filterLedgeSpans);
+		hash.add(m_filterWalkableLowHeightSpans);
+		for (NavMeshPolyAreaFlags::const_iterator iter = m_flagsAreaTable.begin();
+				iter != m_flagsAreaTable.end(); ++iter)
+		{
+			hash.add(iter->first);
+			hash.add(iter->second);
+		}
+		hash.addGeometry(m_geom, bd.cfg.bmin, bd.cfg.bmax);
+		hash.addOffMeshConnections(m_geom, bd.cfg.bmin, bd.cfg.bmax);
+		inputHash = hash.getValue();
+		
+		unsigned char* data = 0;
+		int size = 0;
+		if (m_buildCache->load(inputHash, &data, &size, 1) == 1)
+		{
+			dataSize = size;
+			return data;
+		}
+	}
 	
 #ifdef RN_DEBUG
 	// Reset build times gathering.
-	m_ctx->resetTimers();
+	ctx->resetTimers();
 	
 	// Start the build process.
-	m_ctx->startTimer(RC_TIMER_TOTAL);
+	ctx->startTimer(RC_TIMER_TOTAL);
 	
-	CTXLOG(m_ctx,RC_LOG_PROGRESS, "Building navigation:");
-	CTXLOG2(m_ctx,RC_LOG_PROGRESS, " - %d x %d cells", m_cfg.width, m_cfg.height);
-	CTXLOG2(m_ctx,RC_LOG_PROGRESS, " - %.1fK verts, %.1fK tris", nverts/1000.0f, ntris/1000.0f);
+	CTXLOG(ctx,RC_LOG_PROGRESS, "Building navigation:");
+	CTXLOG2(ctx,RC_LOG_PROGRESS, " - %d x %d cells", bd.cfg.width, bd.cfg.height);
+	CTXLOG2(ctx,RC_LOG_PROGRESS, " - %.1fK verts, %.1fK tris", nverts/1000.0f, ntris/1000.0f);
 	
 #endif
 	// Allocate voxel heightfield where we rasterize our input data to.
-	m_solid = rcAllocHeightfield();
-	if (!m_solid)
+	bd.solid = rcAllocHeightfield();
+	if (!bd.solid)
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'solid'.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'solid'.");
 		return 0;
 	}
-	if (!rcCreateHeightfield(m_ctx, *m_solid, m_cfg.width, m_cfg.height, m_cfg.bmin, m_cfg.bmax, m_cfg.cs, m_cfg.ch))
+	if (!rcCreateHeightfield(ctx, *bd.solid, bd.cfg.width, bd.cfg.height, bd.cfg.bmin, bd.cfg.bmax, bd.cfg.cs, bd.cfg.ch))
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Could not create solid heightfield.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Could not create solid heightfield.");
 		return 0;
 	}
 	
 	// Allocate array that can hold triangle flags.
 	// If you have multiple meshes you need to process, allocate
 	// and array which can hold the max number of triangles you need to process.
-	m_triareas = new unsigned char[chunkyMesh->maxTrisPerChunk];
-	if (!m_triareas)
+	// (reused between builds)
+	if (bd.maxTriareas < chunkyMesh->maxTrisPerChunk)
 	{
-		CTXLOG1(m_ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'm_triareas' (%d).", chunkyMesh->maxTrisPerChunk);
+		delete [] bd.triareas;
+		bd.triareas = new unsigned char[chunkyMesh->maxTrisPerChunk];
+		bd.maxTriareas = chunkyMesh->maxTrisPerChunk;
+	}
+	if (!bd.triareas)
+	{
+		CTXLOG1(ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'm_triareas' (%d).", chunkyMesh->maxTrisPerChunk);
 		return 0;
 	}
 	
 	float tbmin[2], tbmax[2];
-	tbmin[0] = m_cfg.bmin[0];
-	tbmin[1] = m_cfg.bmin[2];
-	tbmax[0] = m_cfg.bmax[0];
-	tbmax[1] = m_cfg.bmax[2];
+	tbmin[0] = bd.cfg.bmin[0];
+	tbmin[1] = bd.cfg.bmin[2];
+	tbmax[0] = bd.cfg.bmax[0];
+	tbmax[1] = bd.cfg.bmax[2];
 	int cid[512];// TODO: Make grow when returning too many items.
 	const int ncid = rcGetChunksOverlappingRect(chunkyMesh, tbmin, tbmax, cid, 512);
 	if (!ncid)
 		return 0;
 	
-	m_tileTriCount = 0;
+	bd.triCount = 0;
 	
 	for (int i = 0; i < ncid; ++i)
 	{
@@ -1042,64 +1264,62 @@ unsigned char* NavMeshType_Tile::buildTileMesh(const int tx, const int ty, const
 		const int* ctris = &chunkyMesh->tris[node.i*3];
 		const int nctris = node.n;
 		
-		m_tileTriCount += nctris;
+		bd.triCount += nctris;
 		
-		memset(m_triareas, 0, nctris*sizeof(unsigned char));
-		rcMarkWalkableTriangles(m_ctx, m_cfg.walkableSlopeAngle,
-								verts, nverts, ctris, nctris, m_triareas);
+		memset(bd.triareas, 0, nctris*sizeof(unsigned char));
+		rcMarkWalkableTriangles(ctx, bd.cfg.walkableSlopeAngle,
+								verts, nverts, ctris, nctris, bd.triareas);
 		
-		if (!rcRasterizeTriangles(m_ctx, verts, nverts, ctris, m_triareas, nctris, *m_solid, m_cfg.walkableClimb))
+		if (!rcRasterizeTriangles(ctx, verts, nverts, ctris, bd.triareas, nctris, *bd.solid, bd.cfg.walkableClimb))
 			return 0;
 	}
 	
-	if (!m_keepInterResults)
-	{
-		delete [] m_triareas;
-		m_triareas = 0;
-	}
-	
 	// Once all geometry is rasterized, we do initial pass of filtering to
 	// remove unwanted overhangs caused by the conservative rasterization
 	// as well as filter spans where the character cannot possibly stand.
 	if (m_filterLowHangingObstacles)
-		rcFilterLowHangingWalkableObstacles(m_ctx, m_cfg.walkableClimb, *m_solid);
+		rcFilterLowHangingWalkableObstacles(ctx, bd.cfg.walkableClimb, *bd.solid);
 	if (m_filterLedgeSpans)
-		rcFilterLedgeSpans(m_ctx, m_cfg.walkableHeight, m_cfg.walkableClimb, *m_solid);
+		rcFilterLedgeSpans(ctx, bd.cfg.walkableHeight, bd.cfg.walkableClimb, *bd.solid);
 	if (m_filterWalkableLowHeightSpans)
-		rcFilterWalkableLowHeightSpans(m_ctx, m_cfg.walkableHeight, *m_solid);
+		rcFilterWalkableLowHeightSpans(ctx, bd.cfg.walkableHeight, *bd.solid);
 	
 	// Compact the heightfield so that it is faster to handle from now on.
 	// This will result more cache coherent data as well as the neighbours
 	// between walkable cells will be calculated.
-	m_chf = rcAllocCompactHeightfield();
-	if (!m_chf)
+	bd.chf = rcAllocCompactHeightfield();
+	if (!bd.chf)
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'chf'.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'chf'.");
 		return 0;
 	}
-	if (!rcBuildCompactHeightfield(m_ctx, m_cfg.walkableHeight, m_cfg.walkableClimb, *m_solid, *m_chf))
+	if (!rcBuildCompactHeightfield(ctx, bd.cfg.walkableHeight, bd.cfg.walkableClimb, *bd.solid, *bd.chf))
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Could not build compact data.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Could not build compact data.");
 		return 0;
 	}
 	
-	if (!m_keepInterResults)
+	if (!keepInterResults)
 	{
-		rcFreeHeightField(m_solid);
-		m_solid = 0;
+		rcFreeHeightField(bd.solid);
+		bd.solid = 0;
 	}
 
 	// Erode the walkable area by agent radius.
-	if (!rcErodeWalkableArea(m_ctx, m_cfg.walkableRadius, *m_chf))
+	if (!rcErodeWalkableArea(ctx, bd.cfg.walkableRadius, *bd.chf))
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Could not erode.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Could not erode.");
 		return 0;
 	}
 
 	// (Optional) Mark areas.
 	const ConvexVolume* vols = m_geom->getConvexVolumes();
-	for (int i  = 0; i < m_geom->getConvexVolumeCount(); ++i)
-		rcMarkConvexPolyArea(m_ctx, vols[i].verts, vols[i].nverts, vols[i].hmin, vols[i].hmax, (unsigned char)vols[i].area, *m_chf);
+	m_geom->queryConvexVolumes(bd.cfg.bmin, bd.cfg.bmax, bd.volumes);
+	for (int k = 0; k < (int)bd.volumes.size(); ++k)
+	{
+		const int i = bd.volumes[k];
+		rcMarkConvexPolyArea(ctx, vols[i].verts, vols[i].nverts, vols[i].hmin, vols[i].hmax, (unsigned char)vols[i].area, *bd.chf);
+	}
 	
 	
 	// Partition the heightfield so that we can use simple algorithm later to triangulate the walkable areas.
@@ -1131,16 +1351,16 @@ unsigned char* NavMeshType_Tile::buildTileMesh(const int tx, const int ty, const
 	if (m_partitionType == NAVMESH_PARTITION_WATERSHED)
 	{
 		// Prepare for region partitioning, by calculating distance field along the walkable surface.
-		if (!rcBuildDistanceField(m_ctx, *m_chf))
+		if (!rcBuildDistanceField(ctx, *bd.chf))
 		{
-			CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Could not build distance field.");
+			CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Could not build distance field.");
 			return 0;
 		}
 		
 		// Partition the walkable surface into simple regions without holes.
-		if (!rcBuildRegions(m_ctx, *m_chf, m_cfg.borderSize, m_cfg.minRegionArea, m_cfg.mergeRegionArea))
+		if (!rcBuildRegions(ctx, *bd.chf, bd.cfg.borderSize, bd.cfg.minRegionArea, bd.cfg.mergeRegionArea))
 		{
-			CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Could not build watershed regions.");
+			CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Could not build watershed regions.");
 			return 0;
 		}
 	}
@@ -1148,170 +1368,182 @@ unsigned char* NavMeshType_Tile::buildTileMesh(const int tx, const int ty, const
 	{
 		// Partition the walkable surface into simple regions without holes.
 		// Monotone partitioning does not need distancefield.
-		if (!rcBuildRegionsMonotone(m_ctx, *m_chf, m_cfg.borderSize, m_cfg.minRegionArea, m_cfg.mergeRegionArea))
+		if (!rcBuildRegionsMonotone(ctx, *bd.chf, bd.cfg.borderSize, bd.cfg.minRegionArea, bd.cfg.mergeRegionArea))
 		{
-			CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Could not build monotone regions.");
+			CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Could not build monotone regions.");
 			return 0;
 		}
 	}
 	else // SAMPLE_PARTITION_LAYERS
 	{
 		// Partition the walkable surface into simple regions without holes.
-		if (!rcBuildLayerRegions(m_ctx, *m_chf, m_cfg.borderSize, m_cfg.minRegionArea))
+		if (!rcBuildLayerRegions(ctx, *bd.chf, bd.cfg.borderSize, bd.cfg.minRegionArea))
 		{
-			CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Could not build layer regions.");
+			CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Could not build layer regions.");
 			return 0;
 		}
 	}
 	 	
 	// Create contours.
-	m_cset = rcAllocContourSet();
-	if (!m_cset)
+	bd.cset = rcAllocContourSet();
+	if (!bd.cset)
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'cset'.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'cset'.");
 		return 0;
 	}
-	if (!rcBuildContours(m_ctx, *m_chf, m_cfg.maxSimplificationError, m_cfg.maxEdgeLen, *m_cset))
+	if (!rcBuildContours(ctx, *bd.chf, bd.cfg.maxSimplificationError, bd.cfg.maxEdgeLen, *bd.cset))
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Could not create contours.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Could not create contours.");
 		return 0;
 	}
 	
-	if (m_cset->nconts == 0)
+	if (bd.cset->nconts == 0)
 	{
 		return 0;
 	}
 	
 	// Build polygon navmesh from the contours.
-	m_pmesh = rcAllocPolyMesh();
-	if (!m_pmesh)
+	bd.pmesh = rcAllocPolyMesh();
+	if (!bd.pmesh)
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'pmesh'.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'pmesh'.");
 		return 0;
 	}
-	if (!rcBuildPolyMesh(m_ctx, *m_cset, m_cfg.maxVertsPerPoly, *m_pmesh))
+	if (!rcBuildPolyMesh(ctx, *bd.cset, bd.cfg.maxVertsPerPoly, *bd.pmesh))
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, 				"buildNavigation: Could not triangulate contours.");
+		CTXLOG(ctx, RC_LOG_ERROR, 				"buildNavigation: Could not triangulate contours.");
 		return 0;
 	}
 	
 	// Build detail mesh.
-	m_dmesh = rcAllocPolyMeshDetail();
-	if (!m_dmesh)
+	bd.dmesh = rcAllocPolyMeshDetail();
+	if (!bd.dmesh)
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'dmesh'.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Out of memory 'dmesh'.");
 		return 0;
 	}
 	
-	if (!rcBuildPolyMeshDetail(m_ctx, *m_pmesh, *m_chf,
-							   m_cfg.detailSampleDist, m_cfg.detailSampleMaxError,
-							   *m_dmesh))
+	if (!rcBuildPolyMeshDetail(ctx, *bd.pmesh, *bd.chf,
+							   bd.cfg.detailSampleDist, bd.cfg.detailSampleMaxError,
+							   *bd.dmesh))
 	{
-		CTXLOG(m_ctx, RC_LOG_ERROR, "buildNavigation: Could build polymesh detail.");
+		CTXLOG(ctx, RC_LOG_ERROR, "buildNavigation: Could build polymesh detail.");
 		return 0;
 	}
 	
-	if (!m_keepInterResults)
+	if (!keepInterResults)
 	{
-		rcFreeCompactHeightfield(m_chf);
-		m_chf = 0;
-		rcFreeContourSet(m_cset);
-		m_cset = 0;
+		rcFreeCompactHeightfield(bd.chf);
+		bd.chf = 0;
+		rcFreeContourSet(bd.cset);
+		bd.cset = 0;
 	}
 	
 	unsigned char* navData = 0;
 	int navDataSize = 0;
-	if (m_cfg.maxVertsPerPoly <= DT_VERTS_PER_POLYGON)
+	if (bd.cfg.maxVertsPerPoly <= DT_VERTS_PER_POLYGON)
 	{
-		if (m_pmesh->nverts >= 0xffff)
+		if (bd.pmesh->nverts >= 0xffff)
 		{
 			// The vertex indices are ushorts, and cannot point to more than 0xffff vertices.
-			CTXLOG2(m_ctx, RC_LOG_ERROR, "Too many vertices per tile %d (max: %d).", m_pmesh->nverts, 0xffff);
+			CTXLOG2(ctx, RC_LOG_ERROR, "Too many vertices per tile %d (max: %d).", bd.pmesh->nverts, 0xffff);
 			return 0;
 		}
 		
 		// Update poly flags from areas.
-		for (int i = 0; i < m_pmesh->npolys; ++i)
+		for (int i = 0; i < bd.pmesh->npolys; ++i)
 		{
-			if (m_pmesh->areas[i] == RC_WALKABLE_AREA)
-				m_pmesh->areas[i] = NAVMESH_POLYAREA_GROUND;
+			if (bd.pmesh->areas[i] == RC_WALKABLE_AREA)
+				bd.pmesh->areas[i] = NAVMESH_POLYAREA_GROUND;
 			
 			//set polyFlags for polyAreas only if m_flagsAreaTable not empty
 			if (! m_flagsAreaTable.empty())
 			{ 
 				// get flags from a table indexed by areas
-				m_pmesh->flags[i] = m_flagsAreaTable[m_pmesh->areas[i]];
+				// (find() doesn't modify the table, which is shared by threads)
+				NavMeshPolyAreaFlags::const_iterator iter =
+						m_flagsAreaTable.find(bd.pmesh->areas[i]);
+				bd.pmesh->flags[i] = (iter != m_flagsAreaTable.end() ?
+						iter->second : 0);
 			} 
 			else
 			{ 
-				if (m_pmesh->areas[i] == NAVMESH_POLYAREA_GROUND ||
-					m_pmesh->areas[i] == NAVMESH_POLYAREA_GRASS ||
-					m_pmesh->areas[i] == NAVMESH_POLYAREA_ROAD)
+				if (bd.pmesh->areas[i] == NAVMESH_POLYAREA_GROUND ||
+					bd.pmesh->areas[i] == NAVMESH_POLYAREA_GRASS ||
+					bd.pmesh->areas[i] == NAVMESH_POLYAREA_ROAD)
 				{
-					m_pmesh->flags[i] = NAVMESH_POLYFLAGS_WALK;
+					bd.pmesh->flags[i] = NAVMESH_POLYFLAGS_WALK;
 				}
-				else if (m_pmesh->areas[i] == NAVMESH_POLYAREA_WATER)
+				else if (bd.pmesh->areas[i] == NAVMESH_POLYAREA_WATER)
 				{
-					m_pmesh->flags[i] = NAVMESH_POLYFLAGS_SWIM;
+					bd.pmesh->flags[i] = NAVMESH_POLYFLAGS_SWIM;
 				}
-				else if (m_pmesh->areas[i] == NAVMESH_POLYAREA_DOOR)
+				else if (bd.pmesh->areas[i] == NAVMESH_POLYAREA_DOOR)
 				{
-					m_pmesh->flags[i] = NAVMESH_POLYFLAGS_WALK | NAVMESH_POLYFLAGS_DOOR;
+					bd.pmesh->flags[i] = NAVMESH_POLYFLAGS_WALK | NAVMESH_POLYFLAGS_DOOR;
 				}
 			} 
 		}
 		
 		dtNavMeshCreateParams params;
 		memset(&params, 0, sizeof(params));
-		params.verts = m_pmesh->verts;
-		params.vertCount = m_pmesh->nverts;
-		params.polys = m_pmesh->polys;
-		params.polyAreas = m_pmesh->areas;
-		params.polyFlags = m_pmesh->flags;
-		params.polyCount = m_pmesh->npolys;
-		params.nvp = m_pmesh->nvp;
-		params.detailMeshes = m_dmesh->meshes;
-		params.detailVerts = m_dmesh->verts;
-		params.detailVertsCount = m_dmesh->nverts;
-		params.detailTris = m_dmesh->tris;
-		params.detailTriCount = m_dmesh->ntris;
-		params.offMeshConVerts = m_geom->getOffMeshConnectionVerts();
-		params.offMeshConRad = m_geom->getOffMeshConnectionRads();
-		params.offMeshConDir = m_geom->getOffMeshConnectionDirs();
-		params.offMeshConAreas = m_geom->getOffMeshConnectionAreas();
-		params.offMeshConFlags = m_geom->getOffMeshConnectionFlags();
-		params.offMeshConUserID = m_geom->getOffMeshConnectionId();
-		params.offMeshConCount = m_geom->getOffMeshConnectionCount();
+		params.verts = bd.pmesh->verts;
+		params.vertCount = bd.pmesh->nverts;
+		params.polys = bd.pmesh->polys;
+		params.polyAreas = bd.pmesh->areas;
+		params.polyFlags = bd.pmesh->flags;
+		params.polyCount = bd.pmesh->npolys;
+		params.nvp = bd.pmesh->nvp;
+		params.detailMeshes = bd.dmesh->meshes;
+		params.detailVerts = bd.dmesh->verts;
+		params.detailVertsCount = bd.dmesh->nverts;
+		params.detailTris = bd.dmesh->tris;
+		params.detailTriCount = bd.dmesh->ntris;
+		// Only the off-mesh connections which can be linked to this tile.
+		OffMeshConnectionSet& cons = bd.offMeshCons;
+		m_geom->getOffMeshConnections(bd.pmesh->bmin, bd.pmesh->bmax, cons);
+		if (cons.count)
+		{
+			params.offMeshConVerts = &cons.verts[0];
+			params.offMeshConRad = &cons.rads[0];
+			params.offMeshConDir = &cons.dirs[0];
+			params.offMeshConAreas = &cons.areas[0];
+			params.offMeshConFlags = &cons.flags[0];
+			params.offMeshConUserID = &cons.ids[0];
+		}
+		params.offMeshConCount = cons.count;
 		params.walkableHeight = m_agentHeight;
 		params.walkableRadius = m_agentRadius;
 		params.walkableClimb = m_agentMaxClimb;
 		params.tileX = tx;
 		params.tileY = ty;
 		params.tileLayer = 0;
-		rcVcopy(params.bmin, m_pmesh->bmin);
-		rcVcopy(params.bmax, m_pmesh->bmax);
-		params.cs = m_cfg.cs;
-		params.ch = m_cfg.ch;
+		rcVcopy(params.bmin, bd.pmesh->bmin);
+		rcVcopy(params.bmax, bd.pmesh->bmax);
+		params.cs = bd.cfg.cs;
+		params.ch = bd.cfg.ch;
 		params.buildBvTree = true;
 		
 		if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
 		{
-			CTXLOG(m_ctx, RC_LOG_ERROR, "Could not build Detour navmesh.");
+			CTXLOG(ctx, RC_LOG_ERROR, "Could not build Detour navmesh.");
 			return 0;
 		}		
 	}
-	m_tileMemUsage = navDataSize/1024.0f;
-	
 #ifdef RN_DEBUG
-	m_ctx->stopTimer(RC_TIMER_TOTAL);
+	ctx->stopTimer(RC_TIMER_TOTAL);
 	
 	// Show performance stats.
-	duLogBuildTimes(*m_ctx, m_ctx->getAccumulatedTime(RC_TIMER_TOTAL));
-	CTXLOG2(m_ctx, RC_LOG_PROGRESS, ">> Polymesh: %d vertices  %d polygons", m_pmesh->nverts, m_pmesh->npolys);
-	
-	m_tileBuildTime = m_ctx->getAccumulatedTime(RC_TIMER_TOTAL)/1000.0f;
+	duLogBuildTimes(*ctx, ctx->getAccumulatedTime(RC_TIMER_TOTAL));
+	CTXLOG2(ctx, RC_LOG_PROGRESS, ">> Polymesh: %d vertices  %d polygons", bd.pmesh->nverts, bd.pmesh->npolys);
 #endif
 
+	if (useCache && navData)
+	{
+		const unsigned char* datas[1] = { navData };
+		m_buildCache->store(inputHash, datas, &navDataSize, 1);
+	}
+	
 	dataSize = navDataSize;
 	return navData;
 }
@@ -1324,6 +1556,17 @@ void NavMeshType_Tile::setTileSettings(const NavMeshTileSettings& settings)
 	m_tileSize = settings.m_tileSize;
 }
 
+unsigned long long NavMeshType_Tile::getSettingsHash() const
+{
+	TileInputHash hash;
+	hash.add(NavMeshType::getSettingsHash());
+	hash.add(m_buildAll);
+	hash.add(m_maxTiles);
+	hash.add(m_maxPolysPerTile);
+	hash.add(m_tileSize);
+	return hash.getValue();
+}
+
 NavMeshTileSettings NavMeshType_Tile::getTileSettings()
 {
 	NavMeshTileSettings settings;
@@ -1331,6 +1574,8 @@ NavMeshTileSettings NavMeshType_Tile::getTileSettings()
 	settings.m_maxTiles = m_maxTiles;
 	settings.m_maxPolysPerTile = m_maxPolysPerTile;
 	settings.m_tileSize = m_tileSize;
+	//there is no tile cache here: report the default compressor
+	settings.m_compressorType = NAVMESH_TILE_COMPRESSOR_FAST;
 	return settings;
 }
 
@@ -29,10 +29,54 @@
 #include "NavMeshType.h"
 #include <DetourNavMesh.h>
 #include <Recast.h>
+#include "InputGeom.h"
+#include <vector>
 
 namespace rnsup
 {
 
+/// The tile set file format (see NavMeshType_Tile::saveAll()): a header
+/// followed by each tile's header and data.
+static const int NAVMESHSET_MAGIC = 'M'<<24 | 'S'<<16 | 'E'<<8 | 'T'; //'MSET';
+static const int NAVMESHSET_VERSION = 1;
+
+struct NavMeshSetHeader
+{
+	int magic;
+	int version;
+	int numTiles;
+	dtNavMeshParams params;
+};
+
+struct NavMeshTileHeader
+{
+	dtTileRef tileRef;
+	int dataSize;
+};
+
+/// Scratch data and intermediate results of a tile build: each thread
+/// building tiles owns one.
+struct TileBuildData
+{
+	rcConfig cfg;
+	unsigned char* triareas;
+	int maxTriareas;
+	rcHeightfield* solid;
+	rcCompactHeightfield* chf;
+	rcContourSet* cset;
+	rcPolyMesh* pmesh;
+	rcPolyMeshDetail* dmesh;
+	int triCount;
+	/// The convex volumes and off-mesh connections touching the tile.
+	std::vector<int> volumes;
+	OffMeshConnectionSet offMeshCons;
+
+	TileBuildData();
+	/// Frees the intermediate results only, keeping the scratch buffers.
+	void freeResults();
+	void freeAll();
+};
+
 class NavMeshType_Tile: public NavMeshType
 {
 protected:
@@ -85,10 +129,12 @@ protected:
 	int m_tileTriCount;
 
 	unsigned char* buildTileMesh(const int tx, const int ty, const float* bmin, const float* bmax, int& dataSize);
+	unsigned char* buildTileMesh(BuildContext* ctx, TileBuildData& bd,
+			const int tx, const int ty, const float* bmin, const float* bmax,
+			int& dataSize, const bool keepInterResults);
 	
 	void cleanup();
 	
-	void saveAll(const char* path, const dtNavMesh* mesh);
 	dtNavMesh* loadAll(const char* path);
 	
 public:
@@ -103,15 +149,20 @@ public:
 	virtual void handleMeshChanged(class InputGeom* geom);
 	virtual bool handleBuild();
 	virtual void collectSettings(struct BuildSettings& settings);
+	virtual int rebuildTiles(const float* bmin, const float* bmax, int* tiles,
+			const int maxTiles);
 	
 	void setTileSettings(const NavMeshTileSettings& settings);
 	NavMeshTileSettings getTileSettings();
+	virtual unsigned long long getSettingsHash() const;
 	void getTilePos(const float* pos, int& tx, int& ty);
 	
 	void buildTile(const float* pos);
+	void buildTileAt(const int tx, const int ty);
 	void removeTile(const float* pos);
 	void buildAllTiles();
 	void removeAllTiles();
+	bool saveAll(const char* path, const dtNavMesh* mesh);
 
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
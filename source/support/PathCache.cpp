@@ -0,0 +1,185 @@
+/**
+ * \file PathCache.cpp
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#include "PathCache.h"
+#include <algorithm>
+#include <string.h>
+
+namespace rnsup
+{
+
+bool PathCache::Key::operator<(const Key& other) const
+{
+	if (startRef != other.startRef)
+		return startRef < other.startRef;
+	if (endRef != other.endRef)
+		return endRef < other.endRef;
+	if (includeFlags != other.includeFlags)
+		return includeFlags < other.includeFlags;
+	if (excludeFlags != other.excludeFlags)
+		return excludeFlags < other.excludeFlags;
+	return costVersion < other.costVersion;
+}
+
+PathCache::PathCache(int capacity) :
+		m_capacity(capacity > 0 ? capacity : 0), m_costVersion(0),
+		m_hits(0), m_misses(0)
+{
+}
+
+void PathCache::setCapacity(int capacity)
+{
+	m_capacity = capacity > 0 ? capacity : 0;
+	while ((int) m_index.size() > m_capacity)
+	{
+		erase(--m_entries.end());
+	}
+}
+
+bool PathCache::find(const dtNavMesh* navMesh, dtPolyRef startRef,
+		dtPolyRef endRef, const dtQueryFilter* filter, dtPolyRef* path,
+		int* pathCount, const int maxPath)
+{
+	if (!m_capacity)
+		return false;
+
+	std::map<Key, EntryList::iterator>::iterator iter =
+			m_index.find(makeKey(startRef, endRef, filter));
+	if ((iter == m_index.end()) || ((int) iter->second->path.size() > maxPath))
+	{
+		++m_misses;
+		return false;
+	}
+	EntryList::iterator entry = iter->second;
+	// a rebuilt tile changes the salt of its polygons' refs
+	for (int i = 0; i < (int) entry->path.size(); ++i)
+	{
+		if (!navMesh->isValidPolyRef(entry->path[i]))
+		{
+			erase(entry);
+			++m_misses;
+			return false;
+		}
+	}
+	// move to front
+	m_entries.splice(m_entries.begin(), m_entries, entry);
+	*pathCount = (int) entry->path.size();
+	memcpy(path, &entry->path[0], sizeof(dtPolyRef) * (*pathCount));
+	++m_hits;
+	return true;
+}
+
+void PathCache::store(const dtNavMesh* navMesh, dtPolyRef startRef,
+		dtPolyRef endRef, const dtQueryFilter* filter, const dtPolyRef* path,
+		const int pathCount)
+{
+	if (!m_capacity || (pathCount <= 0) || (path[pathCount - 1] != endRef))
+		return;
+
+	Key key = makeKey(startRef, endRef, filter);
+	std::map<Key, EntryList::iterator>::iterator iter = m_index.find(key);
+	if (iter != m_index.end())
+	{
+		erase(iter->second);
+	}
+	else if ((int) m_index.size() >= m_capacity)
+	{
+		// evict least recently used
+		erase(--m_entries.end());
+	}
+
+	m_entries.push_front(Entry());
+	Entry& entry = m_entries.front();
+	entry.key = key;
+	entry.path.assign(path, path + pathCount);
+	for (int i = 0; i < pathCount; ++i)
+	{
+		const dtMeshTile* tile = 0;
+		const dtPoly* poly = 0;
+		navMesh->getTileAndPolyByRefUnsafe(path[i], &tile, &poly);
+		const int tx = tile->header->x, ty = tile->header->y;
+		bool found = false;
+		for (int j = 0; j < (int) entry.tiles.size(); j += 2)
+		{
+			if ((entry.tiles[j] == tx) && (entry.tiles[j + 1] == ty))
+			{
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+		{
+			entry.tiles.push_back(tx);
+			entry.tiles.push_back(ty);
+		}
+	}
+	m_index[key] = m_entries.begin();
+}
+
+void PathCache::invalidateTile(int tx, int ty)
+{
+	EntryList::iterator iter = m_entries.begin();
+	while (iter != m_entries.end())
+	{
+		EntryList::iterator current = iter++;
+		for (int j = 0; j < (int) current->tiles.size(); j += 2)
+		{
+			if ((current->tiles[j] == tx) && (current->tiles[j + 1] == ty))
+			{
+				erase(current);
+				break;
+			}
+		}
+	}
+}
+
+void PathCache::clear()
+{
+	m_entries.clear();
+	m_index.clear();
+	m_hits = m_misses = 0;
+}
+
+PathCache::Key PathCache::makeKey(dtPolyRef startRef, dtPolyRef endRef,
+		const dtQueryFilter* filter) const
+{
+	Key key;
+	key.startRef = startRef;
+	key.endRef = endRef;
+	key.includeFlags = filter->getIncludeFlags();
+	key.excludeFlags = filter->getExcludeFlags();
+	key.costVersion = m_costVersion;
+	return key;
+}
+
+void PathCache::erase(EntryList::iterator iter)
+{
+	m_index.erase(iter->key);
+	m_entries.erase(iter);
+}
+
+dtStatus findPathCached(PathCache* cache, const dtNavMeshQuery* navQuery,
+		dtPolyRef startRef, dtPolyRef endRef, const float* startPos,
+		const float* endPos, const dtQueryFilter* filter, dtPolyRef* path,
+		int* pathCount, const int maxPath, bool* cached)
+{
+	const bool hit = cache && cache->find(navQuery->getAttachedNavMesh(),
+			startRef, endRef, filter, path, pathCount, maxPath);
+	if (cached)
+		*cached = hit;
+	if (hit)
+		return DT_SUCCESS;
+
+	dtStatus status = navQuery->findPath(startRef, endRef, startPos, endPos,
+			filter, path, pathCount, maxPath);
+	if (cache && dtStatusSucceed(status) && !dtStatusDetail(status, DT_PARTIAL_RESULT))
+		cache->store(navQuery->getAttachedNavMesh(), startRef, endRef, filter,
+				path, *pathCount);
+	return status;
+}
+
+} // namespace rnsup
@@ -0,0 +1,108 @@
+/**
+ * \file PathCache.h
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#ifndef PATHCACHE_H
+#define PATHCACHE_H
+
+#include <DetourNavMesh.h>
+#include <DetourNavMeshQuery.h>
+#include <list>
+#include <map>
+#include <vector>
+
+namespace rnsup
+{
+
+/**
+ * A LRU cache of polygon corridors (i.e. findPath() results).
+ *
+ * Entries are keyed on start polygon, end polygon, filter's include/exclude
+ * flags and the current "cost version", which should be bumped (see
+ * invalidateCosts()) whenever the filter's area costs change.\n
+ * An entry is dropped when a tile it crosses is rebuilt (see
+ * invalidateTile()), or when any of its polygons is found no longer valid on
+ * lookup. Only complete (i.e. non partial) paths are stored.
+ * \note A capacity of 0 disables the cache.
+ */
+class PathCache
+{
+	struct Key
+	{
+		dtPolyRef startRef, endRef;
+		unsigned short includeFlags, excludeFlags;
+		unsigned int costVersion;
+		bool operator<(const Key& other) const;
+	};
+	struct Entry
+	{
+		Key key;
+		std::vector<dtPolyRef> path;
+		///Crossed tiles: (x,y) pairs.
+		std::vector<int> tiles;
+	};
+	typedef std::list<Entry> EntryList;
+
+	int m_capacity;
+	unsigned int m_costVersion;
+	///Most recently used first.
+	EntryList m_entries;
+	std::map<Key, EntryList::iterator> m_index;
+	int m_hits, m_misses;
+
+public:
+	PathCache(int capacity = 0);
+
+	void setCapacity(int capacity);
+	int getCapacity() const
+	{
+		return m_capacity;
+	}
+	int getNumEntries() const
+	{
+		return (int) m_index.size();
+	}
+	int getHits() const
+	{
+		return m_hits;
+	}
+	int getMisses() const
+	{
+		return m_misses;
+	}
+
+	///Copies the cached path (if any) into path and returns true.
+	bool find(const dtNavMesh* navMesh, dtPolyRef startRef, dtPolyRef endRef,
+			const dtQueryFilter* filter, dtPolyRef* path, int* pathCount,
+			const int maxPath);
+	void store(const dtNavMesh* navMesh, dtPolyRef startRef, dtPolyRef endRef,
+			const dtQueryFilter* filter, const dtPolyRef* path,
+			const int pathCount);
+
+	void invalidateTile(int tx, int ty);
+	void invalidateCosts()
+	{
+		++m_costVersion;
+	}
+	void clear();
+
+private:
+	Key makeKey(dtPolyRef startRef, dtPolyRef endRef,
+			const dtQueryFilter* filter) const;
+	void erase(EntryList::iterator iter);
+};
+
+///Finds a path through the cache (if any). cached (if not NULL) tells if the
+///path was found in the cache, i.e. findPath() didn't run and navQuery's node
+///pool doesn't hold its nodes.
+dtStatus findPathCached(PathCache* cache, const dtNavMeshQuery* navQuery,
+		dtPolyRef startRef, dtPolyRef endRef, const float* startPos,
+		const float* endPos, const dtQueryFilter* filter, dtPolyRef* path,
+		int* pathCount, const int maxPath, bool* cached = 0);
+
+} // namespace rnsup
+
+#endif // PATHCACHE_H
@@ -0,0 +1,185 @@
+/**
+ * \file PathRequestQueue.cpp
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#include "PathRequestQueue.h"
+#include <DetourCommon.h>
+#include <algorithm>
+
+namespace rnsup
+{
+
+PathRequestQueue::PathRequestQueue() :
+		m_navMesh(0), m_navQuery(0), m_filter(0), m_nextRef(0)
+{
+	m_polyPickExt[0] = 2;
+	m_polyPickExt[1] = 4;
+	m_polyPickExt[2] = 2;
+}
+
+PathRequestQueue::~PathRequestQueue()
+{
+	dtFreeNavMeshQuery(m_navQuery);
+}
+
+bool PathRequestQueue::init(const dtNavMesh* navMesh, const dtQueryFilter* filter, const int maxNodes)
+{
+	clear();
+	m_navMesh = 0;
+	if (!navMesh || !filter)
+		return false;
+
+	if (!m_navQuery)
+	{
+		m_navQuery = dtAllocNavMeshQuery();
+		if (!m_navQuery)
+			return false;
+	}
+	if (dtStatusFailed(m_navQuery->init(navMesh, maxNodes)))
+		return false;
+
+	m_filter = filter;
+	m_navMesh = navMesh;
+	return true;
+}
+
+unsigned int PathRequestQueue::request(const float* spos, const float* epos, const int options)
+{
+	if (!m_navMesh)
+		return 0;
+
+	// skip 0 (the invalid ref) on wrap around
+	if (++m_nextRef == 0)
+		++m_nextRef;
+	Request& req = m_requests[m_nextRef];
+	dtVcopy(req.spos, spos);
+	dtVcopy(req.epos, epos);
+	req.options = options;
+	req.started = false;
+	req.status = REQUEST_PENDING;
+	m_queue.push_back(m_nextRef);
+	return m_nextRef;
+}
+
+void PathRequestQueue::update(const int maxIter, std::vector<unsigned int>* completed)
+{
+	int iterLeft = maxIter;
+	while (!m_queue.empty() && (iterLeft > 0))
+	{
+		unsigned int ref = m_queue.front();
+		Request& req = m_requests[ref];
+		if (!req.started && !startRequest(req))
+		{
+			req.status = REQUEST_FAILED;
+		}
+		else
+		{
+			int doneIters = 0;
+			dtStatus status = m_navQuery->updateSlicedFindPath(iterLeft, &doneIters);
+			iterLeft -= doneIters;
+			if (dtStatusFailed(status))
+			{
+				req.status = REQUEST_FAILED;
+			}
+			else if (dtStatusSucceed(status))
+			{
+				finalizeRequest(req);
+			}
+			else
+			{
+				// still in progress: budget exhausted
+				break;
+			}
+		}
+		// request completed
+		m_queue.pop_front();
+		if (completed)
+			completed->push_back(ref);
+	}
+}
+
+PathRequestQueue::RequestStatus PathRequestQueue::getRequestStatus(unsigned int ref) const
+{
+	std::map<unsigned int, Request>::const_iterator iter = m_requests.find(ref);
+	if (iter == m_requests.end())
+		return REQUEST_INVALID;
+	return iter->second.status;
+}
+
+int PathRequestQueue::getRequestResult(unsigned int ref, const float** straightPath,
+		const unsigned char** straightPathFlags) const
+{
+	std::map<unsigned int, Request>::const_iterator iter = m_requests.find(ref);
+	if ((iter == m_requests.end()) || (iter->second.status != REQUEST_SUCCEEDED))
+		return 0;
+
+	const Request& req = iter->second;
+	const int npoints = (int) req.straightPathFlags.size();
+	if (straightPath)
+		*straightPath = npoints ? &req.straightPath[0] : 0;
+	if (straightPathFlags)
+		*straightPathFlags = npoints ? &req.straightPathFlags[0] : 0;
+	return npoints;
+}
+
+bool PathRequestQueue::removeRequest(unsigned int ref)
+{
+	if (m_requests.erase(ref) == 0)
+		return false;
+	// a started request being removed is simply abandoned
+	std::deque<unsigned int>::iterator iter = std::find(m_queue.begin(), m_queue.end(), ref);
+	if (iter != m_queue.end())
+		m_queue.erase(iter);
+	return true;
+}
+
+void PathRequestQueue::clear()
+{
+	m_requests.clear();
+	m_queue.clear();
+}
+
+bool PathRequestQueue::startRequest(Request& req)
+{
+	req.started = true;
+
+	dtPolyRef startRef = 0;
+	req.endRef = 0;
+	m_navQuery->findNearestPoly(req.spos, m_polyPickExt, m_filter, &startRef, 0);
+	m_navQuery->findNearestPoly(req.epos, m_polyPickExt, m_filter, &req.endRef, 0);
+	if (!startRef || !req.endRef)
+		return false;
+
+	return !dtStatusFailed(m_navQuery->initSlicedFindPath(startRef, req.endRef,
+			req.spos, req.epos, m_filter));
+}
+
+void PathRequestQueue::finalizeRequest(Request& req)
+{
+	int npolys = 0;
+	m_navQuery->finalizeSlicedFindPath(m_polys, &npolys, MAX_POLYS);
+	if (!npolys)
+	{
+		req.status = REQUEST_FAILED;
+		return;
+	}
+
+	// In case of partial path, make sure the end point is clamped to the last polygon.
+	float epos[3];
+	dtVcopy(epos, req.epos);
+	if (m_polys[npolys-1] != req.endRef)
+		m_navQuery->closestPointOnPoly(m_polys[npolys-1], req.epos, epos, 0);
+
+	int nstraightPath = 0;
+	m_navQuery->findStraightPath(req.spos, epos, m_polys, npolys,
+								 m_straightPath, m_straightPathFlags,
+								 m_straightPathPolys, &nstraightPath, MAX_POLYS, req.options);
+	req.straightPath.assign(m_straightPath, m_straightPath + nstraightPath * 3);
+	req.straightPathFlags.assign(m_straightPathFlags, m_straightPathFlags + nstraightPath);
+	req.status = REQUEST_SUCCEEDED;
+}
+
+} // namespace rnsup
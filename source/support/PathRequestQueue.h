@@ -0,0 +1,101 @@
+/**
+ * \file PathRequestQueue.h
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#ifndef PATHREQUESTQUEUE_H
+#define PATHREQUESTQUEUE_H
+
+#include <DetourNavMesh.h>
+#include <DetourNavMeshQuery.h>
+#include <map>
+#include <deque>
+#include <vector>
+
+namespace rnsup
+{
+
+/**
+ * A queue of asynchronous straight path requests.
+ *
+ * Requests are served in order of arrival by a private dtNavMeshQuery, using
+ * the Detour's sliced path finding: each update() call performs at most the
+ * given number of A* iterations, so that long queries can be spread over
+ * several frames.\n
+ * A completed request keeps its result until it is removed.
+ */
+class PathRequestQueue
+{
+public:
+	static const int MAX_POLYS = 256;
+
+	enum RequestStatus
+	{
+		REQUEST_INVALID = 0,
+		REQUEST_PENDING,
+		REQUEST_SUCCEEDED,
+		REQUEST_FAILED
+	};
+
+private:
+	struct Request
+	{
+		float spos[3], epos[3];
+		int options;
+		bool started;
+		dtPolyRef endRef;
+		RequestStatus status;
+		std::vector<float> straightPath;
+		std::vector<unsigned char> straightPathFlags;
+	};
+
+	const dtNavMesh* m_navMesh;
+	dtNavMeshQuery* m_navQuery;
+	const dtQueryFilter* m_filter;
+
+	float m_polyPickExt[3];
+	dtPolyRef m_polys[MAX_POLYS];
+	float m_straightPath[MAX_POLYS*3];
+	unsigned char m_straightPathFlags[MAX_POLYS];
+	dtPolyRef m_straightPathPolys[MAX_POLYS];
+
+	std::map<unsigned int, Request> m_requests;
+	std::deque<unsigned int> m_queue;
+	unsigned int m_nextRef;
+
+public:
+	PathRequestQueue();
+	~PathRequestQueue();
+
+	bool init(const dtNavMesh* navMesh, const dtQueryFilter* filter, const int maxNodes = 2048);
+
+	///Returns the request's ref, 0 on error.
+	unsigned int request(const float* spos, const float* epos, const int options = 0);
+	///Advances the pending requests by at most maxIter A* iterations in
+	///total: the refs of the completed ones are appended to completed (if any).
+	void update(const int maxIter, std::vector<unsigned int>* completed = 0);
+	RequestStatus getRequestStatus(unsigned int ref) const;
+	///Returns the number of points of a completed request's straight path.
+	int getRequestResult(unsigned int ref, const float** straightPath,
+			const unsigned char** straightPathFlags) const;
+	bool removeRequest(unsigned int ref);
+	int getNumPendingRequests() const
+	{
+		return (int) m_queue.size();
+	}
+	void clear();
+
+private:
+	bool startRequest(Request& req);
+	void finalizeRequest(Request& req);
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	PathRequestQueue(const PathRequestQueue&);
+	PathRequestQueue& operator=(const PathRequestQueue&);
+};
+
+} // namespace rnsup
+
+#endif // PATHREQUESTQUEUE_H
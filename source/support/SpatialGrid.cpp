@@ -0,0 +1,153 @@
+/**
+ * \file SpatialGrid.cpp
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#include "SpatialGrid.h"
+#include <algorithm>
+#include <math.h>
+
+namespace rnsup
+{
+
+SpatialGrid::SpatialGrid() :
+		m_cellSize(1.0f), m_width(1), m_height(1)
+{
+	m_bmin[0] = m_bmin[1] = 0.0f;
+	m_cells.resize(1);
+}
+
+void SpatialGrid::init(const float* bmin, const float* bmax, float cellSize)
+{
+	m_cellSize = cellSize > 0.0f ? cellSize : 1.0f;
+	m_bmin[0] = bmin[0];
+	m_bmin[1] = bmin[2];
+	m_width = std::max((int) ceilf((bmax[0] - bmin[0]) / m_cellSize), 1);
+	m_height = std::max((int) ceilf((bmax[2] - bmin[2]) / m_cellSize), 1);
+	m_cells.assign(m_width * m_height, std::vector<int>());
+	// re-index the current items
+	for (int id = 0; id < (int) m_itemValid.size(); ++id)
+	{
+		if (m_itemValid[id])
+			link(id);
+	}
+}
+
+void SpatialGrid::clear()
+{
+	for (int i = 0; i < (int) m_cells.size(); ++i)
+		m_cells[i].clear();
+	m_itemBounds.clear();
+	m_itemValid.clear();
+}
+
+void SpatialGrid::insert(int id, const float* bmin, const float* bmax)
+{
+	if (id >= (int) m_itemValid.size())
+	{
+		m_itemValid.resize(id + 1, 0);
+		m_itemBounds.resize((id + 1) * 4, 0.0f);
+	}
+	else if (m_itemValid[id])
+		unlink(id);
+	float* bounds = &m_itemBounds[id * 4];
+	bounds[0] = bmin[0];
+	bounds[1] = bmin[2];
+	bounds[2] = bmax[0];
+	bounds[3] = bmax[2];
+	m_itemValid[id] = 1;
+	link(id);
+}
+
+void SpatialGrid::remove(int id)
+{
+	if ((id < 0) || (id >= (int) m_itemValid.size()) || !m_itemValid[id])
+		return;
+	unlink(id);
+	m_itemValid[id] = 0;
+}
+
+void SpatialGrid::move(int fromId, int toId)
+{
+	if ((fromId < 0) || (fromId >= (int) m_itemValid.size())
+			|| !m_itemValid[fromId] || (fromId == toId))
+		return;
+	const float* bounds = &m_itemBounds[fromId * 4];
+	const float bmin[3] = { bounds[0], 0.0f, bounds[1] };
+	const float bmax[3] = { bounds[2], 0.0f, bounds[3] };
+	remove(fromId);
+	insert(toId, bmin, bmax);
+}
+
+void SpatialGrid::query(const float* bmin, const float* bmax,
+		std::vector<int>& ids) const
+{
+	ids.clear();
+	const float bounds[4] = { bmin[0], bmin[2], bmax[0], bmax[2] };
+	int x0, z0, x1, z1;
+	getCellRange(bounds, x0, z0, x1, z1);
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			const std::vector<int>& cell = m_cells[z * m_width + x];
+			for (int i = 0; i < (int) cell.size(); ++i)
+			{
+				// exact overlap test
+				const float* ib = &m_itemBounds[cell[i] * 4];
+				if ((ib[0] <= bounds[2]) && (ib[2] >= bounds[0])
+						&& (ib[1] <= bounds[3]) && (ib[3] >= bounds[1]))
+					ids.push_back(cell[i]);
+			}
+		}
+	}
+	// items spanning several cells are found more than once
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+void SpatialGrid::getCellRange(const float* bounds, int& x0, int& z0,
+		int& x1, int& z1) const
+{
+	x0 = (int) floorf((bounds[0] - m_bmin[0]) / m_cellSize);
+	z0 = (int) floorf((bounds[1] - m_bmin[1]) / m_cellSize);
+	x1 = (int) floorf((bounds[2] - m_bmin[0]) / m_cellSize);
+	z1 = (int) floorf((bounds[3] - m_bmin[1]) / m_cellSize);
+	x0 = std::min(std::max(x0, 0), m_width - 1);
+	z0 = std::min(std::max(z0, 0), m_height - 1);
+	x1 = std::min(std::max(x1, 0), m_width - 1);
+	z1 = std::min(std::max(z1, 0), m_height - 1);
+}
+
+void SpatialGrid::link(int id)
+{
+	int x0, z0, x1, z1;
+	getCellRange(&m_itemBounds[id * 4], x0, z0, x1, z1);
+	for (int z = z0; z <= z1; ++z)
+		for (int x = x0; x <= x1; ++x)
+			m_cells[z * m_width + x].push_back(id);
+}
+
+void SpatialGrid::unlink(int id)
+{
+	int x0, z0, x1, z1;
+	getCellRange(&m_itemBounds[id * 4], x0, z0, x1, z1);
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			std::vector<int>& cell = m_cells[z * m_width + x];
+			std::vector<int>::iterator iter = std::find(cell.begin(),
+					cell.end(), id);
+			if (iter != cell.end())
+			{
+				*iter = cell.back();
+				cell.pop_back();
+			}
+		}
+	}
+}
+
+} // namespace rnsup
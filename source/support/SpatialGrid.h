@@ -0,0 +1,57 @@
+/**
+ * \file SpatialGrid.h
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <vector>
+
+namespace rnsup
+{
+
+/**
+ * A uniform 2D grid (on the x,z plane) indexing items by their bounds.
+ *
+ * Each item (identified by a small non negative integer) is registered in all
+ * the cells its bounds overlap, so a query visits only the items overlapping
+ * the cells of the query's bounds. Items outside the grid fall in its border
+ * cells.
+ */
+class SpatialGrid
+{
+	float m_bmin[2];
+	float m_cellSize;
+	int m_width, m_height;
+	std::vector<std::vector<int> > m_cells;
+	///Per item bounds (x,z min then x,z max), for removal and re-indexing.
+	std::vector<float> m_itemBounds;
+	std::vector<unsigned char> m_itemValid;
+
+public:
+	SpatialGrid();
+
+	///Sets the grid's area (x,z of bmin and bmax) and the cell size, keeping
+	///the current items.
+	void init(const float* bmin, const float* bmax, float cellSize);
+	void clear();
+
+	void insert(int id, const float* bmin, const float* bmax);
+	void remove(int id);
+	///Changes an item's id (i.e. after a swap with last removal).
+	void move(int fromId, int toId);
+	///Gets the ids of the items whose bounds overlap bmin-bmax, sorted.
+	void query(const float* bmin, const float* bmax, std::vector<int>& ids) const;
+
+private:
+	void getCellRange(const float* bounds, int& x0, int& z0, int& x1, int& z1) const;
+	void link(int id);
+	void unlink(int id);
+};
+
+} // namespace rnsup
+
+#endif // SPATIALGRID_H
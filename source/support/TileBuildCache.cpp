@@ -0,0 +1,251 @@
+/**
+ * \file TileBuildCache.cpp
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#include "TileBuildCache.h"
+#include "InputGeom.h"
+#include <DetourAlloc.h>
+#include <stdio.h>
+#include <thread>
+#include <functional>
+#ifdef _WIN32
+#	include <process.h>
+#	define getpid _getpid
+#else
+#	include <unistd.h>
+#endif
+
+namespace rnsup
+{
+
+static const int TILEBUILDCACHE_MAGIC = 'T'<<24 | 'B'<<16 | 'C'<<8 | 'F'; //'TBCF';
+static const int TILEBUILDCACHE_VERSION = 2;
+
+struct TileBuildCacheHeader
+{
+	int magic;
+	int version;
+	int count;
+};
+
+///Each blob is preceded by its size and by this checksum (64 bit FNV-1a),
+///so that a corrupted one is never handed to the navigation mesh.
+static unsigned long long tileBuildCacheChecksum(const unsigned char* data,
+		const int size)
+{
+	unsigned long long value = 14695981039346656037ULL;
+	for (int i = 0; i < size; ++i)
+	{
+		value ^= data[i];
+		value *= 1099511628211ULL;
+	}
+	return value;
+}
+
+TileInputHash::TileInputHash() :
+		m_value(14695981039346656037ULL)
+{
+	add(TILEBUILDCACHE_VERSION);
+}
+
+void TileInputHash::add(const void* data, int size)
+{
+	const unsigned char* bytes = (const unsigned char*) data;
+	for (int i = 0; i < size; ++i)
+	{
+		m_value ^= bytes[i];
+		m_value *= 1099511628211ULL;
+	}
+}
+
+void TileInputHash::addGeometry(const InputGeom* geom, const float* bmin,
+		const float* bmax)
+{
+	const float* verts = geom->getMesh()->getVerts();
+	const rcChunkyTriMesh* chunkyMesh = geom->getChunkyMesh();
+	float tbmin[2] = { bmin[0], bmin[2] };
+	float tbmax[2] = { bmax[0], bmax[2] };
+	int cid[512];// same limit as the builds
+	const int ncid = rcGetChunksOverlappingRect(chunkyMesh, tbmin, tbmax, cid, 512);
+	add(ncid);
+	for (int i = 0; i < ncid; ++i)
+	{
+		const rcChunkyTriMeshNode& node = chunkyMesh->nodes[cid[i]];
+		const int* tris = &chunkyMesh->tris[node.i*3];
+		add(node.n);
+		for (int j = 0; j < node.n*3; ++j)
+			add(&verts[tris[j]*3], (int) sizeof(float)*3);
+	}
+
+	std::vector<int> volumes;
+	geom->queryConvexVolumes(bmin, bmax, volumes);
+	const ConvexVolume* vols = geom->getConvexVolumes();
+	add((int) volumes.size());
+	for (int k = 0; k < (int) volumes.size(); ++k)
+	{
+		const ConvexVolume& vol = vols[volumes[k]];
+		add(vol.verts, (int) sizeof(float)*3*vol.nverts);
+		add(vol.hmin);
+		add(vol.hmax);
+		add(vol.nverts);
+		add(vol.area);
+	}
+}
+
+void TileInputHash::addOffMeshConnections(const InputGeom* geom,
+		const float* bmin, const float* bmax)
+{
+	OffMeshConnectionSet cons;
+	geom->getOffMeshConnections(bmin, bmax, cons);
+	add(cons.count);
+	if (!cons.count)
+		return;
+	add(&cons.verts[0], (int) sizeof(float)*3*2*cons.count);
+	add(&cons.rads[0], (int) sizeof(float)*cons.count);
+	add(&cons.dirs[0], (int) sizeof(unsigned char)*cons.count);
+	add(&cons.areas[0], (int) sizeof(unsigned char)*cons.count);
+	add(&cons.flags[0], (int) sizeof(unsigned short)*cons.count);
+	add(&cons.ids[0], (int) sizeof(unsigned int)*cons.count);
+}
+
+void TileInputHash::addAllGeometry(const InputGeom* geom)
+{
+	const rcMeshLoaderObj* mesh = geom->getMesh();
+	add(mesh->getVertCount());
+	add(mesh->getVerts(), (int) sizeof(float)*3*mesh->getVertCount());
+	add(mesh->getTriCount());
+	add(mesh->getTris(), (int) sizeof(int)*3*mesh->getTriCount());
+
+	const ConvexVolume* vols = geom->getConvexVolumes();
+	add(geom->getConvexVolumeCount());
+	for (int k = 0; k < geom->getConvexVolumeCount(); ++k)
+	{
+		const ConvexVolume& vol = vols[k];
+		add(vol.verts, (int) sizeof(float)*3*vol.nverts);
+		add(vol.hmin);
+		add(vol.hmax);
+		add(vol.nverts);
+		add(vol.area);
+	}
+
+	const int ncons = geom->getOffMeshConnectionCount();
+	add(ncons);
+	if (!ncons)
+		return;
+	add(geom->getOffMeshConnectionVerts(), (int) sizeof(float)*3*2*ncons);
+	add(geom->getOffMeshConnectionRads(), (int) sizeof(float)*ncons);
+	add(geom->getOffMeshConnectionDirs(), (int) sizeof(unsigned char)*ncons);
+	add(geom->getOffMeshConnectionAreas(), (int) sizeof(unsigned char)*ncons);
+	add(geom->getOffMeshConnectionFlags(), (int) sizeof(unsigned short)*ncons);
+	add(geom->getOffMeshConnectionId(), (int) sizeof(unsigned int)*ncons);
+}
+
+TileBuildCache::TileBuildCache() :
+		m_hits(0), m_misses(0)
+{
+}
+
+int TileBuildCache::load(unsigned long long hash, unsigned char** datas,
+		int* sizes, const int maxBlobs)
+{
+	if (m_directory.empty())
+		return -1;
+	FILE* fp = fopen(getPath(hash).c_str(), "rb");
+	if (!fp)
+	{
+		++m_misses;
+		return -1;
+	}
+	TileBuildCacheHeader header;
+	int count = -1;
+	if ((fread(&header, sizeof(TileBuildCacheHeader), 1, fp) == 1)
+			&& (header.magic == TILEBUILDCACHE_MAGIC)
+			&& (header.version == TILEBUILDCACHE_VERSION)
+			&& (header.count >= 0) && (header.count <= maxBlobs))
+	{
+		int n = 0;
+		for (; n < header.count; ++n)
+		{
+			int size = 0;
+			unsigned long long checksum = 0;
+			if ((fread(&size, sizeof(int), 1, fp) != 1) || (size <= 0)
+					|| (fread(&checksum, sizeof(checksum), 1, fp) != 1))
+				break;
+			datas[n] = (unsigned char*) dtAlloc(size, DT_ALLOC_PERM);
+			if (!datas[n])
+				break;
+			if ((fread(datas[n], size, 1, fp) != 1)
+					|| (tileBuildCacheChecksum(datas[n], size) != checksum))
+			{
+				dtFree(datas[n]);
+				break;
+			}
+			sizes[n] = size;
+		}
+		if (n == header.count)
+			count = n;
+		else
+		{
+			// truncated or corrupted
+			for (int i = 0; i < n; ++i)
+				dtFree(datas[i]);
+		}
+	}
+	fclose(fp);
+	if (count < 0)
+		++m_misses;
+	else
+		++m_hits;
+	return count;
+}
+
+bool TileBuildCache::store(unsigned long long hash,
+		const unsigned char* const * datas, const int* sizes, const int count)
+{
+	if (m_directory.empty())
+		return false;
+	const std::string path = getPath(hash);
+	// a temporary file per process and thread
+	char suffix[48];
+	snprintf(suffix, sizeof(suffix), ".%lx.%llx.tmp", (unsigned long) getpid(),
+			(unsigned long long) std::hash<std::thread::id>()(
+					std::this_thread::get_id()));
+	const std::string tmpPath = path + suffix;
+	FILE* fp = fopen(tmpPath.c_str(), "wb");
+	if (!fp)
+		return false;
+	TileBuildCacheHeader header;
+	header.magic = TILEBUILDCACHE_MAGIC;
+	header.version = TILEBUILDCACHE_VERSION;
+	header.count = count;
+	bool ok = (fwrite(&header, sizeof(TileBuildCacheHeader), 1, fp) == 1);
+	for (int i = 0; ok && (i < count); ++i)
+	{
+		const unsigned long long checksum = tileBuildCacheChecksum(datas[i],
+				sizes[i]);
+		ok = (fwrite(&sizes[i], sizeof(int), 1, fp) == 1)
+				&& (fwrite(&checksum, sizeof(checksum), 1, fp) == 1)
+				&& (fwrite(datas[i], sizes[i], 1, fp) == 1);
+	}
+	ok = (fclose(fp) == 0) && ok;
+#ifdef _WIN32
+	if (ok)
+		remove(path.c_str());
+#endif
+	ok = ok && (rename(tmpPath.c_str(), path.c_str()) == 0);
+	if (!ok)
+		remove(tmpPath.c_str());
+	return ok;
+}
+
+std::string TileBuildCache::getPath(unsigned long long hash) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.tile", hash);
+	return m_directory + name;
+}
+
+} // namespace rnsup
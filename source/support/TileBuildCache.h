@@ -0,0 +1,114 @@
+/**
+ * \file TileBuildCache.h
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#ifndef TILEBUILDCACHE_H
+#define TILEBUILDCACHE_H
+
+#include <string>
+#include <atomic>
+
+namespace rnsup
+{
+
+/**
+ * Incremental 64 bit FNV-1a hash of a tile's build input.
+ */
+class TileInputHash
+{
+	unsigned long long m_value;
+
+public:
+	TileInputHash();
+
+	void add(const void* data, int size);
+	template<typename T> void add(const T& value)
+	{
+		add(&value, (int) sizeof(T));
+	}
+	///Adds the triangles of the chunks, and the convex volumes, overlapping
+	///bmin-bmax (x,z), in the order they are rasterized and marked.
+	void addGeometry(const class InputGeom* geom, const float* bmin,
+			const float* bmax);
+	///Adds the off-mesh connections overlapping bmin-bmax (x,z).
+	void addOffMeshConnections(const class InputGeom* geom, const float* bmin,
+			const float* bmax);
+	///Adds all the triangles, convex volumes and off-mesh connections.
+	void addAllGeometry(const class InputGeom* geom);
+
+	unsigned long long getValue() const
+	{
+		return m_value;
+	}
+};
+
+/**
+ * A directory of built tiles' data, each stored into a file named after the
+ * hash of the tile's input (see TileInputHash), so that a rebuild after an
+ * edit only recomputes the tiles whose input changed.
+ *
+ * A tile's data may be made up of several blobs (i.e. the compressed layers
+ * of a tile cache's tile). Files are written to a temporary file (per process
+ * and thread) which is then renamed, so load() and store() can be called by
+ * several threads (and processes) at once; each blob is stored with its
+ * checksum, which load() verifies. Stale files are never removed: the
+ * directory can be emptied at any time.
+ * \note An empty directory disables the cache.
+ */
+class TileBuildCache
+{
+	std::string m_directory;
+	std::atomic<int> m_hits;
+	std::atomic<int> m_misses;
+
+public:
+	TileBuildCache();
+
+	void setDirectory(const std::string& directory)
+	{
+		m_directory = directory;
+	}
+	const std::string& getDirectory() const
+	{
+		return m_directory;
+	}
+	bool isEnabled() const
+	{
+		return !m_directory.empty();
+	}
+
+	///Gets the blobs (allocated with dtAlloc()) stored for the hash into
+	///datas and sizes: returns their number, or -1 if there is none.
+	int load(unsigned long long hash, unsigned char** datas, int* sizes,
+			const int maxBlobs);
+	bool store(unsigned long long hash, const unsigned char* const * datas,
+			const int* sizes, const int count);
+
+	int getNumHits() const
+	{
+		return m_hits;
+	}
+	int getNumMisses() const
+	{
+		return m_misses;
+	}
+	void resetStats()
+	{
+		m_hits = 0;
+		m_misses = 0;
+	}
+
+private:
+	std::string getPath(unsigned long long hash) const;
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	TileBuildCache(const TileBuildCache&);
+	TileBuildCache& operator=(const TileBuildCache&);
+};
+
+} // namespace rnsup
+
+#endif // TILEBUILDCACHE_H
@@ -0,0 +1,593 @@
+/**
+ * \file TileCacheCompressor.cpp
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#include "TileCacheCompressor.h"
+#include "NavMeshType.h"
+#include "fastlz.h"
+#include <DetourAlloc.h>
+#include <DetourCommon.h>
+#include <string.h>
+
+namespace rnsup
+{
+
+///The dense data begin with a byte whose 3 high bits are set, which FastLZ
+///never writes (they hold its level), followed by the (little endian) 32 bit
+///uncompressed size, and by the range coded LZ77 stream.
+static const unsigned char TILECACHECOMPRESSOR_DENSE_TAG = 0xE0;
+static const int TILECACHECOMPRESSOR_DENSE_HEADER_SIZE = 5;
+
+static const int TILECACHECOMPRESSOR_MIN_MATCH = 3;
+static const int TILECACHECOMPRESSOR_MAX_LEN = 272;
+static const int TILECACHECOMPRESSOR_HASH_BITS = 15;
+static const int TILECACHECOMPRESSOR_MAX_CHAIN = 64;
+
+static const int TILECACHECOMPRESSOR_PROB_BITS = 11;
+static const int TILECACHECOMPRESSOR_MOVE_BITS = 5;
+static const unsigned int TILECACHECOMPRESSOR_TOP = 1 << 24;
+
+///Length coder: 0-7, 8-15, 16-271 (plus the minimum length).
+struct DenseLenModel
+{
+	unsigned short choice;
+	unsigned short choice2;
+	unsigned short low[8];
+	unsigned short mid[8];
+	unsigned short high[256];
+};
+
+///The adaptive probabilities of all the coded decisions. The state is the
+///kind of the previous item: 0 literal, 1 match, 2 repeated match.
+struct DenseModel
+{
+	unsigned short isMatch[3];
+	unsigned short isRep[3];
+	unsigned short isRep1[3];
+	///Literals in the context of the previous byte's 3 high bits.
+	unsigned short literal[8][256];
+	DenseLenModel matchLen;
+	DenseLenModel repLen;
+	unsigned short distSlot[64];
+	///Extra bits of the distance slots 4-13.
+	unsigned short distExtra[10][32];
+	unsigned short distAlign[16];
+
+	void init()
+	{
+		unsigned short* probs = (unsigned short*) this;
+		for (size_t i = 0; i < sizeof(DenseModel) / sizeof(unsigned short); ++i)
+			probs[i] = 1 << (TILECACHECOMPRESSOR_PROB_BITS - 1);
+	}
+};
+
+struct DenseEncoder
+{
+	unsigned long long low;
+	unsigned int range;
+	unsigned char cache;
+	unsigned long long cacheSize;
+	unsigned char* out;
+	unsigned char* end;
+	bool overflow;
+
+	DenseEncoder(unsigned char* begin, unsigned char* limit) :
+			low(0), range(0xFFFFFFFF), cache(0), cacheSize(1), out(begin),
+			end(limit), overflow(false)
+	{
+	}
+
+	void writeByte(unsigned char byte)
+	{
+		if (out < end)
+			*out++ = byte;
+		else
+			overflow = true;
+	}
+	void shiftLow()
+	{
+		if (((unsigned int) low < 0xFF000000) || ((low >> 32) != 0))
+		{
+			unsigned char temp = cache;
+			do
+			{
+				writeByte((unsigned char) (temp + (unsigned char) (low >> 32)));
+				temp = 0xFF;
+			} while (--cacheSize != 0);
+			cache = (unsigned char) ((unsigned int) low >> 24);
+		}
+		cacheSize++;
+		low = (unsigned int) low << 8;
+	}
+	void encodeBit(unsigned short& prob, unsigned int bit)
+	{
+		const unsigned int bound = (range >> TILECACHECOMPRESSOR_PROB_BITS)
+				* prob;
+		if (!bit)
+		{
+			range = bound;
+			prob += ((1 << TILECACHECOMPRESSOR_PROB_BITS) - prob)
+					>> TILECACHECOMPRESSOR_MOVE_BITS;
+		}
+		else
+		{
+			low += bound;
+			range -= bound;
+			prob -= prob >> TILECACHECOMPRESSOR_MOVE_BITS;
+		}
+		while (range < TILECACHECOMPRESSOR_TOP)
+		{
+			range <<= 8;
+			shiftLow();
+		}
+	}
+	void encodeDirect(unsigned int value, int numBits)
+	{
+		for (int i = numBits - 1; i >= 0; --i)
+		{
+			range >>= 1;
+			if ((value >> i) & 1)
+				low += range;
+			while (range < TILECACHECOMPRESSOR_TOP)
+			{
+				range <<= 8;
+				shiftLow();
+			}
+		}
+	}
+	void encodeTree(unsigned short* probs, int numBits, unsigned int value)
+	{
+		unsigned int m = 1;
+		for (int i = numBits - 1; i >= 0; --i)
+		{
+			const unsigned int bit = (value >> i) & 1;
+			encodeBit(probs[m], bit);
+			m = (m << 1) | bit;
+		}
+	}
+	void encodeLen(DenseLenModel& model, unsigned int len)
+	{
+		if (len < 8)
+		{
+			encodeBit(model.choice, 0);
+			encodeTree(model.low, 3, len);
+		}
+		else if (len < 16)
+		{
+			encodeBit(model.choice, 1);
+			encodeBit(model.choice2, 0);
+			encodeTree(model.mid, 3, len - 8);
+		}
+		else
+		{
+			encodeBit(model.choice, 1);
+			encodeBit(model.choice2, 1);
+			encodeTree(model.high, 8, len - 16);
+		}
+	}
+	void flush()
+	{
+		for (int i = 0; i < 5; ++i)
+			shiftLow();
+	}
+};
+
+struct DenseDecoder
+{
+	unsigned int range;
+	unsigned int code;
+	const unsigned char* in;
+	const unsigned char* end;
+	bool overrun;
+
+	DenseDecoder(const unsigned char* begin, const unsigned char* limit) :
+			range(0xFFFFFFFF), code(0), in(begin), end(limit), overrun(false)
+	{
+		for (int i = 0; i < 5; ++i)
+			code = (code << 8) | readByte();
+	}
+
+	unsigned char readByte()
+	{
+		if (in < end)
+			return *in++;
+		overrun = true;
+		return 0;
+	}
+	unsigned int decodeBit(unsigned short& prob)
+	{
+		const unsigned int bound = (range >> TILECACHECOMPRESSOR_PROB_BITS)
+				* prob;
+		unsigned int bit;
+		if (code < bound)
+		{
+			range = bound;
+			prob += ((1 << TILECACHECOMPRESSOR_PROB_BITS) - prob)
+					>> TILECACHECOMPRESSOR_MOVE_BITS;
+			bit = 0;
+		}
+		else
+		{
+			code -= bound;
+			range -= bound;
+			prob -= prob >> TILECACHECOMPRESSOR_MOVE_BITS;
+			bit = 1;
+		}
+		if (range < TILECACHECOMPRESSOR_TOP)
+		{
+			range <<= 8;
+			code = (code << 8) | readByte();
+		}
+		return bit;
+	}
+	unsigned int decodeDirect(int numBits)
+	{
+		unsigned int value = 0;
+		for (int i = 0; i < numBits; ++i)
+		{
+			range >>= 1;
+			unsigned int bit = 0;
+			if (code >= range)
+			{
+				code -= range;
+				bit = 1;
+			}
+			value = (value << 1) | bit;
+			if (range < TILECACHECOMPRESSOR_TOP)
+			{
+				range <<= 8;
+				code = (code << 8) | readByte();
+			}
+		}
+		return value;
+	}
+	unsigned int decodeTree(unsigned short* probs, int numBits)
+	{
+		unsigned int m = 1;
+		for (int i = 0; i < numBits; ++i)
+			m = (m << 1) | decodeBit(probs[m]);
+		return m - (1 << numBits);
+	}
+	unsigned int decodeLen(DenseLenModel& model)
+	{
+		if (!decodeBit(model.choice))
+			return decodeTree(model.low, 3);
+		if (!decodeBit(model.choice2))
+			return 8 + decodeTree(model.mid, 3);
+		return 16 + decodeTree(model.high, 8);
+	}
+};
+
+///Distance slots: 0-3 are the distances (minus 1) themselves, then each slot
+///covers half of a power of two range, whose offset is coded as extra bits.
+static unsigned int tileCacheCompressorDistSlot(unsigned int d)
+{
+	if (d < 4)
+		return d;
+	int n = 31;
+	while (!(d >> n))
+		--n;
+	return (n << 1) | ((d >> (n - 1)) & 1);
+}
+
+static void tileCacheCompressorEncodeDist(DenseEncoder& rc, DenseModel& model,
+		unsigned int dist)
+{
+	const unsigned int d = dist - 1;
+	const unsigned int slot = tileCacheCompressorDistSlot(d);
+	rc.encodeTree(model.distSlot, 6, slot);
+	if (slot < 4)
+		return;
+	const int numExtra = (slot >> 1) - 1;
+	const unsigned int extra = d - ((2 | (slot & 1)) << numExtra);
+	if (slot < 14)
+		rc.encodeTree(model.distExtra[slot - 4], numExtra, extra);
+	else
+	{
+		rc.encodeDirect(extra >> 4, numExtra - 4);
+		rc.encodeTree(model.distAlign, 4, extra & 15);
+	}
+}
+
+static unsigned int tileCacheCompressorDecodeDist(DenseDecoder& rc,
+		DenseModel& model)
+{
+	const unsigned int slot = rc.decodeTree(model.distSlot, 6);
+	if (slot < 4)
+		return slot + 1;
+	const int numExtra = (slot >> 1) - 1;
+	unsigned int d = (2 | (slot & 1)) << numExtra;
+	if (slot < 14)
+		d += rc.decodeTree(model.distExtra[slot - 4], numExtra);
+	else
+	{
+		d += rc.decodeDirect(numExtra - 4) << 4;
+		d += rc.decodeTree(model.distAlign, 4);
+	}
+	return d + 1;
+}
+
+static unsigned int tileCacheCompressorHash(const unsigned char* p)
+{
+	const unsigned int v = p[0] | (p[1] << 8) | (p[2] << 16);
+	return (v * 2654435761u) >> (32 - TILECACHECOMPRESSOR_HASH_BITS);
+}
+
+static int tileCacheCompressorMatchLen(const unsigned char* a,
+		const unsigned char* b, const int maxLen)
+{
+	int len = 0;
+	while ((len < maxLen) && (a[len] == b[len]))
+		++len;
+	return len;
+}
+
+///Hash chains over the input: head holds the last position of each hash,
+///prev the previous position with the same hash of each position.
+struct DenseMatchFinder
+{
+	const unsigned char* data;
+	int size;
+	int* head;
+	int* prev;
+
+	void insert(int pos)
+	{
+		if (pos + TILECACHECOMPRESSOR_MIN_MATCH > size)
+			return;
+		const unsigned int h = tileCacheCompressorHash(data + pos);
+		prev[pos] = head[h];
+		head[h] = pos;
+	}
+	///Finds the longest match at pos, among the inserted positions.
+	int find(int pos, int maxLen, int* dist) const
+	{
+		if (pos + TILECACHECOMPRESSOR_MIN_MATCH > size)
+			return 0;
+		int bestLen = 0;
+		int cur = head[tileCacheCompressorHash(data + pos)];
+		for (int chain = 0; (cur >= 0) && (chain < TILECACHECOMPRESSOR_MAX_CHAIN);
+				++chain, cur = prev[cur])
+		{
+			if (data[cur + bestLen] != data[pos + bestLen])
+				continue;
+			const int len = tileCacheCompressorMatchLen(data + cur, data + pos,
+					maxLen);
+			if (len > bestLen)
+			{
+				bestLen = len;
+				*dist = pos - cur;
+				if (len == maxLen)
+					break;
+			}
+		}
+		return bestLen >= TILECACHECOMPRESSOR_MIN_MATCH ? bestLen : 0;
+	}
+};
+
+///Returns the compressed size, or 0 if it exceeds maxSize.
+static int tileCacheCompressorDenseEncode(const unsigned char* buffer,
+		const int bufferSize, unsigned char* compressed, const int maxSize)
+{
+	if (maxSize <= TILECACHECOMPRESSOR_DENSE_HEADER_SIZE)
+		return 0;
+	const int hashSize = 1 << TILECACHECOMPRESSOR_HASH_BITS;
+	int* chains = (int*) dtAlloc(sizeof(int) * (hashSize + bufferSize),
+			DT_ALLOC_TEMP);
+	if (!chains)
+		return 0;
+	DenseMatchFinder mf;
+	mf.data = buffer;
+	mf.size = bufferSize;
+	mf.head = chains;
+	mf.prev = chains + hashSize;
+	memset(mf.head, 0xFF, sizeof(int) * hashSize);
+
+	compressed[0] = TILECACHECOMPRESSOR_DENSE_TAG;
+	for (int i = 0; i < 4; ++i)
+		compressed[1 + i] = (unsigned char) (bufferSize >> (i * 8));
+	DenseEncoder rc(compressed + TILECACHECOMPRESSOR_DENSE_HEADER_SIZE,
+			compressed + maxSize);
+	DenseModel model;
+	model.init();
+
+	int reps[2] = { 1, 1 };
+	int state = 0;
+	int pos = 0;
+	while ((pos < bufferSize) && !rc.overflow)
+	{
+		const int maxLen = dtMin(TILECACHECOMPRESSOR_MAX_LEN, bufferSize - pos);
+		// the longest of the repeated distances' matches
+		int repIdx = 0, repLen = 0;
+		for (int k = 0; k < 2; ++k)
+		{
+			if (reps[k] > pos)
+				continue;
+			const int len = tileCacheCompressorMatchLen(buffer + pos - reps[k],
+					buffer + pos, maxLen);
+			if (len > repLen)
+			{
+				repIdx = k;
+				repLen = len;
+			}
+		}
+		int dist = 0;
+		int len = mf.find(pos, maxLen, &dist);
+		// a repeated distance is cheaper even if one byte shorter
+		if ((repLen > 0) && (repLen + 1 >= len))
+		{
+			rc.encodeBit(model.isMatch[state], 1);
+			rc.encodeBit(model.isRep[state], 1);
+			rc.encodeBit(model.isRep1[state], repIdx);
+			rc.encodeLen(model.repLen, repLen - 1);
+			if (repIdx)
+			{
+				const int tmp = reps[0];
+				reps[0] = reps[1];
+				reps[1] = tmp;
+			}
+			state = 2;
+			len = repLen;
+		}
+		else
+		{
+			if (len)
+			{
+				// lazy matching: defer to a longer match at the next byte
+				mf.insert(pos);
+				int nextDist = 0;
+				const int nextMaxLen = dtMin(TILECACHECOMPRESSOR_MAX_LEN,
+						bufferSize - pos - 1);
+				if (mf.find(pos + 1, nextMaxLen, &nextDist) > len)
+					len = 0;
+				// undo the insertion: the position is inserted below
+				mf.head[tileCacheCompressorHash(buffer + pos)] = mf.prev[pos];
+			}
+			if (len)
+			{
+				rc.encodeBit(model.isMatch[state], 1);
+				rc.encodeBit(model.isRep[state], 0);
+				rc.encodeLen(model.matchLen, len - TILECACHECOMPRESSOR_MIN_MATCH);
+				tileCacheCompressorEncodeDist(rc, model, dist);
+				reps[1] = reps[0];
+				reps[0] = dist;
+				state = 1;
+			}
+			else
+			{
+				rc.encodeBit(model.isMatch[state], 0);
+				const int ctx = pos ? buffer[pos - 1] >> 5 : 0;
+				rc.encodeTree(model.literal[ctx], 8, buffer[pos]);
+				state = 0;
+				len = 1;
+			}
+		}
+		for (int i = 0; i < len; ++i)
+			mf.insert(pos + i);
+		pos += len;
+	}
+	rc.flush();
+	dtFree(chains);
+	if (rc.overflow)
+		return 0;
+	return (int) (rc.out - compressed);
+}
+
+///Returns the decompressed size, or -1 on corrupted data.
+static int tileCacheCompressorDenseDecode(const unsigned char* compressed,
+		const int compressedSize, unsigned char* buffer, const int maxBufferSize)
+{
+	if (compressedSize < TILECACHECOMPRESSOR_DENSE_HEADER_SIZE)
+		return -1;
+	unsigned int size = 0;
+	for (int i = 0; i < 4; ++i)
+		size |= (unsigned int) compressed[1 + i] << (i * 8);
+	if (size > (unsigned int) maxBufferSize)
+		return -1;
+	DenseDecoder rc(compressed + TILECACHECOMPRESSOR_DENSE_HEADER_SIZE,
+			compressed + compressedSize);
+	DenseModel model;
+	model.init();
+
+	const int bufferSize = (int) size;
+	int reps[2] = { 1, 1 };
+	int state = 0;
+	int pos = 0;
+	while (pos < bufferSize)
+	{
+		if (!rc.decodeBit(model.isMatch[state]))
+		{
+			const int ctx = pos ? buffer[pos - 1] >> 5 : 0;
+			buffer[pos++] = (unsigned char) rc.decodeTree(model.literal[ctx], 8);
+			state = 0;
+		}
+		else
+		{
+			int len;
+			if (rc.decodeBit(model.isRep[state]))
+			{
+				if (rc.decodeBit(model.isRep1[state]))
+				{
+					const int tmp = reps[0];
+					reps[0] = reps[1];
+					reps[1] = tmp;
+				}
+				len = rc.decodeLen(model.repLen) + 1;
+				state = 2;
+			}
+			else
+			{
+				len = rc.decodeLen(model.matchLen) + TILECACHECOMPRESSOR_MIN_MATCH;
+				reps[1] = reps[0];
+				reps[0] = tileCacheCompressorDecodeDist(rc, model);
+				state = 1;
+			}
+			if ((unsigned int) reps[0] > (unsigned int) pos
+					|| (len > bufferSize - pos))
+				return -1;
+			// byte by byte: the match can overlap the output
+			const unsigned char* src = buffer + pos - reps[0];
+			unsigned char* dst = buffer + pos;
+			for (int i = 0; i < len; ++i)
+				dst[i] = src[i];
+			pos += len;
+		}
+		if (rc.overrun)
+			return -1;
+	}
+	return bufferSize;
+}
+
+TileCacheCompressor::TileCacheCompressor() :
+		m_type(NAVMESH_TILE_COMPRESSOR_FAST)
+{
+}
+
+int TileCacheCompressor::maxCompressedSize(const int bufferSize)
+{
+	// FastLZ needs 5% more than the input, and at least 66 bytes: the dense
+	// compression falls back to it if it doesn't fit.
+	return dtMax(bufferSize + bufferSize / 20 + 1, 66);
+}
+
+dtStatus TileCacheCompressor::compress(const unsigned char* buffer,
+		const int bufferSize, unsigned char* compressed,
+		const int maxCompressedSize, int* compressedSize)
+{
+	*compressedSize = 0;
+	if (m_type == NAVMESH_TILE_COMPRESSOR_DENSE)
+	{
+		*compressedSize = tileCacheCompressorDenseEncode(buffer, bufferSize,
+				compressed, maxCompressedSize);
+	}
+	if (!*compressedSize)
+	{
+		*compressedSize = fastlz_compress_level(1, buffer, bufferSize,
+				compressed);
+	}
+	return DT_SUCCESS;
+}
+
+dtStatus TileCacheCompressor::decompress(const unsigned char* compressed,
+		const int compressedSize, unsigned char* buffer,
+		const int maxBufferSize, int* bufferSize)
+{
+	if (compressedSize <= 0)
+		return DT_FAILURE;
+	if ((compressed[0] & TILECACHECOMPRESSOR_DENSE_TAG)
+			== TILECACHECOMPRESSOR_DENSE_TAG)
+	{
+		*bufferSize = tileCacheCompressorDenseDecode(compressed, compressedSize,
+				buffer, maxBufferSize);
+		return *bufferSize < 0 ? DT_FAILURE : DT_SUCCESS;
+	}
+	*bufferSize = fastlz_decompress(compressed, compressedSize, buffer,
+			maxBufferSize);
+	// FastLZ returns 0 on corrupted data
+	return *bufferSize <= 0 ? DT_FAILURE : DT_SUCCESS;
+}
+
+} // namespace rnsup
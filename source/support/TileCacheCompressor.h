@@ -0,0 +1,65 @@
+/**
+ * \file TileCacheCompressor.h
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#ifndef TILECACHECOMPRESSOR_H
+#define TILECACHECOMPRESSOR_H
+
+#include <DetourTileCacheBuilder.h>
+
+namespace rnsup
+{
+
+/**
+ * The compressor of the tile cache's layers, of one of the
+ * NavMeshTileCompressorType types:
+ * - NAVMESH_TILE_COMPRESSOR_FAST favours decompression speed: the layers are
+ * compressed with FastLZ (level 1), whose decompression is little more than
+ * copying bytes.
+ * - NAVMESH_TILE_COMPRESSOR_DENSE favours compression ratio: the layers are
+ * LZ77 compressed, with a hash chain match finder and lazy matching, and the
+ * result is coded with an adaptive binary range coder. As in the layers the
+ * same values are usually found at the same cell of the previous row (or grid),
+ * the last two match distances can be reused cheaply.
+ *
+ * decompress() recognizes the format of the data, so the layers compressed
+ * with a type can always be decompressed after the type has changed (e.g.
+ * those restored from the built data). The compressor has no state: it can be
+ * shared by several threads.
+ */
+class TileCacheCompressor: public dtTileCacheCompressor
+{
+	int m_type;
+
+public:
+	TileCacheCompressor();
+
+	void setType(int type)
+	{
+		m_type = type;
+	}
+	int getType() const
+	{
+		return m_type;
+	}
+
+	virtual int maxCompressedSize(const int bufferSize);
+	virtual dtStatus compress(const unsigned char* buffer, const int bufferSize,
+			unsigned char* compressed, const int maxCompressedSize,
+			int* compressedSize);
+	virtual dtStatus decompress(const unsigned char* compressed,
+			const int compressedSize, unsigned char* buffer,
+			const int maxBufferSize, int* bufferSize);
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	TileCacheCompressor(const TileCacheCompressor&);
+	TileCacheCompressor& operator=(const TileCacheCompressor&);
+};
+
+} // namespace rnsup
+
+#endif // TILECACHECOMPRESSOR_H
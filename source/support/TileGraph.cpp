@@ -0,0 +1,463 @@
+/**
+ * \file TileGraph.cpp
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#include "TileGraph.h"
+#include <DetourCommon.h>
+#include <float.h>
+#include <stdlib.h>
+#include <queue>
+#include <set>
+#include <functional>
+
+namespace rnsup
+{
+
+TileGraph::TileGraph() :
+		m_navMesh(0), m_navQuery(0)
+{
+	m_polyPickExt[0] = 2;
+	m_polyPickExt[1] = 4;
+	m_polyPickExt[2] = 2;
+}
+
+TileGraph::~TileGraph()
+{
+	dtFreeNavMeshQuery(m_navQuery);
+}
+
+bool TileGraph::init(const dtNavMesh* navMesh, const dtQueryFilter* filter, const int maxNodes)
+{
+	clear();
+	m_navMesh = 0;
+	if (!navMesh)
+		return false;
+
+	if (!m_navQuery)
+	{
+		m_navQuery = dtAllocNavMeshQuery();
+		if (!m_navQuery)
+			return false;
+	}
+	// refinement searches are local to few tiles: a small node pool is enough
+	if (dtStatusFailed(m_navQuery->init(navMesh, maxNodes)))
+		return false;
+
+	if (filter)
+		m_filter = *filter;
+	m_navMesh = navMesh;
+	return true;
+}
+
+void TileGraph::buildAll()
+{
+	clear();
+	if (!m_navMesh)
+		return;
+
+	std::set<TileCoord> coords;
+	for (int i = 0; i < m_navMesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = m_navMesh->getTile(i);
+		if (!tile || !tile->header)
+			continue;
+		coords.insert(TileCoord(tile->header->x, tile->header->y));
+	}
+	for (std::set<TileCoord>::const_iterator iter = coords.begin();
+			iter != coords.end(); ++iter)
+	{
+		buildTileNodes(iter->first, iter->second);
+	}
+}
+
+void TileGraph::updateTile(int tx, int ty)
+{
+	if (!m_navMesh)
+		return;
+
+	// neighbors' portals depend on this tile's presence
+	for (int y = ty - 1; y <= ty + 1; ++y)
+	{
+		for (int x = tx - 1; x <= tx + 1; ++x)
+		{
+			removeTileNodes(x, y);
+		}
+	}
+	for (int y = ty - 1; y <= ty + 1; ++y)
+	{
+		for (int x = tx - 1; x <= tx + 1; ++x)
+		{
+			buildTileNodes(x, y);
+		}
+	}
+}
+
+void TileGraph::clear()
+{
+	m_nodes.clear();
+	m_tileNodes.clear();
+	m_corridor.clear();
+	m_straightPath.clear();
+	m_straightPathFlags.clear();
+	m_straightPathPolys.clear();
+}
+
+int TileGraph::findStraightPath(const float* spos, const float* epos, const int options)
+{
+	m_corridor.clear();
+	m_straightPath.clear();
+	m_straightPathFlags.clear();
+	m_straightPathPolys.clear();
+	if (!m_navMesh)
+		return 0;
+
+	dtPolyRef startRef = 0, endRef = 0;
+	m_navQuery->findNearestPoly(spos, m_polyPickExt, &m_filter, &startRef, 0);
+	m_navQuery->findNearestPoly(epos, m_polyPickExt, &m_filter, &endRef, 0);
+	if (!startRef || !endRef)
+		return 0;
+
+	std::vector<dtPolyRef> waypoints;
+	if (!findAbstractPath(startRef, spos, endRef, epos, waypoints) ||
+			!refine(waypoints, spos, epos))
+	{
+		m_corridor.clear();
+		return 0;
+	}
+
+	// In case of partial path, make sure the end point is clamped to the last polygon.
+	float clampedEpos[3];
+	dtVcopy(clampedEpos, epos);
+	if (m_corridor.back() != endRef)
+		m_navQuery->closestPointOnPoly(m_corridor.back(), epos, clampedEpos, 0);
+
+	const int maxStraightPath = (int) m_corridor.size() + 2;
+	m_straightPath.resize(maxStraightPath * 3);
+	m_straightPathFlags.resize(maxStraightPath);
+	m_straightPathPolys.resize(maxStraightPath);
+	int nstraightPath = 0;
+	m_navQuery->findStraightPath(spos, clampedEpos, &m_corridor[0], (int) m_corridor.size(),
+								 &m_straightPath[0], &m_straightPathFlags[0],
+								 &m_straightPathPolys[0], &nstraightPath, maxStraightPath, options);
+	m_straightPath.resize(nstraightPath * 3);
+	m_straightPathFlags.resize(nstraightPath);
+	m_straightPathPolys.resize(nstraightPath);
+	return nstraightPath;
+}
+
+void TileGraph::removeTileNodes(int tx, int ty)
+{
+	std::map<TileCoord, std::vector<dtPolyRef> >::iterator iter =
+			m_tileNodes.find(TileCoord(tx, ty));
+	if (iter == m_tileNodes.end())
+		return;
+
+	for (int i = 0; i < (int) iter->second.size(); ++i)
+	{
+		m_nodes.erase(iter->second[i]);
+	}
+	m_tileNodes.erase(iter);
+}
+
+void TileGraph::buildTileNodes(int tx, int ty)
+{
+	static const int MAX_LAYERS = 32;
+	const dtMeshTile* tiles[MAX_LAYERS];
+	const int ntiles = m_navMesh->getTilesAt(tx, ty, tiles, MAX_LAYERS);
+	if (!ntiles)
+		return;
+
+	std::vector<dtPolyRef>& refs = m_tileNodes[TileCoord(tx, ty)];
+	std::vector<int> portals;
+	std::vector<float> costs;
+	for (int t = 0; t < ntiles; ++t)
+	{
+		const dtMeshTile* tile = tiles[t];
+		const dtPolyRef base = m_navMesh->getPolyRefBase(tile);
+		// collect portals
+		portals.clear();
+		for (int i = 0; i < tile->header->polyCount; ++i)
+		{
+			const dtPoly* poly = &tile->polys[i];
+			const dtPolyRef ref = base | (dtPolyRef) i;
+			if (!isPortal(tile, poly) || !passFilter(poly))
+				continue;
+			portals.push_back(i);
+			Node& node = m_nodes[ref];
+			getPolyCenter(tile, poly, node.pos);
+			node.edges.clear();
+			refs.push_back(ref);
+		}
+		// precompute intra-tile costs between portals
+		for (int p = 0; p < (int) portals.size(); ++p)
+		{
+			const dtPolyRef ref = base | (dtPolyRef) portals[p];
+			Node& node = m_nodes[ref];
+			localCosts(tile, ref, node.pos, costs);
+			for (int q = 0; q < (int) portals.size(); ++q)
+			{
+				if ((q != p) && (costs[portals[q]] < FLT_MAX))
+				{
+					node.edges.push_back(std::make_pair(base | (dtPolyRef) portals[q],
+							costs[portals[q]]));
+				}
+			}
+		}
+	}
+	if (refs.empty())
+		m_tileNodes.erase(TileCoord(tx, ty));
+}
+
+bool TileGraph::isPortal(const dtMeshTile* tile, const dtPoly* poly) const
+{
+	for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+	{
+		// boundary links have a side
+		if (tile->links[k].side != 0xff)
+			return true;
+	}
+	return false;
+}
+
+void TileGraph::getPolyCenter(const dtMeshTile* tile, const dtPoly* poly, float* center) const
+{
+	dtVset(center, 0.0f, 0.0f, 0.0f);
+	for (int i = 0; i < (int) poly->vertCount; ++i)
+	{
+		dtVadd(center, center, &tile->verts[poly->verts[i] * 3]);
+	}
+	dtVscale(center, center, 1.0f / (float) poly->vertCount);
+}
+
+void TileGraph::localCosts(const dtMeshTile* tile, dtPolyRef startRef, const float* startPos,
+		std::vector<float>& costs) const
+{
+	typedef std::pair<float, int> QueueItem;
+	const int npolys = tile->header->polyCount;
+	const int startIdx = (int) m_navMesh->decodePolyIdPoly(startRef);
+	costs.assign(npolys, FLT_MAX);
+	std::vector<char> closed(npolys, 0);
+	std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem> > open;
+	costs[startIdx] = 0.0f;
+	open.push(QueueItem(0.0f, startIdx));
+	while (!open.empty())
+	{
+		const QueueItem item = open.top();
+		open.pop();
+		const int idx = item.second;
+		if (closed[idx])
+			continue;
+		closed[idx] = 1;
+
+		const dtPoly* poly = &tile->polys[idx];
+		float pa[3];
+		if (idx == startIdx)
+			dtVcopy(pa, startPos);
+		else
+			getPolyCenter(tile, poly, pa);
+		for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+		{
+			const dtPolyRef neiRef = tile->links[k].ref;
+			if (!neiRef)
+				continue;
+			const dtMeshTile* neiTile = 0;
+			const dtPoly* neiPoly = 0;
+			m_navMesh->getTileAndPolyByRefUnsafe(neiRef, &neiTile, &neiPoly);
+			// stay inside the tile
+			if ((neiTile != tile) || !passFilter(neiPoly))
+				continue;
+			const int neiIdx = (int) m_navMesh->decodePolyIdPoly(neiRef);
+			if (closed[neiIdx])
+				continue;
+			float pb[3];
+			getPolyCenter(tile, neiPoly, pb);
+			const float cost = item.first + dtVdist(pa, pb) *
+					m_filter.getAreaCost(poly->getArea());
+			if (cost < costs[neiIdx])
+			{
+				costs[neiIdx] = cost;
+				open.push(QueueItem(cost, neiIdx));
+			}
+		}
+	}
+}
+
+bool TileGraph::findAbstractPath(dtPolyRef startRef, const float* spos, dtPolyRef endRef,
+		const float* epos, std::vector<dtPolyRef>& waypoints) const
+{
+	typedef std::pair<float, dtPolyRef> QueueItem;
+	static const float H_SCALE = 0.999f;
+
+	const dtMeshTile* startTile = 0;
+	const dtMeshTile* endTile = 0;
+	const dtPoly* poly = 0;
+	m_navMesh->getTileAndPolyByRefUnsafe(startRef, &startTile, &poly);
+	m_navMesh->getTileAndPolyByRefUnsafe(endRef, &endTile, &poly);
+	waypoints.clear();
+	waypoints.push_back(startRef);
+	// near enough: no need of the abstract graph
+	if ((abs(startTile->header->x - endTile->header->x) <= 1) &&
+			(abs(startTile->header->y - endTile->header->y) <= 1))
+	{
+		waypoints.push_back(endRef);
+		return true;
+	}
+
+	// costs from the start and towards the end, within their tiles
+	std::vector<float> startCosts, endCosts;
+	localCosts(startTile, startRef, spos, startCosts);
+	localCosts(endTile, endRef, epos, endCosts);
+
+	std::map<dtPolyRef, float> gCosts;
+	std::map<dtPolyRef, dtPolyRef> parents;
+	std::set<dtPolyRef> closed;
+	std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem> > open;
+	dtPolyRef current = 0;
+	auto relax = [&](dtPolyRef ref, float cost)
+	{
+		if (closed.count(ref))
+			return;
+		std::map<dtPolyRef, Node>::const_iterator node = m_nodes.find(ref);
+		if (node == m_nodes.end())
+			return;
+		std::map<dtPolyRef, float>::iterator g = gCosts.find(ref);
+		if ((g == gCosts.end()) || (cost < g->second))
+		{
+			gCosts[ref] = cost;
+			parents[ref] = current;
+			open.push(QueueItem(cost + dtVdist(node->second.pos, epos) * H_SCALE, ref));
+		}
+	};
+	// start portals (0 parent)
+	const dtPolyRef startBase = m_navMesh->getPolyRefBase(startTile);
+	for (int i = 0; i < startTile->header->polyCount; ++i)
+	{
+		if (startCosts[i] < FLT_MAX)
+			relax(startBase | (dtPolyRef) i, startCosts[i]);
+	}
+
+	float bestCost = FLT_MAX;
+	dtPolyRef bestLast = 0;
+	while (!open.empty())
+	{
+		const QueueItem item = open.top();
+		open.pop();
+		if (item.first >= bestCost)
+			break;
+		current = item.second;
+		if (!closed.insert(current).second)
+			continue;
+
+		const Node& node = m_nodes.find(current)->second;
+		const float g = gCosts[current];
+		const dtMeshTile* tile = 0;
+		m_navMesh->getTileAndPolyByRefUnsafe(current, &tile, &poly);
+		// reached the end tile
+		if (tile == endTile)
+		{
+			const float endCost = endCosts[m_navMesh->decodePolyIdPoly(current)];
+			if ((endCost < FLT_MAX) && (g + endCost < bestCost))
+			{
+				bestCost = g + endCost;
+				bestLast = current;
+			}
+		}
+		// intra-tile edges
+		for (int i = 0; i < (int) node.edges.size(); ++i)
+		{
+			relax(node.edges[i].first, g + node.edges[i].second);
+		}
+		// inter-tile edges: Detour's boundary links
+		for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+		{
+			const dtLink& link = tile->links[k];
+			if ((link.side == 0xff) || !link.ref)
+				continue;
+			std::map<dtPolyRef, Node>::const_iterator nei = m_nodes.find(link.ref);
+			if (nei != m_nodes.end())
+				relax(link.ref, g + dtVdist(node.pos, nei->second.pos) *
+						m_filter.getAreaCost(poly->getArea()));
+		}
+	}
+	if (!bestLast)
+		return false;
+
+	std::vector<dtPolyRef> reversed;
+	for (dtPolyRef ref = bestLast; ref; ref = parents[ref])
+	{
+		reversed.push_back(ref);
+	}
+	waypoints.insert(waypoints.end(), reversed.rbegin(), reversed.rend());
+	waypoints.push_back(endRef);
+	return true;
+}
+
+bool TileGraph::refine(const std::vector<dtPolyRef>& waypoints, const float* spos, const float* epos)
+{
+	static const int MAX_LOCAL_POLYS = 256;
+	dtPolyRef polys[MAX_LOCAL_POLYS];
+
+	m_corridor.clear();
+	m_corridor.push_back(waypoints[0]);
+	for (int i = 1; i < (int) waypoints.size(); ++i)
+	{
+		const dtPolyRef from = m_corridor.back(), to = waypoints[i];
+		if (from == to)
+			continue;
+		// adjacent portals of different tiles
+		if (areLinked(from, to))
+		{
+			m_corridor.push_back(to);
+			continue;
+		}
+		// search only inside the current tile (or few more)
+		const dtMeshTile* tile = 0;
+		const dtPoly* poly = 0;
+		float fromPos[3], toPos[3];
+		if (i == 1)
+		{
+			dtVcopy(fromPos, spos);
+		}
+		else
+		{
+			m_navMesh->getTileAndPolyByRefUnsafe(from, &tile, &poly);
+			getPolyCenter(tile, poly, fromPos);
+		}
+		if (i == (int) waypoints.size() - 1)
+		{
+			dtVcopy(toPos, epos);
+		}
+		else
+		{
+			m_navMesh->getTileAndPolyByRefUnsafe(to, &tile, &poly);
+			getPolyCenter(tile, poly, toPos);
+		}
+		int npolys = 0;
+		m_navQuery->findPath(from, to, fromPos, toPos, &m_filter, polys, &npolys, MAX_LOCAL_POLYS);
+		if (!npolys)
+			return false;
+		m_corridor.insert(m_corridor.end(), polys + 1, polys + npolys);
+		// partial: stop here
+		if (polys[npolys - 1] != to)
+			break;
+	}
+	return true;
+}
+
+bool TileGraph::areLinked(dtPolyRef from, dtPolyRef to) const
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	m_navMesh->getTileAndPolyByRefUnsafe(from, &tile, &poly);
+	for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+	{
+		if (tile->links[k].ref == to)
+			return true;
+	}
+	return false;
+}
+
+} // namespace rnsup
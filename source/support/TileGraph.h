@@ -0,0 +1,122 @@
+/**
+ * \file TileGraph.h
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#ifndef TILEGRAPH_H
+#define TILEGRAPH_H
+
+#include <DetourNavMesh.h>
+#include <DetourNavMeshQuery.h>
+#include <map>
+#include <vector>
+
+namespace rnsup
+{
+
+/**
+ * An abstract graph over the tiles of a dtNavMesh, for hierarchical path
+ * finding.
+ *
+ * The graph's nodes are the "portal" polygons, i.e. those with at least a
+ * link to another tile. Each node has edges towards the portals of its own
+ * tile, with costs precomputed by a Dijkstra search restricted to the tile,
+ * while the edges towards other tiles are the Detour's external links.\n
+ * findStraightPath() searches this graph first, then refines the result only
+ * through the crossed tiles with (short) dtNavMeshQuery::findPath() calls, so
+ * its cost grows with the number of tiles crossed rather than with the number
+ * of polygons.\n
+ * When tiles are rebuilt or removed, updateTile() should be called for each
+ * of them.
+ */
+class TileGraph
+{
+	struct Node
+	{
+		float pos[3];
+		///Intra-tile edges: (portal, cost).
+		std::vector<std::pair<dtPolyRef, float> > edges;
+	};
+	typedef std::pair<int, int> TileCoord;
+
+	const dtNavMesh* m_navMesh;
+	dtNavMeshQuery* m_navQuery;
+	dtQueryFilter m_filter;
+	float m_polyPickExt[3];
+
+	std::map<dtPolyRef, Node> m_nodes;
+	std::map<TileCoord, std::vector<dtPolyRef> > m_tileNodes;
+
+	std::vector<dtPolyRef> m_corridor;
+	std::vector<float> m_straightPath;
+	std::vector<unsigned char> m_straightPathFlags;
+	std::vector<dtPolyRef> m_straightPathPolys;
+
+public:
+	TileGraph();
+	~TileGraph();
+
+	bool init(const dtNavMesh* navMesh, const dtQueryFilter* filter, const int maxNodes = 2048);
+	const dtNavMesh* getNavMesh() const
+	{
+		return m_navMesh;
+	}
+	dtQueryFilter& getFilter()
+	{
+		return m_filter;
+	}
+
+	///Builds the graph for all the tiles.
+	void buildAll();
+	///Rebuilds the graph for the tile at (tx,ty) and for its neighbors.
+	void updateTile(int tx, int ty);
+	void clear();
+	int getNumNodes() const
+	{
+		return (int) m_nodes.size();
+	}
+
+	///Returns the number of straight path points.
+	int findStraightPath(const float* spos, const float* epos, const int options = 0);
+	const float* getStraightPath() const
+	{
+		return m_straightPath.empty() ? 0 : &m_straightPath[0];
+	}
+	const unsigned char* getStraightPathFlags() const
+	{
+		return m_straightPathFlags.empty() ? 0 : &m_straightPathFlags[0];
+	}
+	///The polygon corridor of the last path found.
+	int getNumCorridorPolys() const
+	{
+		return (int) m_corridor.size();
+	}
+
+private:
+	void removeTileNodes(int tx, int ty);
+	void buildTileNodes(int tx, int ty);
+	///dtQueryFilter::passFilter() is not visible outside Detour (when not virtual).
+	bool passFilter(const dtPoly* poly) const
+	{
+		return (poly->flags & m_filter.getIncludeFlags()) != 0 &&
+				(poly->flags & m_filter.getExcludeFlags()) == 0;
+	}
+	bool isPortal(const dtMeshTile* tile, const dtPoly* poly) const;
+	void getPolyCenter(const dtMeshTile* tile, const dtPoly* poly, float* center) const;
+	void localCosts(const dtMeshTile* tile, dtPolyRef startRef, const float* startPos,
+			std::vector<float>& costs) const;
+	bool findAbstractPath(dtPolyRef startRef, const float* spos, dtPolyRef endRef,
+			const float* epos, std::vector<dtPolyRef>& waypoints) const;
+	bool refine(const std::vector<dtPolyRef>& waypoints, const float* spos, const float* epos);
+	bool areLinked(dtPolyRef from, dtPolyRef to) const;
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	TileGraph(const TileGraph&);
+	TileGraph& operator=(const TileGraph&);
+};
+
+} // namespace rnsup
+
+#endif // TILEGRAPH_H
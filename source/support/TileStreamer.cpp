@@ -0,0 +1,349 @@
+/**
+ * \file TileStreamer.cpp
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#include "TileStreamer.h"
+#include "NavMeshType_Tile.h"
+#include <DetourAlloc.h>
+#include <DetourCommon.h>
+#include <algorithm>
+#include <math.h>
+
+namespace rnsup
+{
+
+TileStreamer::TileStreamer() :
+		m_navMesh(0), m_tileWidth(0.0f), m_tileHeight(0.0f), m_radius(0.0f),
+		m_tick(0), m_numResident(0), m_fp(0), m_quit(false)
+{
+	dtVset(m_orig, 0, 0, 0);
+}
+
+TileStreamer::~TileStreamer()
+{
+	close();
+}
+
+bool TileStreamer::open(const char* path, dtNavMesh* navMesh)
+{
+	close();
+	if (!navMesh)
+		return false;
+	FILE* fp = fopen(path, "rb");
+	if (!fp)
+		return false;
+
+	// the file must share the tiles' grid with the navigation mesh
+	NavMeshSetHeader header;
+	const dtNavMeshParams* params = navMesh->getParams();
+	if ((fread(&header, sizeof(NavMeshSetHeader), 1, fp) != 1)
+			|| (header.magic != NAVMESHSET_MAGIC)
+			|| (header.version != NAVMESHSET_VERSION)
+			|| (dtVdistSqr(header.params.orig, params->orig) > 1e-6f)
+			|| (fabsf(header.params.tileWidth - params->tileWidth) > 1e-3f)
+			|| (fabsf(header.params.tileHeight - params->tileHeight) > 1e-3f))
+	{
+		fclose(fp);
+		return false;
+	}
+
+	// index the tiles, skipping their data: a truncated or corrupt file is
+	// rejected as a whole
+	const long headerEnd = ftell(fp);
+	long fileSize = -1;
+	if (fseek(fp, 0, SEEK_END) == 0)
+		fileSize = ftell(fp);
+	bool valid = (headerEnd >= 0) && (fileSize >= 0)
+			&& (fseek(fp, headerEnd, SEEK_SET) == 0) && (header.numTiles >= 0);
+	for (int i = 0; valid && (i < header.numTiles); ++i)
+	{
+		valid = false;
+		NavMeshTileHeader tileHeader;
+		if (fread(&tileHeader, sizeof(tileHeader), 1, fp) != 1)
+			break;
+		if (!tileHeader.tileRef || (tileHeader.dataSize <= 0))
+			break;
+		Entry entry;
+		entry.offset = ftell(fp);
+		entry.dataSize = tileHeader.dataSize;
+		dtMeshHeader meshHeader;
+		if ((entry.offset < 0)
+				|| (entry.offset + (long) entry.dataSize > fileSize)
+				|| (tileHeader.dataSize < (int) sizeof(dtMeshHeader))
+				|| (fread(&meshHeader, sizeof(dtMeshHeader), 1, fp) != 1)
+				|| (meshHeader.magic != DT_NAVMESH_MAGIC)
+				|| (meshHeader.version != DT_NAVMESH_VERSION)
+				|| (fseek(fp, entry.offset + entry.dataSize, SEEK_SET) != 0))
+			break;
+		entry.polyCount = meshHeader.polyCount;
+		entry.x = meshHeader.x;
+		entry.y = meshHeader.y;
+		entry.ref = 0;
+		entry.state = TILE_NONE;
+		entry.wanted = entry.kept = 0;
+		m_tiles[std::make_pair(entry.x, entry.y)].push_back(
+				(int) m_entries.size());
+		m_entries.push_back(entry);
+		valid = true;
+	}
+	if (!valid)
+	{
+		fclose(fp);
+		m_entries.clear();
+		m_tiles.clear();
+		return false;
+	}
+
+	m_navMesh = navMesh;
+	dtVcopy(m_orig, params->orig);
+	m_tileWidth = params->tileWidth;
+	m_tileHeight = params->tileHeight;
+	m_fp = fp;
+	m_quit = false;
+	m_thread = std::thread(&TileStreamer::loaderLoop, this);
+	return true;
+}
+
+void TileStreamer::close()
+{
+	if (m_thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_cond.notify_all();
+		m_thread.join();
+	}
+	for (size_t i = 0; i < m_loaded.size(); ++i)
+		dtFree(m_loaded[i].data);
+	m_loaded.clear();
+	m_requests.clear();
+	if (m_fp)
+	{
+		fclose(m_fp);
+		m_fp = 0;
+	}
+	m_entries.clear();
+	m_tiles.clear();
+	m_active.clear();
+	m_numResident = 0;
+	m_navMesh = 0;
+}
+
+void TileStreamer::update(const float* anchors, const int numAnchors,
+		std::vector<int>& changedTiles)
+{
+	changedTiles.clear();
+	if (!m_navMesh)
+		return;
+
+	++m_tick;
+	std::vector<std::pair<float, int> > candidates;
+	for (int i = 0; i < numAnchors; ++i)
+		markTiles(&anchors[i * 3], candidates);
+	requestTiles(candidates);
+	evictTiles(changedTiles);
+	addLoadedTiles(changedTiles);
+
+	// forget the entries back to none
+	int n = 0;
+	for (size_t i = 0; i < m_active.size(); ++i)
+	{
+		if (m_entries[m_active[i]].state != TILE_NONE)
+			m_active[n++] = m_active[i];
+	}
+	m_active.resize(n);
+}
+
+int TileStreamer::getNumPendingTiles() const
+{
+	int numPending = 0;
+	for (size_t i = 0; i < m_active.size(); ++i)
+	{
+		if (m_entries[m_active[i]].state == TILE_REQUESTED)
+			++numPending;
+	}
+	return numPending;
+}
+
+void TileStreamer::markTiles(const float* pos,
+		std::vector<std::pair<float, int> >& candidates)
+{
+	// tiles are kept up to a tile size farther than they are wanted
+	const float keepRadius = m_radius + dtMax(m_tileWidth, m_tileHeight);
+	const int x0 = (int) floorf((pos[0] - keepRadius - m_orig[0]) / m_tileWidth);
+	const int x1 = (int) floorf((pos[0] + keepRadius - m_orig[0]) / m_tileWidth);
+	const int y0 = (int) floorf((pos[2] - keepRadius - m_orig[2]) / m_tileHeight);
+	const int y1 = (int) floorf((pos[2] + keepRadius - m_orig[2]) / m_tileHeight);
+	for (int y = y0; y <= y1; ++y)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			std::map<std::pair<int, int>, std::vector<int> >::const_iterator iter =
+					m_tiles.find(std::make_pair(x, y));
+			if (iter == m_tiles.end())
+				continue;
+			// distance (x,z) from the tile's rectangle
+			const float minX = m_orig[0] + x * m_tileWidth;
+			const float minZ = m_orig[2] + y * m_tileHeight;
+			const float dx = dtMax(dtMax(minX - pos[0], pos[0] - (minX + m_tileWidth)), 0.0f);
+			const float dz = dtMax(dtMax(minZ - pos[2], pos[2] - (minZ + m_tileHeight)), 0.0f);
+			const float distSqr = dx * dx + dz * dz;
+			if (distSqr > keepRadius * keepRadius)
+				continue;
+			const std::vector<int>& layers = iter->second;
+			for (size_t i = 0; i < layers.size(); ++i)
+			{
+				Entry& entry = m_entries[layers[i]];
+				entry.kept = m_tick;
+				if ((distSqr <= m_radius * m_radius) && (entry.wanted != m_tick))
+				{
+					entry.wanted = m_tick;
+					candidates.push_back(std::make_pair(distSqr, layers[i]));
+				}
+			}
+		}
+	}
+}
+
+void TileStreamer::requestTiles(std::vector<std::pair<float, int> >& candidates)
+{
+	// nearest first
+	std::sort(candidates.begin(), candidates.end());
+	std::vector<int> requests;
+	const int maxPolys = m_navMesh->getParams()->maxPolys;
+	for (size_t i = 0; i < candidates.size(); ++i)
+	{
+		const int index = candidates[i].second;
+		Entry& entry = m_entries[index];
+		if (entry.state == TILE_CANCELLED)
+		{
+			// still being read: take it back
+			entry.state = TILE_REQUESTED;
+		}
+		else if (entry.state == TILE_NONE)
+		{
+			// the tile's polygons must fit in the navigation mesh's refs
+			entry.state = entry.polyCount <= maxPolys ?
+					TILE_REQUESTED : TILE_FAILED;
+			m_active.push_back(index);
+			if (entry.state == TILE_REQUESTED)
+				requests.push_back(index);
+		}
+	}
+	if (requests.empty())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_requests.insert(m_requests.end(), requests.begin(), requests.end());
+	}
+	m_cond.notify_one();
+}
+
+void TileStreamer::evictTiles(std::vector<int>& changedTiles)
+{
+	std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
+	for (size_t i = 0; i < m_active.size(); ++i)
+	{
+		Entry& entry = m_entries[m_active[i]];
+		if (entry.kept == m_tick)
+			continue;
+		if (entry.state == TILE_RESIDENT)
+		{
+			m_navMesh->removeTile(entry.ref, 0, 0);
+			entry.ref = 0;
+			entry.state = TILE_NONE;
+			--m_numResident;
+			changedTiles.push_back(entry.x);
+			changedTiles.push_back(entry.y);
+		}
+		else if (entry.state == TILE_REQUESTED)
+		{
+			// drop the request if not yet taken by the loader
+			if (!lock.owns_lock())
+				lock.lock();
+			std::deque<int>::iterator iter = std::find(m_requests.begin(),
+					m_requests.end(), m_active[i]);
+			if (iter != m_requests.end())
+			{
+				m_requests.erase(iter);
+				entry.state = TILE_NONE;
+			}
+			else
+				entry.state = TILE_CANCELLED;
+		}
+		else if (entry.state == TILE_FAILED)
+			entry.state = TILE_NONE;
+	}
+}
+
+void TileStreamer::addLoadedTiles(std::vector<int>& changedTiles)
+{
+	std::vector<LoadedTile> loaded;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		loaded.swap(m_loaded);
+	}
+	for (size_t i = 0; i < loaded.size(); ++i)
+	{
+		Entry& entry = m_entries[loaded[i].entry];
+		if (entry.state == TILE_CANCELLED)
+		{
+			dtFree(loaded[i].data);
+			entry.state = TILE_NONE;
+			continue;
+		}
+		dtTileRef ref = 0;
+		if (!loaded[i].data
+				|| dtStatusFailed(m_navMesh->addTile(loaded[i].data,
+						entry.dataSize, DT_TILE_FREE_DATA, 0, &ref)))
+		{
+			// i.e. no free tiles, or a tile already there
+			dtFree(loaded[i].data);
+			entry.state = TILE_FAILED;
+			continue;
+		}
+		entry.ref = ref;
+		entry.state = TILE_RESIDENT;
+		++m_numResident;
+		changedTiles.push_back(entry.x);
+		changedTiles.push_back(entry.y);
+	}
+}
+
+void TileStreamer::loaderLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		while (!m_quit && m_requests.empty())
+			m_cond.wait(lock);
+		if (m_quit)
+			break;
+		LoadedTile tile;
+		tile.entry = m_requests.front();
+		m_requests.pop_front();
+		// offsets and sizes are read-only while open
+		const long offset = m_entries[tile.entry].offset;
+		const int dataSize = m_entries[tile.entry].dataSize;
+		lock.unlock();
+
+		tile.data = (unsigned char*) dtAlloc(dataSize, DT_ALLOC_PERM);
+		if (tile.data
+				&& ((fseek(m_fp, offset, SEEK_SET) != 0)
+						|| (fread(tile.data, dataSize, 1, m_fp) != 1)))
+		{
+			dtFree(tile.data);
+			tile.data = 0;
+		}
+
+		lock.lock();
+		m_loaded.push_back(tile);
+	}
+}
+
+} // namespace rnsup
@@ -0,0 +1,139 @@
+/**
+ * \file TileStreamer.h
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#ifndef TILESTREAMER_H
+#define TILESTREAMER_H
+
+#include <DetourNavMesh.h>
+#include <stdio.h>
+#include <map>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace rnsup
+{
+
+/**
+ * Streams the tiles of a navigation mesh from a tile set file (see
+ * NavMeshType_Tile::saveAll()) around a set of anchor points.
+ *
+ * open() reads only the file's index: then each update() requests the tiles
+ * within the radius of any anchor, nearest first, which are read by a loader
+ * thread and added to the navigation mesh by the next update() calls, and
+ * removes the resident tiles farther than the radius plus a tile size (to
+ * avoid thrashing at the boundary) from all the anchors.\n
+ * The navigation mesh must have the same origin and tile sizes as the file's
+ * one, while its maximum number of tiles bounds only the resident tiles.
+ * \note The navigation mesh is accessed by the calling thread only.
+ */
+class TileStreamer
+{
+	enum TileState
+	{
+		TILE_NONE = 0,
+		TILE_REQUESTED,
+		///Out of range while being read: its data will be discarded.
+		TILE_CANCELLED,
+		TILE_RESIDENT,
+		///Couldn't be added: not retried until it goes out of range.
+		TILE_FAILED
+	};
+
+	struct Entry
+	{
+		long offset;
+		int dataSize;
+		int polyCount;
+		int x, y;
+		dtTileRef ref;
+		unsigned char state;
+		///Last update() which wanted and kept it in range.
+		unsigned int wanted, kept;
+	};
+
+	struct LoadedTile
+	{
+		int entry;
+		unsigned char* data;
+	};
+
+	dtNavMesh* m_navMesh;
+	float m_orig[3];
+	float m_tileWidth, m_tileHeight;
+	float m_radius;
+	std::vector<Entry> m_entries;
+	///Entries indices by tile coordinates (one per layer).
+	std::map<std::pair<int, int>, std::vector<int> > m_tiles;
+	///Entries not in TILE_NONE state.
+	std::vector<int> m_active;
+	unsigned int m_tick;
+	int m_numResident;
+
+	///Loader thread's state (guarded by m_mutex).
+	FILE* m_fp;
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::deque<int> m_requests;
+	std::vector<LoadedTile> m_loaded;
+	bool m_quit;
+
+public:
+	TileStreamer();
+	~TileStreamer();
+
+	bool open(const char* path, dtNavMesh* navMesh);
+	///Stops streaming: resident tiles are left in the navigation mesh.
+	void close();
+	bool isOpen() const
+	{
+		return m_navMesh != 0;
+	}
+
+	void setRadius(float radius)
+	{
+		m_radius = radius > 0.0f ? radius : 0.0f;
+	}
+	float getRadius() const
+	{
+		return m_radius;
+	}
+
+	///Gets the (x,y) pairs of the tiles added or removed by this call into
+	///changedTiles.
+	void update(const float* anchors, const int numAnchors,
+			std::vector<int>& changedTiles);
+
+	int getNumTiles() const
+	{
+		return (int) m_entries.size();
+	}
+	int getNumResidentTiles() const
+	{
+		return m_numResident;
+	}
+	int getNumPendingTiles() const;
+
+private:
+	void markTiles(const float* pos,
+			std::vector<std::pair<float, int> >& candidates);
+	void requestTiles(std::vector<std::pair<float, int> >& candidates);
+	void evictTiles(std::vector<int>& changedTiles);
+	void addLoadedTiles(std::vector<int>& changedTiles);
+	void loaderLoop();
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	TileStreamer(const TileStreamer&);
+	TileStreamer& operator=(const TileStreamer&);
+};
+
+} // namespace rnsup
+
+#endif // TILESTREAMER_H
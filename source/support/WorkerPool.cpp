@@ -0,0 +1,138 @@
+/**
+ * \file WorkerPool.cpp
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#include "WorkerPool.h"
+
+namespace rnsup
+{
+
+WorkerPool::WorkerPool(int numWorkers) :
+		m_job(0), m_count(0), m_next(0), m_pending(0), m_generation(0),
+		m_quit(false)
+{
+	start(numWorkers);
+}
+
+WorkerPool::~WorkerPool()
+{
+	stop();
+}
+
+void WorkerPool::setNumWorkers(int numWorkers)
+{
+	std::lock_guard<std::recursive_mutex> callerLock(m_callerMutex);
+	stop();
+	start(numWorkers);
+}
+
+void WorkerPool::start(int numWorkers)
+{
+	if (numWorkers <= 0)
+	{
+		numWorkers = (int) std::thread::hardware_concurrency();
+		if (numWorkers <= 0)
+		{
+			numWorkers = 1;
+		}
+	}
+	m_quit = false;
+	// worker 0 is the calling thread
+	for (int w = 1; w < numWorkers; ++w)
+	{
+		m_threads.push_back(
+				std::thread(&WorkerPool::workerLoop, this, w, m_generation));
+	}
+}
+
+void WorkerPool::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_wakeCond.notify_all();
+	for (size_t i = 0; i < m_threads.size(); ++i)
+	{
+		m_threads[i].join();
+	}
+	m_threads.clear();
+}
+
+void WorkerPool::parallelFor(int count, const Job& job)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+	// wait for the other callers: the (job's) workers' scratch data are
+	// shared too
+	std::lock_guard<std::recursive_mutex> callerLock(m_callerMutex);
+	// no need to wake up anyone
+	if (m_threads.empty() || (count == 1))
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			job(i, 0);
+		}
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_job = &job;
+		m_count = count;
+		m_pending = (int) m_threads.size();
+		m_next.store(0);
+		++m_generation;
+	}
+	m_wakeCond.notify_all();
+	runJob(0);
+	// wait for the other workers
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_pending > 0)
+	{
+		m_doneCond.wait(lock);
+	}
+	m_job = 0;
+}
+
+void WorkerPool::workerLoop(int worker, unsigned int generation)
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while ((!m_quit) && (m_generation == generation))
+			{
+				m_wakeCond.wait(lock);
+			}
+			if (m_quit)
+			{
+				return;
+			}
+			generation = m_generation;
+		}
+		runJob(worker);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (--m_pending == 0)
+			{
+				m_doneCond.notify_one();
+			}
+		}
+	}
+}
+
+void WorkerPool::runJob(int worker)
+{
+	int index;
+	while ((index = m_next.fetch_add(1)) < m_count)
+	{
+		(*m_job)(index, worker);
+	}
+}
+
+} // namespace rnsup
@@ -0,0 +1,93 @@
+/**
+ * \file WorkerPool.h
+ *
+ * \date 2026-10-17
+ * \author consultit
+ */
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace rnsup
+{
+
+/**
+ * A minimal pool of persistent worker threads.
+ *
+ * The only operation is parallelFor(), which runs a job over the indexes
+ * [0, count) and returns when all of them have been processed: the calling
+ * thread takes part in the work as worker 0, so a pool with a single worker
+ * has no extra thread and runs everything sequentially.\n
+ * The job receives the index and the worker number (in [0, getNumWorkers())),
+ * which can be used to select per-worker scratch data without locking.
+ *
+ * Callers on different threads take turns: parallelFor() holds the pool (see
+ * lock()) for the whole dispatch and wait. A caller that sizes per-worker
+ * scratch data by getNumWorkers(), or needs several parallelFor() in a row
+ * without other callers in between, holds the pool itself across them (i.e.
+ * with a std::lock_guard<WorkerPool>): the lock is recursive.
+ * \note A job must not call parallelFor() (it would deadlock).
+ */
+class WorkerPool
+{
+public:
+	typedef std::function<void(int index, int worker)> Job;
+
+	WorkerPool(int numWorkers = 0);
+	~WorkerPool();
+
+	///Restarts the pool with the given number of workers (<=0 means one per
+	///hardware thread).
+	void setNumWorkers(int numWorkers);
+	int getNumWorkers() const
+	{
+		return (int) m_threads.size() + 1;
+	}
+
+	void parallelFor(int count, const Job& job);
+
+	///Holds the pool, so that only the calling thread can use it.
+	void lock()
+	{
+		m_callerMutex.lock();
+	}
+	void unlock()
+	{
+		m_callerMutex.unlock();
+	}
+
+private:
+	void start(int numWorkers);
+	void stop();
+	void workerLoop(int worker, unsigned int generation);
+	void runJob(int worker);
+
+	std::vector<std::thread> m_threads;
+	///Serializes the callers (of parallelFor() and setNumWorkers()).
+	std::recursive_mutex m_callerMutex;
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCond;
+	std::condition_variable m_doneCond;
+	///Current job state (guarded by m_mutex, except the next index to claim).
+	const Job* m_job;
+	int m_count;
+	std::atomic<int> m_next;
+	int m_pending;
+	unsigned int m_generation;
+	bool m_quit;
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	WorkerPool(const WorkerPool&);
+	WorkerPool& operator=(const WorkerPool&);
+};
+
+} // namespace rnsup
+
+#endif // WORKERPOOL_H
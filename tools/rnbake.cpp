@@ -0,0 +1,185 @@
+/**
+ * \file rnbake.cpp
+ *
+ * \date 2026-10-17
+ * \author consultit
+ *
+ * Headless navigation mesh baker.
+ *
+ * Builds the navigation mesh of a model (.egg, .bam, or any other format the
+ * Panda3D loader supports, like .obj), without opening any window, and writes
+ * it to a baked file (see RNNavMesh::save_baked_nav_mesh()), or to a bam file
+ * (with the built data) if the output file has the .bam extension.
+ * It is built only if the BUILD_RNBAKE CMake option is on (it is off by
+ * default, see CMakeLists.txt).
+ *
+ * The build settings are the RNNavMesh text parameters (see RNNavMesh), read
+ * from a config file with one "parameter_name value" per line: parameters of
+ * the multiple type can be repeated, lines beginning with '#' are comments.
+ * For example:
+ * \code
+ * navmesh_type tile
+ * cell_size 0.2
+ * tile_size 64
+ * build_all_tiles true
+ * convex_volume -1.0,-1.0,0.0:1.0,-1.0,0.0:1.0,1.0,0.0:-1.0,1.0,0.0@1
+ * tile_build_cache_dir navmesh_cache
+ * \endcode
+ */
+
+#include <loader.h>
+#include <filename.h>
+#include <clockObject.h>
+#include <rnNavMeshManager.h>
+#include <rnNavMesh.h>
+#include <fstream>
+#include <map>
+#include <stdlib.h>
+
+///Reads the "parameter_name value" lines of the config file.
+static bool read_config(const string& fileName,
+		std::map<string, ValueList<string> >& params)
+{
+	std::ifstream config(Filename(fileName).to_os_specific().c_str());
+	if (!config)
+	{
+		return false;
+	}
+	string line;
+	while (std::getline(config, line))
+	{
+		const string whitespace(" \t\r");
+		size_t begin = line.find_first_not_of(whitespace);
+		if ((begin == string::npos) || (line[begin] == '#'))
+		{
+			continue;
+		}
+		size_t nameEnd = line.find_first_of(whitespace, begin);
+		string name = line.substr(begin, nameEnd - begin);
+		string value;
+		if (nameEnd != string::npos)
+		{
+			size_t valueBegin = line.find_first_not_of(whitespace, nameEnd);
+			size_t valueEnd = line.find_last_not_of(whitespace);
+			if (valueBegin != string::npos)
+			{
+				value = line.substr(valueBegin, valueEnd - valueBegin + 1);
+			}
+		}
+		params[name].add_value(value);
+	}
+	return true;
+}
+
+static void usage(const char* program)
+{
+	cerr << "usage: " << program
+			<< " [-c config] [-j threads] model output" << endl
+			<< "  -c config   RNNavMesh text parameters' file" << endl
+			<< "  -j threads  build threads (default: one per hardware thread)"
+			<< endl
+			<< "  model       .egg, .bam or any other loadable model" << endl
+			<< "  output      baked navigation mesh file, or a .bam file"
+			<< endl;
+}
+
+int main(int argc, char *argv[])
+{
+	string configFile, modelFile, outputFile;
+	int numThreads = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg(argv[i]);
+		if ((arg == "-c") && (i + 1 < argc))
+		{
+			configFile = argv[++i];
+		}
+		else if ((arg == "-j") && (i + 1 < argc))
+		{
+			numThreads = strtol(argv[++i], NULL, 0);
+		}
+		else if (modelFile.empty())
+		{
+			modelFile = arg;
+		}
+		else if (outputFile.empty())
+		{
+			outputFile = arg;
+		}
+		else
+		{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (modelFile.empty() || outputFile.empty())
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	std::map<string, ValueList<string> > params;
+	if ((!configFile.empty()) && (!read_config(configFile, params)))
+	{
+		cerr << "cannot read config file '" << configFile << "'" << endl;
+		return 1;
+	}
+
+	/// the manager without any scene: RNNavMesh(es) are just built and saved
+	PT(RNNavMeshManager)navMeshMgr = new RNNavMeshManager();
+	navMeshMgr->set_num_worker_threads(numThreads);
+	for (std::map<string, ValueList<string> >::const_iterator iter =
+			params.begin(); iter != params.end(); ++iter)
+	{
+		navMeshMgr->set_parameter_values(RNNavMeshManager::NAVMESH,
+				iter->first, iter->second);
+	}
+
+	PT(PandaNode)modelNode = Loader::get_global_ptr()->load_sync(
+			Filename(modelFile));
+	if (!modelNode)
+	{
+		cerr << "cannot load model '" << modelFile << "'" << endl;
+		return 1;
+	}
+	NodePath modelNP(modelNode);
+	modelNP.reparent_to(navMeshMgr->get_reference_node_path());
+
+	NodePath navMeshNP = navMeshMgr->create_nav_mesh();
+	PT(RNNavMesh)navMesh = DCAST(RNNavMesh, navMeshNP.node());
+	navMesh->set_owner_node_path(modelNP);
+	const bool toBam = Filename(outputFile).get_extension() == "bam";
+	navMesh->set_save_built_data(toBam);
+
+	double startTime = ClockObject::get_global_clock()->get_real_time();
+	if (navMesh->setup() != RN_SUCCESS)
+	{
+		cerr << "cannot build the navigation mesh of '" << modelFile << "'"
+				<< endl;
+		return 1;
+	}
+	cout << "built '" << modelFile << "' in "
+			<< ClockObject::get_global_clock()->get_real_time() - startTime
+			<< " s, with " << navMeshMgr->get_num_worker_threads()
+			<< " threads" << endl;
+
+	bool saved;
+	if (toBam)
+	{
+		saved = navMeshMgr->write_to_bam_file(outputFile);
+	}
+	else
+	{
+		// baked files are for SOLO and TILE types only
+		saved = navMesh->save_baked_nav_mesh(outputFile) == RN_SUCCESS;
+	}
+	if (!saved)
+	{
+		cerr << "cannot write '" << outputFile << "'" << endl;
+		return 1;
+	}
+	cout << "written '" << outputFile << "'" << endl;
+
+	navMeshMgr->destroy_nav_mesh(navMeshNP);
+	return 0;
+}
@@ -0,0 +1,153 @@
+/**
+ * \file rncompressbench.cpp
+ *
+ * \date 2026-10-17
+ * \author consultit
+ *
+ * Tile cache compression benchmark.
+ *
+ * Builds the OBSTACLE navigation mesh of a model (by default
+ * samples/data/dungeon.egg) with each of the tile cache compressors (see the
+ * tile_cache_compressor RNNavMesh text parameter), and reports for each one:
+ * - the compression ratio of the tile cache's layers (uncompressed over
+ * compressed size);
+ * - the rebuild throughput, i.e. how fast all the navigation mesh tiles are
+ * rebuilt from the compressed layers (each layer is decompressed and its tile
+ * built, as when obstacles change): the navigation mesh is saved with its
+ * built data into a temporary bam file, which is then read back a number of
+ * times, timing the restore.
+ */
+
+#include <loader.h>
+#include <filename.h>
+#include <rnNavMeshManager.h>
+#include <rnNavMesh.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+static void usage(const char* program)
+{
+	cerr << "usage: " << program << " [-j threads] [-n runs] [-t tile_size] [model]"
+			<< endl
+			<< "  -j threads    build threads (default: one per hardware thread)"
+			<< endl
+			<< "  -n runs       rebuilds per compressor (default: 5)" << endl
+			<< "  -t tile_size  tile size in cells (default: 32)" << endl
+			<< "  model         .egg, .bam or any other loadable model (default: "
+			<< "samples/data/dungeon.egg)" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+	string modelFile("samples/data/dungeon.egg"), tileSize("32");
+	int numThreads = 0, numRuns = 5;
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg(argv[i]);
+		if ((arg == "-j") && (i + 1 < argc))
+		{
+			numThreads = strtol(argv[++i], NULL, 0);
+		}
+		else if ((arg == "-n") && (i + 1 < argc))
+		{
+			numRuns = strtol(argv[++i], NULL, 0);
+		}
+		else if ((arg == "-t") && (i + 1 < argc))
+		{
+			tileSize = argv[++i];
+		}
+		else if ((!arg.empty()) && (arg[0] != '-'))
+		{
+			modelFile = arg;
+		}
+		else
+		{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (numRuns < 1)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	/// the manager without any scene: RNNavMesh(es) are just built and timed
+	PT(RNNavMeshManager)navMeshMgr = new RNNavMeshManager();
+	navMeshMgr->set_num_worker_threads(numThreads);
+	navMeshMgr->set_parameter_value(RNNavMeshManager::NAVMESH,
+			"navmesh_type", "obstacle");
+	navMeshMgr->set_parameter_value(RNNavMeshManager::NAVMESH, "tile_size",
+			tileSize);
+
+	PT(PandaNode)modelNode = Loader::get_global_ptr()->load_sync(
+			Filename(modelFile));
+	if (!modelNode)
+	{
+		cerr << "cannot load model '" << modelFile << "'" << endl;
+		return 1;
+	}
+	NodePath modelNP(modelNode);
+	const Filename bamFile = Filename::temporary("", "rncompressbench",
+			".bam");
+
+	const char* compressors[] = { "fast", "dense" };
+	printf("%-11s %8s %12s %12s %7s %10s %12s %12s %12s\n", "compressor",
+			"layers", "raw (B)", "compr. (B)", "ratio", "build (ms)",
+			"rebuild (ms)", "layers/s", "raw MB/s");
+	for (int c = 0; c < 2; ++c)
+	{
+		navMeshMgr->set_parameter_value(RNNavMeshManager::NAVMESH,
+				"tile_cache_compressor", compressors[c]);
+
+		// build: the layers are rasterized and compressed
+		modelNP.reparent_to(navMeshMgr->get_reference_node_path());
+		NodePath navMeshNP = navMeshMgr->create_nav_mesh();
+		PT(RNNavMesh)navMesh = DCAST(RNNavMesh, navMeshNP.node());
+		navMesh->set_owner_node_path(modelNP);
+		navMesh->set_save_built_data(true);
+		if (navMesh->setup() != RN_SUCCESS)
+		{
+			cerr << "cannot build the navigation mesh of '" << modelFile
+					<< "'" << endl;
+			return 1;
+		}
+		const RNNavMeshStats stats = navMesh->get_stats();
+		if (!navMeshMgr->write_to_bam_file(bamFile.get_fullpath()))
+		{
+			cerr << "cannot write '" << bamFile << "'" << endl;
+			return 1;
+		}
+		navMeshMgr->destroy_nav_mesh(navMeshNP);
+
+		// rebuild: the tiles are restored from the compressed layers
+		float rebuildTime = 0.0;
+		for (int r = 0; r < numRuns; ++r)
+		{
+			if (!navMeshMgr->read_from_bam_file(bamFile.get_fullpath()))
+			{
+				cerr << "cannot read '" << bamFile << "'" << endl;
+				return 1;
+			}
+			PT(RNNavMesh)restored = navMeshMgr->get_nav_mesh(
+					navMeshMgr->get_num_nav_meshes() - 1);
+			rebuildTime += restored->get_stats().get_build_time();
+			navMeshMgr->destroy_nav_mesh(NodePath::any_path(restored));
+		}
+		rebuildTime /= numRuns;
+
+		const int rawSize = stats.get_cache_raw_size();
+		const int compressedSize = stats.get_cache_compressed_size();
+		printf("%-11s %8d %12d %12d %7.2f %10.1f %12.1f %12.0f %12.1f\n",
+				compressors[c], stats.get_num_cache_layers(), rawSize,
+				compressedSize,
+				compressedSize ? (float) rawSize / compressedSize : 0.0f,
+				stats.get_build_time(), rebuildTime,
+				rebuildTime > 0.0 ?
+						stats.get_num_cache_layers() * 1000.0 / rebuildTime : 0.0,
+				rebuildTime > 0.0 ? rawSize / (rebuildTime * 1000.0) : 0.0);
+	}
+	bamFile.unlink();
+	return 0;
+}